@@ -0,0 +1,81 @@
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "utility/BenchmarkComparison.h"
+
+// compares two benchmark runs, see BenchmarkComparison
+// exit code: 0 no regression, 1 at least one regression, 2 invalid arguments or unreadable input
+namespace
+{
+    void printUsage()
+    {
+        std::cerr << "usage: benchcompare <baseline> <candidate> [--threshold <fraction>] [--alpha <p>] [--confidence <level>] [--bootstrap <iterations>]\n"
+            "  baseline/candidate: a report written by --benchmark (.json) or a folder of timer CSVs\n";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        printUsage();
+        return 2;
+    }
+
+    BenchmarkComparison::Settings settings;
+    BenchmarkComparison::Samples baseline;
+    BenchmarkComparison::Samples candidate;
+    try
+    {
+        for (int i = 3; i < argc; i += 2)
+        {
+            const std::string argument = argv[i];
+            if (i + 1 >= argc)
+                throw std::runtime_error("Missing value for " + argument);
+            const std::string value = argv[i + 1];
+
+            if (argument == "--threshold")
+                settings.threshold = std::stof(value);
+            else if (argument == "--alpha")
+                settings.alpha = std::stod(value);
+            else if (argument == "--confidence")
+                settings.confidence = std::stod(value);
+            else if (argument == "--bootstrap")
+                settings.bootstrapIterations = static_cast<uint32_t>(std::stoul(value));
+            else
+                throw std::runtime_error("Unknown argument " + argument);
+        }
+
+        baseline = BenchmarkComparison::load(argv[1]);
+        candidate = BenchmarkComparison::load(argv[2]);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        printUsage();
+        return 2;
+    }
+
+    const auto results = BenchmarkComparison::compare(baseline, candidate, settings);
+    if (results.empty())
+    {
+        std::cerr << "The runs have no series in common" << std::endl;
+        return 2;
+    }
+
+    std::printf("%-34s %10s %10s %9s %22s %10s\n", "series", "base (ms)", "cand (ms)", "delta", "median delta CI (ms)", "p");
+    int regressions = 0;
+    for (const auto& result : results)
+    {
+        const char* verdict = result.regression ? "REGRESSION" : result.improvement ? "improvement" : "";
+        std::printf("%-34s %10.3f %10.3f %+8.1f%% [%+9.3f, %+9.3f] %10.2g %s\n", result.name.c_str(), result.baselineMedian, result.candidateMedian,
+            100.0 * result.relativeDelta, result.deltaLow, result.deltaHigh, result.pValue, verdict);
+        if (result.regression)
+            regressions++;
+    }
+
+    std::printf("%d regression(s) above %.1f%% at alpha %.3g\n", regressions, 100.0 * settings.threshold, settings.alpha);
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "geometry/BlasPartition.h"
+#include "geometry/Bvh.h"
+#include "geometry/SceneBvh.h"
+#include "geometry/PBRScene.h"
+
+// builds the two level hierarchy of a scene on the CPU for each BLAS partition and compares their quality,
+// and measures the build speed of the binned SAH builder on a synthetic soup of millions of triangles
+namespace
+{
+    void printUsage()
+    {
+        std::cerr << "usage: bvhbench [<scene>] [--partition <policy>]... [--bins <n>] [--leaf <n>] [--threads <n>] [--repeat <n>] [--triangles <millions>]\n"
+            "  scene: path relative to the resources folder, without one only the synthetic build is measured\n"
+            "  policy: per-mesh or spatial[:<cells per axis>[:<max triangles>]], default both per-mesh and spatial\n"
+            "  triangles: size of the synthetic triangle soup, 0 skips it\n";
+    }
+
+    template <typename Function>
+    float measureMin(const uint32_t repeat, Function&& function)
+    {
+        float best = std::numeric_limits<float>::max();
+        for (uint32_t i = 0; i < repeat; i++)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            best = std::min(best, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        return best;
+    }
+
+    void printBvhStats(const char* name, const BvhStats& stats)
+    {
+        std::printf("  %-12s nodes %9u  leaves %9u  depth %3u  SAH %9.2f  overlap %8.3f (node avg %.3f)  leaf size %u..%u avg %.2f  %8.2f MB\n", name,
+            stats.nodeCount, stats.leafCount, stats.maxDepth, stats.sahCost, stats.overlap, stats.averageNodeOverlap,
+            stats.minLeafSize, stats.maxLeafSize, stats.averageLeafSize, static_cast<double>(stats.memoryBytes) / (1024.0 * 1024.0));
+    }
+
+    void benchmarkScene(const std::string& sceneFile, const std::vector<BlasPartitionPolicy>& policies, const BvhBuildSettings& settings, const uint32_t repeat)
+    {
+        const PBRScene scene(sceneFile);
+        for (const auto& policy : policies)
+        {
+            const BlasPartition partition(scene, policy, {});
+            SceneBvh bvh;
+            const float milliseconds = measureMin(repeat, [&] { bvh = SceneBvh(scene, partition, settings); });
+            const auto stats = bvh.computeStats();
+
+            // the bottom levels as one, costs relative to their roots are weighted by the triangles they hold
+            BvhStats bottomLevels;
+            bottomLevels.minLeafSize = std::numeric_limits<uint32_t>::max();
+            uint32_t innerNodes = 0;
+            for (size_t i = 0; i < stats.bottomLevels.size(); i++)
+            {
+                const auto& bottomLevel = stats.bottomLevels.at(i);
+                const float weight = static_cast<float>(bvh.getBottomLevels().at(i).bvh.getPrimitiveCount()) / static_cast<float>(std::max(1u, stats.triangleCount));
+                bottomLevels.nodeCount += bottomLevel.nodeCount;
+                bottomLevels.leafCount += bottomLevel.leafCount;
+                bottomLevels.maxDepth = std::max(bottomLevels.maxDepth, bottomLevel.maxDepth);
+                bottomLevels.sahCost += weight * bottomLevel.sahCost;
+                bottomLevels.overlap += weight * bottomLevel.overlap;
+                bottomLevels.averageNodeOverlap += bottomLevel.averageNodeOverlap * static_cast<float>(bottomLevel.nodeCount - bottomLevel.leafCount);
+                innerNodes += bottomLevel.nodeCount - bottomLevel.leafCount;
+                if (bottomLevel.leafCount > 0)
+                    bottomLevels.minLeafSize = std::min(bottomLevels.minLeafSize, bottomLevel.minLeafSize);
+                bottomLevels.maxLeafSize = std::max(bottomLevels.maxLeafSize, bottomLevel.maxLeafSize);
+                bottomLevels.memoryBytes += bottomLevel.memoryBytes;
+            }
+            if (bottomLevels.leafCount == 0)
+                bottomLevels.minLeafSize = 0;
+            bottomLevels.averageNodeOverlap /= static_cast<float>(std::max(1u, innerNodes));
+            bottomLevels.averageLeafSize = static_cast<float>(stats.triangleCount) / static_cast<float>(std::max(1u, bottomLevels.leafCount));
+
+            std::printf("%s: %zu BLAS, %u triangles, %.2f ms (BLAS %.2f, TLAS %.2f), %.2f Mtris/s\n", policy.toString().c_str(), stats.bottomLevels.size(), stats.triangleCount,
+                milliseconds, stats.bottomLevelBuildMilliseconds, stats.topLevelBuildMilliseconds, static_cast<double>(stats.triangleCount) / (1000.0 * milliseconds));
+            std::printf("  two level SAH %.2f, instances entered per ray %.2f, %.2f MB\n", stats.sahCost, stats.instanceVisits, static_cast<double>(stats.memoryBytes) / (1024.0 * 1024.0));
+            printBvhStats("TLAS", stats.topLevel);
+            printBvhStats("BLAS (all)", bottomLevels);
+        }
+    }
+
+    // small random triangles in a cube, the worst case for the upper levels since nothing is clustered
+    void benchmarkSynthetic(const uint32_t triangleCount, const BvhBuildSettings& settings, const uint32_t repeat)
+    {
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> position(0.0f, 100.0f);
+        std::uniform_real_distribution<float> offset(-0.5f, 0.5f);
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+        positions.reserve(3 * static_cast<size_t>(triangleCount));
+        indices.reserve(3 * static_cast<size_t>(triangleCount));
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            const glm::vec3 center(position(generator), position(generator), position(generator));
+            for (int corner = 0; corner < 3; corner++)
+            {
+                indices.push_back(static_cast<uint32_t>(positions.size()));
+                positions.push_back(center + glm::vec3(offset(generator), offset(generator), offset(generator)));
+            }
+        }
+
+        auto singleThreaded = settings;
+        singleThreaded.threadCount = 1;
+        Bvh bvh;
+        const float milliseconds = measureMin(repeat, [&] { bvh = Bvh::buildTriangles(positions, indices, settings); });
+        const float singleThreadedMilliseconds = measureMin(repeat, [&] { bvh = Bvh::buildTriangles(positions, indices, singleThreaded); });
+
+        std::printf("synthetic: %u triangles, %.2f ms, %.2f Mtris/s, %.2fx over one thread (%.2f ms)\n", triangleCount, milliseconds,
+            static_cast<double>(triangleCount) / (1000.0 * milliseconds), singleThreadedMilliseconds / milliseconds, singleThreadedMilliseconds);
+        printBvhStats("BVH", bvh.computeStats(settings));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::string sceneFile;
+    std::vector<BlasPartitionPolicy> policies;
+    BvhBuildSettings settings;
+    uint32_t repeat = 3;
+    float millionTriangles = 4.0f;
+    try
+    {
+        int i = 1;
+        if (i < argc && std::string(argv[i]).rfind("--", 0) != 0)
+            sceneFile = argv[i++];
+        for (; i < argc; i += 2)
+        {
+            const std::string argument = argv[i];
+            if (i + 1 >= argc)
+                throw std::runtime_error("Missing value for " + argument);
+            const std::string value = argv[i + 1];
+
+            if (argument == "--partition")
+                policies.push_back(BlasPartitionPolicy::parse(value));
+            else if (argument == "--bins")
+                settings.binCount = static_cast<uint32_t>(std::stoul(value));
+            else if (argument == "--leaf")
+                settings.maxLeafSize = static_cast<uint32_t>(std::stoul(value));
+            else if (argument == "--threads")
+                settings.threadCount = static_cast<uint32_t>(std::stoul(value));
+            else if (argument == "--repeat")
+                repeat = std::max(1u, static_cast<uint32_t>(std::stoul(value)));
+            else if (argument == "--triangles")
+                millionTriangles = std::stof(value);
+            else
+                throw std::runtime_error("Unknown argument " + argument);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        printUsage();
+        return 2;
+    }
+
+    if (policies.empty())
+        policies = { BlasPartitionPolicy::parse("per-mesh"), BlasPartitionPolicy{} };
+
+    // PBRScene logs through the logger the context creates otherwise
+    spdlog::stdout_color_mt("standard");
+    try
+    {
+        if (!sceneFile.empty())
+            benchmarkScene(sceneFile, policies, settings, repeat);
+        if (millionTriangles > 0.0f)
+            benchmarkSynthetic(static_cast<uint32_t>(millionTriangles * 1000000.0f), settings, repeat);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,321 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE // use Vulkans depth range [0, 1], as rtcombined
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "geometry/BlasPartition.h"
+#include "geometry/CpuRayTracer.h"
+#include "geometry/PBRScene.h"
+#include "geometry/SceneBvh.h"
+#include "userinput/Pilotview.h"
+#include "utility/BenchmarkScript.h"
+
+// traces the primary, ambient occlusion and shadow rays of rtcombined on the CPU and reports the throughput of each,
+// with the camera and point light of rtcombined or of a benchmark script
+namespace
+{
+    void printUsage()
+    {
+        std::cerr << "usage: cpurt [<scene>] [--script <file> [--time <seconds>]] [--camera <x> <y> <z> <theta> <phi>] [--partition <policy>]\n"
+            "             [--width <n>] [--height <n>] [--ao-samples <n>] [--ao-radius <r>] [--threads <n>] [--tile <n>] [--repeat <n>] [--image <file.ppm>]\n"
+            "  scene: path relative to the resources folder, default is the scene of the script or pica pica\n"
+            "  policy: per-mesh or spatial[:<cells per axis>[:<max triangles>]], how the instances are grouped\n"
+            "  image: writes the ambient occlusion as a binary PPM\n";
+    }
+
+    struct Options
+    {
+        std::string sceneFile;
+        std::string scriptFile;
+        double time = 0.0;
+        std::optional<BenchmarkScript::CameraPose> cameraPose;
+        BlasPartitionPolicy partitionPolicy;
+        uint32_t width = 1600;
+        uint32_t height = 900;
+        uint32_t aoSamples = 4;
+        // as m_RTAORadius of rtcombined
+        float aoRadius = 100.0f;
+        uint32_t threadCount = 0;
+        uint32_t tileSize = 16;
+        uint32_t repeat = 3;
+        std::string imageFile;
+    };
+
+    Options parseOptions(const int argc, char* argv[])
+    {
+        Options options;
+        int i = 1;
+        if (i < argc && std::string(argv[i]).rfind("--", 0) != 0)
+            options.sceneFile = argv[i++];
+
+        const auto value = [&](const std::string& argument) -> std::string
+        {
+            if (i + 1 >= argc)
+                throw std::runtime_error("Missing value for " + argument);
+            return argv[++i];
+        };
+        for (; i < argc; i++)
+        {
+            const std::string argument = argv[i];
+            if (argument == "--script")
+                options.scriptFile = value(argument);
+            else if (argument == "--time")
+                options.time = std::stod(value(argument));
+            else if (argument == "--camera")
+            {
+                BenchmarkScript::CameraPose pose;
+                pose.position.x = std::stof(value(argument));
+                pose.position.y = std::stof(value(argument));
+                pose.position.z = std::stof(value(argument));
+                pose.theta = std::stof(value(argument));
+                pose.phi = std::stof(value(argument));
+                options.cameraPose = pose;
+            }
+            else if (argument == "--partition")
+                options.partitionPolicy = BlasPartitionPolicy::parse(value(argument));
+            else if (argument == "--width")
+                options.width = std::max(1u, static_cast<uint32_t>(std::stoul(value(argument))));
+            else if (argument == "--height")
+                options.height = std::max(1u, static_cast<uint32_t>(std::stoul(value(argument))));
+            else if (argument == "--ao-samples")
+                options.aoSamples = static_cast<uint32_t>(std::stoul(value(argument)));
+            else if (argument == "--ao-radius")
+                options.aoRadius = std::stof(value(argument));
+            else if (argument == "--threads")
+                options.threadCount = static_cast<uint32_t>(std::stoul(value(argument)));
+            else if (argument == "--tile")
+                options.tileSize = std::max(1u, static_cast<uint32_t>(std::stoul(value(argument))));
+            else if (argument == "--repeat")
+                options.repeat = std::max(1u, static_cast<uint32_t>(std::stoul(value(argument))));
+            else if (argument == "--image")
+                options.imageFile = value(argument);
+            else
+                throw std::runtime_error("Unknown argument " + argument);
+        }
+        return options;
+    }
+
+    // where a primary ray hit, normal facing the camera since the triangles are double sided
+    struct SurfacePoint
+    {
+        glm::vec3 position{ 0.0f };
+        glm::vec3 normal{ 0.0f };
+        bool valid = false;
+    };
+
+    SurfacePoint getSurfacePoint(const SceneBvh& bvh, const CpuRayTracer::Ray& ray, const CpuRayTracer::Hit& hit)
+    {
+        const auto& instance = bvh.getInstances().at(hit.instance);
+        const auto& bottomLevel = bvh.getBottomLevels().at(instance.bottomLevel);
+        std::array<glm::vec3, 3> vertices;
+        for (uint32_t corner = 0; corner < 3; corner++)
+            vertices.at(corner) = glm::vec3(instance.transform * glm::vec4(bottomLevel.positions.at(bottomLevel.indices.at(3 * hit.primitive + corner)), 1.0f));
+
+        glm::vec3 normal = glm::normalize(glm::cross(vertices.at(1) - vertices.at(0), vertices.at(2) - vertices.at(0)));
+        if (glm::dot(normal, ray.direction) > 0.0f)
+            normal = -normal;
+        return { ray.origin + hit.t * ray.direction, normal, true };
+    }
+
+    // cosine weighted around the normal, as in rtao.rgen
+    glm::vec3 sampleHemisphere(const glm::vec3& normal, const float u1, const float u2)
+    {
+        const float radius = std::sqrt(u1);
+        const float angle = 2.0f * glm::pi<float>() * u2;
+        const glm::vec3 tangent = glm::normalize(std::abs(normal.x) > 0.9f ? glm::cross(normal, glm::vec3(0.0f, 1.0f, 0.0f)) : glm::cross(normal, glm::vec3(1.0f, 0.0f, 0.0f)));
+        const glm::vec3 bitangent = glm::cross(normal, tangent);
+        return radius * std::cos(angle) * tangent + radius * std::sin(angle) * bitangent + std::sqrt(std::max(0.0f, 1.0f - u1)) * normal;
+    }
+
+    template <typename Function>
+    float measureMin(const uint32_t repeat, Function&& function)
+    {
+        float best = std::numeric_limits<float>::max();
+        for (uint32_t i = 0; i < repeat; i++)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            best = std::min(best, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        return best;
+    }
+
+    void printThroughput(const char* name, const size_t rayCount, const float milliseconds)
+    {
+        std::printf("  %-8s %10zu rays  %9.2f ms  %8.2f Mrays/s\n", name, rayCount, milliseconds, static_cast<double>(rayCount) / (1000.0 * milliseconds));
+    }
+
+    void writeImage(const std::string& file, const uint32_t width, const uint32_t height, const std::vector<float>& values)
+    {
+        std::ofstream out(file, std::ios::binary);
+        if (!out)
+            throw std::runtime_error("Could not write " + file);
+        out << "P6\n" << width << " " << height << "\n255\n";
+        for (const float value : values)
+        {
+            const auto byte = static_cast<char>(static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f));
+            out.write(std::string(3, byte).data(), 3);
+        }
+    }
+
+    void run(const Options& options)
+    {
+        BenchmarkScript script;
+        if (!options.scriptFile.empty())
+            script = BenchmarkScript::load(options.scriptFile);
+        std::string sceneFile = options.sceneFile;
+        if (sceneFile.empty())
+            sceneFile = !script.getScene().empty() ? script.getScene() : "pica_pica_-_mini_diorama_01/scene.gltf";
+
+        // the point light of rtcombined, unless the script moves it
+        glm::vec3 lightPosition(43.0f, 100.0f, -17.0f);
+        const auto lightPositions = script.getPointLightPositions(options.time);
+        if (lightPositions.count(0) != 0)
+            lightPosition = lightPositions.at(0);
+
+        Pilotview camera(static_cast<int>(options.width), static_cast<int>(options.height));
+        if (options.cameraPose)
+            camera.setPose(options.cameraPose->position, options.cameraPose->theta, options.cameraPose->phi);
+        else if (script.hasCameraPath())
+        {
+            const auto pose = script.getCameraPose(options.time);
+            camera.setPose(pose.position, pose.theta, pose.phi);
+        }
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), options.width / static_cast<float>(options.height), 0.1f, 10000.0f);
+        projection[1][1] *= -1;
+        const glm::mat4 inverseViewProjection = glm::inverse(projection * camera.getView());
+        const glm::vec3 cameraPosition = camera.getPosition();
+
+        const PBRScene scene(sceneFile);
+        const auto buildStart = std::chrono::steady_clock::now();
+        const BlasPartition partition(scene, options.partitionPolicy, {});
+        BvhBuildSettings settings;
+        settings.threadCount = options.threadCount;
+        const SceneBvh bvh(scene, partition, settings);
+        const CpuRayTracer tracer(bvh);
+        std::printf("%s: %zu instances, %zu BLAS, built in %.2f ms\n", sceneFile.c_str(), bvh.getInstances().size(), bvh.getBottomLevels().size(),
+            std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - buildStart).count());
+
+        const size_t pixelCount = static_cast<size_t>(options.width) * options.height;
+        std::vector<SurfacePoint> surfacePoints(pixelCount);
+        std::vector<float> ambientOcclusion(pixelCount, 1.0f);
+        std::vector<uint8_t> shadowed(pixelCount, 0);
+        const auto forEachPixel = [&](auto&& function)
+        {
+            CpuRayTracer::forEachTile(options.width, options.height, options.tileSize, options.threadCount, [&](const uint32_t x0, const uint32_t y0, const uint32_t x1, const uint32_t y1)
+            {
+                for (uint32_t y = y0; y < y1; y++)
+                    for (uint32_t x = x0; x < x1; x++)
+                        function(x, y, static_cast<size_t>(y) * options.width + x);
+            });
+        };
+
+        const float primaryMilliseconds = measureMin(options.repeat, [&]
+        {
+            forEachPixel([&](const uint32_t x, const uint32_t y, const size_t pixel)
+            {
+                const glm::vec2 ndc(2.0f * (x + 0.5f) / options.width - 1.0f, 2.0f * (y + 0.5f) / options.height - 1.0f);
+                const glm::vec4 target = inverseViewProjection * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+                CpuRayTracer::Ray ray;
+                ray.origin = cameraPosition;
+                ray.direction = glm::normalize(glm::vec3(target) / target.w - cameraPosition);
+                ray.tMin = 0.1f;
+                ray.tMax = 10000.0f;
+                const auto hit = tracer.traceClosest(ray);
+                surfacePoints.at(pixel) = hit ? getSurfacePoint(bvh, ray, *hit) : SurfacePoint{};
+            });
+        });
+        const auto hitCount = static_cast<size_t>(std::count_if(surfacePoints.begin(), surfacePoints.end(), [](const SurfacePoint& point) { return point.valid; }));
+
+        const float aoMilliseconds = measureMin(options.repeat, [&]
+        {
+            forEachPixel([&](uint32_t, uint32_t, const size_t pixel)
+            {
+                const auto& point = surfacePoints.at(pixel);
+                if (!point.valid)
+                    return;
+                // the same sequence in every repetition, so the runs trace the same rays
+                std::minstd_rand generator(static_cast<uint32_t>(pixel) + 1);
+                std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+                uint32_t occluded = 0;
+                for (uint32_t s = 0; s < options.aoSamples; s++)
+                {
+                    CpuRayTracer::Ray ray;
+                    ray.origin = point.position;
+                    ray.direction = sampleHemisphere(point.normal, distribution(generator), distribution(generator));
+                    ray.tMin = 0.001f;
+                    ray.tMax = options.aoRadius;
+                    occluded += tracer.isOccluded(ray) ? 1 : 0;
+                }
+                ambientOcclusion.at(pixel) = 1.0f - static_cast<float>(occluded) / static_cast<float>(std::max(1u, options.aoSamples));
+            });
+        });
+
+        const float shadowMilliseconds = measureMin(options.repeat, [&]
+        {
+            forEachPixel([&](uint32_t, uint32_t, const size_t pixel)
+            {
+                const auto& point = surfacePoints.at(pixel);
+                if (!point.valid)
+                    return;
+                const glm::vec3 toLight = lightPosition - point.position;
+                CpuRayTracer::Ray ray;
+                ray.origin = point.position;
+                ray.direction = glm::normalize(toLight);
+                ray.tMin = 0.001f;
+                ray.tMax = glm::length(toLight);
+                shadowed.at(pixel) = tracer.isOccluded(ray) ? 1 : 0;
+            });
+        });
+
+        std::printf("%ux%u, %zu pixels hit, %u AO samples, best of %u\n", options.width, options.height, hitCount, options.aoSamples, options.repeat);
+        printThroughput("primary", pixelCount, primaryMilliseconds);
+        printThroughput("AO", hitCount * options.aoSamples, aoMilliseconds);
+        printThroughput("shadow", hitCount, shadowMilliseconds);
+        std::printf("  %zu of %zu hit pixels in shadow\n", static_cast<size_t>(std::count(shadowed.begin(), shadowed.end(), 1)), hitCount);
+
+        if (!options.imageFile.empty())
+            writeImage(options.imageFile, options.width, options.height, ambientOcclusion);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    try
+    {
+        options = parseOptions(argc, argv);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        printUsage();
+        return 2;
+    }
+
+    // PBRScene logs through the logger the context creates otherwise
+    spdlog::stdout_color_mt("standard");
+    try
+    {
+        run(options);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
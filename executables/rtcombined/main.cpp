@@ -17,6 +17,7 @@
 #include "graphic/Definitions.h"
 #include "userinput/Pilotview.h"
 #include "geometry/PBRScene.h"
+#include "geometry/BlasPartition.h"
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
@@ -24,10 +25,27 @@
 #include "imgui/imgui_impl_vulkan.h"
 #include "imgui/imgui_impl_glfw.h"
 #include "utility/Timer.h"
+#include "utility/DynamicResolutionController.h"
+#include "utility/BenchmarkRunner.h"
+#include "utility/PipelineStatistics.h"
+#include "utility/TlasUpdatePolicy.h"
+#include "utility/FloatImage.h"
+#include "utility/RTCapture.h"
+#include "graphic/PipelineBuildService.h"
+#include "graphic/ShaderCompiler.h"
+#include "graphic/ShaderReloadService.h"
+#include "graphic/SpecializationConstants.h"
+#include "graphic/PipelinePermutationCache.h"
+#include "graphic/BlasBuildScheduler.h"
+#include "graphic/InstanceBufferRing.h"
+#include "graphic/ShaderBindingTable.h"
 #include "stb/stb_image.h"
 #include "geometry/lightmanager.h"
 #include <random>
 #include <execution>
+#include <chrono>
+#include <algorithm>
+#include <optional>
 
 
 namespace vg
@@ -36,8 +54,9 @@ namespace vg
     class RTCombinedApp : public BaseApp
     {
     public:
-        RTCombinedApp() :
-            BaseApp({ VK_KHR_SWAPCHAIN_EXTENSION_NAME, "VK_KHR_shader_draw_parameters", "VK_NV_ray_tracing" }),
+        // with a benchmark the scene, camera, lights and animation follow its script, see BenchmarkRunner
+        explicit RTCombinedApp(BenchmarkRunner* benchmark = nullptr) :
+            BaseApp({ VK_KHR_SWAPCHAIN_EXTENSION_NAME, "VK_KHR_shader_draw_parameters", "VK_NV_ray_tracing" }, { VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME }),
             m_camera(m_context.getSwapChainExtent().width,
                 m_context.getSwapChainExtent().height),
             m_timerManager(std::map<std::string, Timer>{
@@ -50,24 +69,33 @@ namespace vg
                 { {"6 ImGui"}, {} },
                 { {"AS Build"},  Timer{ false } }
             }, m_context),
-            m_scene("pica_pica_-_mini_diorama_01/scene.gltf")
-            //m_scene("Bistro/Bistro_Research_Exterior.fbx")
-            //m_scene("Bistro/Bistro_Research_Interior.fbx")
-            //m_scene("Bistro_v4/Bistro_Interior.fbx")
-            //m_scene("Bistro_v4/Bistro_Exterior.fbx")
-            //m_scene("SunTemple/SunTemple.fbx")
-
+            m_pipelineStatistics({ "1 G-Buffer", "5 Fullscreen Lighting" }, m_context),
+            m_pipelineBuildService(m_context),
+            m_shaderCompiler(m_context),
+            m_shaderReloadService(m_context),
+            m_fullscreenLightingPermutations(m_context),
+            m_scene(getSceneFile(benchmark)),
+            m_benchmark(benchmark)
         {
-            //shaderExtension = std::string(".fbx.spv");
-            m_shaderExtension = std::string(".spv");
+            const auto startupStart = std::chrono::high_resolution_clock::now();
+
+            if (m_benchmark != nullptr && !m_benchmark->getOptions().blasPartition.empty())
+                m_blasPartitionPolicy = BlasPartitionPolicy::parse(m_benchmark->getOptions().blasPartition);
+
+            // FBX scenes store metalness/roughness in different channels than GLTF
+            const auto sceneFile = getSceneFile(benchmark);
+            m_sceneConstants.set(SpecConstant::MaterialChannelLayout, static_cast<int32_t>(sceneFile.extension() == ".fbx" ? MaterialChannelLayout::FBX : MaterialChannelLayout::GLTF));
 
             createCommandPools();
-		    createSceneInformation("pica_pica_-_mini_diorama_01/");
-			//createSceneInformation("Bistro/");
-            //createSceneInformation("Bistro_v4/");
-            //createSceneInformation("SunTemple/");
+            // texture paths are relative to the folder of the scene file
+		    createSceneInformation((sceneFile.parent_path().generic_string() + "/").c_str());
+
+            // the size dependent targets only get reallocated once the window outgrows them
+            m_targetCapacity = m_context.getSwapChainExtent();
+            createDepthResources(m_targetCapacity);
 
-            createDepthResources();
+            // full resolution until the dynamic resolution controller has timings
+            m_renderExtent = m_context.getSwapChainExtent();
 
             createGBufferRenderpass();
             createFullscreenLightingRenderpass();
@@ -84,36 +112,72 @@ namespace vg
             createCombinedDescriptorPool();
 
             createLightStuff();
+
+            // fixed for the lifetime of the scene, so the shaders can unroll the light loops
+            m_sceneConstants.set(SpecConstant::NumTextures, static_cast<int32_t>(m_allImages.size()))
+                .set(SpecConstant::NumDirLights, static_cast<int32_t>(m_lightManager.getDirectionalLights().size()))
+                .set(SpecConstant::NumPointLights, static_cast<int32_t>(m_lightManager.getPointLights().size()))
+                .set(SpecConstant::NumSpotLights, static_cast<int32_t>(m_lightManager.getSpotLights().size()));
+
             createRTResources();
             createRTDescriptors();
 
             createGBufferDescriptors();
             createFullscreenLightingDescriptors();
 
-            createGBufferPipeline();
-            createFullscreenLightingPipeline();
+            // pipelines compile on worker threads while the remaining resources are created
+            auto gbufferPipeline = createGBufferPipeline();
+            auto fullscreenLightingPipeline = m_fullscreenLightingPermutations.get(fullscreenLightingConstants(m_useLowResReflections), fullscreenLightingBuildFunction());
+            auto rtSoftShadowsPipeline = createRTSoftShadowsPipeline();
+            auto rtAOPipeline = createRTAOPipeline();
+            auto rtReflectionPipeline = createRTReflectionPipeline();
 
             createRandomImage();
+            createRTPerFrameInfoBuffers();
 
             // RT
             createAccelerationStructure();
-            createRTSoftShadowsPipeline();
-            createRTAOPipeline();
-			createRTReflectionPipeline();
+            createRTSoftShadowsDescriptorSets();
+            createRTAODescriptorSets();
+            createRTReflectionDescriptorSets();
 
             createPerFrameInformation();
 
+            // wait only now, the SBTs and command buffers are the first things that need the pipelines
+            m_gbufferGraphicsPipeline = gbufferPipeline.get();
+            m_fullscreenLightingPipeline = fullscreenLightingPipeline.get();
+            m_activeLowResReflections = m_useLowResReflections;
+            m_rtSoftShadowsPipeline = rtSoftShadowsPipeline.get();
+            m_rtAOPipeline = rtAOPipeline.get();
+            m_rtReflectionsPipeline = rtReflectionPipeline.get();
+            m_pipelineBuildService.logCompileTimes();
+
+            // the other reflection mode is built in the background, so switching it in the GUI doesn't stall
+            m_fullscreenLightingPermutations.get(fullscreenLightingConstants(1 - m_useLowResReflections), fullscreenLightingBuildFunction());
+
+            createShaderBindingTables();
+
             createAllCommandBuffers();
             createSyncObjects();
 
-            createQueryPool();
+            // one frame timestamp per frame slot, read once the frame is finished
+            createQueryPool(2 * static_cast<uint32_t>(m_frameResourceCount));
+            m_timer.setTimestampProperties(m_context.getTimestampPeriod(), m_context.getTimestampValidBits());
 
             setupImgui();
+
+            registerShaderReloads();
+
+            if (m_benchmark != nullptr)
+                setupBenchmark();
+
+            const auto startupEnd = std::chrono::high_resolution_clock::now();
+            m_context.getLogger()->info("Startup took {} ms", std::chrono::duration<float, std::milli>(startupEnd - startupStart).count());
         }
 
-        // todo clarify what is here and what is in cleanupswapchain
         ~RTCombinedApp()
         {
+            m_retireQueue.flush();
             m_context.getDevice().destroyQueryPool(m_queryPool);
 
             vmaDestroyBuffer(m_context.getAllocator(), static_cast<VkBuffer>(m_indexBufferInfo.m_Buffer), m_indexBufferInfo.m_BufferAllocation);
@@ -122,16 +186,21 @@ namespace vg
             vmaDestroyBuffer(m_context.getAllocator(), static_cast<VkBuffer>(m_materialBufferInfo.m_Buffer), m_materialBufferInfo.m_BufferAllocation);
             vmaDestroyBuffer(m_context.getAllocator(), static_cast<VkBuffer>(m_modelMatrixBufferInfo.m_Buffer), m_modelMatrixBufferInfo.m_BufferAllocation);
 
-            vmaDestroyBuffer(m_context.getAllocator(), static_cast<VkBuffer>(m_scratchBuffer.m_Buffer), m_scratchBuffer.m_BufferAllocation);
-            vmaDestroyBuffer(m_context.getAllocator(), static_cast<VkBuffer>(m_instanceBufferInfo.m_Buffer), m_instanceBufferInfo.m_BufferAllocation);
+            for (const auto& scratchBuffer : m_topASScratchBuffers)
+                vmaDestroyBuffer(m_context.getAllocator(), static_cast<VkBuffer>(scratchBuffer.m_Buffer), scratchBuffer.m_BufferAllocation);
+            m_instanceRing.reset();
             vmaDestroyBuffer(m_context.getAllocator(), static_cast<VkBuffer>(m_offsetBufferInfo.m_Buffer), m_offsetBufferInfo.m_BufferAllocation);
-            vmaDestroyBuffer(m_context.getAllocator(), static_cast<VkBuffer>(m_rtSoftShadowSBTInfo.m_Buffer), m_rtSoftShadowSBTInfo.m_BufferAllocation);
-            vmaDestroyBuffer(m_context.getAllocator(), static_cast<VkBuffer>(m_rtAOSBTInfo.m_Buffer), m_rtAOSBTInfo.m_BufferAllocation);
-            vmaDestroyBuffer(m_context.getAllocator(), static_cast<VkBuffer>(m_rtReflectionsSBTInfo.m_Buffer), m_rtReflectionsSBTInfo.m_BufferAllocation);
+            vmaDestroyBuffer(m_context.getAllocator(), static_cast<VkBuffer>(m_primitiveMeshBufferInfo.m_Buffer), m_primitiveMeshBufferInfo.m_BufferAllocation);
+            vmaDestroyBuffer(m_context.getAllocator(), static_cast<VkBuffer>(m_rtSBTInfo.m_Buffer), m_rtSBTInfo.m_BufferAllocation);
+            for (const auto& upload : m_pendingSBTUploads)
+                vmaDestroyBuffer(m_context.getAllocator(), static_cast<VkBuffer>(upload.staging.m_Buffer), upload.staging.m_BufferAllocation);
 
 
-            m_context.getDevice().destroyAccelerationStructureNV(m_topAS.m_AS);
-            vmaFreeMemory(m_context.getAllocator(), m_topAS.m_BufferAllocation);
+            for (const auto& as : m_topASs)
+            {
+                m_context.getDevice().destroyAccelerationStructureNV(as.m_AS);
+                vmaFreeMemory(m_context.getAllocator(), as.m_BufferAllocation);
+            }
 
             for (const auto& as : m_bottomASs)
             {
@@ -154,9 +223,6 @@ namespace vg
             for (const auto& buffer : m_rtPerFrameInfoBufferInfos)
                 vmaDestroyBuffer(m_context.getAllocator(), static_cast<VkBuffer>(buffer.m_Buffer), buffer.m_BufferAllocation);            
 
-            m_context.getDevice().destroyImageView(m_depthImageView);
-            vmaDestroyImage(m_context.getAllocator(), m_depthImage.m_Image, m_depthImage.m_ImageAllocation);
-
             for (int i = 0; i < m_context.max_frames_in_flight; i++)
             {
                 m_context.getDevice().destroySemaphore(m_imageAvailableSemaphores.at(i));
@@ -177,9 +243,6 @@ namespace vg
             for (const auto framebuffer : m_swapChainFramebuffers)
                 m_context.getDevice().destroyFramebuffer(framebuffer);
 
-            for (const auto& framebuffer : m_gbufferFramebuffers)
-                m_context.getDevice().destroyFramebuffer(framebuffer);
-
             for(const auto& sampler : m_allImageSamplers)
                 m_context.getDevice().destroySampler(sampler);
             for (const auto& view : m_allImageViews)
@@ -187,78 +250,7 @@ namespace vg
             for(const auto& image : m_allImages)
                 vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
 
-            for(const auto& sampler : m_gbufferPositionSamplers)
-                m_context.getDevice().destroySampler(sampler);
-            for (const auto& sampler : m_gbufferNormalSamplers)
-                m_context.getDevice().destroySampler(sampler);
-            for (const auto& sampler : m_gbufferUVSamplers)
-                m_context.getDevice().destroySampler(sampler);
-
-            for (const auto& view : m_gbufferPositionImageViews)
-                m_context.getDevice().destroyImageView(view);
-            for (const auto& view : m_gbufferNormalImageViews)
-                m_context.getDevice().destroyImageView(view);
-            for (const auto& view : m_gbufferUVImageViews)
-                m_context.getDevice().destroyImageView(view);
-            for (const auto& view : m_gbufferDepthImageViews)
-                m_context.getDevice().destroyImageView(view);
-
-            for (const auto& image : m_gbufferPositionImageInfos)
-                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
-            for (const auto& image : m_gbufferNormalImageInfos)
-                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
-            for (const auto& image : m_gbufferUVImageInfos)
-                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
-            for (const auto& image : m_gbufferDepthImages)
-                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
-
-            for (const auto& image : m_rtSoftShadowDirectionalImageInfos)
-                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
-            for (const auto& view : m_rtSoftShadowDirectionalImageViews)
-                m_context.getDevice().destroyImageView(view);
-            for (const auto& sampler : m_rtSoftShadowDirectionalImageSamplers)
-                m_context.getDevice().destroySampler(sampler);
-
-            for (const auto& image : m_rtSoftShadowPointImageInfos)
-                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
-            for (const auto& view : m_rtSoftShadowPointImageViews)
-                m_context.getDevice().destroyImageView(view);
-            for (const auto& sampler : m_rtSoftShadowPointImageSamplers)
-                m_context.getDevice().destroySampler(sampler);
-
-            for (const auto& image : m_rtSoftShadowSpotImageInfos)
-                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
-            for (const auto& view : m_rtSoftShadowSpotImageViews)
-                m_context.getDevice().destroyImageView(view);
-            for (const auto& sampler : m_rtSoftShadowSpotImageSamplers)
-                m_context.getDevice().destroySampler(sampler);
-
-            for (const auto& image : m_rtAOImageInfos)
-                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
-            for (const auto& view : m_rtAOImageViews)
-                m_context.getDevice().destroyImageView(view);
-            for (const auto& sampler : m_rtAOImageSamplers)
-                m_context.getDevice().destroySampler(sampler);
-
-            for (const auto& image : m_rtReflectionImageInfos)
-                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
-            for (const auto& view : m_rtReflectionImageViews)
-                m_context.getDevice().destroyImageView(view);
-            for (const auto& sampler : m_rtReflectionImageSamplers)
-                m_context.getDevice().destroySampler(sampler);
-
-            for (const auto& image : m_rtReflectionLowResImageInfos)
-                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
-            for (const auto& view : m_rtReflectionLowResImageViews)
-                m_context.getDevice().destroyImageView(view);
-            for (const auto& sampler : m_rtReflectionLowResImageSamplers)
-                m_context.getDevice().destroySampler(sampler);
-
-            for (const auto& image : m_randomImageInfos)
-                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
-
-            for (const auto& view : m_randomImageViews)
-                m_context.getDevice().destroyImageView(view);
+            destroyRenderTargets();
 
             m_context.getDevice().destroyDescriptorPool(m_combinedDescriptorPool);
 
@@ -276,7 +268,7 @@ namespace vg
             m_context.getDevice().destroyPipelineLayout(m_gbufferPipelineLayout);
             m_context.getDevice().destroyRenderPass(m_gbufferRenderpass);
 
-            m_context.getDevice().destroyPipeline(m_fullscreenLightingPipeline);
+            // the fullscreen lighting pipelines are owned by m_fullscreenLightingPermutations
             m_context.getDevice().destroyPipelineLayout(m_fullscreenLightingPipelineLayout);
             m_context.getDevice().destroyRenderPass(m_fullscreenLightingRenderpass);
             // cleanup here
@@ -347,7 +339,7 @@ namespace vg
         {
             // 2: create descriptor pool
             vk::DescriptorPoolSize poolSizeAllImages(vk::DescriptorType::eCombinedImageSampler, static_cast<uint32_t>(m_allImageSamplers.size()));
-            vk::DescriptorPoolSize poolSizeForSSBOs(vk::DescriptorType::eStorageBuffer, 7);
+            vk::DescriptorPoolSize poolSizeForSSBOs(vk::DescriptorType::eStorageBuffer, 8);
             vk::DescriptorPoolSize gbufferImages(vk::DescriptorType::eCombinedImageSampler, 3);
             vk::DescriptorPoolSize shadowImage(vk::DescriptorType::eStorageImage, 1);
             vk::DescriptorPoolSize rtOutputImage(vk::DescriptorType::eStorageImage, 1);
@@ -356,7 +348,7 @@ namespace vg
             std::array poolSizes = { poolSizeForSSBOs, gbufferImages, poolSizeAllImages, rtOutputImage, rtAS, shadowImage };
 
 
-            vk::DescriptorPoolCreateInfo poolInfo({}, 7 * static_cast<uint32_t>(m_swapChainFramebuffers.size()) + 2, static_cast<uint32_t>(poolSizes.size()), poolSizes.data());
+            vk::DescriptorPoolCreateInfo poolInfo({}, 7 * static_cast<uint32_t>(m_frameResourceCount) + 2, static_cast<uint32_t>(poolSizes.size()), poolSizes.data());
 
             m_combinedDescriptorPool = m_context.getDevice().createDescriptorPool(poolInfo);
         }
@@ -403,87 +395,94 @@ namespace vg
             m_context.getDevice().updateDescriptorSets(static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
         }
 
-        void createGBufferPipeline()
+        std::shared_future<vk::Pipeline> createGBufferPipeline()
         {
-            const auto vertShaderCode = Utility::readFile("combined/gbuffer.vert" + m_shaderExtension);
-            const auto fragShaderCode = Utility::readFile("combined/gbuffer.frag" + m_shaderExtension);
+            if (!m_gbufferPipelineLayout)
+            {
+                // push view & proj matrix
+                std::array vpcr = {
+                    vk::PushConstantRange{vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, 2 * sizeof(glm::mat4) + sizeof(glm::vec4) + sizeof(float) + sizeof(int32_t) + sizeof(glm::vec2)}
+                };
 
-            const auto vertShaderModule = m_context.createShaderModule(vertShaderCode);
-            const auto fragShaderModule = m_context.createShaderModule(fragShaderCode);
+                vk::PipelineLayoutCreateInfo pipelineLayoutInfo({}, 1, &m_gbufferDescriptorSetLayout, static_cast<uint32_t>(vpcr.size()), vpcr.data());
 
-            // specialization constant for the number of textures
-            vk::SpecializationMapEntry mapEntry(0, 0, sizeof(int32_t));
-            int32_t numTextures = static_cast<int32_t>(m_allImages.size());
-            vk::SpecializationInfo numTexturesSpecInfo(1, &mapEntry, sizeof(int32_t), &numTextures);
+                m_gbufferPipelineLayout = m_context.getDevice().createPipelineLayout(pipelineLayoutInfo);
+            }
 
-            const vk::PipelineShaderStageCreateInfo vertShaderStageInfo({}, vk::ShaderStageFlagBits::eVertex, vertShaderModule, "main");
-            const vk::PipelineShaderStageCreateInfo fragShaderStageInfo({}, vk::ShaderStageFlagBits::eFragment, fragShaderModule, "main", &numTexturesSpecInfo);
+            // everything below runs on a worker thread
+            return m_pipelineBuildService.submit("G-Buffer", [this, constants = m_sceneConstants]()
+            {
+                const auto vertShaderCode = m_shaderCompiler.compile("combined/gbuffer.vert");
+                const auto fragShaderCode = m_shaderCompiler.compile("combined/gbuffer.frag");
 
-            const vk::PipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+                const auto vertShaderModule = m_context.createShaderModule(vertShaderCode);
+                const auto fragShaderModule = m_context.createShaderModule(fragShaderCode);
 
-            auto bindingDescription = vg::VertexPosUvNormal::getBindingDescription();
-            auto attributeDescriptions = vg::VertexPosUvNormal::getAttributeDescriptions();
-            vk::PipelineVertexInputStateCreateInfo vertexInputInfo({}, 1, &bindingDescription,
-                static_cast<uint32_t>(attributeDescriptions.size()), attributeDescriptions.data());
+                // scene constants (number of textures, material layout)
+                const auto specInfo = constants.info();
 
-            vk::PipelineInputAssemblyStateCreateInfo inputAssembly({}, vk::PrimitiveTopology::eTriangleList, false);
+                const vk::PipelineShaderStageCreateInfo vertShaderStageInfo({}, vk::ShaderStageFlagBits::eVertex, vertShaderModule, "main");
+                const vk::PipelineShaderStageCreateInfo fragShaderStageInfo({}, vk::ShaderStageFlagBits::eFragment, fragShaderModule, "main", &specInfo);
 
-            vk::Viewport viewport(0.0f, 0.0f, static_cast<float>(m_context.getWidth()), static_cast<float>(m_context.getHeight()), 0.0f, 1.0f);
+                const vk::PipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
-            vk::Rect2D scissor({ 0, 0 }, m_context.getSwapChainExtent());
+                auto bindingDescription = vg::VertexPosUvNormal::getBindingDescription();
+                auto attributeDescriptions = vg::VertexPosUvNormal::getAttributeDescriptions();
+                vk::PipelineVertexInputStateCreateInfo vertexInputInfo({}, 1, &bindingDescription,
+                    static_cast<uint32_t>(attributeDescriptions.size()), attributeDescriptions.data());
 
-            vk::PipelineViewportStateCreateInfo viewportState({}, 1, &viewport, 1, &scissor);
+                vk::PipelineInputAssemblyStateCreateInfo inputAssembly({}, vk::PrimitiveTopology::eTriangleList, false);
 
-            vk::PipelineRasterizationStateCreateInfo rasterizer({}, false, false,
-                vk::PolygonMode::eFill, vk::CullModeFlagBits::eBack, vk::FrontFace::eCounterClockwise,
-                false, 0, 0, 0, 1.0f);
+                vk::Viewport viewport(0.0f, 0.0f, static_cast<float>(m_context.getWidth()), static_cast<float>(m_context.getHeight()), 0.0f, 1.0f);
 
-            vk::PipelineMultisampleStateCreateInfo multisampling({}, vk::SampleCountFlagBits::e1, false);
+                vk::Rect2D scissor({ 0, 0 }, m_context.getSwapChainExtent());
 
-            vk::PipelineDepthStencilStateCreateInfo depthStencil({}, true, true, vk::CompareOp::eLess);
+                vk::PipelineViewportStateCreateInfo viewportState({}, 1, &viewport, 1, &scissor);
 
-            // no blending needed
-            vk::PipelineColorBlendAttachmentState colorBlendAttachment(false); // standard values for blending.
-            colorBlendAttachment.setColorWriteMask(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA);
-            //vk::PipelineColorBlendAttachmentState uvBlendAttachment(false); // if blending is ON, this is needed
-            //uvBlendAttachment.setColorWriteMask(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG);
-            // we need 2 blend attachments for 2 framebuffer attachments
-            std::array blendAttachments = { colorBlendAttachment, colorBlendAttachment, colorBlendAttachment };
-            // standard values for now
-            vk::PipelineColorBlendStateCreateInfo colorBlending({}, false, vk::LogicOp::eCopy,
-                static_cast<uint32_t>(blendAttachments.size()), blendAttachments.data(),
-                std::array<float, 4>{0.0f, 0.0f, 0.0f, 0.0f});
-            
-            // no dynamic state needed
-            //std::array<vk::DynamicState, 2> dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eLineWidth };
-            //vk::PipelineDynamicStateCreateInfo dynamicState({}, dynamicStates.size(), dynamicStates.data());
+                vk::PipelineRasterizationStateCreateInfo rasterizer({}, false, false,
+                    vk::PolygonMode::eFill, vk::CullModeFlagBits::eBack, vk::FrontFace::eCounterClockwise,
+                    false, 0, 0, 0, 1.0f);
 
-            // push view & proj matrix
-            std::array vpcr = {
-                vk::PushConstantRange{vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, 2 * sizeof(glm::mat4) + sizeof(glm::vec4) + sizeof(float) + sizeof(int32_t)}
-            };
+                vk::PipelineMultisampleStateCreateInfo multisampling({}, vk::SampleCountFlagBits::e1, false);
 
-            vk::PipelineLayoutCreateInfo pipelineLayoutInfo({}, 1, &m_gbufferDescriptorSetLayout, static_cast<uint32_t>(vpcr.size()), vpcr.data());
+                vk::PipelineDepthStencilStateCreateInfo depthStencil({}, true, true, vk::CompareOp::eLess);
 
-            m_gbufferPipelineLayout = m_context.getDevice().createPipelineLayout(pipelineLayoutInfo);
+                // no blending needed
+                vk::PipelineColorBlendAttachmentState colorBlendAttachment(false); // standard values for blending.
+                colorBlendAttachment.setColorWriteMask(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA);
+                //vk::PipelineColorBlendAttachmentState uvBlendAttachment(false); // if blending is ON, this is needed
+                //uvBlendAttachment.setColorWriteMask(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG);
+                // we need 2 blend attachments for 2 framebuffer attachments
+                std::array blendAttachments = { colorBlendAttachment, colorBlendAttachment, colorBlendAttachment };
+                // standard values for now
+                vk::PipelineColorBlendStateCreateInfo colorBlending({}, false, vk::LogicOp::eCopy,
+                    static_cast<uint32_t>(blendAttachments.size()), blendAttachments.data(),
+                    std::array<float, 4>{0.0f, 0.0f, 0.0f, 0.0f});
+            
+                // the g-buffer is rendered at the dynamic resolution, set when recording
+                std::array dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+                vk::PipelineDynamicStateCreateInfo dynamicState({}, static_cast<uint32_t>(dynamicStates.size()), dynamicStates.data());
+
+                vk::GraphicsPipelineCreateInfo pipelineInfo({}, 2, shaderStages, &vertexInputInfo, &inputAssembly, nullptr,
+                    &viewportState, &rasterizer, &multisampling, &depthStencil, &colorBlending, &dynamicState,
+                    m_gbufferPipelineLayout, m_gbufferRenderpass, 0);
 
-            vk::GraphicsPipelineCreateInfo pipelineInfo({}, 2, shaderStages, &vertexInputInfo, &inputAssembly, nullptr,
-                &viewportState, &rasterizer, &multisampling, &depthStencil, &colorBlending, nullptr,
-                m_gbufferPipelineLayout, m_gbufferRenderpass, 0);
 
+                const auto pipeline = m_context.getDevice().createGraphicsPipeline(nullptr, pipelineInfo);
 
-            m_gbufferGraphicsPipeline = m_context.getDevice().createGraphicsPipeline(nullptr, pipelineInfo);
+                m_context.getDevice().destroyShaderModule(vertShaderModule);
+                m_context.getDevice().destroyShaderModule(fragShaderModule);
 
-            m_context.getDevice().destroyShaderModule(vertShaderModule);
-            m_context.getDevice().destroyShaderModule(fragShaderModule);
+                return pipeline;
+            });
         }
         
 
         void createGBufferResources()
         {
             // create images
-            const auto ext = m_context.getSwapChainExtent();
-            for(size_t i = 0; i < m_context.getSwapChainImages().size(); i++)
+            const auto ext = m_targetCapacity;
+            for(size_t i = 0; i < m_frameResourceCount; i++)
             {
                 // image
                 m_gbufferPositionImageInfos.push_back(
@@ -563,9 +562,9 @@ namespace vg
 
             // create depth images //TODO maybe those aren't even needed
             vk::Format depthFormat = vk::Format::eD32SfloatS8Uint;
-            for(size_t i = 0; i < m_context.getSwapChainImages().size(); i++)
+            for(size_t i = 0; i < m_frameResourceCount; i++)
             {
-                m_gbufferDepthImages.push_back(createImage(m_context.getSwapChainExtent().width, m_context.getSwapChainExtent().height, 1,
+                m_gbufferDepthImages.push_back(createImage(ext.width, ext.height, 1,
                     depthFormat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eDepthStencilAttachment, VMA_MEMORY_USAGE_GPU_ONLY));
 
                 vk::ImageViewCreateInfo viewInfo({}, m_gbufferDepthImages.at(i).m_Image, vk::ImageViewType::e2D, depthFormat, {}, { vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1 });
@@ -576,7 +575,7 @@ namespace vg
                 
 
             // create fbos
-            for (size_t i = 0; i < m_context.getSwapChainImages().size(); i++)
+            for (size_t i = 0; i < m_frameResourceCount; i++)
             {
                 // TODO attach missing attachments (pos, normal, geometry ID, ...)
                 std::array attachments = {
@@ -635,87 +634,112 @@ namespace vg
             m_fullscreenLightingRenderpass = m_context.getDevice().createRenderPass(renderpassInfo);
         }
 
-        void createFullscreenLightingPipeline()
+        // scene constants plus the reflection mode, one pipeline per mode is kept in m_fullscreenLightingPermutations
+        SpecializationConstants fullscreenLightingConstants(const int32_t useLowResReflections) const
         {
+            auto constants = m_sceneConstants;
+            constants.set(SpecConstant::LowResReflections, useLowResReflections);
+            return constants;
+        }
+
+        PipelinePermutationCache::BuildFunction fullscreenLightingBuildFunction()
+        {
+            return [this](const SpecializationConstants& constants) { return createFullscreenLightingPipeline(constants); };
+        }
+
+        std::shared_future<vk::Pipeline> createFullscreenLightingPipeline(const SpecializationConstants& constants)
+        {
+            if (!m_fullscreenLightingPipelineLayout)
+            {
+                // push view & proj matrix
+                std::array vpcr = {
+                    vk::PushConstantRange{vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, 2 * sizeof(glm::mat4) + sizeof(glm::vec4) + sizeof(float) + sizeof(int32_t) + sizeof(glm::vec2)}
+                };
 
-            const auto vertShaderCode = Utility::readFile("deferred/fullscreen.vert" + m_shaderExtension);
-            const auto fragShaderCode = Utility::readFile("combined/fullscreenLightingPBR_RT.frag" + m_shaderExtension);
+                std::array dsls = { m_fullScreenLightingDescriptorSetLayout, m_lightDescriptorSetLayout, m_allRTImageSampleDescriptorSetLayout };
+                vk::PipelineLayoutCreateInfo pipelineLayoutInfo({}, static_cast<uint32_t>(dsls.size()), dsls.data(), static_cast<uint32_t>(vpcr.size()), vpcr.data());
 
-            const auto vertShaderModule = m_context.createShaderModule(vertShaderCode);
-            const auto fragShaderModule = m_context.createShaderModule(fragShaderCode);
+                m_fullscreenLightingPipelineLayout = m_context.getDevice().createPipelineLayout(pipelineLayoutInfo);
+            }
+
+            // compile times are kept per name, so each permutation gets its own
+            const std::string name = std::string("Fullscreen Lighting, ") + (constants.get(SpecConstant::LowResReflections) ? "low res reflections" : "full res reflections");
 
-            // specialization constant for the number of textures
-            vk::SpecializationMapEntry mapEntry(0, 0, sizeof(int32_t));
-            int32_t numTextures = static_cast<int32_t>(m_allImages.size());
-            vk::SpecializationInfo numTexturesSpecInfo(1, &mapEntry, sizeof(int32_t), &numTextures);
+            // everything below runs on a worker thread
+            return m_pipelineBuildService.submit(name, [this, constants]()
+            {
+                const auto vertShaderCode = m_shaderCompiler.compile("deferred/fullscreen.vert");
+                const auto fragShaderCode = m_shaderCompiler.compile("combined/fullscreenLightingPBR_RT.frag");
 
-            const vk::PipelineShaderStageCreateInfo vertShaderStageInfo({}, vk::ShaderStageFlagBits::eVertex, vertShaderModule, "main");
-            const vk::PipelineShaderStageCreateInfo fragShaderStageInfo({}, vk::ShaderStageFlagBits::eFragment, fragShaderModule, "main", &numTexturesSpecInfo);
+                const auto vertShaderModule = m_context.createShaderModule(vertShaderCode);
+                const auto fragShaderModule = m_context.createShaderModule(fragShaderCode);
 
-            const vk::PipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+                // scene constants (number of textures, material layout, light counts) and the reflection mode
+                const auto specInfo = constants.info();
 
-            // no vertex input
-            vk::PipelineVertexInputStateCreateInfo vertexInputInfo({}, 0, nullptr, 0, nullptr);
+                const vk::PipelineShaderStageCreateInfo vertShaderStageInfo({}, vk::ShaderStageFlagBits::eVertex, vertShaderModule, "main");
+                const vk::PipelineShaderStageCreateInfo fragShaderStageInfo({}, vk::ShaderStageFlagBits::eFragment, fragShaderModule, "main", &specInfo);
 
-            // everything else is standard
+                const vk::PipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
-            vk::PipelineInputAssemblyStateCreateInfo inputAssembly({}, vk::PrimitiveTopology::eTriangleList, false);
+                // no vertex input
+                vk::PipelineVertexInputStateCreateInfo vertexInputInfo({}, 0, nullptr, 0, nullptr);
 
-            vk::Viewport viewport(0.0f, 0.0f, static_cast<float>(m_context.getWidth()), static_cast<float>(m_context.getHeight()), 0.0f, 1.0f);
+                // everything else is standard
 
-            vk::Rect2D scissor({ 0, 0 }, m_context.getSwapChainExtent());
+                vk::PipelineInputAssemblyStateCreateInfo inputAssembly({}, vk::PrimitiveTopology::eTriangleList, false);
 
-            vk::PipelineViewportStateCreateInfo viewportState({}, 1, &viewport, 1, &scissor);
+                vk::Viewport viewport(0.0f, 0.0f, static_cast<float>(m_context.getWidth()), static_cast<float>(m_context.getHeight()), 0.0f, 1.0f);
 
-            vk::PipelineRasterizationStateCreateInfo rasterizer({}, false, false,
-                vk::PolygonMode::eFill, vk::CullModeFlagBits::eFront, vk::FrontFace::eCounterClockwise,
-                false, 0, 0, 0, 1.0f);
+                vk::Rect2D scissor({ 0, 0 }, m_context.getSwapChainExtent());
 
-            vk::PipelineMultisampleStateCreateInfo multisampling({}, vk::SampleCountFlagBits::e1, false);
+                vk::PipelineViewportStateCreateInfo viewportState({}, 1, &viewport, 1, &scissor);
 
-            vk::PipelineDepthStencilStateCreateInfo depthStencil({}, true, true, vk::CompareOp::eLess);
+                vk::PipelineRasterizationStateCreateInfo rasterizer({}, false, false,
+                    vk::PolygonMode::eFill, vk::CullModeFlagBits::eFront, vk::FrontFace::eCounterClockwise,
+                    false, 0, 0, 0, 1.0f);
 
-            // no blending needed
-            vk::PipelineColorBlendAttachmentState colorBlendAttachment(false); // standard values for blending.
-            colorBlendAttachment.setColorWriteMask(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA);
+                vk::PipelineMultisampleStateCreateInfo multisampling({}, vk::SampleCountFlagBits::e1, false);
 
-            // standard values for now
-            vk::PipelineColorBlendStateCreateInfo colorBlending({}, false, vk::LogicOp::eCopy, 1, &colorBlendAttachment,
-                std::array<float, 4>{0.0f, 0.0f, 0.0f, 0.0f});
+                vk::PipelineDepthStencilStateCreateInfo depthStencil({}, true, true, vk::CompareOp::eLess);
 
+                // no blending needed
+                vk::PipelineColorBlendAttachmentState colorBlendAttachment(false); // standard values for blending.
+                colorBlendAttachment.setColorWriteMask(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA);
 
+                // standard values for now
+                vk::PipelineColorBlendStateCreateInfo colorBlending({}, false, vk::LogicOp::eCopy, 1, &colorBlendAttachment,
+                    std::array<float, 4>{0.0f, 0.0f, 0.0f, 0.0f});
 
-            // push view & proj matrix
-            std::array vpcr = {
-                vk::PushConstantRange{vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, 2 * sizeof(glm::mat4) + sizeof(glm::vec4) + sizeof(float) + sizeof(int32_t)}
-            };
+                // follows the swapchain extent, so a resize doesn't need new pipelines
+                std::array dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+                vk::PipelineDynamicStateCreateInfo dynamicState({}, static_cast<uint32_t>(dynamicStates.size()), dynamicStates.data());
 
-            std::array dsls = { m_fullScreenLightingDescriptorSetLayout, m_lightDescriptorSetLayout, m_allRTImageSampleDescriptorSetLayout };
-            vk::PipelineLayoutCreateInfo pipelineLayoutInfo({}, static_cast<uint32_t>(dsls.size()), dsls.data(), static_cast<uint32_t>(vpcr.size()), vpcr.data());
 
-            m_fullscreenLightingPipelineLayout = m_context.getDevice().createPipelineLayout(pipelineLayoutInfo);
+                vk::GraphicsPipelineCreateInfo pipelineInfo;
+                pipelineInfo.stageCount = 2;
+                pipelineInfo.pStages = shaderStages;
+                pipelineInfo.pVertexInputState = &vertexInputInfo;
+                pipelineInfo.pInputAssemblyState = &inputAssembly;
+                pipelineInfo.pViewportState = &viewportState;
+                pipelineInfo.pRasterizationState = &rasterizer;
+                pipelineInfo.pMultisampleState = &multisampling;
+                pipelineInfo.pDepthStencilState = &depthStencil;
+                pipelineInfo.pColorBlendState = &colorBlending;
+                pipelineInfo.pDynamicState = &dynamicState;
 
-            vk::GraphicsPipelineCreateInfo pipelineInfo;
-            pipelineInfo.stageCount = 2;
-            pipelineInfo.pStages = shaderStages;
-            pipelineInfo.pVertexInputState = &vertexInputInfo;
-            pipelineInfo.pInputAssemblyState = &inputAssembly;
-            pipelineInfo.pViewportState = &viewportState;
-            pipelineInfo.pRasterizationState = &rasterizer;
-            pipelineInfo.pMultisampleState = &multisampling;
-            pipelineInfo.pDepthStencilState = &depthStencil;
-            pipelineInfo.pColorBlendState = &colorBlending;
-            pipelineInfo.pDynamicState = nullptr;// &dynamicState;
+                pipelineInfo.layout = m_fullscreenLightingPipelineLayout;
+                pipelineInfo.renderPass = m_fullscreenLightingRenderpass;
+                pipelineInfo.subpass = 0;   // this is an index
+                // missing: pipeline derivation
 
-            pipelineInfo.layout = m_fullscreenLightingPipelineLayout;
-            pipelineInfo.renderPass = m_fullscreenLightingRenderpass;
-            pipelineInfo.subpass = 0;   // this is an index
-            // missing: pipeline derivation
+                const auto pipeline = m_context.getDevice().createGraphicsPipeline(nullptr, pipelineInfo);
 
-            m_fullscreenLightingPipeline = m_context.getDevice().createGraphicsPipeline(nullptr, pipelineInfo);
+                m_context.getDevice().destroyShaderModule(vertShaderModule);
+                m_context.getDevice().destroyShaderModule(fragShaderModule);
 
-            m_context.getDevice().destroyShaderModule(vertShaderModule);
-            m_context.getDevice().destroyShaderModule(fragShaderModule);
+                return pipeline;
+            });
         }
 
 
@@ -740,14 +764,16 @@ namespace vg
 
             vk::DescriptorSetLayoutCreateInfo layoutInfo({}, static_cast<uint32_t>(bindings.size()), bindings.data());
 
-            m_fullScreenLightingDescriptorSetLayout = m_context.getDevice().createDescriptorSetLayout(layoutInfo);
-
-
+            // called again after the render targets grew, then only the writes are needed
+            if (m_fullScreenLightingDescriptorSets.empty())
+            {
+                m_fullScreenLightingDescriptorSetLayout = m_context.getDevice().createDescriptorSetLayout(layoutInfo);
 
-            // create n descriptor sets, 1 for each multi-buffered gbuffer
-            std::vector<vk::DescriptorSetLayout> dsls(m_swapChainFramebuffers.size(), m_fullScreenLightingDescriptorSetLayout);
-            vk::DescriptorSetAllocateInfo desSetAllocInfo(m_combinedDescriptorPool, static_cast<uint32_t>(m_swapChainFramebuffers.size()), dsls.data());
-            m_fullScreenLightingDescriptorSets = m_context.getDevice().allocateDescriptorSets(desSetAllocInfo);
+                // create n descriptor sets, 1 for each multi-buffered gbuffer
+                std::vector<vk::DescriptorSetLayout> dsls(m_frameResourceCount, m_fullScreenLightingDescriptorSetLayout);
+                vk::DescriptorSetAllocateInfo desSetAllocInfo(m_combinedDescriptorPool, static_cast<uint32_t>(m_frameResourceCount), dsls.data());
+                m_fullScreenLightingDescriptorSets = m_context.getDevice().allocateDescriptorSets(desSetAllocInfo);
+            }
 
 
             std::vector<vk::DescriptorImageInfo> allImageInfos;
@@ -757,7 +783,7 @@ namespace vg
             }
             vk::DescriptorBufferInfo perMeshInformationIndirectDrawSSBOInfo(m_indirectDrawBufferInfo.m_Buffer, 0, VK_WHOLE_SIZE);
 
-            for (size_t i = 0; i < m_swapChainFramebuffers.size(); i++)
+            for (size_t i = 0; i < m_frameResourceCount; i++)
             {
                 //TODO coordinate bindings with shader
                 vk::WriteDescriptorSet descWritePerMeshInfo(m_fullScreenLightingDescriptorSets.at(i), 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &perMeshInformationIndirectDrawSSBOInfo, nullptr);
@@ -791,6 +817,7 @@ namespace vg
 
         void createSceneInformation(const char * foldername)
         {
+            VG_PROFILE_SCOPE("Scene loading");
             m_context.getLogger()->info("Loading Textures...");
             // load all images
             std::vector<ImageLoadInfo> loadedImages(m_scene.getIndexedBaseColorTexturePaths().size() + m_scene.getIndexedMetallicRoughnessTexturePaths().size());
@@ -799,6 +826,7 @@ namespace vg
 #pragma omp parallel for
             for (int i = 0; i < static_cast<int>(m_scene.getIndexedBaseColorTexturePaths().size()); i++)
             {
+                VG_PROFILE_SCOPE("Decode base color texture");
                 auto path = g_resourcesPath;
                 const auto name = std::string(std::string(foldername) + m_scene.getIndexedBaseColorTexturePaths().at(i).second);
                 path.append(name);
@@ -809,6 +837,7 @@ namespace vg
 #pragma omp parallel for
             for (int i = static_cast<int>(m_scene.getIndexedBaseColorTexturePaths().size()); i < static_cast<int>(loadedImages.size()); i++)
             {
+                VG_PROFILE_SCOPE("Decode metallic roughness texture");
                 auto path = g_resourcesPath;
                 const auto name = std::string(std::string(foldername) + m_scene.getIndexedMetallicRoughnessTexturePaths().at(i - m_scene.getIndexedBaseColorTexturePaths().size()).second);
                 path.append(name);
@@ -913,7 +942,7 @@ namespace vg
 
         void createRTResources()
         {
-            const auto ext = m_context.getSwapChainExtent();
+            const auto ext = m_targetCapacity;
             auto cmdBuf = beginSingleTimeCommands(m_commandPool);
 
          
@@ -922,15 +951,16 @@ namespace vg
             // rtao image: float32 image
 
             // multi-buffered for whatever reason
+            // transfer sources too, so captureRTTerms can read the terms back
 
-            for (size_t i = 0; i < m_context.getSwapChainImages().size(); i++)
+            for (size_t i = 0; i < m_frameResourceCount; i++)
             {
                 // shadow image arrays (layered images)
                 m_rtSoftShadowDirectionalImageInfos.push_back(
                     createImage(ext.width, ext.height, 1,
                         vk::Format::eR32Sfloat,
                         vk::ImageTiling::eOptimal,
-                        vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled,
+                        vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc,
                         VMA_MEMORY_USAGE_GPU_ONLY,
                         vk::SharingMode::eExclusive, 0,
                         static_cast<int32_t>(m_lightManager.getDirectionalLights().size()))
@@ -940,7 +970,7 @@ namespace vg
                     createImage(ext.width, ext.height, 1,
                         vk::Format::eR32Sfloat,
                         vk::ImageTiling::eOptimal,
-                        vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled,
+                        vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc,
                         VMA_MEMORY_USAGE_GPU_ONLY,
                         vk::SharingMode::eExclusive, 0,
                         static_cast<int32_t>(m_lightManager.getPointLights().size()))
@@ -950,7 +980,7 @@ namespace vg
                     createImage(ext.width, ext.height, 1,
                         vk::Format::eR32Sfloat,
                         vk::ImageTiling::eOptimal,
-                        vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled,
+                        vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc,
                         VMA_MEMORY_USAGE_GPU_ONLY,
                         vk::SharingMode::eExclusive, 0,
                         static_cast<int32_t>(m_lightManager.getPointLights().size()))
@@ -1009,7 +1039,7 @@ namespace vg
                     createImage(ext.width, ext.height, 1,
                         vk::Format::eR32Sfloat,
                         vk::ImageTiling::eOptimal,
-                        vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled,
+                        vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc,
                         VMA_MEMORY_USAGE_GPU_ONLY,
                         vk::SharingMode::eExclusive, 0,
                         1)
@@ -1036,7 +1066,7 @@ namespace vg
 					createImage(ext.width, ext.height, 1,
 						vk::Format::eR32G32B32A32Sfloat,
 						vk::ImageTiling::eOptimal,
-						vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled,
+						vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc,
 						VMA_MEMORY_USAGE_GPU_ONLY,
 						vk::SharingMode::eExclusive, 0,
 						1)
@@ -1063,7 +1093,7 @@ namespace vg
                     createImage(ext.width/2, ext.height/2, 1,
                         vk::Format::eR32G32B32A32Sfloat,
                         vk::ImageTiling::eOptimal,
-                        vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled,
+                        vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc,
                         VMA_MEMORY_USAGE_GPU_ONLY,
                         vk::SharingMode::eExclusive, 0,
                         1)
@@ -1150,8 +1180,8 @@ namespace vg
             m_allRTImageSampleDescriptorSetLayout = m_context.getDevice().createDescriptorSetLayout(layoutInfo);
 
             // create n descriptor sets, 1 for each multi-buffered gbuffer
-            std::vector<vk::DescriptorSetLayout> dsls(m_swapChainFramebuffers.size(), m_allRTImageSampleDescriptorSetLayout);
-            vk::DescriptorSetAllocateInfo desSetAllocInfo(m_combinedDescriptorPool, static_cast<uint32_t>(m_swapChainFramebuffers.size()), dsls.data());
+            std::vector<vk::DescriptorSetLayout> dsls(m_frameResourceCount, m_allRTImageSampleDescriptorSetLayout);
+            vk::DescriptorSetAllocateInfo desSetAllocInfo(m_combinedDescriptorPool, static_cast<uint32_t>(m_frameResourceCount), dsls.data());
             m_allRTImageSampleDescriptorSets = m_context.getDevice().allocateDescriptorSets(desSetAllocInfo);
 
 
@@ -1170,8 +1200,8 @@ namespace vg
             m_shadowImageStoreDescriptorSetLayout = m_context.getDevice().createDescriptorSetLayout(layoutInfo1);
 
             // create n descriptor sets, 1 for each multi-buffered gbuffer
-            std::vector<vk::DescriptorSetLayout> dsls1(m_swapChainFramebuffers.size(), m_shadowImageStoreDescriptorSetLayout);
-            vk::DescriptorSetAllocateInfo desSetAllocInfo1(m_combinedDescriptorPool, static_cast<uint32_t>(m_swapChainFramebuffers.size()), dsls1.data());
+            std::vector<vk::DescriptorSetLayout> dsls1(m_frameResourceCount, m_shadowImageStoreDescriptorSetLayout);
+            vk::DescriptorSetAllocateInfo desSetAllocInfo1(m_combinedDescriptorPool, static_cast<uint32_t>(m_frameResourceCount), dsls1.data());
             m_shadowImageStoreDescriptorSets = m_context.getDevice().allocateDescriptorSets(desSetAllocInfo1);
 
             vk::DescriptorSetLayoutBinding rtAOImageStoreBinding(0, vk::DescriptorType::eStorageImage, 1, ssf::eRaygenNV, nullptr);
@@ -1184,11 +1214,17 @@ namespace vg
             m_rtAOImageStoreDescriptorSetLayout = m_context.getDevice().createDescriptorSetLayout(layoutInfo2);
 
 
-            std::vector<vk::DescriptorSetLayout> dsls2(m_swapChainFramebuffers.size(), m_rtAOImageStoreDescriptorSetLayout);
-            vk::DescriptorSetAllocateInfo desSetAllocInfo2(m_combinedDescriptorPool, static_cast<uint32_t>(m_swapChainFramebuffers.size()), dsls2.data());
+            std::vector<vk::DescriptorSetLayout> dsls2(m_frameResourceCount, m_rtAOImageStoreDescriptorSetLayout);
+            vk::DescriptorSetAllocateInfo desSetAllocInfo2(m_combinedDescriptorPool, static_cast<uint32_t>(m_frameResourceCount), dsls2.data());
             m_rtAOImageStoreDescriptorSets = m_context.getDevice().allocateDescriptorSets(desSetAllocInfo2);
-            
-            for (size_t i = 0; i < m_swapChainFramebuffers.size(); i++)
+
+            writeRTImageDescriptors();
+        }
+
+        // separate from the allocation, the images are replaced when the render targets grow
+        void writeRTImageDescriptors()
+        {
+            for (size_t i = 0; i < m_frameResourceCount; i++)
             {
 
                 // sampling descriptor set
@@ -1245,7 +1281,7 @@ namespace vg
 
         void createRandomImage()
         {
-            const auto ext = m_context.getSwapChainExtent();
+            const auto ext = m_targetCapacity;
 
             vk::DeviceSize imageSize = ext.width * ext.height * 4;
             auto sizeInBytes = imageSize * sizeof(uint32_t);
@@ -1265,7 +1301,7 @@ namespace vg
             auto cmdBuf = beginSingleTimeCommands(m_commandPool);
 
             // multi-buffered random image
-            for(size_t i = 0; i < m_swapChainFramebuffers.size(); i++)
+            for(size_t i = 0; i < m_frameResourceCount; i++)
             {
                 using us = vk::ImageUsageFlagBits;
                 m_randomImageInfos.push_back(createImage(ext.width, ext.height, 1, vk::Format::eR32G32B32A32Uint, vk::ImageTiling::eOptimal,
@@ -1320,30 +1356,41 @@ namespace vg
             endSingleTimeCommands(cmdBuf, m_context.getGraphicsQueue(), m_commandPool);
 
             vmaDestroyBuffer(m_context.getAllocator(), stagingBuffer.m_Buffer, stagingBuffer.m_BufferAllocation);
+        }
 
-            m_sampleCounts = std::vector<int32_t>(m_swapChainFramebuffers.size(), 0);
+        void createRTPerFrameInfoBuffers()
+        {
+            m_sampleCounts = std::vector<int32_t>(m_frameResourceCount, 0);
             std::vector<RTperFrameInfoCombined> initdata(1);
-            for(size_t i = 0; i < m_swapChainFramebuffers.size(); i++)
+            for(size_t i = 0; i < m_frameResourceCount; i++)
                 m_rtPerFrameInfoBufferInfos.push_back(fillBufferTroughStagedTransfer(initdata, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst));
         }
 
 
         void createAccelerationStructure()
         {
+            VG_PROFILE_SCOPE("Acceleration structure build");
             //TODO for this function:
             //	* use less for-loops and indices, some can be merged
             //	* support using transforms (?)
 
+            // meshes that move keep an instance of their own, everything else may be merged
+            std::set<uint32_t> dynamicMeshes = { static_cast<uint32_t>(m_animatedObjectID) };
+            if (m_benchmark != nullptr && m_benchmark->getScript().getAnimation().has_value())
+                dynamicMeshes.insert(static_cast<uint32_t>(std::min(m_benchmark->getScript().getAnimation()->objectID, static_cast<int>(m_scene.getModelMatrices().size()) - 1)));
+            m_blasPartition = BlasPartition(m_scene, m_blasPartitionPolicy, dynamicMeshes);
+
             //// Helper Buffers for Ray Tracing
 
             // Offset Buffer
-
+            // primitives are numbered per group, the hit shaders find the mesh of a primitive through the primitive mesh buffer
             struct OffsetInfo
             {
                 int m_vbOffset = 0;
                 int m_ibOffset = 0;
                 int m_baseColorTextureID = -1;
                 int m_metallicRoughnessTextureID = -1;
+                int m_firstPrimitive = 0;
             };
 
             std::vector<OffsetInfo> offsetInfos;
@@ -1351,29 +1398,57 @@ namespace vg
             int j = 0;
             for (const PerMeshInfoPBR& meshInfo : m_scene.getDrawCommandData())
             {
-                offsetInfos.push_back(OffsetInfo{ meshInfo.vertexOffset, indexOffset0, meshInfo.texIndexBaseColor, meshInfo.texIndexMetallicRoughness });
+                offsetInfos.push_back(OffsetInfo{ meshInfo.vertexOffset, indexOffset0, meshInfo.texIndexBaseColor, meshInfo.texIndexMetallicRoughness,
+                    static_cast<int>(m_blasPartition.getFirstPrimitiveOfMesh(j)) });
                 indexOffset0 += meshInfo.indexCount;
 
                 j++;
             }
             m_offsetBufferInfo = fillBufferTroughStagedTransfer(offsetInfos, vk::BufferUsageFlagBits::eStorageBuffer);
+            m_primitiveMeshBufferInfo = fillBufferTroughStagedTransfer(m_blasPartition.getPrimitiveMeshes(), vk::BufferUsageFlagBits::eStorageBuffer);
 
-            std::vector<vk::GeometryNV> geometryVec;
-
-            // TODO 1 Mesh = 1 BLAS + GeometryInstance w/ ModelMatrix as Transform
+            // merged groups are built from world space copies of their vertices, only needed until the bottom level build
+            const auto bakedGeometry = m_blasPartition.bake(m_scene);
+            BufferInfo bakedPositionBufferInfo;
+            BufferInfo bakedIndexBufferInfo;
+            if (!bakedGeometry.positions.empty())
+            {
+                bakedPositionBufferInfo = fillBufferTroughStagedTransfer(bakedGeometry.positions, vk::BufferUsageFlagBits::eRayTracingNV);
+                bakedIndexBufferInfo = fillBufferTroughStagedTransfer(bakedGeometry.indices, vk::BufferUsageFlagBits::eRayTracingNV);
+            }
 
+            // 1 geometry = 1 group of the partition, either a baked group or a single mesh placed by its instance
+            const auto& groups = m_blasPartition.getGroups();
+            std::vector<vk::GeometryNV> geometryVec(groups.size());
+            for (size_t g = 0; g < groups.size(); g++)
+            {
+                if (!groups.at(g).baked)
+                    continue;
 
-            //std::vector<glm::mat4x3> transforms;
-            //for (const auto& modelMatrix : m_scene.getModelMatrices())
-            //    transforms.emplace_back(toRowMajor4x3(modelMatrix));
+                vk::GeometryTrianglesNV triangles;
+                triangles.vertexData = bakedPositionBufferInfo.m_Buffer;
+                triangles.vertexOffset = bakedGeometry.firstVertex.at(g) * sizeof(glm::vec3);
+                triangles.vertexCount = bakedGeometry.vertexCount.at(g);
+                triangles.vertexStride = sizeof(glm::vec3);
+                triangles.vertexFormat = vk::Format::eR32G32B32Sfloat;
+                triangles.indexData = bakedIndexBufferInfo.m_Buffer;
+                triangles.indexOffset = bakedGeometry.firstIndex.at(g) * sizeof(uint32_t);
+                triangles.indexCount = groups.at(g).triangleCount * 3;
+                triangles.indexType = vk::IndexType::eUint32;
 
-            //m_transformBufferInfo = fillBufferTroughStagedTransfer(transforms, vk::BufferUsageFlagBits::eRayTracingNV);
+                geometryVec.at(g) = vk::GeometryNV(vk::GeometryTypeNV::eTriangles, vk::GeometryDataNV(triangles, {}), vk::GeometryFlagBitsNV::eOpaque);
+            }
 
-            // currently: 1 geometry = 1 mesh
             size_t c = 0;
             uint64_t indexOffset = 0;
             for (const PerMeshInfoPBR& meshInfo : m_scene.getDrawCommandData())
             {
+                if (m_blasPartition.isBaked(c))
+                {
+                    indexOffset += meshInfo.indexCount;
+                    c++;
+                    continue;
+                }
 
                 uint32_t vertexCount = 0;
 
@@ -1393,20 +1468,18 @@ namespace vg
                 triangles.indexOffset = indexOffset * sizeof(std::decay_t<decltype(m_scene.getIndices())>::value_type);
                 triangles.indexCount = meshInfo.indexCount;
                 triangles.indexType = vk::IndexType::eUint32;
-                triangles.transformData = nullptr;// m_transformBufferInfo.m_Buffer;
-                triangles.transformOffset = 0;// c * sizeof(glm::mat4x3);
 
                 indexOffset += meshInfo.indexCount;
 
                 vk::GeometryDataNV geoData(triangles, {});
                 vk::GeometryNV geom(vk::GeometryTypeNV::eTriangles, geoData, vk::GeometryFlagBitsNV::eOpaque);
 
-                geometryVec.push_back(geom);
+                geometryVec.at(m_blasPartition.getGroupOfMesh(c)) = geom;
                 c++;
             }
 
             auto createActualAcc = [&]
-            (vk::AccelerationStructureTypeNV type, uint32_t geometryCount, vk::GeometryNV* geometries, uint32_t instanceCount, vk::BuildAccelerationStructureFlagsNV flags) -> ASInfo
+            (vk::AccelerationStructureTypeNV type, uint32_t geometryCount, vk::GeometryNV* geometries, uint32_t instanceCount, vk::BuildAccelerationStructureFlagsNV flags, vk::DeviceSize compactedSize = 0) -> ASInfo
             {
                 auto findMemoryType = [&](uint32_t typeFilter, VkMemoryPropertyFlags properties) -> uint32_t
                 {
@@ -1426,7 +1499,7 @@ namespace vg
 
                 ASInfo returnInfo;
                 vk::AccelerationStructureInfoNV asInfo(type, flags, instanceCount, geometryCount, geometries);
-                vk::AccelerationStructureCreateInfoNV accStrucInfo(0, asInfo);
+                vk::AccelerationStructureCreateInfoNV accStrucInfo(compactedSize, asInfo);
                 returnInfo.m_AS = m_context.getDevice().createAccelerationStructureNV(accStrucInfo);
 
                 vk::AccelerationStructureMemoryRequirementsInfoNV memReqAS(vk::AccelerationStructureMemoryRequirementsTypeNV::eObject, returnInfo.m_AS);
@@ -1448,36 +1521,18 @@ namespace vg
             };
             using basf = vk::BuildAccelerationStructureFlagBitsNV;
 
+            const vk::BuildAccelerationStructureFlagsNV blasFlags = m_compactBottomLevelAS ? basf::ePreferFastTrace | basf::eAllowCompaction : basf::ePreferFastTrace;
             for (auto& geometry : geometryVec)
-                m_bottomASs.push_back(createActualAcc(vk::AccelerationStructureTypeNV::eBottomLevel, 1, &geometry, 0, basf::ePreferFastTrace));
-
-
-            std::vector<GeometryInstance> instances;
-
-            int count = 0;
-            for (const auto& modelMatrix : m_scene.getModelMatrices())
-            {
-                GeometryInstance instance = {};
-                auto transform = toRowMajor4x3(modelMatrix);
-                memcpy(instance.transform, glm::value_ptr(transform), sizeof(instance.transform));
-                instance.instanceId = count;
-                instance.mask = 0xff;
-                instance.instanceOffset = 0;
-                instance.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_CULL_DISABLE_BIT_NV;
-
-                const auto res = m_context.getDevice().getAccelerationStructureHandleNV(m_bottomASs.at(count).m_AS, sizeof(uint64_t), &instance.accelerationStructureHandle);
-                if (res != vk::Result::eSuccess) throw std::runtime_error("AS Handle could not be retrieved");
-
-                instances.push_back(instance);
-                count++;
-            }
-
-            // todo this buffer is gpu only. maybe change this to make it host visible & coherent like it is in the examples.
-            // probaby wont be needed if the instanced is not transformed later on
-            m_instanceBufferInfo = fillBufferTroughStagedTransferForComputeQueue(instances, vk::BufferUsageFlagBits::eRayTracingNV);
-
+                m_bottomASs.push_back(createActualAcc(vk::AccelerationStructureTypeNV::eBottomLevel, 1, &geometry, 0, blasFlags));
 
-            m_topAS = createActualAcc(vk::AccelerationStructureTypeNV::eTopLevel, 0, nullptr, 1, basf::ePreferFastTrace | basf::eAllowUpdate);
+            // the builds of a batch overlap on the GPU, each one has its own scratch region
+            BlasBuildScheduler blasScheduler(m_context);
+            for (size_t i = 0; i < geometryVec.size(); i++)
+                blasScheduler.add(m_bottomASs.at(i).m_AS, vk::AccelerationStructureInfoNV(vk::AccelerationStructureTypeNV::eBottomLevel, blasFlags, 0, 1, &geometryVec.at(i)));
+            const vk::DeviceSize blasScratchSize = blasScheduler.plan();
+            // one top level structure per frame slot, so updating the one of a frame never touches one that is still traced
+            for (size_t i = 0; i < m_frameResourceCount; i++)
+                m_topASs.push_back(createActualAcc(vk::AccelerationStructureTypeNV::eTopLevel, 0, nullptr, static_cast<uint32_t>(groups.size()), basf::ePreferFastTrace | basf::eAllowUpdate));
 
             auto GetScratchBufferSize = [&](vk::AccelerationStructureNV handle)
             {
@@ -1489,22 +1544,20 @@ namespace vg
                 return result;
             };
 
-            vk::DeviceSize maxBLASSize = 0;
-            for (const auto& blas : m_bottomASs)
-            {
-                maxBLASSize = std::max(GetScratchBufferSize(blas.m_AS), maxBLASSize);
-            }
+            // the bottom level scratch is only needed for the initial build, the top level ones are kept for the updates
+            auto blasScratchBuffer = createBuffer(blasScratchSize, vk::BufferUsageFlagBits::eRayTracingNV, VMA_MEMORY_USAGE_GPU_ONLY);
 
             //VkDeviceSize bottomAccelerationStructureBufferSize = GetScratchBufferSize(m_bottomAS.m_AS);
-            VkDeviceSize topAccelerationStructureBufferSize = GetScratchBufferSize(m_topAS.m_AS);
-            VkDeviceSize scratchBufferSize = std::max(maxBLASSize, topAccelerationStructureBufferSize);
+            // the update scratch is never bigger than the build scratch
+            VkDeviceSize topAccelerationStructureBufferSize = GetScratchBufferSize(m_topASs.front().m_AS);
+            VkDeviceSize scratchBufferSize = topAccelerationStructureBufferSize;
 
             vg::QueueFamilyIndices indices = m_context.findQueueFamilies(m_context.getPhysicalDevice());
             std::array queueFamilyIndices = { indices.graphicsFamily.value(), indices.computeFamily.value() };
             vk::BufferCreateInfo bufferCreateInfo({}, scratchBufferSize, vk::BufferUsageFlagBits::eRayTracingNV, vk::SharingMode::eConcurrent, static_cast<uint32_t>(queueFamilyIndices.size()), queueFamilyIndices.data());
-            allocBufferVma(m_scratchBuffer, bufferCreateInfo, VMA_MEMORY_USAGE_GPU_ONLY);
-
-            //m_scratchBuffer = createBuffer(scratchBufferSize, vk::BufferUsageFlagBits::eRayTracingNV, VMA_MEMORY_USAGE_GPU_ONLY);
+            m_topASScratchBuffers.resize(m_topASs.size());
+            for (auto& scratchBuffer : m_topASScratchBuffers)
+                allocBufferVma(scratchBuffer, bufferCreateInfo, VMA_MEMORY_USAGE_GPU_ONLY);
 
             //// compute shader test
             //const auto csc = Utility::readFile("combined/test.comp" + shaderExtension);
@@ -1523,9 +1576,6 @@ namespace vg
             //endSingleTimeCommands(cmdBufComp, m_context.getComputeQueue(), m_computeCommandPool);
             //m_context.getDevice().waitIdle();
 
-            auto cmdBuf = beginSingleTimeCommands(m_commandPool);
-            m_timerManager.writeTimestampStart("AS Build", cmdBuf, vk::PipelineStageFlagBits::eAccelerationStructureBuildNV, 0);
-
 #undef MemoryBarrier
             vk::MemoryBarrier memoryBarrier(
                 vk::AccessFlagBits::eAccelerationStructureWriteNV | vk::AccessFlagBits::eAccelerationStructureReadNV,
@@ -1533,31 +1583,165 @@ namespace vg
             );
 #define MemoryBarrier __faststorefence
 
-            //todo remove this when the SDK update happened
-            auto OwnCmdBuildAccelerationStructureNV = reinterpret_cast<PFN_vkCmdBuildAccelerationStructureNV>(vkGetDeviceProcAddr(m_context.getDevice(), "vkCmdBuildAccelerationStructureNV"));
+            // the compacted sizes can only be read once the bottom level build finished, so compaction needs a submit of its own
+            vk::QueryPool compactedSizePool;
+            if (m_compactBottomLevelAS)
+                compactedSizePool = m_context.getDevice().createQueryPool({ {}, vk::QueryType::eAccelerationStructureCompactedSizeNV, static_cast<uint32_t>(m_bottomASs.size()) });
 
-            for (size_t i = 0; i < geometryVec.size(); i++)
+            auto cmdBuf = beginSingleTimeCommands(m_commandPool);
+            {
+                GpuTimerScope timerScope(m_timerManager, cmdBuf, "AS Build", 0, vk::PipelineStageFlagBits::eAccelerationStructureBuildNV, true);
+                {
+                    GpuTimerScope bottomLevelScope(m_timerManager, cmdBuf, "Bottom level", 0, vk::PipelineStageFlagBits::eAccelerationStructureBuildNV);
+                    const auto batchCount = blasScheduler.getBatches().size();
+                    for (size_t batch = 0; batch < batchCount; batch++)
+                    {
+                        // every timed batch needs its own timer, with too many batches only the total is timed
+                        std::optional<GpuTimerScope> batchScope;
+                        if (batchCount <= s_maxTimedBlasBatches)
+                            batchScope.emplace(m_timerManager, cmdBuf, "Batch " + std::to_string(batch), 0, vk::PipelineStageFlagBits::eAccelerationStructureBuildNV);
+                        blasScheduler.cmdBuildBatch(cmdBuf, batch, blasScratchBuffer.m_Buffer);
+                    }
+                }
+                if (m_compactBottomLevelAS)
+                    blasScheduler.cmdWriteCompactedSizes(cmdBuf, compactedSizePool);
+            }
+            endSingleTimeCommands(cmdBuf, m_context.getGraphicsQueue(), m_commandPool);
+
+            vmaDestroyBuffer(m_context.getAllocator(), static_cast<VkBuffer>(blasScratchBuffer.m_Buffer), blasScratchBuffer.m_BufferAllocation);
+            if (!bakedGeometry.positions.empty())
             {
-                vk::AccelerationStructureInfoNV asInfoBot(vk::AccelerationStructureTypeNV::eBottomLevel, basf::ePreferFastTrace, 0, 1, &geometryVec.at(i));
-                OwnCmdBuildAccelerationStructureNV(cmdBuf, reinterpret_cast<VkAccelerationStructureInfoNV*>(&asInfoBot), nullptr, 0, VK_FALSE, m_bottomASs.at(i).m_AS, nullptr, m_scratchBuffer.m_Buffer, 0);
-                //cmdBuf.buildAccelerationStructureNV(asInfoBot, nullptr, 0, VK_FALSE, m_bottomAS.m_AS, nullptr, m_scratchBuffer.m_Buffer, 0);
-                cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eAccelerationStructureBuildNV, vk::PipelineStageFlagBits::eAccelerationStructureBuildNV, {}, memoryBarrier, nullptr, nullptr);
+                vmaDestroyBuffer(m_context.getAllocator(), static_cast<VkBuffer>(bakedPositionBufferInfo.m_Buffer), bakedPositionBufferInfo.m_BufferAllocation);
+                vmaDestroyBuffer(m_context.getAllocator(), static_cast<VkBuffer>(bakedIndexBufferInfo.m_Buffer), bakedIndexBufferInfo.m_BufferAllocation);
+            }
+
+            const auto getBottomLevelASMemory = [this]()
+            {
+                vk::DeviceSize size = 0;
+                for (const auto& blas : m_bottomASs)
+                    size += blas.m_BufferAllocInfo.size;
+                return size;
+            };
+            const auto uncompactedMemory = getBottomLevelASMemory();
+
+            if (m_compactBottomLevelAS)
+            {
+                std::vector<vk::DeviceSize> compactedSizes(m_bottomASs.size());
+                const auto res = m_context.getDevice().getQueryPoolResults(compactedSizePool, 0, static_cast<uint32_t>(compactedSizes.size()), compactedSizes.size() * sizeof(vk::DeviceSize),
+                    compactedSizes.data(), sizeof(vk::DeviceSize), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+                if (res != vk::Result::eSuccess)
+                    throw std::runtime_error("Compacted acceleration structure sizes could not be retrieved");
+                m_context.getDevice().destroyQueryPool(compactedSizePool);
+
+                //todo remove this when the SDK update happened
+                auto OwnCmdCopyAccelerationStructureNV = reinterpret_cast<PFN_vkCmdCopyAccelerationStructureNV>(vkGetDeviceProcAddr(m_context.getDevice(), "vkCmdCopyAccelerationStructureNV"));
+
+                std::vector<ASInfo> compactedASs;
+                compactedASs.reserve(m_bottomASs.size());
+                auto cmdBufCompaction = beginSingleTimeCommands(m_commandPool);
+                {
+                    GpuTimerScope compactionScope(m_timerManager, cmdBufCompaction, "AS Build/Compaction", 0, vk::PipelineStageFlagBits::eAccelerationStructureBuildNV, true);
+                    for (size_t i = 0; i < m_bottomASs.size(); i++)
+                    {
+                        compactedASs.push_back(createActualAcc(vk::AccelerationStructureTypeNV::eBottomLevel, 0, nullptr, 0, blasFlags, compactedSizes.at(i)));
+                        OwnCmdCopyAccelerationStructureNV(cmdBufCompaction, compactedASs.back().m_AS, m_bottomASs.at(i).m_AS, VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_NV);
+                    }
+                    cmdBufCompaction.pipelineBarrier(vk::PipelineStageFlagBits::eAccelerationStructureBuildNV, vk::PipelineStageFlagBits::eAccelerationStructureBuildNV, {}, memoryBarrier, nullptr, nullptr);
+                }
+                endSingleTimeCommands(cmdBufCompaction, m_context.getGraphicsQueue(), m_commandPool);
 
+                for (const auto& blas : m_bottomASs)
+                {
+                    m_context.getDevice().destroyAccelerationStructureNV(blas.m_AS);
+                    vmaFreeMemory(m_context.getAllocator(), blas.m_BufferAllocation);
+                }
+                m_bottomASs = std::move(compactedASs);
             }
 
-            vk::AccelerationStructureInfoNV asInfoTop(vk::AccelerationStructureTypeNV::eTopLevel, basf::ePreferFastTrace | basf::eAllowUpdate, static_cast<uint32_t>(instances.size()), 0, nullptr);
-            OwnCmdBuildAccelerationStructureNV(cmdBuf, reinterpret_cast<VkAccelerationStructureInfoNV*>(&asInfoTop), m_instanceBufferInfo.m_Buffer, 0, VK_FALSE, m_topAS.m_AS, nullptr, m_scratchBuffer.m_Buffer, 0);
-            //cmdBuf.buildAccelerationStructureNV(asInfoTop, m_instanceBufferInfo.m_Buffer, 0, VK_FALSE, m_topAS.m_AS, nullptr, m_scratchBuffer.m_Buffer, 0);
-            cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eAccelerationStructureBuildNV, vk::PipelineStageFlagBits::eRayTracingShaderNV, {}, memoryBarrier, nullptr, nullptr);
+            // the instances point to the final (compacted) bottom level structures, one instance per group
+            std::vector<GeometryInstance> instances;
 
-            m_timerManager.writeTimestampStop("AS Build", cmdBuf, vk::PipelineStageFlagBits::eAccelerationStructureBuildNV, 0);
-            endSingleTimeCommands(cmdBuf, m_context.getGraphicsQueue(), m_commandPool);
+            if (m_blasPartition.getPrimitiveMeshes().size() >= (1u << 24))
+                throw std::runtime_error("Too many triangles for the 24 bit custom index of the instances");
+            for (size_t count = 0; count < groups.size(); count++)
+            {
+                const auto& group = groups.at(count);
+                GeometryInstance instance = {};
+                // baked groups already are in world space
+                auto transform = toRowMajor4x3(group.baked ? glm::mat4(1.0f) : m_scene.getModelMatrices().at(group.meshes.front()));
+                memcpy(instance.transform, glm::value_ptr(transform), sizeof(instance.transform));
+                instance.instanceId = group.firstPrimitive;
+                instance.mask = 0xff;
+                instance.instanceOffset = 0;
+                instance.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_CULL_DISABLE_BIT_NV;
+
+                const auto res = m_context.getDevice().getAccelerationStructureHandleNV(m_bottomASs.at(count).m_AS, sizeof(uint64_t), &instance.accelerationStructureHandle);
+                if (res != vk::Result::eSuccess) throw std::runtime_error("AS Handle could not be retrieved");
+
+                instances.push_back(instance);
+            }
+
+            // host visible and persistently mapped, every top level structure reads the instances from its own slot
+            m_instanceRing.emplace(m_context, instances, static_cast<uint32_t>(m_topASs.size()));
+
+            // the automatic update mode tracks how far the instances moved since each top level structure was built
+            std::vector<TlasUpdatePolicy::Bounds> instanceBounds;
+            std::vector<glm::mat4> instanceTransforms;
+            for (size_t count = 0; count < groups.size(); count++)
+            {
+                const auto [min, max] = m_blasPartition.getBounds(m_scene, count);
+                instanceBounds.push_back({ min, max });
+                instanceTransforms.push_back(groups.at(count).baked ? glm::mat4(1.0f) : m_scene.getModelMatrices().at(groups.at(count).meshes.front()));
+            }
+            m_tlasUpdatePolicy.setInstances(static_cast<uint32_t>(m_topASs.size()), std::move(instanceBounds), instanceTransforms);
+
+            auto cmdBufTopLevel = beginSingleTimeCommands(m_commandPool);
+            {
+                GpuTimerScope topLevelScope(m_timerManager, cmdBufTopLevel, "AS Build/Top level", 0, vk::PipelineStageFlagBits::eAccelerationStructureBuildNV, true);
+
+                //todo remove this when the SDK update happened
+                auto OwnCmdBuildAccelerationStructureNV = reinterpret_cast<PFN_vkCmdBuildAccelerationStructureNV>(vkGetDeviceProcAddr(m_context.getDevice(), "vkCmdBuildAccelerationStructureNV"));
+
+                vk::AccelerationStructureInfoNV asInfoTop(vk::AccelerationStructureTypeNV::eTopLevel, basf::ePreferFastTrace | basf::eAllowUpdate, static_cast<uint32_t>(instances.size()), 0, nullptr);
+                for (uint32_t i = 0; i < static_cast<uint32_t>(m_topASs.size()); i++)
+                {
+                    OwnCmdBuildAccelerationStructureNV(cmdBufTopLevel, reinterpret_cast<VkAccelerationStructureInfoNV*>(&asInfoTop), m_instanceRing->getBuffer(), m_instanceRing->getSlotOffset(i), VK_FALSE,
+                        m_topASs.at(i).m_AS, nullptr, m_topASScratchBuffers.at(i).m_Buffer, 0);
+                }
+                cmdBufTopLevel.pipelineBarrier(vk::PipelineStageFlagBits::eAccelerationStructureBuildNV, vk::PipelineStageFlagBits::eRayTracingShaderNV, {}, memoryBarrier, nullptr, nullptr);
+            }
+            endSingleTimeCommands(cmdBufTopLevel, m_context.getGraphicsQueue(), m_commandPool);
 
             m_context.getDevice().waitIdle();
 
             m_timerManager.querySpecificTimerResults("AS Build", 0);
-            auto timeDiffs = m_timerManager.getTimer("AS Build").getTimeDiffs();
-            m_context.getLogger()->info("Acceleration Structure Build took {} ms for {} meshes, {} triangles", timeDiffs.front(), instances.size(), m_scene.getIndices().size() / 3);
+            // a scope that found the timer query pool full has no timer
+            const auto getBuildTime = [this](const std::string& timer)
+            {
+                const auto it = m_timerManager.getTimers().find(timer);
+                return it != m_timerManager.getTimers().end() ? it->second.getStatistics().getSummary().last : 0.0f;
+            };
+            const auto compactionTime = m_compactBottomLevelAS ? getBuildTime("AS Build/Compaction") : 0.0f;
+            const auto buildTime = getBuildTime("AS Build/Bottom level") + compactionTime + getBuildTime("AS Build/Top level");
+            m_context.getLogger()->info("Acceleration Structure Build took {} ms for {} meshes, {} triangles (bottom level {} ms, compaction {} ms, top level {} ms)", buildTime, m_scene.getDrawCommandData().size(), m_scene.getIndices().size() / 3,
+                getBuildTime("AS Build/Bottom level"), compactionTime, getBuildTime("AS Build/Top level"));
+            const auto bakedGroups = static_cast<size_t>(std::count_if(groups.begin(), groups.end(), [](const auto& group) { return group.baked; }));
+            m_context.getLogger()->info("BLAS partition {}: {} instances, {} of them merged from {} static meshes", m_blasPartitionPolicy.toString(), instances.size(), bakedGroups,
+                m_scene.getDrawCommandData().size() - (groups.size() - bakedGroups));
+            const auto& batches = blasScheduler.getBatches();
+            m_context.getLogger()->info("{} bottom level builds in {} batches, {} MiB scratch", blasScheduler.getBuildCount(), batches.size(), blasScratchSize / (1024 * 1024));
+            for (size_t batch = 0; batch < batches.size() && batches.size() <= s_maxTimedBlasBatches; batch++)
+            {
+                m_context.getLogger()->info("  batch {}: {} builds, {} KiB scratch, {} ms", batch, batches.at(batch).builds.size(), batches.at(batch).scratchSize / 1024,
+                    getBuildTime("AS Build/Bottom level/Batch " + std::to_string(batch)));
+            }
+            if (m_compactBottomLevelAS)
+                m_context.getLogger()->info("Bottom level acceleration structures: {:.2f} MiB, compacted {:.2f} MiB", uncompactedMemory / (1024.0 * 1024.0), getBottomLevelASMemory() / (1024.0 * 1024.0));
+            else
+                m_context.getLogger()->info("Bottom level acceleration structures: {:.2f} MiB", uncompactedMemory / (1024.0 * 1024.0));
+            // the trace time of a policy shows in the timers of the RT passes
+            m_accelerationStructureStats = { m_blasPartitionPolicy.toString(), static_cast<uint32_t>(m_bottomASs.size()), static_cast<uint32_t>(instances.size()),
+                getBottomLevelASMemory(), m_topASs.front().m_BufferAllocInfo.size * m_topASs.size(), buildTime };
             //m_context.getLogger()->info("Flags: {}, {}", vk::to_string(basf::ePreferFastTrace), vk::to_string(basf::eAllowUpdate));
 
             m_timerManager.eraseTimer("AS Build");
@@ -1569,106 +1753,131 @@ namespace vg
             }
         }
 
-        void createRTSoftShadowsPipeline()
+        std::shared_future<vk::Pipeline> createRTSoftShadowsPipeline()
         {
-            //// 1. DSL
+            //// 1. DSL & Pipeline Layout (main thread)
+
+            if (!m_rtSoftShadowsDescriptorSetLayout)
+            {
+                // AS
+                vk::DescriptorSetLayoutBinding asLB(0, vk::DescriptorType::eAccelerationStructureNV, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
+                // Image Load/Store for output
+                vk::DescriptorSetLayoutBinding gbufferPos(1, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
+                vk::DescriptorSetLayoutBinding randomImageLB(2, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
+                vk::DescriptorSetLayoutBinding rtPerFrame(3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
 
-            // AS
-            vk::DescriptorSetLayoutBinding asLB(0, vk::DescriptorType::eAccelerationStructureNV, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
-            // Image Load/Store for output
-            vk::DescriptorSetLayoutBinding gbufferPos(1, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
-            vk::DescriptorSetLayoutBinding randomImageLB(2, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
-            vk::DescriptorSetLayoutBinding rtPerFrame(3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
+                std::array bindings = { asLB, gbufferPos, randomImageLB, rtPerFrame };
 
-            std::array bindings = { asLB, gbufferPos, randomImageLB, rtPerFrame };
+                vk::DescriptorSetLayoutCreateInfo layoutInfo({}, static_cast<uint32_t>(bindings.size()), bindings.data());
 
-            vk::DescriptorSetLayoutCreateInfo layoutInfo({}, static_cast<uint32_t>(bindings.size()), bindings.data());
+                m_rtSoftShadowsDescriptorSetLayout = m_context.getDevice().createDescriptorSetLayout(layoutInfo);
+            }
+
+            if (!m_rtSoftShadowsPipelineLayout)
+            {
+                std::array dss = { m_rtSoftShadowsDescriptorSetLayout, m_lightDescriptorSetLayout, m_shadowImageStoreDescriptorSetLayout };
+                vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo({}, static_cast<uint32_t>(dss.size()), dss.data());
 
-            m_rtSoftShadowsDescriptorSetLayout = m_context.getDevice().createDescriptorSetLayout(layoutInfo);
+                m_rtSoftShadowsPipelineLayout = m_context.getDevice().createPipelineLayout(pipelineLayoutCreateInfo);
+            }
 
-            //// 2. Create Pipeline
+            //// 2. Create Pipeline (worker thread)
 
-            const auto rgenShaderCode = Utility::readFile("combined/softshadowPBR.rgen" + m_shaderExtension);
-            const auto rgenShaderModule = m_context.createShaderModule(rgenShaderCode);
+            return m_pipelineBuildService.submit("RT Soft Shadows", [this, constants = m_sceneConstants]()
+            {
+                const auto rgenShaderCode = m_shaderCompiler.compile("combined/softshadowPBR.rgen");
+                const auto rgenShaderModule = m_context.createShaderModule(rgenShaderCode);
 
-            //const auto ahitShaderCode = Utility::readFile("combined/softshadow.rahit" + shaderExtension);
-            //const auto ahitShaderModule = m_context.createShaderModule(ahitShaderCode);
+                //const auto ahitShaderCode = Utility::readFile("combined/softshadow.rahit" + shaderExtension);
+                //const auto ahitShaderModule = m_context.createShaderModule(ahitShaderCode);
 
-            //const auto chitShaderCode = Utility::readFile("combined/softshadow.rchit" + m_shaderExtension);
-            //const auto chitShaderModule = m_context.createShaderModule(chitShaderCode);
+                //const auto chitShaderCode = m_shaderCompiler.compile("combined/softshadow.rchit");
+                //const auto chitShaderModule = m_context.createShaderModule(chitShaderCode);
 
-            const auto missShaderCode = Utility::readFile("combined/softshadow.rmiss" + m_shaderExtension);
-            const auto missShaderModule = m_context.createShaderModule(missShaderCode);
+                const auto missShaderCode = m_shaderCompiler.compile("combined/softshadow.rmiss");
+                const auto missShaderModule = m_context.createShaderModule(missShaderCode);
 
+                // scene constants (number of textures, material layout, light counts)
+                const auto specInfo = constants.info();
 
-            std::array rtShaderStageInfos = {
-                vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eRaygenNV, rgenShaderModule, "main"),
-                //vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eClosestHitNV, chitShaderModule, "main"),
-                //vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eAnyHitNV, ahitShaderModule, "main"),
 
-                vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eMissNV, missShaderModule, "main")
-            };
+                std::array rtShaderStageInfos = {
+                    vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eRaygenNV, rgenShaderModule, "main", &specInfo),
+                    //vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eClosestHitNV, chitShaderModule, "main"),
+                    //vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eAnyHitNV, ahitShaderModule, "main"),
 
-            std::array dss = { m_rtSoftShadowsDescriptorSetLayout, m_lightDescriptorSetLayout, m_shadowImageStoreDescriptorSetLayout };
-            vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo({}, static_cast<uint32_t>(dss.size()), dss.data());
+                    vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eMissNV, missShaderModule, "main")
+                };
 
-            m_rtSoftShadowsPipelineLayout = m_context.getDevice().createPipelineLayout(pipelineLayoutCreateInfo);
 
-            std::array shaderGroups = {
-                // group 0: raygen
-                vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eGeneral, 0, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV},
-                // group 1: hit
-                //vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eTrianglesHitGroup, VK_SHADER_UNUSED_NV, 1, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV},
-                //vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eTrianglesHitGroup, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV, 2, VK_SHADER_UNUSED_NV},
-                // group 1: miss
-                vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eGeneral, 1, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV}
-            };
+                std::array shaderGroups = {
+                    // group 0: raygen
+                    vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eGeneral, 0, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV},
+                    // group 1: hit
+                    //vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eTrianglesHitGroup, VK_SHADER_UNUSED_NV, 1, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV},
+                    //vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eTrianglesHitGroup, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV, 2, VK_SHADER_UNUSED_NV},
+                    // group 1: miss
+                    vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eGeneral, 1, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV}
+                };
 
-            vk::RayTracingPipelineCreateInfoNV rayPipelineInfo({},
-                static_cast<uint32_t>(rtShaderStageInfos.size()), rtShaderStageInfos.data(),
-                static_cast<uint32_t>(shaderGroups.size()), shaderGroups.data(),
-                1,
-                m_rtSoftShadowsPipelineLayout,
-                nullptr, 0
-            );
+                vk::RayTracingPipelineCreateInfoNV rayPipelineInfo({},
+                    static_cast<uint32_t>(rtShaderStageInfos.size()), rtShaderStageInfos.data(),
+                    static_cast<uint32_t>(shaderGroups.size()), shaderGroups.data(),
+                    1,
+                    m_rtSoftShadowsPipelineLayout,
+                    nullptr, 0
+                );
 
-            m_rtSoftShadowsPipeline = m_context.getDevice().createRayTracingPipelinesNV(nullptr, rayPipelineInfo).at(0);
+                const auto pipeline = m_context.getDevice().createRayTracingPipelinesNV(nullptr, rayPipelineInfo).at(0);
 
-            // destroy shader modules:
-            m_context.getDevice().destroyShaderModule(rgenShaderModule);
-            //m_context.getDevice().destroyShaderModule(ahitShaderModule);
-            //m_context.getDevice().destroyShaderModule(chitShaderModule);
-            m_context.getDevice().destroyShaderModule(missShaderModule);
+                // destroy shader modules:
+                m_context.getDevice().destroyShaderModule(rgenShaderModule);
+                //m_context.getDevice().destroyShaderModule(ahitShaderModule);
+                //m_context.getDevice().destroyShaderModule(chitShaderModule);
+                m_context.getDevice().destroyShaderModule(missShaderModule);
 
-            //// 3. Create Shader Binding Table
+                return pipeline;
+            });
+        }
 
-            const uint32_t shaderBindingTableSize = m_context.getRaytracingProperties().shaderGroupHandleSize * rayPipelineInfo.groupCount;
-            
-            if(!m_rtSoftShadowSBTInfo.m_Buffer)
-                m_rtSoftShadowSBTInfo = createBuffer(shaderBindingTableSize, vk::BufferUsageFlagBits::eTransferSrc, VMA_MEMORY_USAGE_CPU_TO_GPU);
-            void* mappedData;
-            vmaMapMemory(m_context.getAllocator(), m_rtSoftShadowSBTInfo.m_BufferAllocation, &mappedData);
-            const auto res = m_context.getDevice().getRayTracingShaderGroupHandlesNV(m_rtSoftShadowsPipeline, 0, rayPipelineInfo.groupCount, shaderBindingTableSize, mappedData);
-            if (res != vk::Result::eSuccess) throw std::runtime_error("Failed to retrieve Shader Group Handles");
-            vmaUnmapMemory(m_context.getAllocator(), m_rtSoftShadowSBTInfo.m_BufferAllocation);
+        // the tables of all RT pipelines in one buffer, needs the finished pipelines
+        // at startup, waits for the transfer
+        void createShaderBindingTables()
+        {
+            m_rtSBTInfo = fillBufferTroughStagedTransfer(buildShaderBindingTables(), vk::BufferUsageFlagBits::eRayTracingNV);
+        }
 
-            //// 4. Create Descriptor Set
+        // the records of all RT pipelines, sets their regions
+        std::vector<uint8_t> buildShaderBindingTables()
+        {
+            ShaderBindingTableBuilder builder(m_context.getRaytracingProperties());
+            // group indices as in the create*Pipeline functions
+            m_rtSoftShadowSBTRegion = builder.getRegion(builder.addPipeline(m_rtSoftShadowsPipeline, { 0 }, { { 1 } }));
+            m_rtAOSBTRegion = builder.getRegion(builder.addPipeline(m_rtAOPipeline, { 0 }, { { 2 } }, { { 1 } }));
+            // the second miss group is the one of the shadow rays from the hits (miss index 1 in rtreflectionsPBR.rchit)
+            m_rtReflectionsSBTRegion = builder.getRegion(builder.addPipeline(m_rtReflectionsPipeline, { 0 }, { { 2 }, { 3 } }, { { 1 } }));
+
+            return builder.build(m_context.getDevice());
+        }
 
+        // needs the acceleration structure
+        void createRTSoftShadowsDescriptorSets()
+        {
             // deviation from tutorial: I'm creating multiple descriptor sets, and binding the one with the current swap chain image
 
             if (m_rtSoftShadowsDescriptorSets.empty())
             {
                 // create n descriptor sets
-                std::vector<vk::DescriptorSetLayout> dsls(m_swapChainFramebuffers.size(), m_rtSoftShadowsDescriptorSetLayout);
-                vk::DescriptorSetAllocateInfo desSetAllocInfo(m_combinedDescriptorPool, static_cast<uint32_t>(m_swapChainFramebuffers.size()), dsls.data());
+                std::vector<vk::DescriptorSetLayout> dsls(m_frameResourceCount, m_rtSoftShadowsDescriptorSetLayout);
+                vk::DescriptorSetAllocateInfo desSetAllocInfo(m_combinedDescriptorPool, static_cast<uint32_t>(m_frameResourceCount), dsls.data());
                 m_rtSoftShadowsDescriptorSets = m_context.getDevice().allocateDescriptorSets(desSetAllocInfo);
             }
 
 
 
-            for (size_t i = 0; i < m_swapChainFramebuffers.size(); i++)
+            for (size_t i = 0; i < m_frameResourceCount; i++)
             {
-                vk::WriteDescriptorSetAccelerationStructureNV descriptorSetAccelerationStructureInfo(1, &m_topAS.m_AS);
+                vk::WriteDescriptorSetAccelerationStructureNV descriptorSetAccelerationStructureInfo(1, &m_topASs.at(i).m_AS);
                 vk::WriteDescriptorSet accelerationStructureWrite(m_rtSoftShadowsDescriptorSets.at(i), 0, 0, 1, vk::DescriptorType::eAccelerationStructureNV, nullptr, nullptr, nullptr);
                 accelerationStructureWrite.setPNext(&descriptorSetAccelerationStructureInfo); // pNext is assigned here!!!
 
@@ -1687,108 +1896,115 @@ namespace vg
             }
         }
 
-        void createRTAOPipeline()
+        std::shared_future<vk::Pipeline> createRTAOPipeline()
         {
-            //// 1. DSL
-            // TODO streamline DSs: 1DS for Gbuffer, 1 for what all RT passes use, 1 per RT pass with anything else
-            // AS
-            vk::DescriptorSetLayoutBinding asLB(0, vk::DescriptorType::eAccelerationStructureNV, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
-            // Image Load/Store for output
-            vk::DescriptorSetLayoutBinding gbufferPos(1, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
-            vk::DescriptorSetLayoutBinding gbufferNormal(2, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
-            vk::DescriptorSetLayoutBinding randomImageLB(3, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
-            vk::DescriptorSetLayoutBinding rtPerFrame(4, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
+            //// 1. DSL & Pipeline Layout (main thread)
 
+            if (!m_rtAODescriptorSetLayout)
+            {
+                // TODO streamline DSs: 1DS for Gbuffer, 1 for what all RT passes use, 1 per RT pass with anything else
+                // AS
+                vk::DescriptorSetLayoutBinding asLB(0, vk::DescriptorType::eAccelerationStructureNV, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
+                // Image Load/Store for output
+                vk::DescriptorSetLayoutBinding gbufferPos(1, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
+                vk::DescriptorSetLayoutBinding gbufferNormal(2, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
+                vk::DescriptorSetLayoutBinding randomImageLB(3, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
+                vk::DescriptorSetLayoutBinding rtPerFrame(4, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
 
-            std::array bindings = { asLB, gbufferPos, gbufferNormal, randomImageLB, rtPerFrame };
 
-            vk::DescriptorSetLayoutCreateInfo layoutInfo({}, static_cast<uint32_t>(bindings.size()), bindings.data());
+                std::array bindings = { asLB, gbufferPos, gbufferNormal, randomImageLB, rtPerFrame };
 
-            m_rtAODescriptorSetLayout = m_context.getDevice().createDescriptorSetLayout(layoutInfo);
+                vk::DescriptorSetLayoutCreateInfo layoutInfo({}, static_cast<uint32_t>(bindings.size()), bindings.data());
 
-            //// 2. Create Pipeline
+                m_rtAODescriptorSetLayout = m_context.getDevice().createDescriptorSetLayout(layoutInfo);
+            }
 
-            const auto rgenShaderCode = Utility::readFile("combined/rtao.rgen" + m_shaderExtension);
-            const auto rgenShaderModule = m_context.createShaderModule(rgenShaderCode);
+            if (!m_rtAOPipelineLayout)
+            {
+                std::array dss = { m_rtAODescriptorSetLayout, m_rtAOImageStoreDescriptorSetLayout };
+                vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo({}, static_cast<uint32_t>(dss.size()), dss.data());
 
-            //const auto ahitShaderCode = Utility::readFile("combined/rtao.rahit" + shaderExtension);
-            //const auto ahitShaderModule = m_context.createShaderModule(ahitShaderCode);
+                m_rtAOPipelineLayout = m_context.getDevice().createPipelineLayout(pipelineLayoutCreateInfo);
+            }
 
-            const auto chitShaderCode = Utility::readFile("combined/rtao.rchit" + m_shaderExtension);
-            const auto chitShaderModule = m_context.createShaderModule(chitShaderCode);
+            //// 2. Create Pipeline (worker thread)
 
-            const auto missShaderCode = Utility::readFile("combined/rtao.rmiss" + m_shaderExtension);
-            const auto missShaderModule = m_context.createShaderModule(missShaderCode);
+            return m_pipelineBuildService.submit("RT Ambient Occlusion", [this, constants = m_sceneConstants]()
+            {
+                const auto rgenShaderCode = m_shaderCompiler.compile("combined/rtao.rgen");
+                const auto rgenShaderModule = m_context.createShaderModule(rgenShaderCode);
 
+                //const auto ahitShaderCode = Utility::readFile("combined/rtao.rahit" + shaderExtension);
+                //const auto ahitShaderModule = m_context.createShaderModule(ahitShaderCode);
 
-            std::array rtShaderStageInfos = {
-                vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eRaygenNV, rgenShaderModule, "main"),
-                vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eClosestHitNV, chitShaderModule, "main"),
-                //vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eAnyHitNV, ahitShaderModule, "main"),
+                const auto chitShaderCode = m_shaderCompiler.compile("combined/rtao.rchit");
+                const auto chitShaderModule = m_context.createShaderModule(chitShaderCode);
 
-                vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eMissNV, missShaderModule, "main")
-            };
+                const auto missShaderCode = m_shaderCompiler.compile("combined/rtao.rmiss");
+                const auto missShaderModule = m_context.createShaderModule(missShaderCode);
 
-            std::array dss = { m_rtAODescriptorSetLayout, m_rtAOImageStoreDescriptorSetLayout };
-            vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo({}, static_cast<uint32_t>(dss.size()), dss.data());
+                // scene constants (number of textures, material layout, light counts)
+                const auto specInfo = constants.info();
 
-            m_rtAOPipelineLayout = m_context.getDevice().createPipelineLayout(pipelineLayoutCreateInfo);
 
-            std::array shaderGroups = {
-                // group 0: raygen
-                vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eGeneral, 0, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV},
-                // group 1: closest hit
-                vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eTrianglesHitGroup, VK_SHADER_UNUSED_NV, 1, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV},
-                //vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eTrianglesHitGroup, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV, 2, VK_SHADER_UNUSED_NV},
-                // group 2: miss
-                vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eGeneral, 2, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV}
-            };
+                std::array rtShaderStageInfos = {
+                    vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eRaygenNV, rgenShaderModule, "main", &specInfo),
+                    vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eClosestHitNV, chitShaderModule, "main", &specInfo),
+                    //vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eAnyHitNV, ahitShaderModule, "main"),
 
-            vk::RayTracingPipelineCreateInfoNV rayPipelineInfo({},
-                static_cast<uint32_t>(rtShaderStageInfos.size()), rtShaderStageInfos.data(),
-                static_cast<uint32_t>(shaderGroups.size()), shaderGroups.data(),
-                1,
-                m_rtAOPipelineLayout,
-                nullptr, 0
-            );
+                    vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eMissNV, missShaderModule, "main")
+                };
 
-            m_rtAOPipeline = m_context.getDevice().createRayTracingPipelinesNV(nullptr, rayPipelineInfo).at(0);
 
-            // destroy shader modules:
-            m_context.getDevice().destroyShaderModule(rgenShaderModule);
-            //m_context.getDevice().destroyShaderModule(ahitShaderModule);
-            m_context.getDevice().destroyShaderModule(chitShaderModule);
-            m_context.getDevice().destroyShaderModule(missShaderModule);
+                std::array shaderGroups = {
+                    // group 0: raygen
+                    vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eGeneral, 0, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV},
+                    // group 1: closest hit
+                    vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eTrianglesHitGroup, VK_SHADER_UNUSED_NV, 1, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV},
+                    //vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eTrianglesHitGroup, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV, 2, VK_SHADER_UNUSED_NV},
+                    // group 2: miss
+                    vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eGeneral, 2, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV}
+                };
 
-            //// 3. Create Shader Binding Table
+                vk::RayTracingPipelineCreateInfoNV rayPipelineInfo({},
+                    static_cast<uint32_t>(rtShaderStageInfos.size()), rtShaderStageInfos.data(),
+                    static_cast<uint32_t>(shaderGroups.size()), shaderGroups.data(),
+                    1,
+                    m_rtAOPipelineLayout,
+                    nullptr, 0
+                );
 
-            const uint32_t shaderBindingTableSize = m_context.getRaytracingProperties().shaderGroupHandleSize * rayPipelineInfo.groupCount;
+                const auto pipeline = m_context.getDevice().createRayTracingPipelinesNV(nullptr, rayPipelineInfo).at(0);
 
-            if (!m_rtAOSBTInfo.m_Buffer)
-                m_rtAOSBTInfo = createBuffer(shaderBindingTableSize, vk::BufferUsageFlagBits::eTransferSrc, VMA_MEMORY_USAGE_CPU_TO_GPU);
-            void* mappedData;
-            vmaMapMemory(m_context.getAllocator(), m_rtAOSBTInfo.m_BufferAllocation, &mappedData);
-            const auto res = m_context.getDevice().getRayTracingShaderGroupHandlesNV(m_rtAOPipeline, 0, rayPipelineInfo.groupCount, shaderBindingTableSize, mappedData);
-            if (res != vk::Result::eSuccess) throw std::runtime_error("Failed to retrieve Shader Group Handles");
-            vmaUnmapMemory(m_context.getAllocator(), m_rtAOSBTInfo.m_BufferAllocation);
+                // destroy shader modules:
+                m_context.getDevice().destroyShaderModule(rgenShaderModule);
+                //m_context.getDevice().destroyShaderModule(ahitShaderModule);
+                m_context.getDevice().destroyShaderModule(chitShaderModule);
+                m_context.getDevice().destroyShaderModule(missShaderModule);
 
-            //// 4. Create Descriptor Set
+                return pipeline;
+            });
+        }
 
-            // deviation from tutorial: I'm creating multiple descriptor sets, and binding the one with the current swap chain image
+
+        // needs the acceleration structure
+        void createRTAODescriptorSets()
+        {
+            // deviation from tutorial: I'm creating multiple descriptor sets, and binding the one with the current swap chain image
 
             if (m_rtAODescriptorSets.empty())
             {
                 // create n descriptor sets
-                std::vector<vk::DescriptorSetLayout> dsls(m_swapChainFramebuffers.size(), m_rtAODescriptorSetLayout);
-                vk::DescriptorSetAllocateInfo desSetAllocInfo(m_combinedDescriptorPool, static_cast<uint32_t>(m_swapChainFramebuffers.size()), dsls.data());
+                std::vector<vk::DescriptorSetLayout> dsls(m_frameResourceCount, m_rtAODescriptorSetLayout);
+                vk::DescriptorSetAllocateInfo desSetAllocInfo(m_combinedDescriptorPool, static_cast<uint32_t>(m_frameResourceCount), dsls.data());
                 m_rtAODescriptorSets = m_context.getDevice().allocateDescriptorSets(desSetAllocInfo);
             }
 
 
 
-            for (size_t i = 0; i < m_swapChainFramebuffers.size(); i++)
+            for (size_t i = 0; i < m_frameResourceCount; i++)
             {
-                vk::WriteDescriptorSetAccelerationStructureNV descriptorSetAccelerationStructureInfo(1, &m_topAS.m_AS);
+                vk::WriteDescriptorSetAccelerationStructureNV descriptorSetAccelerationStructureInfo(1, &m_topASs.at(i).m_AS);
                 vk::WriteDescriptorSet accelerationStructureWrite(m_rtAODescriptorSets.at(i), 0, 0, 1, vk::DescriptorType::eAccelerationStructureNV, nullptr, nullptr, nullptr);
                 accelerationStructureWrite.setPNext(&descriptorSetAccelerationStructureInfo); // pNext is assigned here!!!
 
@@ -1810,125 +2026,133 @@ namespace vg
             }
         }
 
-		void createRTReflectionPipeline()
-        {
-			//// 1. DSL
-			 // TODO streamline DSs: 1DS for Gbuffer, 1 for what all RT passes use, 1 per RT pass with anything else
-			 // AS
-			vk::DescriptorSetLayoutBinding asLB(0, vk::DescriptorType::eAccelerationStructureNV, 1, vk::ShaderStageFlagBits::eRaygenNV | vk::ShaderStageFlagBits::eClosestHitNV, nullptr);
-			// GBuffer
-			vk::DescriptorSetLayoutBinding gbufferPos(1, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
-			vk::DescriptorSetLayoutBinding gbufferNormal(2, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
-            vk::DescriptorSetLayoutBinding gbufferUV(12, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
-
-            // add. info
-        	vk::DescriptorSetLayoutBinding randomImageLB(3, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
-
-            vk::DescriptorSetLayoutBinding rtPerFrame(4, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eRaygenNV | vk::ShaderStageFlagBits::eClosestHitNV, nullptr);
-			//output image
-			vk::DescriptorSetLayoutBinding reflectionImageLB(5, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
-            vk::DescriptorSetLayoutBinding reflectionLowResImageLB(13, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
-
-            // info for shading
-			vk::DescriptorSetLayoutBinding vertexBufferLB(6, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eRaygenNV | vk::ShaderStageFlagBits::eClosestHitNV, nullptr);
-			vk::DescriptorSetLayoutBinding indexBufferLB(7, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eRaygenNV | vk::ShaderStageFlagBits::eClosestHitNV, nullptr);
-			vk::DescriptorSetLayoutBinding offsetBufferLB(8, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eRaygenNV | vk::ShaderStageFlagBits::eClosestHitNV, nullptr);
-			
-			vk::DescriptorSetLayoutBinding materialBufferLB(9, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eRaygenNV | vk::ShaderStageFlagBits::eClosestHitNV, nullptr);
-			vk::DescriptorSetLayoutBinding indirectDrawBufferLB(10, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eRaygenNV | vk::ShaderStageFlagBits::eClosestHitNV, nullptr);
-
-        	vk::DescriptorSetLayoutBinding allTexturesLayoutBinding(11, vk::DescriptorType::eCombinedImageSampler, static_cast<uint32_t>(m_allImages.size()), vk::ShaderStageFlagBits::eRaygenNV | vk::ShaderStageFlagBits::eClosestHitNV, nullptr);
-
-			std::array bindings = { asLB, gbufferPos, gbufferNormal,gbufferUV, randomImageLB, rtPerFrame,reflectionImageLB,
-			vertexBufferLB,indexBufferLB, offsetBufferLB, materialBufferLB, indirectDrawBufferLB, allTexturesLayoutBinding, reflectionLowResImageLB };
-
-			vk::DescriptorSetLayoutCreateInfo layoutInfo({}, static_cast<uint32_t>(bindings.size()), bindings.data());
-
-			m_rtReflectionsDescriptorSetLayout = m_context.getDevice().createDescriptorSetLayout(layoutInfo);
-
-			//// 2. Create Pipeline
+		std::shared_future<vk::Pipeline> createRTReflectionPipeline()
+		{
+			//// 1. DSL & Pipeline Layout (main thread)
 
-			const auto rgenShaderCode = Utility::readFile("combined/rtreflectionsPBR.rgen" + m_shaderExtension);
-			const auto rgenShaderModule = m_context.createShaderModule(rgenShaderCode);
+			if (!m_rtReflectionsDescriptorSetLayout)
+			{
+				 // TODO streamline DSs: 1DS for Gbuffer, 1 for what all RT passes use, 1 per RT pass with anything else
+				 // AS
+				vk::DescriptorSetLayoutBinding asLB(0, vk::DescriptorType::eAccelerationStructureNV, 1, vk::ShaderStageFlagBits::eRaygenNV | vk::ShaderStageFlagBits::eClosestHitNV, nullptr);
+				// GBuffer
+				vk::DescriptorSetLayoutBinding gbufferPos(1, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
+				vk::DescriptorSetLayoutBinding gbufferNormal(2, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
+                vk::DescriptorSetLayoutBinding gbufferUV(12, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
+
+                // add. info
+            	vk::DescriptorSetLayoutBinding randomImageLB(3, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
+
+                vk::DescriptorSetLayoutBinding rtPerFrame(4, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eRaygenNV | vk::ShaderStageFlagBits::eClosestHitNV, nullptr);
+				//output image
+				vk::DescriptorSetLayoutBinding reflectionImageLB(5, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
+                vk::DescriptorSetLayoutBinding reflectionLowResImageLB(13, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eRaygenNV, nullptr);
+
+                // info for shading
+				vk::DescriptorSetLayoutBinding vertexBufferLB(6, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eRaygenNV | vk::ShaderStageFlagBits::eClosestHitNV, nullptr);
+				vk::DescriptorSetLayoutBinding indexBufferLB(7, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eRaygenNV | vk::ShaderStageFlagBits::eClosestHitNV, nullptr);
+				vk::DescriptorSetLayoutBinding offsetBufferLB(8, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eRaygenNV | vk::ShaderStageFlagBits::eClosestHitNV, nullptr);
 			
-			const auto chitShaderCode = Utility::readFile("combined/rtreflectionsPBR.rchit" + m_shaderExtension);
-			const auto chitShaderModule = m_context.createShaderModule(chitShaderCode);
-
-			const auto missShaderCode = Utility::readFile("combined/rtreflections.rmiss" + m_shaderExtension);
-			const auto missShaderModule = m_context.createShaderModule(missShaderCode);
-
-			//const auto chitSecondaryShaderCode = Utility::readFile("combined/rtreflectionsSecondaryShadow.rchit" + m_shaderExtension);
-			//const auto chitSecondaryShaderModule = m_context.createShaderModule(chitSecondaryShaderCode);
-
-			const auto missSecondaryShaderCode = Utility::readFile("combined/rtreflectionsSecondaryShadow.rmiss" + m_shaderExtension);
-			const auto missSecondaryShaderModule = m_context.createShaderModule(missSecondaryShaderCode);
+				vk::DescriptorSetLayoutBinding materialBufferLB(9, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eRaygenNV | vk::ShaderStageFlagBits::eClosestHitNV, nullptr);
+				vk::DescriptorSetLayoutBinding indirectDrawBufferLB(10, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eRaygenNV | vk::ShaderStageFlagBits::eClosestHitNV, nullptr);
 
+            	vk::DescriptorSetLayoutBinding allTexturesLayoutBinding(11, vk::DescriptorType::eCombinedImageSampler, static_cast<uint32_t>(m_allImages.size()), vk::ShaderStageFlagBits::eRaygenNV | vk::ShaderStageFlagBits::eClosestHitNV, nullptr);
+                vk::DescriptorSetLayoutBinding primitiveMeshBufferLB(14, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eClosestHitNV, nullptr);
 
-			std::array rtShaderStageInfos = {
-				vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eRaygenNV, rgenShaderModule, "main"),
-				vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eClosestHitNV, chitShaderModule, "main"),
-				//vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eClosestHitNV, chitSecondaryShaderModule, "main"),
-				vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eMissNV, missShaderModule, "main"),
-				vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eMissNV, missSecondaryShaderModule, "main")
-			};
+				std::array bindings = { asLB, gbufferPos, gbufferNormal,gbufferUV, randomImageLB, rtPerFrame,reflectionImageLB,
+				vertexBufferLB,indexBufferLB, offsetBufferLB, materialBufferLB, indirectDrawBufferLB, allTexturesLayoutBinding, reflectionLowResImageLB, primitiveMeshBufferLB };
 
-			std::array dss = { m_rtReflectionsDescriptorSetLayout, m_lightDescriptorSetLayout };
-			vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo({}, static_cast<uint32_t>(dss.size()), dss.data());
+				vk::DescriptorSetLayoutCreateInfo layoutInfo({}, static_cast<uint32_t>(bindings.size()), bindings.data());
 
-			m_rtReflectionsPipelineLayout = m_context.getDevice().createPipelineLayout(pipelineLayoutCreateInfo);
-
-			std::array shaderGroups = {
-				// group 0: raygen
-				vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eGeneral, 0, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV},
-				// group 1: closest hit (for reflections)
-				vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eTrianglesHitGroup, VK_SHADER_UNUSED_NV, 1, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV},
-				// group 2: closest hit (for secondary rays: shadows in reflection)
-				//vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eTrianglesHitGroup, VK_SHADER_UNUSED_NV, 2, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV},
-				// group 3: miss (for reflection rays)
-				vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eGeneral, 2, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV},
-				// group 4: miss (for secondary rays: shadows in reflection)
-				vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eGeneral, 3, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV}
+				m_rtReflectionsDescriptorSetLayout = m_context.getDevice().createDescriptorSetLayout(layoutInfo);
+			}
 
-			};
+			if (!m_rtReflectionsPipelineLayout)
+			{
+				std::array dss = { m_rtReflectionsDescriptorSetLayout, m_lightDescriptorSetLayout };
+				vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo({}, static_cast<uint32_t>(dss.size()), dss.data());
 
-			vk::RayTracingPipelineCreateInfoNV rayPipelineInfo({},
-				static_cast<uint32_t>(rtShaderStageInfos.size()), rtShaderStageInfos.data(),
-				static_cast<uint32_t>(shaderGroups.size()), shaderGroups.data(),
-				2,
-				m_rtReflectionsPipelineLayout,
-				nullptr, 0
-			);
+				m_rtReflectionsPipelineLayout = m_context.getDevice().createPipelineLayout(pipelineLayoutCreateInfo);
+			}
 
-			m_rtReflectionsPipeline = m_context.getDevice().createRayTracingPipelinesNV(nullptr, rayPipelineInfo).at(0);
+			//// 2. Create Pipeline (worker thread)
 
-			// destroy shader modules:
-			m_context.getDevice().destroyShaderModule(rgenShaderModule);
-			m_context.getDevice().destroyShaderModule(chitShaderModule);
-			m_context.getDevice().destroyShaderModule(missShaderModule);
-			//m_context.getDevice().destroyShaderModule(chitSecondaryShaderModule);
-			m_context.getDevice().destroyShaderModule(missSecondaryShaderModule);
+			return m_pipelineBuildService.submit("RT Reflections", [this, constants = m_sceneConstants]()
+			{
+				const auto rgenShaderCode = m_shaderCompiler.compile("combined/rtreflectionsPBR.rgen");
+				const auto rgenShaderModule = m_context.createShaderModule(rgenShaderCode);
+			
+				const auto chitShaderCode = m_shaderCompiler.compile("combined/rtreflectionsPBR.rchit");
+				const auto chitShaderModule = m_context.createShaderModule(chitShaderCode);
+
+				const auto missShaderCode = m_shaderCompiler.compile("combined/rtreflections.rmiss");
+				const auto missShaderModule = m_context.createShaderModule(missShaderCode);
+
+				//const auto chitSecondaryShaderCode = m_shaderCompiler.compile("combined/rtreflectionsSecondaryShadow.rchit");
+				//const auto chitSecondaryShaderModule = m_context.createShaderModule(chitSecondaryShaderCode);
+
+				const auto missSecondaryShaderCode = m_shaderCompiler.compile("combined/rtreflectionsSecondaryShadow.rmiss");
+				const auto missSecondaryShaderModule = m_context.createShaderModule(missSecondaryShaderCode);
+
+				// scene constants (number of textures, material layout, light counts)
+				const auto specInfo = constants.info();
+
+
+				std::array rtShaderStageInfos = {
+					vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eRaygenNV, rgenShaderModule, "main", &specInfo),
+					vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eClosestHitNV, chitShaderModule, "main", &specInfo),
+					//vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eClosestHitNV, chitSecondaryShaderModule, "main"),
+					vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eMissNV, missShaderModule, "main"),
+					vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eMissNV, missSecondaryShaderModule, "main")
+				};
+
+
+				std::array shaderGroups = {
+					// group 0: raygen
+					vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eGeneral, 0, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV},
+					// group 1: closest hit (for reflections)
+					vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eTrianglesHitGroup, VK_SHADER_UNUSED_NV, 1, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV},
+					// group 2: closest hit (for secondary rays: shadows in reflection)
+					//vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eTrianglesHitGroup, VK_SHADER_UNUSED_NV, 2, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV},
+					// group 3: miss (for reflection rays)
+					vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eGeneral, 2, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV},
+					// group 4: miss (for secondary rays: shadows in reflection)
+					vk::RayTracingShaderGroupCreateInfoNV{vk::RayTracingShaderGroupTypeNV::eGeneral, 3, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV, VK_SHADER_UNUSED_NV}
+
+				};
+
+				vk::RayTracingPipelineCreateInfoNV rayPipelineInfo({},
+					static_cast<uint32_t>(rtShaderStageInfos.size()), rtShaderStageInfos.data(),
+					static_cast<uint32_t>(shaderGroups.size()), shaderGroups.data(),
+					2,
+					m_rtReflectionsPipelineLayout,
+					nullptr, 0
+				);
 
-			//// 3. Create Shader Binding Table
+				const auto pipeline = m_context.getDevice().createRayTracingPipelinesNV(nullptr, rayPipelineInfo).at(0);
 
-			const uint32_t shaderBindingTableSize = m_context.getRaytracingProperties().shaderGroupHandleSize * rayPipelineInfo.groupCount;
+				// destroy shader modules:
+				m_context.getDevice().destroyShaderModule(rgenShaderModule);
+				m_context.getDevice().destroyShaderModule(chitShaderModule);
+				m_context.getDevice().destroyShaderModule(missShaderModule);
+				//m_context.getDevice().destroyShaderModule(chitSecondaryShaderModule);
+				m_context.getDevice().destroyShaderModule(missSecondaryShaderModule);
 
-			if (!m_rtReflectionsSBTInfo.m_Buffer)
-				m_rtReflectionsSBTInfo = createBuffer(shaderBindingTableSize, vk::BufferUsageFlagBits::eTransferSrc, VMA_MEMORY_USAGE_CPU_TO_GPU);
-			void* mappedData;
-			vmaMapMemory(m_context.getAllocator(), m_rtReflectionsSBTInfo.m_BufferAllocation, &mappedData);
-			const auto res = m_context.getDevice().getRayTracingShaderGroupHandlesNV(m_rtReflectionsPipeline, 0, rayPipelineInfo.groupCount, shaderBindingTableSize, mappedData);
-			if (res != vk::Result::eSuccess) throw std::runtime_error("Failed to retrieve Shader Group Handles");
-			vmaUnmapMemory(m_context.getAllocator(), m_rtReflectionsSBTInfo.m_BufferAllocation);
+				return pipeline;
+			});
+        }
 
-			//// 4. Create Descriptor Set
 
+		// needs the acceleration structure
+		void createRTReflectionDescriptorSets()
+		{
 			// deviation from tutorial: I'm creating multiple descriptor sets, and binding the one with the current swap chain image
 
 			if (m_rtReflectionsDescriptorSets.empty())
 			{
 				// create n descriptor sets
-				std::vector<vk::DescriptorSetLayout> dsls(m_swapChainFramebuffers.size(), m_rtReflectionsDescriptorSetLayout);
-				vk::DescriptorSetAllocateInfo desSetAllocInfo(m_combinedDescriptorPool, static_cast<uint32_t>(m_swapChainFramebuffers.size()), dsls.data());
+				std::vector<vk::DescriptorSetLayout> dsls(m_frameResourceCount, m_rtReflectionsDescriptorSetLayout);
+				vk::DescriptorSetAllocateInfo desSetAllocInfo(m_combinedDescriptorPool, static_cast<uint32_t>(m_frameResourceCount), dsls.data());
 				m_rtReflectionsDescriptorSets = m_context.getDevice().allocateDescriptorSets(desSetAllocInfo);
 			}
 
@@ -1940,9 +2164,9 @@ namespace vg
 			}
 
 
-			for (size_t i = 0; i < m_swapChainFramebuffers.size(); i++)
+			for (size_t i = 0; i < m_frameResourceCount; i++)
 			{
-				vk::WriteDescriptorSetAccelerationStructureNV descriptorSetAccelerationStructureInfo(1, &m_topAS.m_AS);
+				vk::WriteDescriptorSetAccelerationStructureNV descriptorSetAccelerationStructureInfo(1, &m_topASs.at(i).m_AS);
 				vk::WriteDescriptorSet accelerationStructureWrite(m_rtReflectionsDescriptorSets.at(i), 0, 0, 1, vk::DescriptorType::eAccelerationStructureNV, nullptr, nullptr, nullptr);
 				accelerationStructureWrite.setPNext(&descriptorSetAccelerationStructureInfo); // pNext is assigned here!!!
 
@@ -1975,6 +2199,8 @@ namespace vg
 				vk::WriteDescriptorSet descWriteIndexBuffer(m_rtReflectionsDescriptorSets.at(i), 7, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &ibInfo, nullptr);
 				vk::DescriptorBufferInfo obInfo(m_offsetBufferInfo.m_Buffer, 0, VK_WHOLE_SIZE);
 				vk::WriteDescriptorSet descWriteOffsetBuffer(m_rtReflectionsDescriptorSets.at(i), 8, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &obInfo, nullptr);
+                vk::DescriptorBufferInfo primitiveMeshInfo(m_primitiveMeshBufferInfo.m_Buffer, 0, VK_WHOLE_SIZE);
+                vk::WriteDescriptorSet descWritePrimitiveMeshBuffer(m_rtReflectionsDescriptorSets.at(i), 14, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &primitiveMeshInfo, nullptr);
 				
 				vk::DescriptorBufferInfo matBufferInfo(m_materialBufferInfo.m_Buffer, 0, VK_WHOLE_SIZE);
 				vk::WriteDescriptorSet descWriteMaterialBuffer(m_rtReflectionsDescriptorSets.at(i), 9, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &matBufferInfo, nullptr);
@@ -1987,7 +2213,7 @@ namespace vg
 
 				std::array descriptorWrites = { accelerationStructureWrite,gbufferPosImageWrite, gbufferNormalImageWrite,gbufferUVImageWrite, randomImageWrite,
 					rtPerFrameWrite , reflectionImageWrite, descWriteVertexBuffer, descWriteIndexBuffer, descWriteOffsetBuffer,
-					descWriteMaterialBuffer, descWriteIndirectBuffer, descWriteAllImages, reflectionLowResImageWrite };
+					descWriteMaterialBuffer, descWriteIndirectBuffer, descWriteAllImages, reflectionLowResImageWrite, descWritePrimitiveMeshBuffer };
 				m_context.getDevice().updateDescriptorSets(descriptorWrites, nullptr);
 			}
         }
@@ -2030,7 +2256,8 @@ namespace vg
         }
 
         // base
-        void recreateSwapChain() override//TODO update this for this app
+        // size independent resources (pipelines, descriptor sets, command buffers) survive, the old swapchain objects are retired
+        void recreateSwapChain() override
         {
             int width = 0, height = 0;
             while (width == 0 || height == 0)
@@ -2042,59 +2269,212 @@ namespace vg
             m_projection = glm::perspective(glm::radians(45.0f), width / static_cast<float>(height), 0.1f, 10000.0f);
             m_projection[1][1] *= -1;
             m_projectionChanged = true;
-            // todo set camera width, height ?
-
-            m_context.getDevice().waitIdle();
+            m_camera.setExtent(width, height);
 
-            cleanUpSwapchain();
+            const auto oldSwapchain = m_context.getSwapChain();
+            const auto oldImageViews = m_context.getSwapChainImageViews();
+            const auto oldFramebuffers = m_swapChainFramebuffers;
 
-            m_context.createSwapChain();
+            // the new swapchain may have more or fewer images, only the framebuffers are per image. the per-frame resources
+            // (g-buffers, descriptor sets, command buffers, timer slots) keep their count, see getFrameResourceIndex
+            m_context.createSwapChain(oldSwapchain);
             m_context.createImageViews();
-            //createRenderPass();
-            //createGraphicsPipeline();
-            createDepthResources();
+
+            const auto ext = m_context.getSwapChainExtent();
+            if (ext.width > m_targetCapacity.width || ext.height > m_targetCapacity.height)
+                growRenderTargets(ext);
+
             createSwapchainFramebuffers(m_fullscreenLightingRenderpass);
-            createAllCommandBuffers();
+
+            // the frames submitted before the resize may still use the old swapchain
+            m_retireQueue.retire(m_frameNumber + m_context.max_frames_in_flight, [device = m_context.getDevice(), oldSwapchain, oldImageViews, oldFramebuffers]
+            {
+                for (const auto framebuffer : oldFramebuffers)
+                    device.destroyFramebuffer(framebuffer);
+                for (const auto view : oldImageViews)
+                    device.destroyImageView(view);
+                device.destroySwapchainKHR(oldSwapchain);
+            });
+
+            // the lighting pass covers the new swapchain, the other passes render the same scale of the new extent
+            scheduleSecondaryUpdate([this](size_t i) { recordFullscreenLightingCommandBuffer(i); }, [] {});
+            setRenderScale(m_dynamicResolution.getScale());
         }
 
-        // base
-        void cleanUpSwapchain() //TODO update this for this app
+        // the window outgrew the render targets, the only resize path that has to wait for the GPU:
+        // their descriptor sets are bound by every frame in flight
+        void growRenderTargets(const vk::Extent2D minExtent)
+        {
+            // grow to the monitor resolution right away, so dragging the window larger doesn't reallocate over and over
+            vk::Extent2D capacity(std::max(minExtent.width, m_targetCapacity.width), std::max(minExtent.height, m_targetCapacity.height));
+            if (const auto* mode = glfwGetVideoMode(glfwGetPrimaryMonitor()))
+            {
+                capacity.width = std::max(capacity.width, static_cast<uint32_t>(mode->width));
+                capacity.height = std::max(capacity.height, static_cast<uint32_t>(mode->height));
+            }
+            m_context.getLogger()->info("Growing the render targets from {}x{} to {}x{}", m_targetCapacity.width, m_targetCapacity.height, capacity.width, capacity.height);
+
+            m_context.getDevice().waitForFences(m_inFlightFences, VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+            destroyRenderTargets();
+            m_targetCapacity = capacity;
+            createDepthResources(m_targetCapacity);
+            createGBufferResources();
+            createRTResources();
+            createRandomImage();
+
+            writeRTImageDescriptors();
+            createFullscreenLightingDescriptors();
+            createRTSoftShadowsDescriptorSets();
+            createRTAODescriptorSets();
+            createRTReflectionDescriptorSets();
+
+            // the random seeds and accumulated results are gone
+            for (auto& n : m_sampleCounts)
+                n = 0;
+
+            // nothing is in flight anymore, the lighting pass is re-recorded with the new swapchain framebuffers
+            for (size_t i = 0; i < m_gbufferSecondaryCommandBuffers.size(); i++)
+            {
+                recordGBufferCommandBuffer(i);
+                recordRTSoftShadowsCommandBuffer(i);
+                recordRTAOCommandBuffer(i);
+                recordRTReflectionCommandBuffers(i);
+            }
+        }
+
+        // everything sized by m_targetCapacity
+        void destroyRenderTargets()
         {
             m_context.getDevice().destroyImageView(m_depthImageView);
             vmaDestroyImage(m_context.getAllocator(), m_depthImage.m_Image, m_depthImage.m_ImageAllocation);
 
+            for (const auto& framebuffer : m_gbufferFramebuffers)
+                m_context.getDevice().destroyFramebuffer(framebuffer);
+
+            for(const auto& sampler : m_gbufferPositionSamplers)
+                m_context.getDevice().destroySampler(sampler);
+            for (const auto& sampler : m_gbufferNormalSamplers)
+                m_context.getDevice().destroySampler(sampler);
+            for (const auto& sampler : m_gbufferUVSamplers)
+                m_context.getDevice().destroySampler(sampler);
+
+            for (const auto& view : m_gbufferPositionImageViews)
+                m_context.getDevice().destroyImageView(view);
+            for (const auto& view : m_gbufferNormalImageViews)
+                m_context.getDevice().destroyImageView(view);
+            for (const auto& view : m_gbufferUVImageViews)
+                m_context.getDevice().destroyImageView(view);
+            for (const auto& view : m_gbufferDepthImageViews)
+                m_context.getDevice().destroyImageView(view);
+
+            for (const auto& image : m_gbufferPositionImageInfos)
+                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
+            for (const auto& image : m_gbufferNormalImageInfos)
+                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
+            for (const auto& image : m_gbufferUVImageInfos)
+                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
+            for (const auto& image : m_gbufferDepthImages)
+                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
 
-            for (auto& scfb : m_swapChainFramebuffers)
-                m_context.getDevice().destroyFramebuffer(scfb);
+            for (const auto& image : m_rtSoftShadowDirectionalImageInfos)
+                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
+            for (const auto& view : m_rtSoftShadowDirectionalImageViews)
+                m_context.getDevice().destroyImageView(view);
+            for (const auto& sampler : m_rtSoftShadowDirectionalImageSamplers)
+                m_context.getDevice().destroySampler(sampler);
 
-            m_context.getDevice().freeCommandBuffers(m_commandPool, m_commandBuffers);
+            for (const auto& image : m_rtSoftShadowPointImageInfos)
+                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
+            for (const auto& view : m_rtSoftShadowPointImageViews)
+                m_context.getDevice().destroyImageView(view);
+            for (const auto& sampler : m_rtSoftShadowPointImageSamplers)
+                m_context.getDevice().destroySampler(sampler);
 
-            //m_context.getDevice().destroyPipeline(m_graphicsPipeline);
-            //m_context.getDevice().destroyPipelineLayout(m_pipelineLayout);
-            //m_context.getDevice().destroyRenderPass(m_renderpass);
+            for (const auto& image : m_rtSoftShadowSpotImageInfos)
+                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
+            for (const auto& view : m_rtSoftShadowSpotImageViews)
+                m_context.getDevice().destroyImageView(view);
+            for (const auto& sampler : m_rtSoftShadowSpotImageSamplers)
+                m_context.getDevice().destroySampler(sampler);
 
-            for (auto& sciv : m_context.getSwapChainImageViews())
-                m_context.getDevice().destroyImageView(sciv);
+            for (const auto& image : m_rtAOImageInfos)
+                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
+            for (const auto& view : m_rtAOImageViews)
+                m_context.getDevice().destroyImageView(view);
+            for (const auto& sampler : m_rtAOImageSamplers)
+                m_context.getDevice().destroySampler(sampler);
 
-            m_context.getDevice().destroySwapchainKHR(m_context.getSwapChain());
+            for (const auto& image : m_rtReflectionImageInfos)
+                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
+            for (const auto& view : m_rtReflectionImageViews)
+                m_context.getDevice().destroyImageView(view);
+            for (const auto& sampler : m_rtReflectionImageSamplers)
+                m_context.getDevice().destroySampler(sampler);
+
+            for (const auto& image : m_rtReflectionLowResImageInfos)
+                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
+            for (const auto& view : m_rtReflectionLowResImageViews)
+                m_context.getDevice().destroyImageView(view);
+            for (const auto& sampler : m_rtReflectionLowResImageSamplers)
+                m_context.getDevice().destroySampler(sampler);
+
+            for (const auto& image : m_randomImageInfos)
+                vmaDestroyImage(m_context.getAllocator(), image.m_Image, image.m_ImageAllocation);
+
+            for (const auto& view : m_randomImageViews)
+                m_context.getDevice().destroyImageView(view);
+
+            m_gbufferFramebuffers.clear();
+            m_gbufferPositionSamplers.clear();
+            m_gbufferNormalSamplers.clear();
+            m_gbufferUVSamplers.clear();
+            m_gbufferPositionImageViews.clear();
+            m_gbufferNormalImageViews.clear();
+            m_gbufferUVImageViews.clear();
+            m_gbufferDepthImageViews.clear();
+            m_gbufferPositionImageInfos.clear();
+            m_gbufferNormalImageInfos.clear();
+            m_gbufferUVImageInfos.clear();
+            m_gbufferDepthImages.clear();
+            m_rtSoftShadowDirectionalImageInfos.clear();
+            m_rtSoftShadowDirectionalImageViews.clear();
+            m_rtSoftShadowDirectionalImageSamplers.clear();
+            m_rtSoftShadowPointImageInfos.clear();
+            m_rtSoftShadowPointImageViews.clear();
+            m_rtSoftShadowPointImageSamplers.clear();
+            m_rtSoftShadowSpotImageInfos.clear();
+            m_rtSoftShadowSpotImageViews.clear();
+            m_rtSoftShadowSpotImageSamplers.clear();
+            m_rtAOImageInfos.clear();
+            m_rtAOImageViews.clear();
+            m_rtAOImageSamplers.clear();
+            m_rtReflectionImageInfos.clear();
+            m_rtReflectionImageViews.clear();
+            m_rtReflectionImageSamplers.clear();
+            m_rtReflectionLowResImageInfos.clear();
+            m_rtReflectionLowResImageViews.clear();
+            m_rtReflectionLowResImageSamplers.clear();
+            m_randomImageInfos.clear();
+            m_randomImageViews.clear();
         }
 
         void createAllCommandBuffers()
         {
             // primary buffers, needs to be re-recorded every frame
-            vk::CommandBufferAllocateInfo cmdAllocInfo(m_commandPool, vk::CommandBufferLevel::ePrimary, static_cast<uint32_t>(m_swapChainFramebuffers.size()));
+            vk::CommandBufferAllocateInfo cmdAllocInfo(m_commandPool, vk::CommandBufferLevel::ePrimary, static_cast<uint32_t>(m_frameResourceCount));
             m_commandBuffers = m_context.getDevice().allocateCommandBuffers(cmdAllocInfo);
 
-            vk::CommandBufferAllocateInfo cmdAllocInfoCompute(m_computeCommandPool, vk::CommandBufferLevel::ePrimary, static_cast<uint32_t>(m_swapChainFramebuffers.size()));
+            vk::CommandBufferAllocateInfo cmdAllocInfoCompute(m_computeCommandPool, vk::CommandBufferLevel::ePrimary, static_cast<uint32_t>(m_frameResourceCount));
             m_computeCommandBuffers = m_context.getDevice().allocateCommandBuffers(cmdAllocInfoCompute);
-            m_computeFinishedFences.resize(m_swapChainFramebuffers.size());
+            m_computeFinishedFences.resize(m_frameResourceCount);
             vk::FenceCreateInfo fenceInfo;
             for (auto & fence : m_computeFinishedFences)
                 fence = m_context.getDevice().createFence(fenceInfo);
 
 
             // static secondary buffers (containing draw calls), never change
-            vk::CommandBufferAllocateInfo secondaryCmdAllocInfo(m_commandPool, vk::CommandBufferLevel::eSecondary, static_cast<uint32_t>(m_swapChainFramebuffers.size()));
+            vk::CommandBufferAllocateInfo secondaryCmdAllocInfo(m_commandPool, vk::CommandBufferLevel::eSecondary, static_cast<uint32_t>(m_frameResourceCount));
             m_gbufferSecondaryCommandBuffers            = m_context.getDevice().allocateCommandBuffers(secondaryCmdAllocInfo);
             m_fullscreenLightingSecondaryCommandBuffers = m_context.getDevice().allocateCommandBuffers(secondaryCmdAllocInfo);
             m_rtSoftShadowsSecondaryCommandBuffers      = m_context.getDevice().allocateCommandBuffers(secondaryCmdAllocInfo);
@@ -2109,14 +2489,31 @@ namespace vg
             // fill static command buffers:
             for (size_t i = 0; i < m_gbufferSecondaryCommandBuffers.size(); i++)
             {
-                //// gbuffer pass command buffers
-                vk::CommandBufferInheritanceInfo inheritanceInfo(m_gbufferRenderpass, 0, m_gbufferFramebuffers.at(i), 0, {}, {});
-                vk::CommandBufferBeginInfo beginInfo(vk::CommandBufferUsageFlagBits::eSimultaneousUse | vk::CommandBufferUsageFlagBits::eRenderPassContinue, &inheritanceInfo);
-                m_gbufferSecondaryCommandBuffers.at(i).begin(beginInfo);
-                m_timerManager.writeTimestampStart("1 G-Buffer", m_gbufferSecondaryCommandBuffers.at(i), vk::PipelineStageFlagBits::eAllGraphics, i);
+                recordGBufferCommandBuffer(i);
+                recordFullscreenLightingCommandBuffer(i);
+                recordRTSoftShadowsCommandBuffer(i);
+                recordRTAOCommandBuffer(i);
+                recordRTReflectionCommandBuffers(i);
+            }
+        }
+
+        // static secondary command buffers of frame slot i, one function per pass so a reloaded pipeline only re-records its own pass
+        void recordGBufferCommandBuffer(const size_t i)
+        {
+            //// gbuffer pass command buffers
+            vk::CommandBufferInheritanceInfo inheritanceInfo(m_gbufferRenderpass, 0, m_gbufferFramebuffers.at(i), 0, {}, {});
+            vk::CommandBufferBeginInfo beginInfo(vk::CommandBufferUsageFlagBits::eSimultaneousUse | vk::CommandBufferUsageFlagBits::eRenderPassContinue, &inheritanceInfo);
+            m_gbufferSecondaryCommandBuffers.at(i).begin(beginInfo);
+            {
+                GpuTimerScope timerScope(m_timerManager, m_gbufferSecondaryCommandBuffers.at(i), "1 G-Buffer", i, vk::PipelineStageFlagBits::eAllGraphics);
+                m_pipelineStatistics.cmdBeginQuery("1 G-Buffer", m_gbufferSecondaryCommandBuffers.at(i), i);
 
                 m_gbufferSecondaryCommandBuffers.at(i).bindPipeline(vk::PipelineBindPoint::eGraphics, m_gbufferGraphicsPipeline);
 
+                // render into the top left corner of the g-buffer, the lighting pass upscales
+                m_gbufferSecondaryCommandBuffers.at(i).setViewport(0, vk::Viewport(0.0f, 0.0f, static_cast<float>(m_renderExtent.width), static_cast<float>(m_renderExtent.height), 0.0f, 1.0f));
+                m_gbufferSecondaryCommandBuffers.at(i).setScissor(0, vk::Rect2D({ 0, 0 }, m_renderExtent));
+
                 m_gbufferSecondaryCommandBuffers.at(i).bindVertexBuffers(0, m_vertexBufferInfo.m_Buffer, 0ull);
                 m_gbufferSecondaryCommandBuffers.at(i).bindIndexBuffer(m_indexBufferInfo.m_Buffer, 0ull, vk::IndexType::eUint32);
 
@@ -2124,20 +2521,28 @@ namespace vg
 
                 m_gbufferSecondaryCommandBuffers.at(i).drawIndexedIndirect(m_indirectDrawBufferInfo.m_Buffer, 0, static_cast<uint32_t>(m_scene.getDrawCommandData().size()),
                     sizeof(std::decay_t<decltype(*m_scene.getDrawCommandData().data())>));
-                
-                m_timerManager.writeTimestampStop("1 G-Buffer", m_gbufferSecondaryCommandBuffers.at(i), vk::PipelineStageFlagBits::eAllGraphics, i);
-                m_gbufferSecondaryCommandBuffers.at(i).end();
 
-                //TODO synchronization for g-buffer resources should be done "implicitly" by renderpasses. check this
+                m_pipelineStatistics.cmdEndQuery("1 G-Buffer", m_gbufferSecondaryCommandBuffers.at(i), i);
+            }
+            m_gbufferSecondaryCommandBuffers.at(i).end();
 
+            //TODO synchronization for g-buffer resources should be done "implicitly" by renderpasses. check this
+        }
 
-                //// fullscreen lighting pass command buffers
-                vk::CommandBufferInheritanceInfo inheritanceInfo2(m_fullscreenLightingRenderpass, 0, m_swapChainFramebuffers.at(i), 0, {}, {});
-                vk::CommandBufferBeginInfo beginInfo2(vk::CommandBufferUsageFlagBits::eSimultaneousUse | vk::CommandBufferUsageFlagBits::eRenderPassContinue, &inheritanceInfo2);
-                m_fullscreenLightingSecondaryCommandBuffers.at(i).begin(beginInfo2);
-                m_timerManager.writeTimestampStart("5 Fullscreen Lighting", m_fullscreenLightingSecondaryCommandBuffers.at(i), vk::PipelineStageFlagBits::eAllGraphics, i);
+        void recordFullscreenLightingCommandBuffer(const size_t i)
+        {
+            //// fullscreen lighting pass command buffers
+            vk::CommandBufferInheritanceInfo inheritanceInfo2(m_fullscreenLightingRenderpass, 0, nullptr, 0, {}, {});
+            vk::CommandBufferBeginInfo beginInfo2(vk::CommandBufferUsageFlagBits::eSimultaneousUse | vk::CommandBufferUsageFlagBits::eRenderPassContinue, &inheritanceInfo2);
+            m_fullscreenLightingSecondaryCommandBuffers.at(i).begin(beginInfo2);
+            {
+                GpuTimerScope timerScope(m_timerManager, m_fullscreenLightingSecondaryCommandBuffers.at(i), "5 Fullscreen Lighting", i, vk::PipelineStageFlagBits::eAllGraphics);
+                m_pipelineStatistics.cmdBeginQuery("5 Fullscreen Lighting", m_fullscreenLightingSecondaryCommandBuffers.at(i), i);
 
                 m_fullscreenLightingSecondaryCommandBuffers.at(i).bindPipeline(vk::PipelineBindPoint::eGraphics, m_fullscreenLightingPipeline);
+                const auto ext = m_context.getSwapChainExtent();
+                m_fullscreenLightingSecondaryCommandBuffers.at(i).setViewport(0, vk::Viewport(0.0f, 0.0f, static_cast<float>(ext.width), static_cast<float>(ext.height), 0.0f, 1.0f));
+                m_fullscreenLightingSecondaryCommandBuffers.at(i).setScissor(0, vk::Rect2D({ 0, 0 }, ext));
 
                 // important: bind the descriptor set corresponding to the correct multi-buffered gbuffer resources
                 std::array descSets = { m_fullScreenLightingDescriptorSets.at(i), m_lightDescriptorSet, m_allRTImageSampleDescriptorSets.at(i) };
@@ -2145,114 +2550,124 @@ namespace vg
                     0, static_cast<uint32_t>(descSets.size()), descSets.data(), 0, nullptr);
 
                 m_fullscreenLightingSecondaryCommandBuffers.at(i).draw(3, 1, 0, 0);
-                
-                m_timerManager.writeTimestampStop("5 Fullscreen Lighting", m_fullscreenLightingSecondaryCommandBuffers.at(i), vk::PipelineStageFlagBits::eAllGraphics, i);
-
-                m_fullscreenLightingSecondaryCommandBuffers.at(i).end();
 
+                m_pipelineStatistics.cmdEndQuery("5 Fullscreen Lighting", m_fullscreenLightingSecondaryCommandBuffers.at(i), i);
+            }
 
+            m_fullscreenLightingSecondaryCommandBuffers.at(i).end();
+        }
 
-                //// ray tracing (for shadows) command buffers
-                vk::CommandBufferInheritanceInfo inheritanceInfo3(nullptr, 0, nullptr, 0, {}, {});
-                vk::CommandBufferBeginInfo beginInfo3(vk::CommandBufferUsageFlagBits::eSimultaneousUse , &inheritanceInfo3);
-                m_rtSoftShadowsSecondaryCommandBuffers.at(i).begin(beginInfo3);
-
-                m_rtSoftShadowsSecondaryCommandBuffers.at(i).bindPipeline(vk::PipelineBindPoint::eRayTracingNV, m_rtSoftShadowsPipeline);
-                std::array dss = { m_rtSoftShadowsDescriptorSets.at(i), m_lightDescriptorSet, m_shadowImageStoreDescriptorSets.at(i) };
-                m_rtSoftShadowsSecondaryCommandBuffers.at(i).bindDescriptorSets(vk::PipelineBindPoint::eRayTracingNV, m_rtSoftShadowsPipelineLayout,
-                    0, static_cast<uint32_t>(dss.size()), dss.data(), 0, nullptr);
-
-                // transition gbuffer images to read it in RT
-                vk::ImageMemoryBarrier barrierGBposTORT(
-                    vk::AccessFlagBits::eColorAttachmentWrite, vk::AccessFlagBits::eShaderRead,
-                    vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
-                    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
-                    m_gbufferPositionImageInfos.at(i).m_Image,
-                    vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS)
-                );
+        // also transitions the gbuffer images for all RT passes
+        void recordRTSoftShadowsCommandBuffer(const size_t i)
+        {
+            //// ray tracing (for shadows) command buffers
+            vk::CommandBufferInheritanceInfo inheritanceInfo3(nullptr, 0, nullptr, 0, {}, {});
+            vk::CommandBufferBeginInfo beginInfo3(vk::CommandBufferUsageFlagBits::eSimultaneousUse , &inheritanceInfo3);
+            m_rtSoftShadowsSecondaryCommandBuffers.at(i).begin(beginInfo3);
+
+            m_rtSoftShadowsSecondaryCommandBuffers.at(i).bindPipeline(vk::PipelineBindPoint::eRayTracingNV, m_rtSoftShadowsPipeline);
+            std::array dss = { m_rtSoftShadowsDescriptorSets.at(i), m_lightDescriptorSet, m_shadowImageStoreDescriptorSets.at(i) };
+            m_rtSoftShadowsSecondaryCommandBuffers.at(i).bindDescriptorSets(vk::PipelineBindPoint::eRayTracingNV, m_rtSoftShadowsPipelineLayout,
+                0, static_cast<uint32_t>(dss.size()), dss.data(), 0, nullptr);
+
+            // transition gbuffer images to read it in RT
+            vk::ImageMemoryBarrier barrierGBposTORT(
+                vk::AccessFlagBits::eColorAttachmentWrite, vk::AccessFlagBits::eShaderRead,
+                vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                m_gbufferPositionImageInfos.at(i).m_Image,
+                vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS)
+            );
 
-                vk::ImageMemoryBarrier barrierGBnormalTORT = barrierGBposTORT;
-                barrierGBnormalTORT.setImage(m_gbufferNormalImageInfos.at(i).m_Image);
-                barrierGBnormalTORT.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS));
+            vk::ImageMemoryBarrier barrierGBnormalTORT = barrierGBposTORT;
+            barrierGBnormalTORT.setImage(m_gbufferNormalImageInfos.at(i).m_Image);
+            barrierGBnormalTORT.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS));
 
-                vk::ImageMemoryBarrier barrierGBuvTORT = barrierGBposTORT;
-                barrierGBuvTORT.setImage(m_gbufferUVImageInfos.at(i).m_Image);
+            vk::ImageMemoryBarrier barrierGBuvTORT = barrierGBposTORT;
+            barrierGBuvTORT.setImage(m_gbufferUVImageInfos.at(i).m_Image);
 
 
-                std::array gBufferBarriers = { barrierGBposTORT, barrierGBnormalTORT, barrierGBuvTORT };
+            std::array gBufferBarriers = { barrierGBposTORT, barrierGBnormalTORT, barrierGBuvTORT };
 
-                m_rtSoftShadowsSecondaryCommandBuffers.at(i).pipelineBarrier(
-                    vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eRayTracingShaderNV,
-                    vk::DependencyFlagBits::eByRegion, {}, {}, gBufferBarriers
-                );
+            m_rtSoftShadowsSecondaryCommandBuffers.at(i).pipelineBarrier(
+                vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eRayTracingShaderNV,
+                vk::DependencyFlagBits::eByRegion, {}, {}, gBufferBarriers
+            );
 
-                // transition shadow image to write to it in raygen shader
-                vk::ImageMemoryBarrier barrierPointShadowTORT(
-                    vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eShaderWrite,
-                    vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eGeneral,
-                    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
-                    m_rtSoftShadowPointImageInfos.at(i).m_Image,
-                    vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS)
-                );
+            // transition shadow image to write to it in raygen shader
+            vk::ImageMemoryBarrier barrierPointShadowTORT(
+                vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eShaderWrite,
+                vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eGeneral,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                m_rtSoftShadowPointImageInfos.at(i).m_Image,
+                vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS)
+            );
 
-                vk::ImageMemoryBarrier barrierSpotShadowTORT = barrierPointShadowTORT;
-                barrierSpotShadowTORT.image = m_rtSoftShadowSpotImageInfos.at(i).m_Image;
+            vk::ImageMemoryBarrier barrierSpotShadowTORT = barrierPointShadowTORT;
+            barrierSpotShadowTORT.image = m_rtSoftShadowSpotImageInfos.at(i).m_Image;
 
-                m_rtSoftShadowsSecondaryCommandBuffers.at(i).pipelineBarrier(
-                    vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eRayTracingShaderNV,
-                    vk::DependencyFlagBits::eByRegion, {}, {}, { barrierPointShadowTORT, barrierSpotShadowTORT }
-                );
-                m_timerManager.writeTimestampStart("2 Ray Traced Shadows", m_rtSoftShadowsSecondaryCommandBuffers.at(i), vk::PipelineStageFlagBits::eRayTracingShaderNV, i);
+            m_rtSoftShadowsSecondaryCommandBuffers.at(i).pipelineBarrier(
+                vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eRayTracingShaderNV,
+                vk::DependencyFlagBits::eByRegion, {}, {}, { barrierPointShadowTORT, barrierSpotShadowTORT }
+            );
+            {
+                GpuTimerScope timerScope(m_timerManager, m_rtSoftShadowsSecondaryCommandBuffers.at(i), "2 Ray Traced Shadows", i, vk::PipelineStageFlagBits::eRayTracingShaderNV);
 
 
                 auto vkCmdTraceRaysNV = reinterpret_cast<PFN_vkCmdTraceRaysNV>(vkGetDeviceProcAddr(m_context.getDevice(), "vkCmdTraceRaysNV"));
                 vkCmdTraceRaysNV(m_rtSoftShadowsSecondaryCommandBuffers.at(i),
-                    m_rtSoftShadowSBTInfo.m_Buffer, 0, // raygen
-                    m_rtSoftShadowSBTInfo.m_Buffer, 1 * m_context.getRaytracingProperties().shaderGroupHandleSize, m_context.getRaytracingProperties().shaderGroupHandleSize, // miss
-                    nullptr, 0, 0, // m_rtSoftShadowSBTInfo.m_Buffer, 1 * m_context.getRaytracingProperties().shaderGroupHandleSize, m_context.getRaytracingProperties().shaderGroupHandleSize, // (any) hit
+                    m_rtSBTInfo.m_Buffer, m_rtSoftShadowSBTRegion.raygenOffset, // raygen
+                    m_rtSBTInfo.m_Buffer, m_rtSoftShadowSBTRegion.missOffset, m_rtSoftShadowSBTRegion.missStride, // miss
+                    nullptr, 0, 0, // (any) hit
                     nullptr, 0, 0, // callable
-                    m_context.getSwapChainExtent().width, m_context.getSwapChainExtent().height, 1
+                    m_renderExtent.width, m_renderExtent.height, 1
                 );
 
-                m_timerManager.writeTimestampStop("2 Ray Traced Shadows", m_rtSoftShadowsSecondaryCommandBuffers.at(i), vk::PipelineStageFlagBits::eRayTracingShaderNV, i);
-
-                //vk::ImageMemoryBarrier barrierRandomImage(
-                //    vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
-                //    vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral,
-                //    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
-                //    m_randomImageInfos.at(i).m_Image,
-                //    vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS)
-                //);
-                //m_rtSoftShadowsSecondaryCommandBuffers.at(i).pipelineBarrier(
-                //    vk::PipelineStageFlagBits::eRayTracingShaderNV, vk::PipelineStageFlagBits::eRayTracingShaderNV,
-                //    vk::DependencyFlagBits::eByRegion, {}, {}, { barrierRandomImage }
-                //);
-
-
-                // transition image to read it in the fullscreen lighting shader
-                vk::ImageMemoryBarrier barrierPointShadowTOFS(
-                    vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead,
-                    vk::ImageLayout::eGeneral, vk::ImageLayout::eShaderReadOnlyOptimal,
-                    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
-                    m_rtSoftShadowPointImageInfos.at(i).m_Image,
-                    vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS)
-                );
+            }
 
-                vk::ImageMemoryBarrier barrierSpotShadowTOFS = barrierPointShadowTOFS;
-                barrierSpotShadowTOFS.image = m_rtSoftShadowSpotImageInfos.at(i).m_Image;
+            //vk::ImageMemoryBarrier barrierRandomImage(
+            //    vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+            //    vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral,
+            //    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+            //    m_randomImageInfos.at(i).m_Image,
+            //    vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS)
+            //);
+            //m_rtSoftShadowsSecondaryCommandBuffers.at(i).pipelineBarrier(
+            //    vk::PipelineStageFlagBits::eRayTracingShaderNV, vk::PipelineStageFlagBits::eRayTracingShaderNV,
+            //    vk::DependencyFlagBits::eByRegion, {}, {}, { barrierRandomImage }
+            //);
+
+
+            // transition image to read it in the fullscreen lighting shader
+            vk::ImageMemoryBarrier barrierPointShadowTOFS(
+                vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead,
+                vk::ImageLayout::eGeneral, vk::ImageLayout::eShaderReadOnlyOptimal,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                m_rtSoftShadowPointImageInfos.at(i).m_Image,
+                vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS)
+            );
 
-                m_rtSoftShadowsSecondaryCommandBuffers.at(i).pipelineBarrier(
-                    vk::PipelineStageFlagBits::eRayTracingShaderNV, vk::PipelineStageFlagBits::eFragmentShader,
-                    vk::DependencyFlagBits::eByRegion, {}, {}, { barrierPointShadowTOFS , barrierSpotShadowTOFS }
-                );
+            vk::ImageMemoryBarrier barrierSpotShadowTOFS = barrierPointShadowTOFS;
+            barrierSpotShadowTOFS.image = m_rtSoftShadowSpotImageInfos.at(i).m_Image;
 
-                m_rtSoftShadowsSecondaryCommandBuffers.at(i).end();
+            m_rtSoftShadowsSecondaryCommandBuffers.at(i).pipelineBarrier(
+                vk::PipelineStageFlagBits::eRayTracingShaderNV, vk::PipelineStageFlagBits::eFragmentShader,
+                vk::DependencyFlagBits::eByRegion, {}, {}, { barrierPointShadowTOFS , barrierSpotShadowTOFS }
+            );
 
+            m_rtSoftShadowsSecondaryCommandBuffers.at(i).end();
+        }
 
-                //// AO Pass ////
+        void recordRTAOCommandBuffer(const size_t i)
+        {
+            //// AO Pass ////
+            vk::CommandBufferInheritanceInfo inheritanceInfo3(nullptr, 0, nullptr, 0, {}, {});
+            vk::CommandBufferBeginInfo beginInfo3(vk::CommandBufferUsageFlagBits::eSimultaneousUse , &inheritanceInfo3);
+            auto vkCmdTraceRaysNV = reinterpret_cast<PFN_vkCmdTraceRaysNV>(vkGetDeviceProcAddr(m_context.getDevice(), "vkCmdTraceRaysNV"));
 
-                m_rtAOSecondaryCommandBuffers.at(i).begin(beginInfo3);
-                m_timerManager.writeTimestampStart("3 Ray Traced Ambient Occlusion", m_rtAOSecondaryCommandBuffers.at(i), vk::PipelineStageFlagBits::eRayTracingShaderNV, i);
+            m_rtAOSecondaryCommandBuffers.at(i).begin(beginInfo3);
+            {
+                GpuTimerScope timerScope(m_timerManager, m_rtAOSecondaryCommandBuffers.at(i), "3 Ray Traced Ambient Occlusion", i, vk::PipelineStageFlagBits::eRayTracingShaderNV);
 
                 m_rtAOSecondaryCommandBuffers.at(i).bindPipeline(vk::PipelineBindPoint::eRayTracingNV, m_rtAOPipeline);
                 std::array dss2 = { m_rtAODescriptorSets.at(i), m_rtAOImageStoreDescriptorSets.at(i) };
@@ -2274,11 +2689,11 @@ namespace vg
                 );
 
                 vkCmdTraceRaysNV(m_rtAOSecondaryCommandBuffers.at(i),
-                    m_rtAOSBTInfo.m_Buffer, 0, // raygen
-                    m_rtAOSBTInfo.m_Buffer, 2 * m_context.getRaytracingProperties().shaderGroupHandleSize, m_context.getRaytracingProperties().shaderGroupHandleSize, // miss
-                    m_rtAOSBTInfo.m_Buffer, 1 * m_context.getRaytracingProperties().shaderGroupHandleSize, m_context.getRaytracingProperties().shaderGroupHandleSize, // (any) hit
+                    m_rtSBTInfo.m_Buffer, m_rtAOSBTRegion.raygenOffset, // raygen
+                    m_rtSBTInfo.m_Buffer, m_rtAOSBTRegion.missOffset, m_rtAOSBTRegion.missStride, // miss
+                    m_rtSBTInfo.m_Buffer, m_rtAOSBTRegion.hitOffset, m_rtAOSBTRegion.hitStride, // (any) hit
                     nullptr, 0, 0, // callable
-                    m_context.getSwapChainExtent().width, m_context.getSwapChainExtent().height, 1
+                    m_renderExtent.width, m_renderExtent.height, 1
                 );
 
                 //m_rtAOSecondaryCommandBuffers.at(i).pipelineBarrier(
@@ -2300,15 +2715,23 @@ namespace vg
                     vk::DependencyFlagBits::eByRegion, {}, {}, barrierAOTOFS
                 );
 
-                m_timerManager.writeTimestampStop("3 Ray Traced Ambient Occlusion", m_rtAOSecondaryCommandBuffers.at(i), vk::PipelineStageFlagBits::eRayTracingShaderNV, i);
-                m_rtAOSecondaryCommandBuffers.at(i).end();
+            }
+            m_rtAOSecondaryCommandBuffers.at(i).end();
+        }
 
-				///// REFLECTION PASS /////
+        // full and half resolution variant
+        void recordRTReflectionCommandBuffers(const size_t i)
+        {
+			///// REFLECTION PASS /////
+            vk::CommandBufferInheritanceInfo inheritanceInfo3(nullptr, 0, nullptr, 0, {}, {});
+            vk::CommandBufferBeginInfo beginInfo3(vk::CommandBufferUsageFlagBits::eSimultaneousUse , &inheritanceInfo3);
+            auto vkCmdTraceRaysNV = reinterpret_cast<PFN_vkCmdTraceRaysNV>(vkGetDeviceProcAddr(m_context.getDevice(), "vkCmdTraceRaysNV"));
 
-                auto generateReflectionSecondaryCommandBuffer = [this, &vkCmdTraceRaysNV, &beginInfo3](const glm::ivec2& extent, vk::CommandBuffer& commandBuffer, const size_t i)
+            auto generateReflectionSecondaryCommandBuffer = [this, &vkCmdTraceRaysNV, &beginInfo3](const glm::ivec2& extent, vk::CommandBuffer& commandBuffer, const size_t i)
+            {
+                commandBuffer.begin(beginInfo3);
                 {
-                    commandBuffer.begin(beginInfo3);
-                    m_timerManager.writeTimestampStart("4 Ray Traced Reflections", commandBuffer, vk::PipelineStageFlagBits::eRayTracingShaderNV, i);
+                    GpuTimerScope timerScope(m_timerManager, commandBuffer, "4 Ray Traced Reflections", i, vk::PipelineStageFlagBits::eRayTracingShaderNV);
 
                     commandBuffer.bindPipeline(vk::PipelineBindPoint::eRayTracingNV, m_rtReflectionsPipeline);
                     std::array dss3 = { m_rtReflectionsDescriptorSets.at(i), m_lightDescriptorSet };
@@ -2332,9 +2755,9 @@ namespace vg
                     );
 
                     vkCmdTraceRaysNV(commandBuffer,
-                        m_rtReflectionsSBTInfo.m_Buffer, 0, // raygen
-                        m_rtReflectionsSBTInfo.m_Buffer, 2 * m_context.getRaytracingProperties().shaderGroupHandleSize, m_context.getRaytracingProperties().shaderGroupHandleSize, // miss
-                        m_rtReflectionsSBTInfo.m_Buffer, 1 * m_context.getRaytracingProperties().shaderGroupHandleSize, m_context.getRaytracingProperties().shaderGroupHandleSize, // closest hit
+                        m_rtSBTInfo.m_Buffer, m_rtReflectionsSBTRegion.raygenOffset, // raygen
+                        m_rtSBTInfo.m_Buffer, m_rtReflectionsSBTRegion.missOffset, m_rtReflectionsSBTRegion.missStride, // miss
+                        m_rtSBTInfo.m_Buffer, m_rtReflectionsSBTRegion.hitOffset, m_rtReflectionsSBTRegion.hitStride, // closest hit
                         nullptr, 0, 0, // callable
                         extent.x, extent.y, 1
                     );
@@ -2361,21 +2784,470 @@ namespace vg
                         vk::DependencyFlagBits::eByRegion, {}, {}, { barrierReflTOFS, barrierLowResReflTOFS }
                     );
 
-                    m_timerManager.writeTimestampStop("4 Ray Traced Reflections", commandBuffer, vk::PipelineStageFlagBits::eRayTracingShaderNV, i);
-                    commandBuffer.end();
-                };
+                }
+                commandBuffer.end();
+            };
 
-                glm::ivec2 extent(m_context.getSwapChainExtent().width, m_context.getSwapChainExtent().height);
-                glm::ivec2 extentLowRes(m_context.getSwapChainExtent().width / 2, m_context.getSwapChainExtent().height / 2);
+            glm::ivec2 extent(m_renderExtent.width, m_renderExtent.height);
+            glm::ivec2 extentLowRes(std::max(m_renderExtent.width / 2, 1u), std::max(m_renderExtent.height / 2, 1u));
 
-                generateReflectionSecondaryCommandBuffer(extent, m_rtReflectionsSecondaryCommandBuffers.at(i), i);
-                generateReflectionSecondaryCommandBuffer(extentLowRes, m_rtReflectionsLowResSecondaryCommandBuffers.at(i), i);
+            generateReflectionSecondaryCommandBuffer(extent, m_rtReflectionsSecondaryCommandBuffers.at(i), i);
+            generateReflectionSecondaryCommandBuffer(extentLowRes, m_rtReflectionsLowResSecondaryCommandBuffers.at(i), i);
+        }
 
+        void scheduleSecondaryUpdate(std::function<void(size_t)> record, std::function<void()> retire)
+        {
+            m_pendingSecondaryUpdates.push_back({ std::move(record), std::vector<bool>(m_frameResourceCount, true), std::move(retire) });
+        }
+
+        // re-records the secondary command buffers of currentImage that still reference a replaced pipeline
+        // currentImage is not in flight here (its primary is re-recorded below as well)
+        void processPendingSecondaryUpdates(uint32_t currentImage)
+        {
+            for (auto& update : m_pendingSecondaryUpdates)
+            {
+                if (update.dirtyImages.at(currentImage))
+                {
+                    update.record(currentImage);
+                    update.dirtyImages.at(currentImage) = false;
+                }
             }
+
+            const auto firstDone = std::stable_partition(m_pendingSecondaryUpdates.begin(), m_pendingSecondaryUpdates.end(), [](const PendingSecondaryUpdate& update)
+            {
+                return std::any_of(update.dirtyImages.begin(), update.dirtyImages.end(), [](bool dirty) { return dirty; });
+            });
+
+            // the frames submitted before this one may still use the replaced objects
+            for (auto it = firstDone; it != m_pendingSecondaryUpdates.end(); ++it)
+                m_retireQueue.retire(m_frameNumber + m_context.max_frames_in_flight, std::move(it->retire));
+            m_pendingSecondaryUpdates.erase(firstDone, m_pendingSecondaryUpdates.end());
+        }
+
+        void beginTraceCapture()
+        {
+            m_timerManager.recalibrateGpuClock();
+            m_traceExporter.beginCapture();
+        }
+
+        // open the file in chrome://tracing or ui.perfetto.dev
+        void endTraceCapture()
+        {
+            const auto path = g_resourcesPath / "logs" / ("trace_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count()) + ".json");
+            const auto eventCount = m_traceExporter.getEventCount();
+            if (m_traceExporter.endCapture(path))
+                m_context.getLogger()->info("Wrote {} trace events to {}", eventCount, path.string());
+            else
+                m_context.getLogger()->error("Failed to write trace to {}", path.string());
+        }
+
+        // resources-relative path of the scene, a benchmark can choose another one
+        static std::filesystem::path getSceneFile(const BenchmarkRunner* benchmark)
+        {
+            if (benchmark != nullptr && !benchmark->getScene().empty())
+                return benchmark->getScene();
+            return "pica_pica_-_mini_diorama_01/scene.gltf";
+            //return "Bistro/Bistro_Research_Exterior.fbx";
+            //return "Bistro/Bistro_Research_Interior.fbx";
+            //return "Bistro_v4/Bistro_Interior.fbx";
+            //return "Bistro_v4/Bistro_Exterior.fbx";
+            //return "SunTemple/SunTemple.fbx";
+        }
+
+        // settings that would make runs incomparable are fixed for the whole benchmark
+        void setupBenchmark()
+        {
+            m_dynamicResolution.setEnabled(false);
+            setRenderScale(m_dynamicResolution.getScale());
+            m_accumulateRTSamples = false;
+            m_waitIdleAfterFrame = false;
+
+            if (const auto& animation = m_benchmark->getScript().getAnimation())
+            {
+                m_animate = true;
+                m_animatedObjectID = std::min(animation->objectID, static_cast<int>(m_scene.getModelMatrices().size()) - 1);
+                // same order as the radio buttons
+                m_updateAS = static_cast<int>(animation->updateMode);
+                m_useAsync = animation->useAsyncCompute;
+                m_timerManager.setGuiActiveStatusForTimer("0 AS Update", true);
+            }
+
+            // NVIDIA packs its driver version differently than VK_MAKE_VERSION
+            const auto properties = m_context.getPhysicalDevice().getProperties();
+            const auto driverVersion = properties.vendorID == 0x10DE
+                ? std::to_string(properties.driverVersion >> 22) + "." + std::to_string((properties.driverVersion >> 14) & 0xFF)
+                : std::to_string(VK_VERSION_MAJOR(properties.driverVersion)) + "." + std::to_string(VK_VERSION_MINOR(properties.driverVersion)) + "." + std::to_string(VK_VERSION_PATCH(properties.driverVersion));
+            const auto apiVersion = std::to_string(VK_VERSION_MAJOR(properties.apiVersion)) + "." + std::to_string(VK_VERSION_MINOR(properties.apiVersion)) + "." + std::to_string(VK_VERSION_PATCH(properties.apiVersion));
+            m_benchmark->setDeviceInfo({ properties.deviceName, driverVersion, apiVersion });
+            m_benchmark->setResolution(m_context.getSwapChainExtent().width, m_context.getSwapChainExtent().height);
+            m_benchmark->setAccelerationStructureStats(m_accelerationStructureStats);
+
+            const auto& options = m_benchmark->getOptions();
+            m_context.getLogger()->info("Benchmark {}: {} warm-up and {} measured frames at {} s per frame", options.script.string(), options.warmupFrames, options.measuredFrames, options.timestep);
+        }
+
+        // plays the script back at the simulated time of the frame about to be recorded
+        void updateBenchmark()
+        {
+            VG_PROFILE_SCOPE("Benchmark update");
+            m_benchmark->beginFrame(m_frameNumber);
+            const auto time = m_benchmark->getTime();
+            const auto& script = m_benchmark->getScript();
+
+            if (script.hasCameraPath())
+            {
+                const auto pose = script.getCameraPose(time);
+                m_camera.setPose(pose.position, pose.theta, pose.phi);
+            }
+
+            // the light buffer is persistently mapped, like in the light GUI
+            auto* const pointLights = reinterpret_cast<PBRPointLight*>(m_lightBufferInfos.at(1).m_BufferAllocInfo.pMappedData);
+            for (const auto& [index, position] : script.getPointLightPositions(time))
+            {
+                if (index < static_cast<int>(m_lightManager.getPointLights().size()))
+                    pointLights[index].position = position;
+            }
+
+            if (m_frameNumber % s_benchmarkMemoryInterval == 0)
+                sampleBenchmarkMemory();
+        }
+
+        void sampleBenchmarkMemory()
+        {
+            VmaStats stats;
+            vmaCalculateStats(m_context.getAllocator(), &stats);
+            m_benchmark->addMemorySample({ stats.total.usedBytes, stats.total.unusedBytes, stats.total.allocationCount, stats.total.blockCount });
+        }
+
+        void finishBenchmark()
+        {
+            sampleBenchmarkMemory();
+
+            const auto& options = m_benchmark->getOptions();
+            auto path = options.output;
+            if (path.empty())
+            {
+                const auto name = options.label.empty() ? options.script.stem().string() : options.label;
+                path = g_resourcesPath / "logs" / ("benchmark_" + name + "_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count()) + ".json");
+            }
+
+            if (!m_benchmark->writeReport(path))
+                throw std::runtime_error("Failed to write benchmark report to " + path.string());
+            m_context.getLogger()->info("Wrote benchmark report to {}", path.string());
+        }
+
+        void endCameraPathRecording()
+        {
+            const auto path = g_resourcesPath / "logs" / ("camera_path_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count()) + ".txt");
+            const auto keyframeCount = m_cameraPathRecorder.getKeyframeCount();
+            if (m_cameraPathRecorder.stop(path))
+                m_context.getLogger()->info("Wrote camera path with {} keyframes to {}", keyframeCount + 1, path.string());
+            else
+                m_context.getLogger()->error("Failed to write camera path to {}", path.string());
+        }
+
+        // one layer of an RT image of the last frame as floats, without the alpha channel of rgba images.
+        // the RT images are shader readable between frames, the device has to be idle
+        FloatImage readBackRTImage(const ImageInfo& image, const vk::Extent2D extent, const uint32_t layer, const uint32_t channels)
+        {
+            const auto texelCount = static_cast<size_t>(extent.width) * extent.height;
+            const vk::DeviceSize size = texelCount * channels * sizeof(float);
+            auto stagingBuffer = createBuffer(size, vk::BufferUsageFlagBits::eTransferDst, VMA_MEMORY_USAGE_GPU_TO_CPU, vk::SharingMode::eExclusive, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+            const vk::ImageMemoryBarrier barrierToTransfer(
+                vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferRead,
+                vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferSrcOptimal,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                image.m_Image,
+                vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, layer, 1)
+            );
+            vk::ImageMemoryBarrier barrierToShaderRead = barrierToTransfer;
+            barrierToShaderRead.srcAccessMask = vk::AccessFlagBits::eTransferRead;
+            barrierToShaderRead.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+            barrierToShaderRead.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+            barrierToShaderRead.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+
+            auto cmdBuf = beginSingleTimeCommands(m_commandPool);
+            cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eRayTracingShaderNV, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, { barrierToTransfer });
+            const vk::BufferImageCopy region(0, 0, 0, vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, layer, 1), { 0, 0, 0 }, { extent.width, extent.height, 1 });
+            cmdBuf.copyImageToBuffer(image.m_Image, vk::ImageLayout::eTransferSrcOptimal, stagingBuffer.m_Buffer, region);
+            cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, { barrierToShaderRead });
+            endSingleTimeCommands(cmdBuf, m_context.getGraphicsQueue(), m_commandPool);
+
+            // GPU_TO_CPU memory can be cached without being coherent
+            vmaInvalidateAllocation(m_context.getAllocator(), stagingBuffer.m_BufferAllocation, 0, VK_WHOLE_SIZE);
+            const auto* texels = static_cast<const float*>(stagingBuffer.m_BufferAllocInfo.pMappedData);
+            FloatImage result(extent.width, extent.height, std::min(channels, 3u));
+            for (size_t i = 0; i < texelCount; i++)
+                for (uint32_t c = 0; c < result.getChannels(); c++)
+                    result.getPixels()[i * result.getChannels() + c] = texels[i * channels + c];
+
+            vmaDestroyBuffer(m_context.getAllocator(), static_cast<VkBuffer>(stagingBuffer.m_Buffer), stagingBuffer.m_BufferAllocation);
+            return result;
+        }
+
+        // writes the RT terms of the last frame and everything needed to render them again into a folder,
+        // compare it against the CPU reference with rtreference
+        void captureRTTerms()
+        {
+            const auto folder = g_resourcesPath / "logs" / ("rt_capture_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count()));
+            try
+            {
+                std::filesystem::create_directories(folder);
+
+                RTCapture capture;
+                capture.scene = getSceneFile(m_benchmark).generic_string();
+                capture.width = m_renderExtent.width;
+                capture.height = m_renderExtent.height;
+                capture.aspect = m_context.getSwapChainExtent().width / static_cast<float>(m_context.getSwapChainExtent().height);
+                capture.cameraPosition = m_camera.getPosition();
+                capture.cameraTheta = m_camera.getTheta();
+                capture.cameraPhi = m_camera.getPhi();
+                capture.frameCount = m_sampleCounts.at(m_lastRenderedImage);
+                capture.aoRadius = m_RTAORadius;
+                capture.aoSamples = m_numAOSamples;
+                capture.reflectionSamples = m_numRTReflectionSamples;
+                capture.reflectionRoughnessThreshold = m_reflectionRoughnessThreshold;
+                capture.lowResReflections = m_activeLowResReflections != 0;
+                capture.materialChannelLayout = m_sceneConstants.get(SpecConstant::MaterialChannelLayout);
+
+                // the light GUI and the benchmark move the lights in the mapped buffers
+                const auto* directionalLights = reinterpret_cast<const PBRDirectionalLight*>(m_lightBufferInfos.at(0).m_BufferAllocInfo.pMappedData);
+                const auto* pointLights = reinterpret_cast<const PBRPointLight*>(m_lightBufferInfos.at(1).m_BufferAllocInfo.pMappedData);
+                const auto* spotLights = reinterpret_cast<const PBRSpotLight*>(m_lightBufferInfos.at(2).m_BufferAllocInfo.pMappedData);
+                capture.directionalLights.assign(directionalLights, directionalLights + m_lightManager.getDirectionalLights().size());
+                capture.pointLights.assign(pointLights, pointLights + m_lightManager.getPointLights().size());
+                // the spot shadow image only has a layer per point light
+                capture.spotLights.assign(spotLights, spotLights + std::min(m_lightManager.getSpotLights().size(), m_lightManager.getPointLights().size()));
+
+                const auto image = m_lastRenderedImage;
+                for (uint32_t i = 0; i < capture.directionalLights.size(); i++)
+                    readBackRTImage(m_rtSoftShadowDirectionalImageInfos.at(image), m_renderExtent, i, 1).savePfm(folder / RTCapture::getImageFile(RTCapture::Term::DirectionalShadow, i));
+                for (uint32_t i = 0; i < capture.pointLights.size(); i++)
+                    readBackRTImage(m_rtSoftShadowPointImageInfos.at(image), m_renderExtent, i, 1).savePfm(folder / RTCapture::getImageFile(RTCapture::Term::PointShadow, i));
+                for (uint32_t i = 0; i < capture.spotLights.size(); i++)
+                    readBackRTImage(m_rtSoftShadowSpotImageInfos.at(image), m_renderExtent, i, 1).savePfm(folder / RTCapture::getImageFile(RTCapture::Term::SpotShadow, i));
+                readBackRTImage(m_rtAOImageInfos.at(image), m_renderExtent, 0, 1).savePfm(folder / RTCapture::getImageFile(RTCapture::Term::AmbientOcclusion));
+                if (capture.lowResReflections)
+                {
+                    const vk::Extent2D extentLowRes(std::max(m_renderExtent.width / 2, 1u), std::max(m_renderExtent.height / 2, 1u));
+                    readBackRTImage(m_rtReflectionLowResImageInfos.at(image), extentLowRes, 0, 4).savePfm(folder / RTCapture::getImageFile(RTCapture::Term::Reflections));
+                }
+                else
+                {
+                    readBackRTImage(m_rtReflectionImageInfos.at(image), m_renderExtent, 0, 4).savePfm(folder / RTCapture::getImageFile(RTCapture::Term::Reflections));
+                }
+
+                if (!capture.save(folder))
+                    throw std::runtime_error("Failed to write " + (folder / "capture.txt").string());
+                m_context.getLogger()->info("Captured the RT terms of {} accumulated frames to {}", capture.frameCount, folder.string());
+            }
+            catch (const std::exception& e)
+            {
+                m_context.getLogger()->error("RT capture failed: {}", e.what());
+            }
+        }
+
+        // fraction of the g-buffer/RT images that is rendered to, exact so texel centers line up
+        [[nodiscard]] glm::vec2 getRenderScale() const
+        {
+            return glm::vec2(m_renderExtent.width, m_renderExtent.height) / glm::vec2(m_targetCapacity.width, m_targetCapacity.height);
+        }
+
+        // GPU time of a read back frame, sum of the per-frame passes. 0 if none of them has a result
+        [[nodiscard]] static float getGPUFrameTime(const TimerManager::CollectedFrame& frame)
+        {
+            float frameTime = 0.0f;
+            for (const auto& name : { "1 G-Buffer", "2 Ray Traced Shadows", "3 Ray Traced Ambient Occlusion", "4 Ray Traced Reflections", "5 Fullscreen Lighting", "6 ImGui" })
+            {
+                if (const auto it = frame.timings.find(name); it != frame.timings.end())
+                    frameTime += it->second;
+            }
+            return frameTime;
+        }
+
+        // only frames read back since the last call are fed, a frame without new results must not count twice
+        void updateDynamicResolution()
+        {
+            bool scaleChanged = false;
+            for (const auto frameTime : m_newGPUFrameTimes)
+                scaleChanged |= m_dynamicResolution.update(frameTime);
+            m_newGPUFrameTimes.clear();
+            if (scaleChanged)
+                setRenderScale(m_dynamicResolution.getScale());
+        }
+
+        // the g-buffer and RT passes render into a sub-rectangle of their full size images,
+        // only their static secondaries change (the lighting pass gets the scale per frame)
+        void setRenderScale(const float scale)
+        {
+            const auto ext = m_context.getSwapChainExtent();
+            const vk::Extent2D renderExtent(std::max(static_cast<uint32_t>(ext.width * scale), 1u), std::max(static_cast<uint32_t>(ext.height * scale), 1u));
+            if (renderExtent == m_renderExtent)
+                return;
+            m_renderExtent = renderExtent;
+
+            // the accumulated RT results belong to the old pixel grid
+            for (auto& n : m_sampleCounts)
+                n = 0;
+
+            scheduleSecondaryUpdate([this](size_t i)
+            {
+                recordGBufferCommandBuffer(i);
+                recordRTSoftShadowsCommandBuffer(i);
+                recordRTAOCommandBuffer(i);
+                recordRTReflectionCommandBuffers(i);
+            }, [] {});
+        }
+
+        // switches to the fullscreen lighting permutation for the reflection mode chosen in the GUI once it is built,
+        // until then the old mode stays active for the whole frame (RT reflections and lighting)
+        void updateFullscreenLightingPermutation()
+        {
+            if (m_useLowResReflections == m_activeLowResReflections)
+                return;
+
+            const auto pipeline = m_fullscreenLightingPermutations.tryGet(fullscreenLightingConstants(m_useLowResReflections), fullscreenLightingBuildFunction());
+            if (!pipeline)
+                return;
+
+            // the previous permutation stays in the cache, nothing to retire
+            m_fullscreenLightingPipeline = pipeline;
+            m_activeLowResReflections = m_useLowResReflections;
+            scheduleSecondaryUpdate([this](size_t i) { recordFullscreenLightingCommandBuffer(i); }, [] {});
+        }
+
+        // the shared SBT buffer is rebuilt for the swapped in pipeline, so every RT pass is re-recorded against the new one
+        // while rendering the render thread doesn't wait for a transfer, the new tables are copied from a host visible
+        // staging buffer at the start of the next frame, before its re-recorded RT passes
+        void replaceShaderBindingTables(const vk::Pipeline oldPipeline)
+        {
+            const auto oldSBT = m_rtSBTInfo;
+            const auto data = buildShaderBindingTables();
+            const auto size = static_cast<vk::DeviceSize>(data.size());
+
+            auto staging = createBuffer(size, vk::BufferUsageFlagBits::eTransferSrc, VMA_MEMORY_USAGE_CPU_ONLY, vk::SharingMode::eExclusive, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+            memcpy(staging.m_BufferAllocInfo.pMappedData, data.data(), data.size());
+            vmaFlushAllocation(m_context.getAllocator(), staging.m_BufferAllocation, 0, VK_WHOLE_SIZE);
+            m_rtSBTInfo = createBuffer(size, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eRayTracingNV, VMA_MEMORY_USAGE_GPU_ONLY);
+            m_pendingSBTUploads.push_back({ staging, m_rtSBTInfo.m_Buffer, size });
+
+            scheduleSecondaryUpdate([this](size_t i)
+                {
+                    recordRTSoftShadowsCommandBuffer(i);
+                    recordRTAOCommandBuffer(i);
+                    recordRTReflectionCommandBuffers(i);
+                },
+                [this, oldPipeline, oldSBT]
+                {
+                    m_context.getDevice().destroyPipeline(oldPipeline);
+                    vmaDestroyBuffer(m_context.getAllocator(), static_cast<VkBuffer>(oldSBT.m_Buffer), oldSBT.m_BufferAllocation);
+                });
+        }
+
+        // the new pipeline is swapped in at a frame boundary (ShaderReloadService::update), the old one and its SBT are retired
+        void registerShaderReloads()
+        {
+            m_shaderReloadService.registerPipeline("G-Buffer", { "combined/gbuffer.vert", "combined/gbuffer.frag" },
+                [this] { return createGBufferPipeline(); },
+                [this](vk::Pipeline pipeline)
+                {
+                    const auto oldPipeline = m_gbufferGraphicsPipeline;
+                    m_gbufferGraphicsPipeline = pipeline;
+                    scheduleSecondaryUpdate([this](size_t i) { recordGBufferCommandBuffer(i); },
+                        [this, oldPipeline] { m_context.getDevice().destroyPipeline(oldPipeline); });
+                });
+
+            m_shaderReloadService.registerPipeline("Fullscreen Lighting", { "deferred/fullscreen.vert", "combined/fullscreenLightingPBR_RT.frag" },
+                [this]
+                {
+                    m_fullscreenLightingReloadConstants = fullscreenLightingConstants(m_activeLowResReflections);
+                    return createFullscreenLightingPipeline(m_fullscreenLightingReloadConstants);
+                },
+                [this](vk::Pipeline pipeline)
+                {
+                    // every cached permutation is outdated, the others are rebuilt when they are used next
+                    auto oldPermutations = m_fullscreenLightingPermutations.clear();
+                    m_fullscreenLightingPermutations.insert(m_fullscreenLightingReloadConstants, pipeline);
+                    m_fullscreenLightingPipeline = pipeline;
+                    m_activeLowResReflections = m_fullscreenLightingReloadConstants.get(SpecConstant::LowResReflections);
+                    scheduleSecondaryUpdate([this](size_t i) { recordFullscreenLightingCommandBuffer(i); },
+                        [this, oldPermutations]
+                        {
+                            for (const auto& permutation : oldPermutations)
+                            {
+                                try
+                                {
+                                    m_context.getDevice().destroyPipeline(permutation.get());
+                                }
+                                catch (const std::exception&) {}
+                            }
+                        });
+                });
+
+            // RT pipelines get new SBTs, the old ones are still read by the frames in flight
+            m_shaderReloadService.registerPipeline("RT Soft Shadows", { "combined/softshadowPBR.rgen", "combined/softshadow.rmiss" },
+                [this] { return createRTSoftShadowsPipeline(); },
+                [this](vk::Pipeline pipeline)
+                {
+                    const auto oldPipeline = m_rtSoftShadowsPipeline;
+                    m_rtSoftShadowsPipeline = pipeline;
+                    replaceShaderBindingTables(oldPipeline);
+                });
+
+            m_shaderReloadService.registerPipeline("RT Ambient Occlusion", { "combined/rtao.rgen", "combined/rtao.rchit", "combined/rtao.rmiss" },
+                [this] { return createRTAOPipeline(); },
+                [this](vk::Pipeline pipeline)
+                {
+                    const auto oldPipeline = m_rtAOPipeline;
+                    m_rtAOPipeline = pipeline;
+                    replaceShaderBindingTables(oldPipeline);
+                });
+
+            m_shaderReloadService.registerPipeline("RT Reflections", { "combined/rtreflectionsPBR.rgen", "combined/rtreflectionsPBR.rchit", "combined/rtreflections.rmiss", "combined/rtreflectionsSecondaryShadow.rmiss" },
+                [this] { return createRTReflectionPipeline(); },
+                [this](vk::Pipeline pipeline)
+                {
+                    const auto oldPipeline = m_rtReflectionsPipeline;
+                    m_rtReflectionsPipeline = pipeline;
+                    replaceShaderBindingTables(oldPipeline);
+                });
+        }
+
+        // the barrier also covers the RT passes of later frames, they are submitted after this one
+        void cmdUploadShaderBindingTables(const vk::CommandBuffer& cmdBuffer)
+        {
+            if (m_pendingSBTUploads.empty())
+                return;
+
+            for (const auto& upload : m_pendingSBTUploads)
+            {
+                cmdBuffer.copyBuffer(upload.staging.m_Buffer, upload.target, vk::BufferCopy(0, 0, upload.size));
+                m_retireQueue.retire(m_frameNumber + m_context.max_frames_in_flight, [allocator = m_context.getAllocator(), staging = upload.staging]
+                {
+                    vmaDestroyBuffer(allocator, static_cast<VkBuffer>(staging.m_Buffer), staging.m_BufferAllocation);
+                });
+            }
+            m_pendingSBTUploads.clear();
+
+            const vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead);
+            cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eRayTracingShaderNV, {}, barrier, nullptr, nullptr);
+        }
+
+        // the frame slots are used round robin instead of by swapchain image, so they don't depend on the image count of
+        // the current swapchain. a slot is reused every m_frameResourceCount >= max_frames_in_flight frames, i.e. only
+        // after drawFrame waited for the frame that used it last
+        uint32_t getFrameResourceIndex(const uint32_t) const override
+        {
+            return static_cast<uint32_t>(m_frameNumber % m_frameResourceCount);
         }
 
         void recordPerFrameCommandBuffers(uint32_t currentImage) override
         {
+            updateFullscreenLightingPermutation();
+            processPendingSecondaryUpdates(currentImage);
+            m_lastRenderedImage = currentImage;
+
             ////// Secondary Command Buffer with per-frame information (TODO: this can be done in a seperate thread)
             m_perFrameSecondaryCommandBuffers.at(currentImage).reset({});
 
@@ -2384,7 +3256,13 @@ namespace vg
 
             m_perFrameSecondaryCommandBuffers.at(currentImage).begin(beginInfo1);
 
-            m_camera.update(m_context.getWindow()); // reset is later in this function
+            {
+                VG_PROFILE_SCOPE("Camera update");
+                // a benchmark sets the pose in updateBenchmark()
+                if (m_benchmark == nullptr)
+                    m_camera.update(m_context.getWindow()); // reset is later in this function
+                m_cameraPathRecorder.update({ m_camera.getPosition(), m_camera.getTheta(), m_camera.getPhi() });
+            }
 
             m_perFrameSecondaryCommandBuffers.at(currentImage).pushConstants(m_gbufferPipelineLayout, 
                 vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
@@ -2411,7 +3289,13 @@ namespace vg
             m_perFrameSecondaryCommandBuffers.at(currentImage).pushConstants(m_fullscreenLightingPipelineLayout,
                 vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
                 2 * sizeof(glm::mat4) + sizeof(glm::vec4) + sizeof(float), sizeof(int32_t),
-                &m_useLowResReflections);
+                &m_activeLowResReflections);
+
+            const auto renderScale = getRenderScale();
+            m_perFrameSecondaryCommandBuffers.at(currentImage).pushConstants(m_fullscreenLightingPipelineLayout,
+                vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
+                2 * sizeof(glm::mat4) + sizeof(glm::vec4) + sizeof(float) + sizeof(int32_t), sizeof(glm::vec2),
+                glm::value_ptr(renderScale));
 
             m_perFrameSecondaryCommandBuffers.at(currentImage).end();
 
@@ -2422,12 +3306,20 @@ namespace vg
             vk::CommandBufferBeginInfo beginInfo(vk::CommandBufferUsageFlagBits::eSimultaneousUse, nullptr);
             m_commandBuffers.at(currentImage).begin(beginInfo);
 
+            // the static secondaries write their timestamps into the frame slot
+            m_timerManager.beginFrame(m_frameNumber, currentImage);
+            // in automatic mode only rebuilds go to the compute queue, a refit is too short to gain from the overlap
+            const bool rebuildTopAS = m_updateAS == 0 || (m_updateAS == 2 && m_tlasUpdatePolicy.shouldRebuild(currentImage));
+            const bool asUpdateOnComputeQueue = m_animate && m_useAsync && (m_updateAS != 2 || rebuildTopAS);
+            m_timerManager.cmdResetTimers(m_commandBuffers.at(currentImage), currentImage, asUpdateOnComputeQueue ? std::set<std::string>{ "0 AS Update" } : std::set<std::string>{});
+            m_pipelineStatistics.cmdResetQueries(m_commandBuffers.at(currentImage), currentImage);
+            cmdUploadShaderBindingTables(m_commandBuffers.at(currentImage));
+
 
             // update TLAS
             if(m_animate) //TODO async compute
-                //TODO fix update because it needs ping-pong AS
             {
-                vk::CommandBuffer cmdBufForASUpdate = m_useAsync ? m_computeCommandBuffers.at(currentImage) : m_commandBuffers.at(currentImage);
+                vk::CommandBuffer cmdBufForASUpdate = asUpdateOnComputeQueue ? m_computeCommandBuffers.at(currentImage) : m_commandBuffers.at(currentImage);
 
 #undef MemoryBarrier
                 vk::MemoryBarrier memoryBarrier(
@@ -2449,42 +3341,54 @@ namespace vg
                 //vk::ComputePipelineCreateInfo cpci({}, pssci, pl.get());
                 //auto cp = m_context.getDevice().createComputePipelineUnique(nullptr, cpci);
 
-                if(m_useAsync)
+                if(asUpdateOnComputeQueue)
                 {
                     m_computeCommandBuffers.at(currentImage).reset({});
 
                     m_computeCommandBuffers.at(currentImage).begin(beginInfo);
+                    m_timerManager.cmdResetTimer("0 AS Update", m_computeCommandBuffers.at(currentImage), currentImage);
 
                     //cmdBufForASUpdate.bindPipeline(vk::PipelineBindPoint::eCompute, cp.get());
                     //cmdBufForASUpdate.dispatch(1, 1, 1);
                 }
-                m_timerManager.writeTimestampStart("0 AS Update", cmdBufForASUpdate, vk::PipelineStageFlagBits::eAccelerationStructureBuildNV, currentImage);
+                {
+                    GpuTimerScope timerScope(m_timerManager, cmdBufForASUpdate, "0 AS Update", currentImage, vk::PipelineStageFlagBits::eAccelerationStructureBuildNV);
                 
-                cmdBufForASUpdate.pipelineBarrier(vk::PipelineStageFlagBits::eRayTracingShaderNV, vk::PipelineStageFlagBits::eAccelerationStructureBuildNV, {}, memoryBarrier1, nullptr, nullptr);
+                    cmdBufForASUpdate.pipelineBarrier(vk::PipelineStageFlagBits::eRayTracingShaderNV, vk::PipelineStageFlagBits::eAccelerationStructureBuildNV, {}, memoryBarrier1, nullptr, nullptr);
 
                                
-                const glm::mat4 oldModelMatrix = m_scene.getModelMatrices().at(m_animatedObjectID);
-                glm::mat4 newModelMatrix4x4 = glm::translate(glm::rotate(glm::translate(oldModelMatrix, -glm::vec3(oldModelMatrix[3])), glm::radians(1.0f), glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(oldModelMatrix[3]));
-                m_scene.setModelMatrix(m_animatedObjectID, newModelMatrix4x4);
-                auto newModelMatrix = toRowMajor4x3(newModelMatrix4x4);
-                cmdBufForASUpdate.updateBuffer(m_instanceBufferInfo.m_Buffer,
-                    sizeof(GeometryInstance) * m_animatedObjectID + offsetof(GeometryInstance, transform),
-                    sizeof(decltype(newModelMatrix)), glm::value_ptr(newModelMatrix));
-                m_commandBuffers.at(currentImage).updateBuffer(m_modelMatrixBufferInfo.m_Buffer,
-                    sizeof(decltype(newModelMatrix4x4)) * m_animatedObjectID,
-                    sizeof(decltype(newModelMatrix4x4)), glm::value_ptr(newModelMatrix4x4));
-                //BARRIER?
-
-                vk::AccelerationStructureInfoNV asInfoTop(vk::AccelerationStructureTypeNV::eTopLevel, vk::BuildAccelerationStructureFlagBitsNV::eAllowUpdate, static_cast<uint32_t>(m_scene.getModelMatrices().size()), 0, nullptr);
-                auto OwnCmdBuildAccelerationStructureNV = reinterpret_cast<PFN_vkCmdBuildAccelerationStructureNV>(vkGetDeviceProcAddr(m_context.getDevice(), "vkCmdBuildAccelerationStructureNV"));
-                OwnCmdBuildAccelerationStructureNV(cmdBufForASUpdate, reinterpret_cast<VkAccelerationStructureInfoNV*>(&asInfoTop), m_instanceBufferInfo.m_Buffer, 0, m_updateAS, m_topAS.m_AS, m_updateAS ? m_topAS.m_AS : nullptr, m_scratchBuffer.m_Buffer, 0);
-                //m_commandBuffers.at(currentImage).buildAccelerationStructureNV(asInfoTop, m_instanceBufferInfo.m_Buffer, 0, m_updateAS, m_topAS.m_AS, nullptr, m_scratchBuffer.m_Buffer, 0);
+                    // meshes merged into a static BLAS can't move, the top level structure is still updated so the timings stay comparable
+                    if (!m_blasPartition.isBaked(m_animatedObjectID))
+                    {
+                        const glm::mat4 oldModelMatrix = m_scene.getModelMatrices().at(m_animatedObjectID);
+                        glm::mat4 newModelMatrix4x4 = glm::translate(glm::rotate(glm::translate(oldModelMatrix, -glm::vec3(oldModelMatrix[3])), glm::radians(1.0f), glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(oldModelMatrix[3]));
+                        m_scene.setModelMatrix(m_animatedObjectID, newModelMatrix4x4);
+                        m_instanceRing->setTransform(m_blasPartition.getGroupOfMesh(m_animatedObjectID), newModelMatrix4x4);
+                        m_tlasUpdatePolicy.setTransform(m_blasPartition.getGroupOfMesh(m_animatedObjectID), newModelMatrix4x4);
+                        m_commandBuffers.at(currentImage).updateBuffer(m_modelMatrixBufferInfo.m_Buffer,
+                            sizeof(decltype(newModelMatrix4x4)) * m_animatedObjectID,
+                            sizeof(decltype(newModelMatrix4x4)), glm::value_ptr(newModelMatrix4x4));
+                        //BARRIER?
+                    }
+
+                    // the slot and the structure of this image were last used by a finished frame. host writes are visible to the
+                    // submit, so the instances need no barrier
+                    m_instanceRing->writeSlot(currentImage);
 
-                cmdBufForASUpdate.pipelineBarrier(vk::PipelineStageFlagBits::eAccelerationStructureBuildNV, vk::PipelineStageFlagBits::eRayTracingShaderNV, {}, memoryBarrier, nullptr, nullptr);
+                    // the update refits the structure of this image from its own, older state
+                    const auto& topAS = m_topASs.at(currentImage);
+                    const VkBool32 refitTopAS = rebuildTopAS ? VK_FALSE : VK_TRUE;
+                    vk::AccelerationStructureInfoNV asInfoTop(vk::AccelerationStructureTypeNV::eTopLevel, vk::BuildAccelerationStructureFlagBitsNV::eAllowUpdate, m_instanceRing->getInstanceCount(), 0, nullptr);
+                    auto OwnCmdBuildAccelerationStructureNV = reinterpret_cast<PFN_vkCmdBuildAccelerationStructureNV>(vkGetDeviceProcAddr(m_context.getDevice(), "vkCmdBuildAccelerationStructureNV"));
+                    OwnCmdBuildAccelerationStructureNV(cmdBufForASUpdate, reinterpret_cast<VkAccelerationStructureInfoNV*>(&asInfoTop), m_instanceRing->getBuffer(), m_instanceRing->getSlotOffset(currentImage), refitTopAS,
+                        topAS.m_AS, refitTopAS ? topAS.m_AS : nullptr, m_topASScratchBuffers.at(currentImage).m_Buffer, 0);
+                    m_tlasUpdatePolicy.recordUpdate(m_frameNumber, currentImage, rebuildTopAS);
+
+                    cmdBufForASUpdate.pipelineBarrier(vk::PipelineStageFlagBits::eAccelerationStructureBuildNV, vk::PipelineStageFlagBits::eRayTracingShaderNV, {}, memoryBarrier, nullptr, nullptr);
                 
-                m_timerManager.writeTimestampStop("0 AS Update", cmdBufForASUpdate, vk::PipelineStageFlagBits::eAccelerationStructureBuildNV, currentImage);
+                }
 
-                if(m_useAsync)
+                if(asUpdateOnComputeQueue)
                 {
                     size_t oldSemIndex = (m_currentFrame + m_guiFinishedSemaphores.size() - 1) % m_guiFinishedSemaphores.size();
 
@@ -2502,6 +3406,12 @@ namespace vg
                     m_context.getComputeQueue().submit(submitInfo, nullptr);// , m_computeFinishedFences.at(currentImage));
                     //m_context.getComputeQueue().waitIdle();
                 }
+                else if(m_useAsync)
+                {
+                    // the refit ran on the graphics queue, but the graphics submit still waits for the compute semaphore
+                    vk::SubmitInfo submitInfo(0, nullptr, nullptr, 0, nullptr, 1, &m_ASupdateSemaphores.at(m_currentFrame));
+                    m_context.getComputeQueue().submit(submitInfo, nullptr);
+                }
 
             }
 
@@ -2512,7 +3422,7 @@ namespace vg
             vk::ClearValue clearPosID(std::array<float, 4>{ 0.0f, 0.0f, 0.0f, -1.0f });
             vk::ClearValue clearValue(std::array<float, 4>{ 0.0f, 0.0f, 0.0f, 1.0f });
             std::array<vk::ClearValue, 5> clearColors = { clearPosID, clearValue, clearValue, vk::ClearDepthStencilValue{1.0f, 0} };
-            vk::RenderPassBeginInfo renderpassInfo(m_gbufferRenderpass, m_gbufferFramebuffers.at(currentImage), { {0, 0}, m_context.getSwapChainExtent() }, static_cast<uint32_t>(clearColors.size()), clearColors.data());
+            vk::RenderPassBeginInfo renderpassInfo(m_gbufferRenderpass, m_gbufferFramebuffers.at(currentImage), { {0, 0}, m_renderExtent }, static_cast<uint32_t>(clearColors.size()), clearColors.data());
             m_commandBuffers.at(currentImage).beginRenderPass(renderpassInfo, vk::SubpassContents::eSecondaryCommandBuffers);
 
             // execute command buffer which updates per-frame information
@@ -2549,8 +3459,9 @@ namespace vg
 			m_commandBuffers.at(currentImage).updateBuffer(m_rtPerFrameInfoBufferInfos.at(currentImage).m_Buffer, offsetof(RTperFrameInfoCombined, RTAORadius), vk::ArrayProxy<const float>{ m_RTAORadius });
 			m_commandBuffers.at(currentImage).updateBuffer(m_rtPerFrameInfoBufferInfos.at(currentImage).m_Buffer, offsetof(RTperFrameInfoCombined, RTAOSampleCount), vk::ArrayProxy<const int32_t>{ m_numAOSamples });
 			m_commandBuffers.at(currentImage).updateBuffer(m_rtPerFrameInfoBufferInfos.at(currentImage).m_Buffer, offsetof(RTperFrameInfoCombined, RTReflectionSampleCount), vk::ArrayProxy<const int32_t>{ m_numRTReflectionSamples });
-            m_commandBuffers.at(currentImage).updateBuffer(m_rtPerFrameInfoBufferInfos.at(currentImage).m_Buffer, offsetof(RTperFrameInfoCombined, RTUseLowResReflections), vk::ArrayProxy<const int32_t>{ m_useLowResReflections });
+            m_commandBuffers.at(currentImage).updateBuffer(m_rtPerFrameInfoBufferInfos.at(currentImage).m_Buffer, offsetof(RTperFrameInfoCombined, RTUseLowResReflections), vk::ArrayProxy<const int32_t>{ m_activeLowResReflections });
             m_commandBuffers.at(currentImage).updateBuffer(m_rtPerFrameInfoBufferInfos.at(currentImage).m_Buffer, offsetof(RTperFrameInfoCombined, RTReflectionRoughnessThreshold), vk::ArrayProxy<const float>{ m_reflectionRoughnessThreshold });
+            m_commandBuffers.at(currentImage).updateBuffer(m_rtPerFrameInfoBufferInfos.at(currentImage).m_Buffer, offsetof(RTperFrameInfoCombined, renderScale), vk::ArrayProxy<const glm::vec2>{ renderScale });
 
             m_sampleCounts.at(currentImage)++;
 
@@ -2572,7 +3483,7 @@ namespace vg
             m_commandBuffers.at(currentImage).executeCommands(m_rtAOSecondaryCommandBuffers.at(currentImage));
 
 			// execute command buffers for RT Reflections
-            if(m_useLowResReflections == 0)
+            if(m_activeLowResReflections == 0)
 			    m_commandBuffers.at(currentImage).executeCommands(m_rtReflectionsSecondaryCommandBuffers.at(currentImage));
             else
                 m_commandBuffers.at(currentImage).executeCommands(m_rtReflectionsLowResSecondaryCommandBuffers.at(currentImage));
@@ -2580,7 +3491,7 @@ namespace vg
             // 2nd renderpass: render into swapchain
             vk::ClearValue clearValue2(std::array<float, 4>{ 0.0f, 0.0f, 0.0f, 1.0f });
             std::array<vk::ClearValue, 2> clearColors2 = { clearValue2, vk::ClearDepthStencilValue{1.0f, 0} };
-            vk::RenderPassBeginInfo renderpassInfo2(m_fullscreenLightingRenderpass, m_swapChainFramebuffers.at(currentImage), { {0, 0}, m_context.getSwapChainExtent() }, static_cast<uint32_t>(clearColors2.size()), clearColors2.data());
+            vk::RenderPassBeginInfo renderpassInfo2(m_fullscreenLightingRenderpass, m_swapChainFramebuffers.at(m_currentSwapchainImage), { {0, 0}, m_context.getSwapChainExtent() }, static_cast<uint32_t>(clearColors2.size()), clearColors2.data());
             m_commandBuffers.at(currentImage).beginRenderPass(renderpassInfo2, vk::SubpassContents::eSecondaryCommandBuffers);
 
             m_commandBuffers.at(currentImage).executeCommands(m_fullscreenLightingSecondaryCommandBuffers.at(currentImage));
@@ -2612,49 +3523,53 @@ namespace vg
                 //}
                 if (ImGui::BeginMenu("Shaders"))
                 {
+                    bool watching = m_shaderReloadService.isWatching();
+                    if (ImGui::Checkbox("Reload on file change", &watching))
+                        m_shaderReloadService.setWatching(watching);
+
+                    // pipelines are rebuilt in the background and swapped in at the next frame boundary
                     if (ImGui::Button("Reload: g-buffer"))
-                    {
-                        m_context.getGraphicsQueue().waitIdle();
-                        m_context.getDevice().destroyPipeline(m_gbufferGraphicsPipeline);
-                        m_context.getDevice().destroyPipelineLayout(m_gbufferPipelineLayout);
-                        createGBufferPipeline();
-                        createAllCommandBuffers();
-                    }
+                        m_shaderReloadService.requestReload("G-Buffer");
                     if (ImGui::Button("Reload: fullscreen lighting"))
-                    {
-                        m_context.getGraphicsQueue().waitIdle();
-                        m_context.getDevice().destroyPipeline(m_fullscreenLightingPipeline);
-                        m_context.getDevice().destroyPipelineLayout(m_fullscreenLightingPipelineLayout);
-                        createFullscreenLightingPipeline();
-                        createAllCommandBuffers();
-                    }
+                        m_shaderReloadService.requestReload("Fullscreen Lighting");
                     if (ImGui::Button("Reload: soft shadows (rt)"))
+                        m_shaderReloadService.requestReload("RT Soft Shadows");
+                    if (ImGui::Button("Reload: ambient occlusion (rt)"))
+                        m_shaderReloadService.requestReload("RT Ambient Occlusion");
+                    if (ImGui::Button("Reload: reflections (rt)"))
+                        m_shaderReloadService.requestReload("RT Reflections");
+                    if (ImGui::Button("Reload all"))
+                        m_shaderReloadService.requestReloadAll();
+
+                    if (m_shaderReloadService.isReloadPending())
+                        ImGui::Text("Compiling...");
+                    ImGui::EndMenu();
+                }
+                m_lightManager.lightGUI(m_lightBufferInfos.at(0), m_lightBufferInfos.at(1), m_lightBufferInfos.at(2), true);
+                if (ImGui::BeginMenu("Resolution"))
+                {
+                    bool dynamicResolution = m_dynamicResolution.isEnabled();
+                    // benchmark runs stay at the full resolution to be comparable
+                    if (m_benchmark != nullptr)
+                        ImGui::Text("Dynamic resolution is off while benchmarking");
+                    else if (ImGui::Checkbox("Dynamic resolution", &dynamicResolution))
                     {
-                        m_context.getGraphicsQueue().waitIdle();
-                        m_context.getDevice().destroyPipeline(m_rtSoftShadowsPipeline);
-                        m_context.getDevice().destroyPipelineLayout(m_rtSoftShadowsPipelineLayout);
-                        createRTSoftShadowsPipeline();
-                        createAllCommandBuffers();
+                        m_dynamicResolution.setEnabled(dynamicResolution);
+                        setRenderScale(m_dynamicResolution.getScale());
                     }
-                    if (ImGui::Button("Reload: ambient occlusion (rt)"))
+                    auto settings = m_dynamicResolution.getSettings();
+                    bool settingsChanged = ImGui::SliderFloat("Target GPU frame time (ms)", &settings.targetFrameTime, 1.0f, 50.0f);
+                    settingsChanged |= ImGui::SliderFloat("Minimum scale", &settings.minScale, 0.25f, settings.maxScale);
+                    if (settingsChanged)
                     {
-                        m_context.getGraphicsQueue().waitIdle();
-                        m_context.getDevice().destroyPipeline(m_rtAOPipeline);
-                        m_context.getDevice().destroyPipelineLayout(m_rtAOPipelineLayout);
-                        createRTAOPipeline();
-                        createAllCommandBuffers();
+                        m_dynamicResolution.setSettings(settings);
+                        setRenderScale(m_dynamicResolution.getScale());
                     }
-					if (ImGui::Button("Reload: reflections (rt)"))
-					{
-                        m_context.getGraphicsQueue().waitIdle();
-                        m_context.getDevice().destroyPipeline(m_rtReflectionsPipeline);
-                        m_context.getDevice().destroyPipelineLayout(m_rtReflectionsPipelineLayout);
-						createRTReflectionPipeline();
-						createAllCommandBuffers();
-					}
+                    ImGui::Text("Render resolution: %u x %u (%.0f%%)", m_renderExtent.width, m_renderExtent.height, 100.0f * m_dynamicResolution.getScale());
+                    ImGui::Text("Average GPU frame time: %.2f ms", m_dynamicResolution.getAverageFrameTime());
                     ImGui::EndMenu();
                 }
-                m_lightManager.lightGUI(m_lightBufferInfos.at(0), m_lightBufferInfos.at(1), m_lightBufferInfos.at(2), true);
+
                 if (ImGui::BeginMenu("Ray Tracing"))
                 {
                     if(ImGui::Checkbox("Accumulate Samples", &m_accumulateRTSamples))
@@ -2669,6 +3584,9 @@ namespace vg
                     ImGui::RadioButton("Low Resolution Reflections", &m_useLowResReflections, 1);
                     ImGui::SliderFloat("Roughness Threshold for Reflections", &m_reflectionRoughnessThreshold, 0.0f, 1.0f);
                     //if (m_reflectionRoughnessThreshold > 0.0f) m_accumulateRTSamples = false;
+                    // after the frame, see mainLoop
+                    if (ImGui::Button("Capture RT terms"))
+                        m_rtCaptureRequested = true;
                     ImGui::EndMenu();
                 }
 				if (ImGui::BeginMenu("Lighting"))
@@ -2684,16 +3602,37 @@ namespace vg
                     }
                     if(m_animate)
                     {
-                        ImGui::InputInt("Object ID", &m_animatedObjectID);
-
-                        if (m_animatedObjectID > m_scene.getModelMatrices().size()-1)
-                            m_animatedObjectID = static_cast<int>(m_scene.getModelMatrices().size()-1);
-                        if (m_animatedObjectID < 0)
-                            m_animatedObjectID = 0;
+                        const int previousObjectID = m_animatedObjectID;
+                        if (ImGui::InputInt("Object ID", &m_animatedObjectID))
+                        {
+                            const int meshCount = static_cast<int>(m_scene.getModelMatrices().size());
+                            m_animatedObjectID = std::clamp(m_animatedObjectID, 0, meshCount - 1);
+
+                            // merged meshes can't move, skip ahead to the next mesh with a BLAS of its own or keep the previous one
+                            const int step = m_animatedObjectID < previousObjectID ? -1 : 1;
+                            int objectID = m_animatedObjectID;
+                            while (objectID >= 0 && objectID < meshCount && m_blasPartition.isBaked(objectID))
+                                objectID += step;
+                            m_animatedObjectID = objectID >= 0 && objectID < meshCount ? objectID : previousObjectID;
+                        }
+                        if (m_blasPartition.isBaked(m_animatedObjectID))
+                            ImGui::Text("Merged into a static BLAS (%s), only the top level is updated", m_blasPartitionPolicy.toString().c_str());
 
                         ImGui::RadioButton("Rebuild BVH", &m_updateAS, 0); ImGui::SameLine();
-                        ImGui::RadioButton("Update BVH", &m_updateAS, 1);
-                        ImGui::Checkbox("Use Async Compute", &m_useAsync);
+                        ImGui::RadioButton("Update BVH", &m_updateAS, 1); ImGui::SameLine();
+                        ImGui::RadioButton("Automatic", &m_updateAS, 2);
+                        ImGui::Checkbox(m_updateAS == 2 ? "Rebuild on Async Compute" : "Use Async Compute", &m_useAsync);
+                        if (m_updateAS == 2)
+                        {
+                            float maxDegradation = 1.0f;
+                            for (uint32_t i = 0; i < m_tlasUpdatePolicy.getStructureCount(); i++)
+                                maxDegradation = std::max(maxDegradation, m_tlasUpdatePolicy.getEstimatedDegradation(i));
+                            const auto toMs = [](const std::optional<float>& time) { return time.value_or(0.0f); };
+                            ImGui::Text("Estimated BVH degradation: %.3f", maxDegradation);
+                            ImGui::Text("Rebuild: %.3f ms, Refit: %.3f ms, Trace: %.3f ms", toMs(m_tlasUpdatePolicy.getRebuildTime()),
+                                toMs(m_tlasUpdatePolicy.getRefitTime()), toMs(m_tlasUpdatePolicy.getBaselineTraceTime()));
+                            ImGui::Text("Rebuilds: %llu", static_cast<unsigned long long>(m_tlasUpdatePolicy.getRebuildCount()));
+                        }
                         m_accumulateRTSamples = false;
                     }
                     ImGui::EndMenu();
@@ -2702,11 +3641,49 @@ namespace vg
                 {
                     ImGui::Dummy({ 600.0f, 0 });
                     m_timerManager.drawTimerGUIs();
+                    ImGui::Separator();
+                    CpuProfiler::drawGUI();
+                    ImGui::Separator();
+                    m_pipelineStatistics.drawGUI();
+                    ImGui::Separator();
 
                     ImGui::Checkbox("Wait for device idle after every frame", &m_waitIdleAfterFrame);
                     ImGui::SameLine();
                     if (ImGui::Button("Write Timediffs to file"))
                         m_timerManager.dumpActiveTimerDiffsToFile();
+                    ImGui::SameLine();
+                    if (ImGui::Button("Reset statistics"))
+                    {
+                        m_timerManager.resetAllStatistics();
+                        CpuProfiler::resetStatistics();
+                    }
+
+                    if (!m_traceExporter.isCapturing())
+                    {
+                        if (ImGui::Button("Start trace capture"))
+                            beginTraceCapture();
+                    }
+                    else
+                    {
+                        if (ImGui::Button("Stop trace capture"))
+                            endTraceCapture();
+                        ImGui::SameLine();
+                        ImGui::Text("%zu events", m_traceExporter.getEventCount());
+                    }
+
+                    // the file can be played back with --benchmark
+                    if (!m_cameraPathRecorder.isRecording())
+                    {
+                        if (ImGui::Button("Record camera path"))
+                            m_cameraPathRecorder.start(getSceneFile(m_benchmark).generic_string());
+                    }
+                    else
+                    {
+                        if (ImGui::Button("Stop camera path recording"))
+                            endCameraPathRecording();
+                        ImGui::SameLine();
+                        ImGui::Text("%zu keyframes", m_cameraPathRecorder.getKeyframeCount());
+                    }
 
                     ImGui::EndMenu();
                 }
@@ -2722,59 +3699,138 @@ namespace vg
 
             if(m_imguiCommandBuffers.empty())
             {
-                vk::CommandBufferAllocateInfo cmdAllocInfo(m_commandPool, vk::CommandBufferLevel::ePrimary, static_cast<uint32_t>(m_swapChainFramebuffers.size()));
+                vk::CommandBufferAllocateInfo cmdAllocInfo(m_commandPool, vk::CommandBufferLevel::ePrimary, static_cast<uint32_t>(m_frameResourceCount));
                 m_imguiCommandBuffers = m_context.getDevice().allocateCommandBuffers(cmdAllocInfo);
                 //TODO maybe move this
             }
 
         }
 
-        void buildImguiCmdBufferAndSubmit(const uint32_t imageIndex) override
+        void buildImguiCmdBufferAndSubmit(const uint32_t frameIndex) override
         {
-            const vk::RenderPassBeginInfo imguiRenderpassInfo(m_context.getImguiRenderpass(), m_swapChainFramebuffers.at(imageIndex), { {0, 0}, m_context.getSwapChainExtent() }, 0, nullptr);
+            const vk::RenderPassBeginInfo imguiRenderpassInfo(m_context.getImguiRenderpass(), m_swapChainFramebuffers.at(m_currentSwapchainImage), { {0, 0}, m_context.getSwapChainExtent() }, 0, nullptr);
 
             const vk::CommandBufferBeginInfo beginInfo(vk::CommandBufferUsageFlagBits::eSimultaneousUse, nullptr);
 
             // record cmd buffer
-            m_imguiCommandBuffers.at(imageIndex).reset({}); 
-            m_imguiCommandBuffers.at(imageIndex).begin(beginInfo);
-            m_timerManager.writeTimestampStart("6 ImGui", m_imguiCommandBuffers.at(imageIndex), vk::PipelineStageFlagBits::eAllGraphics, imageIndex);
+            m_imguiCommandBuffers.at(frameIndex).reset({}); 
+            m_imguiCommandBuffers.at(frameIndex).begin(beginInfo);
+            m_timer.cmdResetQueries(m_imguiCommandBuffers.at(frameIndex), m_queryPool, frameIndex);
+            {
+                GpuTimerScope timerScope(m_timerManager, m_imguiCommandBuffers.at(frameIndex), "6 ImGui", frameIndex, vk::PipelineStageFlagBits::eAllGraphics);
 
-            m_imguiCommandBuffers.at(imageIndex).beginRenderPass(imguiRenderpassInfo, vk::SubpassContents::eInline);
-            ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), m_imguiCommandBuffers.at(imageIndex));
-            m_imguiCommandBuffers.at(imageIndex).endRenderPass();
-            m_timer.cmdWriteTimestampStart(m_imguiCommandBuffers.at(imageIndex), vk::PipelineStageFlagBits::eAllGraphics, m_queryPool, 0);
-            m_timerManager.writeTimestampStop("6 ImGui", m_imguiCommandBuffers.at(imageIndex), vk::PipelineStageFlagBits::eAllGraphics, imageIndex);
+                m_imguiCommandBuffers.at(frameIndex).beginRenderPass(imguiRenderpassInfo, vk::SubpassContents::eInline);
+                ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), m_imguiCommandBuffers.at(frameIndex));
+                m_imguiCommandBuffers.at(frameIndex).endRenderPass();
+                m_timer.cmdWriteTimestampStart(m_imguiCommandBuffers.at(frameIndex), vk::PipelineStageFlagBits::eAllGraphics, m_queryPool, frameIndex);
+            }
 
-            m_imguiCommandBuffers.at(imageIndex).end();
+            m_imguiCommandBuffers.at(frameIndex).end();
 
             // wait rest of the rendering, submit
             const std::array waitSemaphores = { m_graphicsRenderFinishedSemaphores.at(m_currentFrame) };
             const std::array waitStages = { static_cast<vk::PipelineStageFlags>(vk::PipelineStageFlagBits::eColorAttachmentOutput) };
             const std::array signalSemaphores = { m_guiFinishedSemaphores.at(m_currentFrame) };
 
-            const vk::SubmitInfo submitInfo(1, waitSemaphores.data(), waitStages.data(), 1, &m_imguiCommandBuffers.at(imageIndex), 1, signalSemaphores.data());
+            const vk::SubmitInfo submitInfo(1, waitSemaphores.data(), waitStages.data(), 1, &m_imguiCommandBuffers.at(frameIndex), 1, signalSemaphores.data());
 
             m_context.getDevice().resetFences(m_inFlightFences.at(m_currentFrame));
             m_context.getGraphicsQueue().submit(submitInfo, m_inFlightFences.at(m_currentFrame));
 
         }
 
+        // the queries of a frame are only read once its fence signaled, so reading them never waits for the GPU
+        void frameFinished(const uint64_t frameNumber) override
+        {
+            VG_PROFILE_SCOPE("Read timestamps");
+            // the fence of this frame just signalled, the clock can resample if the other frame in flight is done too
+            m_timerManager.updateGpuClock(m_inFlightFences);
+            for (const auto& frame : m_timerManager.collectResults(frameNumber, m_traceExporter.isCapturing() ? &m_traceExporter : nullptr))
+            {
+                m_timer.acquireFrameTimestamp(m_context.getDevice(), m_queryPool, frame.frameIndex, frame.frameNumber);
+                const auto pipelineStatistics = m_pipelineStatistics.collectResults(frame.frameIndex, frame.frameNumber);
+
+                // the automatic TLAS update weighs the measured update time against the time the RT passes lose to refitting
+                if (const auto update = frame.timings.find("0 AS Update"); update != frame.timings.end())
+                    m_tlasUpdatePolicy.addUpdateTime(frame.frameNumber, update->second);
+                float traceTime = 0.0f;
+                bool traced = false;
+                for (const auto& pass : { "2 Ray Traced Shadows", "3 Ray Traced Ambient Occlusion", "4 Ray Traced Reflections" })
+                {
+                    if (const auto it = frame.timings.find(pass); it != frame.timings.end())
+                    {
+                        traceTime += it->second;
+                        traced = true;
+                    }
+                }
+                if (traced)
+                    m_tlasUpdatePolicy.addTraceTime(frame.frameNumber, traceTime);
+                if (const auto frameTime = getGPUFrameTime(frame); frameTime > 0.0f)
+                    m_newGPUFrameTimes.push_back(frameTime);
+                if (m_benchmark != nullptr)
+                {
+                    m_benchmark->addGpuTimes(frame.frameNumber, frame.timings);
+                    for (const auto& [pass, counters] : pipelineStatistics)
+                        m_benchmark->addPipelineStatistics(frame.frameNumber, pass, PipelineStatisticsManager::toMap(counters));
+                }
+            }
+        }
+
         void mainLoop()
         {
             while (!glfwWindowShouldClose(m_context.getWindow()))
             {
-                glfwPollEvents();
-                configureImgui();
+                const auto frameStart = std::chrono::steady_clock::now();
+                const auto frameNumber = m_frameNumber;
+                m_traceExporter.beginFrame(m_frameNumber);
+                {
+                    VG_PROFILE_SCOPE("Poll events");
+                    glfwPollEvents();
+                }
+                if (m_benchmark != nullptr)
+                    updateBenchmark();
+                {
+                    VG_PROFILE_SCOPE("Shader reload");
+                    m_shaderReloadService.update();
+                }
+                {
+                    VG_PROFILE_SCOPE("ImGui build");
+                    configureImgui();
+                }
                 drawFrame();
                 if(m_waitIdleAfterFrame)
                 {
+                    VG_PROFILE_SCOPE("Wait idle");
                     m_context.getDevice().waitIdle();
                 }
-                m_timer.acquireCurrentTimestamp(m_context.getDevice(), m_queryPool);
-                m_timerManager.queryAllTimerResults(m_currentFrame);
+                // before the render extent can change
+                if (m_rtCaptureRequested)
+                {
+                    m_rtCaptureRequested = false;
+                    m_context.getDevice().waitIdle();
+                    captureRTTerms();
+                }
+                updateDynamicResolution();
+
+                // after the timestamps, so a trace has the CPU scopes and the GPU passes of the same frames
+                CpuProfiler::collect(&m_traceExporter);
+
+                if (m_benchmark != nullptr)
+                {
+                    m_benchmark->addCpuFrameTime(frameNumber, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+                    if (m_benchmark->isFinished())
+                    {
+                        finishBenchmark();
+                        glfwSetWindowShouldClose(m_context.getWindow(), GLFW_TRUE);
+                    }
+                }
             }
 
+            if (m_traceExporter.isCapturing())
+                endTraceCapture();
+            if (m_cameraPathRecorder.isRecording())
+                endCameraPathRecording();
+
             m_context.getDevice().waitIdle();
         }
 
@@ -2791,14 +3847,47 @@ namespace vg
         std::vector<vk::ImageView> m_allImageViews;
         std::vector<vk::Sampler> m_allImageSamplers;
 
+        // the number of per-frame resource slots, the swapchain image count at startup like the slots of the timer and
+        // pipeline statistics managers. the context requests one image more than the minimum, so there are at least two
+        const size_t m_frameResourceCount = m_context.getSwapChainImages().size();
+
         Pilotview m_camera;
         glm::mat4 m_projection;
         bool m_projectionChanged;
 
         TimerManager m_timerManager;
+        // only the raster passes, the counters don't cover ray tracing
+        PipelineStatisticsManager m_pipelineStatistics;
+
+        PipelineBuildService m_pipelineBuildService;
+        ShaderCompiler m_shaderCompiler;
+        ShaderReloadService m_shaderReloadService;
+
+        // one fullscreen lighting pipeline per reflection mode
+        PipelinePermutationCache m_fullscreenLightingPermutations;
+        // reflection mode of the fullscreen lighting pipeline in use, follows m_useLowResReflections once that permutation is built
+        int32_t m_activeLowResReflections = 0;
+        // constants of the last fullscreen lighting reload
+        SpecializationConstants m_fullscreenLightingReloadConstants;
+
+        // after a reload, the secondary command buffers using the pipeline get re-recorded when their frame slot comes up next
+        struct PendingSecondaryUpdate
+        {
+            std::function<void(size_t)> record;
+            std::vector<bool> dirtyImages;
+            // destroys the replaced objects once no command buffer references them anymore
+            std::function<void()> retire;
+        };
+        std::vector<PendingSecondaryUpdate> m_pendingSecondaryUpdates;
 
         PBRScene m_scene;
 
+        // not owned, nullptr unless started with --benchmark
+        BenchmarkRunner* m_benchmark = nullptr;
+        // frames between two samples of the allocator statistics
+        static constexpr uint64_t s_benchmarkMemoryInterval = 60;
+        CameraPathRecorder m_cameraPathRecorder;
+
         Timer m_timer;
 
         bool m_imguiShowDemoWindow = false;
@@ -2861,20 +3950,42 @@ namespace vg
         // Sync Objects
 
         // RT Stuff
-        ASInfo m_topAS;
+        // by frame slot, like the descriptor sets that reference them
+        std::vector<ASInfo> m_topASs;
         std::vector<ASInfo> m_bottomASs;
-        BufferInfo m_instanceBufferInfo;
+        std::optional<InstanceBufferRing> m_instanceRing;
 
-        BufferInfo m_scratchBuffer;
+        std::vector<BufferInfo> m_topASScratchBuffers;
+        // bottom level build batches that get a timer each, 32 of the 64 timers of the TimerManager
+        static constexpr size_t s_maxTimedBlasBatches = 32;
+        // copies the bottom level structures to their compacted size after the build, costs a submit at load time
+        bool m_compactBottomLevelAS = true;
 
         BufferInfo m_offsetBufferInfo;
-        //BufferInfo m_transformBufferInfo;
+        // mesh index of every primitive, see BlasPartition
+        BufferInfo m_primitiveMeshBufferInfo;
+        BlasPartitionPolicy m_blasPartitionPolicy;
+        BlasPartition m_blasPartition;
+        BenchmarkRunner::AccelerationStructureStats m_accelerationStructureStats;
 
         std::vector<ImageInfo> m_randomImageInfos;
         std::vector<vk::ImageView> m_randomImageViews;
 
         std::vector<int32_t> m_sampleCounts;
+        // frame slot whose RT images were rendered last, for captureRTTerms
+        uint32_t m_lastRenderedImage = 0;
+        bool m_rtCaptureRequested = false;
         std::vector<BufferInfo> m_rtPerFrameInfoBufferInfos;
+        // the shader binding tables of all RT pipelines, see createShaderBindingTables
+        BufferInfo m_rtSBTInfo;
+        // tables of reloaded pipelines that are copied in the next frame, see replaceShaderBindingTables
+        struct PendingSBTUpload
+        {
+            BufferInfo staging;
+            vk::Buffer target;
+            vk::DeviceSize size;
+        };
+        std::vector<PendingSBTUpload> m_pendingSBTUploads;
         int32_t m_numAOSamples = 1;
         float m_RTAORadius = 100.0f;
 		int32_t m_numRTReflectionSamples = 1;
@@ -2884,7 +3995,7 @@ namespace vg
         vk::PipelineLayout m_rtSoftShadowsPipelineLayout;
         vk::Pipeline m_rtSoftShadowsPipeline;
         std::vector<vk::DescriptorSet> m_rtSoftShadowsDescriptorSets;
-        BufferInfo m_rtSoftShadowSBTInfo;
+        ShaderBindingTableBuilder::Region m_rtSoftShadowSBTRegion;
         std::vector<vk::CommandBuffer> m_rtSoftShadowsSecondaryCommandBuffers;
         
         bool m_accumulateRTSamples = true;
@@ -2915,7 +4026,7 @@ namespace vg
         vk::PipelineLayout m_rtAOPipelineLayout;
         vk::Pipeline m_rtAOPipeline;
         std::vector<vk::DescriptorSet> m_rtAODescriptorSets;
-        BufferInfo m_rtAOSBTInfo;
+        ShaderBindingTableBuilder::Region m_rtAOSBTRegion;
         std::vector<vk::CommandBuffer> m_rtAOSecondaryCommandBuffers;
 
         std::vector<ImageInfo> m_rtAOImageInfos;
@@ -2935,7 +4046,7 @@ namespace vg
 		vk::PipelineLayout m_rtReflectionsPipelineLayout;
 		vk::Pipeline m_rtReflectionsPipeline;
 		std::vector<vk::DescriptorSet> m_rtReflectionsDescriptorSets;
-		BufferInfo m_rtReflectionsSBTInfo;
+		ShaderBindingTableBuilder::Region m_rtReflectionsSBTRegion;
 		std::vector<vk::CommandBuffer> m_rtReflectionsSecondaryCommandBuffers;
         std::vector<vk::CommandBuffer> m_rtReflectionsLowResSecondaryCommandBuffers;
 
@@ -2946,24 +4057,52 @@ namespace vg
 
         bool m_animate = false;
         int m_animatedObjectID = 154;
+        // 0 rebuild, 1 refit, 2 let m_tlasUpdatePolicy choose
         int m_updateAS = 0;
+        TlasUpdatePolicy m_tlasUpdatePolicy;
         //bool m_useAsync = false;
         bool m_waitIdleAfterFrame = false;
 
         int32_t m_useLowResReflections = 0;
+
+        // the g-buffer and RT passes render at m_renderExtent <= swapchain extent
+        DynamicResolutionController m_dynamicResolution;
+        // GPU frame times collected in frameFinished, applied after the frame so the render extent stays fixed during it
+        std::vector<float> m_newGPUFrameTimes;
+        vk::Extent2D m_renderExtent;
+        // size of the g-buffer, RT and depth images, >= swapchain extent, only ever grows
+        vk::Extent2D m_targetCapacity;
         float m_reflectionRoughnessThreshold = 0.0f;
 
         std::vector<vk::Fence> m_computeFinishedFences;
         std::vector<vk::CommandBuffer> m_computeCommandBuffers;
 
-        std::string m_shaderExtension;
+        // scene-wide specialization constants, see SpecializationConstants.h
+        SpecializationConstants m_sceneConstants;
 
     };
 }
 
-int main()
+int main(int argc, char* argv[])
 {
-    vg::RTCombinedApp app;
+    std::optional<BenchmarkRunner> benchmark;
+    try
+    {
+        if (auto options = BenchmarkOptions::parse(argc, argv))
+        {
+            // scripts can be given relative to the resources folder
+            if (options->script.is_relative() && !std::filesystem::exists(options->script))
+                options->script = vg::g_resourcesPath / options->script;
+            benchmark.emplace(options.value(), "rtcombined");
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    vg::RTCombinedApp app(benchmark.has_value() ? &benchmark.value() : nullptr);
 
     try
     {
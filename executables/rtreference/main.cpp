@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "geometry/BlasPartition.h"
+#include "geometry/PBRScene.h"
+#include "geometry/ReferenceRenderer.h"
+#include "utility/FloatImage.h"
+#include "utility/ImageComparison.h"
+#include "utility/RTCapture.h"
+
+// renders the RT terms of a capture from rtcombined ("Capture RT terms" in the ray tracing menu) on the CPU at a high
+// sample count and reports the error of the captured GPU terms against it, to see what fewer samples, lower
+// resolutions or other approximations cost in quality
+namespace
+{
+    void printUsage()
+    {
+        std::cerr << "usage: rtreference <capture folder> [--samples <n>] [--seed <n>] [--threads <n>] [--tile <n>] [--partition <policy>]\n"
+            "                   [--ppd <pixels per degree>] [--exposure <scale>] [--out <folder>]\n"
+            "  capture folder: written by rtcombined into resources/logs/rt_capture_*\n"
+            "  out: where the reference_*.pfm and flip_*.pfm images go, default is the capture folder\n";
+    }
+
+    struct Options
+    {
+        std::filesystem::path captureFolder;
+        std::filesystem::path outputFolder;
+        ReferenceRenderer::Settings renderSettings;
+        ImageComparison::Settings comparisonSettings;
+        BlasPartitionPolicy partitionPolicy;
+    };
+
+    Options parseOptions(const int argc, char* argv[])
+    {
+        Options options;
+        int i = 1;
+        if (i >= argc || std::string(argv[i]).rfind("--", 0) == 0)
+            throw std::runtime_error("Missing capture folder");
+        options.captureFolder = argv[i++];
+
+        const auto value = [&](const std::string& argument) -> std::string
+        {
+            if (i + 1 >= argc)
+                throw std::runtime_error("Missing value for " + argument);
+            return argv[++i];
+        };
+        for (; i < argc; i++)
+        {
+            const std::string argument = argv[i];
+            if (argument == "--samples")
+                options.renderSettings.sampleCount = std::max(1u, static_cast<uint32_t>(std::stoul(value(argument))));
+            else if (argument == "--seed")
+                options.renderSettings.seed = static_cast<uint32_t>(std::stoul(value(argument)));
+            else if (argument == "--threads")
+                options.renderSettings.threadCount = static_cast<uint32_t>(std::stoul(value(argument)));
+            else if (argument == "--tile")
+                options.renderSettings.tileSize = std::max(1u, static_cast<uint32_t>(std::stoul(value(argument))));
+            else if (argument == "--partition")
+                options.partitionPolicy = BlasPartitionPolicy::parse(value(argument));
+            else if (argument == "--ppd")
+                options.comparisonSettings.pixelsPerDegree = std::stof(value(argument));
+            else if (argument == "--exposure")
+                options.comparisonSettings.exposure = std::stof(value(argument));
+            else if (argument == "--out")
+                options.outputFolder = value(argument);
+            else
+                throw std::runtime_error("Unknown argument " + argument);
+        }
+        if (options.outputFolder.empty())
+            options.outputFolder = options.captureFolder;
+        return options;
+    }
+
+    // writes the reference and, if the capture has the GPU image of the term, compares it
+    void processTerm(const Options& options, const RTCapture& capture, const std::vector<uint8_t>& coverage, const FloatImage& reference,
+        const RTCapture::Term term, const size_t light = 0)
+    {
+        const auto file = RTCapture::getImageFile(term, light);
+        reference.savePfm(options.outputFolder / ("reference_" + file));
+
+        const auto capturedFile = options.captureFolder / file;
+        if (!std::filesystem::exists(capturedFile))
+        {
+            std::printf("  %-26s no GPU image\n", file.c_str());
+            return;
+        }
+        auto captured = FloatImage::loadPfm(capturedFile);
+        // low resolution reflections are compared at the resolution they are displayed at
+        if (captured.getWidth() != capture.width || captured.getHeight() != capture.height)
+            captured = captured.resized(capture.width, capture.height);
+
+        const auto result = ImageComparison::compare(reference, captured, coverage, options.comparisonSettings);
+        result.flipMap.savePfm(options.outputFolder / ("flip_" + file));
+        std::printf("  %-26s RMSE %.5f  PSNR %6.2f dB  FLIP %.4f (max %.4f)\n", file.c_str(), result.rmse, result.psnr, result.flip, result.maxFlip);
+    }
+
+    void run(const Options& options)
+    {
+        const auto capture = RTCapture::load(options.captureFolder);
+        std::filesystem::create_directories(options.outputFolder);
+
+        const auto buildStart = std::chrono::steady_clock::now();
+        const PBRScene scene(capture.scene);
+        const ReferenceRenderer renderer(scene, capture.scene, options.partitionPolicy);
+        std::printf("%s: loaded in %.2f s\n", capture.scene.c_str(), std::chrono::duration<float>(std::chrono::steady_clock::now() - buildStart).count());
+
+        const auto renderStart = std::chrono::steady_clock::now();
+        const auto images = renderer.render(capture, options.renderSettings);
+        const auto pixelCount = static_cast<size_t>(std::count(images.coverage.begin(), images.coverage.end(), 1));
+        std::printf("%ux%u, %zu pixels hit, %u samples per term, rendered in %.2f s\n", capture.width, capture.height, pixelCount,
+            options.renderSettings.sampleCount, std::chrono::duration<float>(std::chrono::steady_clock::now() - renderStart).count());
+        std::printf("GPU: %d accumulated frames, %d AO and %d reflection samples per frame%s\n", capture.frameCount, capture.aoSamples,
+            capture.reflectionSamples, capture.lowResReflections ? ", low resolution reflections" : "");
+
+        for (size_t i = 0; i < images.directionalShadows.size(); i++)
+            processTerm(options, capture, images.coverage, images.directionalShadows.at(i), RTCapture::Term::DirectionalShadow, i);
+        for (size_t i = 0; i < images.pointShadows.size(); i++)
+            processTerm(options, capture, images.coverage, images.pointShadows.at(i), RTCapture::Term::PointShadow, i);
+        for (size_t i = 0; i < images.spotShadows.size(); i++)
+            processTerm(options, capture, images.coverage, images.spotShadows.at(i), RTCapture::Term::SpotShadow, i);
+        processTerm(options, capture, images.coverage, images.ambientOcclusion, RTCapture::Term::AmbientOcclusion);
+        processTerm(options, capture, images.coverage, images.reflections, RTCapture::Term::Reflections);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    try
+    {
+        options = parseOptions(argc, argv);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        printUsage();
+        return 2;
+    }
+
+    // PBRScene logs through the logger the context creates otherwise
+    spdlog::stdout_color_mt("standard");
+    try
+    {
+        run(options);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -79,6 +79,7 @@ namespace vg
             createSyncObjects();
 
             createQueryPool();
+            m_timer.setTimestampProperties(m_context.getTimestampPeriod(), m_context.getTimestampValidBits());
 
             setupImgui();
         }
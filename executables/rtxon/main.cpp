@@ -66,6 +66,7 @@ namespace vg
             createSyncObjects();
 
             createQueryPool();
+            m_timer.setTimestampProperties(m_context.getTimestampPeriod(), m_context.getTimestampValidBits());
 
             setupImgui();
         }
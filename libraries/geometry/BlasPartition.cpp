@@ -0,0 +1,235 @@
+#include "BlasPartition.h"
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+    // meshes are stored one after the other in the vertex buffer of the scene
+    uint32_t getVertexCount(const PBRScene& scene, const size_t mesh)
+    {
+        const auto& meshes = scene.getDrawCommandData();
+        const auto end = mesh + 1 < meshes.size() ? meshes.at(mesh + 1).vertexOffset : static_cast<int32_t>(scene.getVertices().size());
+        return static_cast<uint32_t>(end - meshes.at(mesh).vertexOffset);
+    }
+
+    uint32_t parseCount(const std::string& text, const std::string& value)
+    {
+        try
+        {
+            size_t end = 0;
+            const auto count = std::stoul(value, &end);
+            if (end != value.size() || count == 0)
+                throw std::invalid_argument(value);
+            return static_cast<uint32_t>(count);
+        }
+        catch (const std::logic_error&)
+        {
+            throw std::runtime_error("Invalid BLAS partition policy " + text);
+        }
+    }
+}
+
+BlasPartitionPolicy BlasPartitionPolicy::parse(const std::string& text)
+{
+    std::vector<std::string> parts;
+    std::stringstream stream(text);
+    for (std::string part; std::getline(stream, part, ':');)
+        parts.push_back(part);
+
+    BlasPartitionPolicy policy;
+    if (parts.size() == 1 && parts.front() == "per-mesh")
+    {
+        policy.mode = Mode::PerMesh;
+        return policy;
+    }
+    if (parts.empty() || parts.size() > 3 || parts.front() != "spatial")
+        throw std::runtime_error("Invalid BLAS partition policy " + text + ", expected per-mesh or spatial[:<cells per axis>[:<max triangles>]]");
+
+    policy.mode = Mode::Spatial;
+    if (parts.size() > 1)
+        policy.cellsPerAxis = parseCount(text, parts.at(1));
+    if (parts.size() > 2)
+        policy.maxTrianglesPerBlas = parseCount(text, parts.at(2));
+    return policy;
+}
+
+std::string BlasPartitionPolicy::toString() const
+{
+    if (mode == Mode::PerMesh)
+        return "per-mesh";
+    return "spatial:" + std::to_string(cellsPerAxis) + ":" + std::to_string(maxTrianglesPerBlas);
+}
+
+BlasPartition::BlasPartition(const PBRScene& scene, const BlasPartitionPolicy& policy, const std::set<uint32_t>& dynamicMeshes)
+{
+    const auto& meshes = scene.getDrawCommandData();
+    const auto meshCount = static_cast<uint32_t>(meshes.size());
+
+    // world space center of the static meshes and the bounds of all of them
+    std::vector<uint32_t> staticMeshes;
+    std::vector<glm::vec3> centers(meshCount, glm::vec3(0.0f));
+    glm::vec3 sceneMin(std::numeric_limits<float>::max());
+    glm::vec3 sceneMax(std::numeric_limits<float>::lowest());
+    for (uint32_t mesh = 0; mesh < meshCount && policy.mode == BlasPartitionPolicy::Mode::Spatial; mesh++)
+    {
+        if (dynamicMeshes.count(mesh) != 0 || meshes.at(mesh).instanceCount > 1 || meshes.at(mesh).indexCount == 0)
+            continue;
+
+        const auto& modelMatrix = scene.getModelMatrices().at(mesh);
+        glm::vec3 meshMin(std::numeric_limits<float>::max());
+        glm::vec3 meshMax(std::numeric_limits<float>::lowest());
+        const auto first = static_cast<size_t>(meshes.at(mesh).vertexOffset);
+        for (size_t v = first; v < first + getVertexCount(scene, mesh); v++)
+        {
+            const glm::vec3 position(modelMatrix * glm::vec4(scene.getVertices().at(v).pos, 1.0f));
+            meshMin = glm::min(meshMin, position);
+            meshMax = glm::max(meshMax, position);
+        }
+        centers.at(mesh) = 0.5f * (meshMin + meshMax);
+        sceneMin = glm::min(sceneMin, meshMin);
+        sceneMax = glm::max(sceneMax, meshMax);
+        staticMeshes.push_back(mesh);
+    }
+
+    std::vector<bool> merged(meshCount, false);
+    if (staticMeshes.size() > 1)
+    {
+        // sort the static meshes by their cell, a run of meshes of the same cell becomes one or more groups
+        const auto cells = static_cast<float>(policy.cellsPerAxis);
+        const glm::vec3 cellSize = glm::max((sceneMax - sceneMin) / cells, glm::vec3(std::numeric_limits<float>::min()));
+        const auto getCell = [&](const uint32_t mesh)
+        {
+            const glm::uvec3 cell = glm::min(glm::uvec3((centers.at(mesh) - sceneMin) / cellSize), glm::uvec3(policy.cellsPerAxis - 1));
+            return (static_cast<uint64_t>(cell.z) * policy.cellsPerAxis + cell.y) * policy.cellsPerAxis + cell.x;
+        };
+        std::stable_sort(staticMeshes.begin(), staticMeshes.end(), [&](const uint32_t a, const uint32_t b) { return getCell(a) < getCell(b); });
+
+        for (size_t begin = 0; begin < staticMeshes.size();)
+        {
+            Group group;
+            group.baked = true;
+            const auto cell = getCell(staticMeshes.at(begin));
+            size_t end = begin;
+            for (; end < staticMeshes.size() && getCell(staticMeshes.at(end)) == cell; end++)
+            {
+                const auto triangles = meshes.at(staticMeshes.at(end)).indexCount / 3;
+                if (!group.meshes.empty() && group.triangleCount + triangles > policy.maxTrianglesPerBlas)
+                    break;
+                group.meshes.push_back(staticMeshes.at(end));
+                group.triangleCount += triangles;
+            }
+
+            // a single mesh does not need a copy of its vertices, it is left to its own instance
+            if (group.meshes.size() > 1)
+            {
+                for (const auto mesh : group.meshes)
+                    merged.at(mesh) = true;
+                m_groups.push_back(std::move(group));
+            }
+            begin = end;
+        }
+    }
+
+    for (uint32_t mesh = 0; mesh < meshCount; mesh++)
+    {
+        if (!merged.at(mesh))
+            m_groups.push_back({ { mesh }, false, meshes.at(mesh).indexCount / 3 });
+    }
+
+    m_meshGroups.resize(meshCount);
+    m_meshFirstPrimitives.resize(meshCount);
+    uint32_t primitive = 0;
+    for (uint32_t g = 0; g < static_cast<uint32_t>(m_groups.size()); g++)
+    {
+        auto& group = m_groups.at(g);
+        group.firstPrimitive = primitive;
+        for (const auto mesh : group.meshes)
+        {
+            m_meshGroups.at(mesh) = g;
+            m_meshFirstPrimitives.at(mesh) = primitive;
+            m_primitiveMeshes.insert(m_primitiveMeshes.end(), meshes.at(mesh).indexCount / 3, mesh);
+            primitive += meshes.at(mesh).indexCount / 3;
+        }
+    }
+}
+
+BlasPartition::BakedGeometry BlasPartition::bake(const PBRScene& scene) const
+{
+    const auto& meshes = scene.getDrawCommandData();
+
+    BakedGeometry geometry;
+    geometry.firstVertex.resize(m_groups.size(), 0);
+    geometry.vertexCount.resize(m_groups.size(), 0);
+    geometry.firstIndex.resize(m_groups.size(), 0);
+    for (size_t g = 0; g < m_groups.size(); g++)
+    {
+        const auto& group = m_groups.at(g);
+        if (!group.baked)
+            continue;
+
+        geometry.firstVertex.at(g) = static_cast<uint32_t>(geometry.positions.size());
+        geometry.firstIndex.at(g) = static_cast<uint32_t>(geometry.indices.size());
+        for (const auto mesh : group.meshes)
+        {
+            const auto& meshInfo = meshes.at(mesh);
+            const auto& modelMatrix = scene.getModelMatrices().at(mesh);
+            const auto base = static_cast<uint32_t>(geometry.positions.size()) - geometry.firstVertex.at(g);
+
+            const auto first = static_cast<size_t>(meshInfo.vertexOffset);
+            for (size_t v = first; v < first + getVertexCount(scene, mesh); v++)
+                geometry.positions.emplace_back(modelMatrix * glm::vec4(scene.getVertices().at(v).pos, 1.0f));
+
+            // same triangle order as the scene, so the primitives of the mesh keep their index relative to its first one
+            for (uint32_t i = meshInfo.firstIndex; i < meshInfo.firstIndex + meshInfo.indexCount; i++)
+                geometry.indices.push_back(base + scene.getIndices().at(i));
+        }
+        geometry.vertexCount.at(g) = static_cast<uint32_t>(geometry.positions.size()) - geometry.firstVertex.at(g);
+    }
+    return geometry;
+}
+
+std::pair<glm::vec3, glm::vec3> BlasPartition::getBounds(const PBRScene& scene, const size_t group) const
+{
+    const auto& meshes = scene.getDrawCommandData();
+    const auto& g = m_groups.at(group);
+
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(std::numeric_limits<float>::lowest());
+    for (const auto mesh : g.meshes)
+    {
+        const glm::mat4 modelMatrix = g.baked ? scene.getModelMatrices().at(mesh) : glm::mat4(1.0f);
+        const auto first = static_cast<size_t>(meshes.at(mesh).vertexOffset);
+        for (size_t v = first; v < first + getVertexCount(scene, mesh); v++)
+        {
+            const glm::vec3 position(modelMatrix * glm::vec4(scene.getVertices().at(v).pos, 1.0f));
+            min = glm::min(min, position);
+            max = glm::max(max, position);
+        }
+    }
+    return { min, max };
+}
+
+std::pair<std::vector<glm::vec3>, std::vector<uint32_t>> BlasPartition::getGeometry(const PBRScene& scene, const size_t group) const
+{
+    const auto& meshes = scene.getDrawCommandData();
+    const auto& g = m_groups.at(group);
+
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    indices.reserve(3 * static_cast<size_t>(g.triangleCount));
+    for (const auto mesh : g.meshes)
+    {
+        const auto& meshInfo = meshes.at(mesh);
+        const glm::mat4 modelMatrix = g.baked ? scene.getModelMatrices().at(mesh) : glm::mat4(1.0f);
+        const auto base = static_cast<uint32_t>(positions.size());
+
+        const auto first = static_cast<size_t>(meshInfo.vertexOffset);
+        for (size_t v = first; v < first + getVertexCount(scene, mesh); v++)
+            positions.emplace_back(modelMatrix * glm::vec4(scene.getVertices().at(v).pos, 1.0f));
+        for (uint32_t i = meshInfo.firstIndex; i < meshInfo.firstIndex + meshInfo.indexCount; i++)
+            indices.push_back(base + scene.getIndices().at(i));
+    }
+    return { std::move(positions), std::move(indices) };
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <string>
+#include <vector>
+#include "glm/glm.hpp"
+#include "PBRScene.h"
+
+// how the meshes of a scene are distributed over bottom level acceleration structures
+struct BlasPartitionPolicy
+{
+    enum class Mode
+    {
+        // one structure per mesh, placed by the model matrix of its instance
+        PerMesh,
+        // the static meshes of a grid cell are merged into one structure, their model matrices are baked into the vertices
+        Spatial
+    };
+
+    Mode mode = Mode::Spatial;
+    // cells per axis of the grid over the bounds of the static meshes
+    uint32_t cellsPerAxis = 4;
+    // cells with more triangles are split into several structures
+    uint32_t maxTrianglesPerBlas = 1u << 20;
+
+    // "per-mesh" or "spatial[:<cells per axis>[:<max triangles>]]", throws on anything else
+    static BlasPartitionPolicy parse(const std::string& text);
+    [[nodiscard]] std::string toString() const;
+};
+
+// groups the meshes of a scene into bottom level acceleration structures, one instance per group.
+// the primitives of all groups are numbered in group order, a hit at gl_PrimitiveID of the instance with
+// gl_InstanceCustomIndexNV = group.firstPrimitive belongs to getPrimitiveMeshes()[firstPrimitive + gl_PrimitiveID]
+class BlasPartition
+{
+public:
+    struct Group
+    {
+        std::vector<uint32_t> meshes;
+        // the geometry of a baked group is in world space and its instance has the identity transform.
+        // groups that are not baked have a single mesh and use its model matrix
+        bool baked = false;
+        uint32_t triangleCount = 0;
+        uint32_t firstPrimitive = 0;
+    };
+
+    // the merged geometry of all baked groups, indices are relative to the first vertex of their group
+    struct BakedGeometry
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+        // by group, 0 for groups that are not baked
+        std::vector<uint32_t> firstVertex;
+        std::vector<uint32_t> vertexCount;
+        std::vector<uint32_t> firstIndex;
+    };
+
+    BlasPartition() = default;
+
+    // dynamic meshes are moved through their instance later on, they get a group of their own like instanced meshes
+    BlasPartition(const PBRScene& scene, const BlasPartitionPolicy& policy, const std::set<uint32_t>& dynamicMeshes);
+
+    [[nodiscard]] const std::vector<Group>& getGroups() const { return m_groups; }
+    [[nodiscard]] uint32_t getGroupOfMesh(const size_t mesh) const { return m_meshGroups.at(mesh); }
+    [[nodiscard]] bool isBaked(const size_t mesh) const { return m_groups.at(m_meshGroups.at(mesh)).baked; }
+
+    // mesh index per primitive, in group order
+    [[nodiscard]] const std::vector<uint32_t>& getPrimitiveMeshes() const { return m_primitiveMeshes; }
+    // first entry of the mesh in getPrimitiveMeshes()
+    [[nodiscard]] uint32_t getFirstPrimitiveOfMesh(const size_t mesh) const { return m_meshFirstPrimitives.at(mesh); }
+
+    [[nodiscard]] BakedGeometry bake(const PBRScene& scene) const;
+    // min and max of the geometry of the group in the space of its instance, world space for baked groups
+    [[nodiscard]] std::pair<glm::vec3, glm::vec3> getBounds(const PBRScene& scene, size_t group) const;
+    // positions and triangles of a single group in the space of its instance, the triangles are in primitive order
+    [[nodiscard]] std::pair<std::vector<glm::vec3>, std::vector<uint32_t>> getGeometry(const PBRScene& scene, size_t group) const;
+
+private:
+    std::vector<Group> m_groups;
+    std::vector<uint32_t> m_meshGroups;
+    std::vector<uint32_t> m_primitiveMeshes;
+    std::vector<uint32_t> m_meshFirstPrimitives;
+};
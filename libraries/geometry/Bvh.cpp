@@ -0,0 +1,439 @@
+#include "Bvh.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+float Aabb::getSurfaceArea() const
+{
+    if (isEmpty())
+        return 0.0f;
+    const glm::vec3 extent = max - min;
+    return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+Aabb Aabb::transform(const glm::mat4& transform) const
+{
+    Aabb result;
+    if (isEmpty())
+        return result;
+    for (int corner = 0; corner < 8; corner++)
+    {
+        const glm::vec3 position((corner & 1) ? max.x : min.x, (corner & 2) ? max.y : min.y, (corner & 4) ? max.z : min.z);
+        result.grow(glm::vec3(transform * glm::vec4(position, 1.0f)));
+    }
+    return result;
+}
+
+class Bvh::Builder
+{
+public:
+    Builder(const std::vector<Aabb>& primitiveBounds, const BvhBuildSettings& settings, Bvh& bvh)
+        : m_primitiveBounds(primitiveBounds), m_settings(settings), m_bvh(bvh)
+    {
+        if (m_settings.binCount < 2 || m_settings.binCount > s_maxBinCount || m_settings.maxLeafSize == 0)
+            throw std::runtime_error("A BVH needs 2 to " + std::to_string(s_maxBinCount) + " bins and at least one primitive per leaf");
+
+        const auto threadCount = m_settings.threadCount != 0 ? m_settings.threadCount : std::max(1u, std::thread::hardware_concurrency());
+        m_freeThreads = threadCount - 1;
+        m_binningThreads = threadCount;
+    }
+
+    void run()
+    {
+        const auto count = static_cast<uint32_t>(m_primitiveBounds.size());
+        if (count == 0)
+            return;
+
+        m_references.resize(count);
+        Range root;
+        root.end = count;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            m_references.at(i) = { m_primitiveBounds.at(i), m_primitiveBounds.at(i).getCenter(), i };
+            root.bounds.grow(m_references.at(i).bounds);
+            root.centerBounds.grow(m_references.at(i).center);
+        }
+
+        // a binary tree with at least one primitive per leaf never has more nodes
+        m_bvh.m_nodes.resize(2 * static_cast<size_t>(count) - 1);
+        m_nodeCount = 1;
+        buildSubtree(root);
+        m_bvh.m_nodes.resize(m_nodeCount);
+        m_bvh.m_nodes.shrink_to_fit();
+
+        m_bvh.m_primitiveIndices.resize(count);
+        for (uint32_t i = 0; i < count; i++)
+            m_bvh.m_primitiveIndices.at(i) = m_references.at(i).primitive;
+    }
+
+private:
+    // the primitives are partitioned by value, so the binning of a node streams through memory
+    struct Reference
+    {
+        Aabb bounds;
+        glm::vec3 center{ 0.0f };
+        uint32_t primitive = 0;
+    };
+
+    struct Range
+    {
+        uint32_t node = 0;
+        uint32_t begin = 0;
+        uint32_t end = 0;
+        Aabb bounds;
+        Aabb centerBounds;
+    };
+
+    struct Bin
+    {
+        Aabb bounds;
+        Aabb centerBounds;
+        uint32_t count = 0;
+    };
+    using Bins = std::array<std::vector<Bin>, 3>;
+    static constexpr uint32_t s_maxBinCount = 256;
+
+    struct Split
+    {
+        float cost = std::numeric_limits<float>::max();
+        int axis = -1;
+        uint32_t bin = 0;
+        Range left;
+        Range right;
+    };
+
+    // the subtree is built depth first on this thread, big children are handed to new threads while there are free ones
+    void buildSubtree(const Range& root)
+    {
+        std::vector<std::future<void>> children;
+        std::vector<Range> stack = { root };
+        auto bins = createBins();
+        while (!stack.empty())
+        {
+            const auto range = stack.back();
+            stack.pop_back();
+
+            auto& node = m_bvh.m_nodes.at(range.node);
+            node.bounds = range.bounds;
+
+            auto split = findSplit(range, bins);
+            const auto count = range.end - range.begin;
+            const float leafCost = m_settings.intersectionCost * static_cast<float>(count);
+            if (count == 1 || (count <= m_settings.maxLeafSize && leafCost <= split.cost))
+            {
+                node.first = range.begin;
+                node.primitiveCount = count;
+                continue;
+            }
+            if (split.axis < 0)
+                split = splitMedian(range);
+            else
+                partition(range, split);
+
+            const auto first = m_nodeCount.fetch_add(2);
+            node.first = first;
+            node.primitiveCount = 0;
+            split.left.node = first;
+            split.right.node = first + 1;
+
+            if (split.right.end - split.right.begin >= m_settings.parallelThreshold && tryAcquireThread())
+            {
+                children.push_back(std::async(std::launch::async, [this, right = split.right]
+                {
+                    buildSubtree(right);
+                    m_freeThreads++;
+                }));
+            }
+            else
+            {
+                stack.push_back(split.right);
+            }
+            stack.push_back(split.left);
+        }
+
+        // rethrows exceptions of the child threads
+        for (auto& child : children)
+            child.get();
+    }
+
+    bool tryAcquireThread()
+    {
+        auto free = m_freeThreads.load();
+        while (free > 0)
+        {
+            if (m_freeThreads.compare_exchange_weak(free, free - 1))
+                return true;
+        }
+        return false;
+    }
+
+    // small nodes don't need more bins than primitives, resetting and sweeping the bins dominates their cost
+    [[nodiscard]] uint32_t getBinCount(const Range& range) const
+    {
+        return std::min(m_settings.binCount, std::max(2u, range.end - range.begin));
+    }
+
+    // bins per unit along each axis, 0 for axes the centers don't extend along
+    [[nodiscard]] glm::vec3 getBinScale(const Range& range) const
+    {
+        glm::vec3 scale(0.0f);
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const float extent = range.centerBounds.max[axis] - range.centerBounds.min[axis];
+            if (extent > 0.0f)
+                scale[axis] = static_cast<float>(getBinCount(range)) / extent;
+        }
+        return scale;
+    }
+
+    [[nodiscard]] uint32_t getBin(const Range& range, const glm::vec3& scale, const Reference& reference, const int axis) const
+    {
+        const float position = (reference.center[axis] - range.centerBounds.min[axis]) * scale[axis];
+        return std::min(static_cast<uint32_t>(position), getBinCount(range) - 1);
+    }
+
+    [[nodiscard]] Bins createBins() const
+    {
+        Bins bins;
+        for (auto& axisBins : bins)
+            axisBins.resize(m_settings.binCount);
+        return bins;
+    }
+
+    // the hot loop of the build, so it indexes without bounds checks
+    void fillBins(const Range& range, const uint32_t begin, const uint32_t end, Bins& bins) const
+    {
+        const auto scale = getBinScale(range);
+        for (uint32_t i = begin; i < end; i++)
+        {
+            const auto& reference = m_references[i];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                if (scale[axis] == 0.0f)
+                    continue;
+                auto& bin = bins[axis][getBin(range, scale, reference, axis)];
+                bin.bounds.grow(reference.bounds);
+                bin.centerBounds.grow(reference.center);
+                bin.count++;
+            }
+        }
+    }
+
+    // bins is scratch space of the calling thread
+    [[nodiscard]] Split findSplit(const Range& range, Bins& bins) const
+    {
+        Split best;
+        const auto count = range.end - range.begin;
+        if (count == 1)
+            return best;
+
+        const auto binCount = getBinCount(range);
+        for (auto& axisBins : bins)
+            std::fill(axisBins.begin(), axisBins.begin() + binCount, Bin{});
+
+        // the upper levels have few nodes with many primitives, their binning is spread over chunks
+        const auto chunkCount = std::min(m_binningThreads, count / std::max(1u, m_settings.parallelThreshold));
+        if (chunkCount > 1)
+        {
+            std::vector<std::future<Bins>> chunks;
+            for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+            {
+                const auto begin = range.begin + static_cast<uint32_t>(static_cast<uint64_t>(count) * chunk / chunkCount);
+                const auto end = range.begin + static_cast<uint32_t>(static_cast<uint64_t>(count) * (chunk + 1) / chunkCount);
+                chunks.push_back(std::async(std::launch::async, [this, &range, begin, end]
+                {
+                    auto chunkBins = createBins();
+                    fillBins(range, begin, end, chunkBins);
+                    return chunkBins;
+                }));
+            }
+            for (auto& chunk : chunks)
+            {
+                const auto chunkBins = chunk.get();
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    for (uint32_t b = 0; b < binCount; b++)
+                    {
+                        bins.at(axis).at(b).bounds.grow(chunkBins.at(axis).at(b).bounds);
+                        bins.at(axis).at(b).centerBounds.grow(chunkBins.at(axis).at(b).centerBounds);
+                        bins.at(axis).at(b).count += chunkBins.at(axis).at(b).count;
+                    }
+                }
+            }
+        }
+        else
+        {
+            fillBins(range, range.begin, range.end, bins);
+        }
+
+        const float parentArea = std::max(range.bounds.getSurfaceArea(), std::numeric_limits<float>::min());
+        const auto scale = getBinScale(range);
+        std::array<float, s_maxBinCount> rightCosts{};
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (scale[axis] == 0.0f)
+                continue;
+            const auto& axisBins = bins.at(axis);
+
+            // area times count of everything right of a plane, the plane after bin b splits [0, b] from [b + 1, binCount)
+            Aabb right;
+            uint32_t rightCount = 0;
+            for (uint32_t b = binCount - 1; b > 0; b--)
+            {
+                right.grow(axisBins.at(b).bounds);
+                rightCount += axisBins.at(b).count;
+                rightCosts.at(b - 1) = right.getSurfaceArea() * static_cast<float>(rightCount);
+            }
+
+            Aabb left;
+            uint32_t leftCount = 0;
+            for (uint32_t b = 0; b + 1 < binCount; b++)
+            {
+                left.grow(axisBins.at(b).bounds);
+                leftCount += axisBins.at(b).count;
+                if (leftCount == 0 || leftCount == count)
+                    continue;
+
+                const float cost = m_settings.traversalCost + m_settings.intersectionCost * (left.getSurfaceArea() * static_cast<float>(leftCount) + rightCosts.at(b)) / parentArea;
+                if (cost < best.cost)
+                {
+                    best.cost = cost;
+                    best.axis = axis;
+                    best.bin = b;
+                }
+            }
+        }
+
+        if (best.axis < 0)
+            return best;
+
+        // the children's bounds are known from the bins, the primitives are only moved later
+        const auto& axisBins = bins.at(best.axis);
+        for (uint32_t b = 0; b < binCount; b++)
+        {
+            auto& child = b <= best.bin ? best.left : best.right;
+            child.bounds.grow(axisBins.at(b).bounds);
+            child.centerBounds.grow(axisBins.at(b).centerBounds);
+            child.end += axisBins.at(b).count;
+        }
+        best.left.begin = range.begin;
+        best.left.end += range.begin;
+        best.right.begin = best.left.end;
+        best.right.end += best.right.begin;
+        return best;
+    }
+
+    void partition(const Range& range, const Split& split)
+    {
+        const auto scale = getBinScale(range);
+        std::partition(m_references.begin() + range.begin, m_references.begin() + range.end, [&](const Reference& reference)
+        {
+            return getBin(range, scale, reference, split.axis) <= split.bin;
+        });
+    }
+
+    // for primitives whose centers coincide, SAH can't tell them apart
+    [[nodiscard]] Split splitMedian(const Range& range) const
+    {
+        Split split;
+        const auto middle = range.begin + (range.end - range.begin) / 2;
+        split.left.begin = range.begin;
+        split.left.end = middle;
+        split.right.begin = middle;
+        split.right.end = range.end;
+        for (auto* child : { &split.left, &split.right })
+        {
+            for (uint32_t i = child->begin; i < child->end; i++)
+            {
+                child->bounds.grow(m_references.at(i).bounds);
+                child->centerBounds.grow(m_references.at(i).center);
+            }
+        }
+        return split;
+    }
+
+    const std::vector<Aabb>& m_primitiveBounds;
+    BvhBuildSettings m_settings;
+    Bvh& m_bvh;
+
+    std::vector<Reference> m_references;
+    std::atomic<uint32_t> m_nodeCount = 0;
+    std::atomic<uint32_t> m_freeThreads = 0;
+    uint32_t m_binningThreads = 1;
+};
+
+Bvh Bvh::build(const std::vector<Aabb>& primitiveBounds, const BvhBuildSettings& settings)
+{
+    if (primitiveBounds.size() >= std::numeric_limits<uint32_t>::max() / 2)
+        throw std::runtime_error("Too many primitives for a BVH");
+
+    Bvh bvh;
+    Builder(primitiveBounds, settings, bvh).run();
+    return bvh;
+}
+
+Bvh Bvh::buildTriangles(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, const BvhBuildSettings& settings)
+{
+    if (indices.size() % 3 != 0)
+        throw std::runtime_error("The index count of a triangle list has to be a multiple of 3");
+
+    std::vector<Aabb> bounds(indices.size() / 3);
+    for (size_t t = 0; t < bounds.size(); t++)
+    {
+        for (size_t corner = 0; corner < 3; corner++)
+            bounds.at(t).grow(positions.at(indices.at(3 * t + corner)));
+    }
+    return build(bounds, settings);
+}
+
+BvhStats Bvh::computeStats(const BvhBuildSettings& settings) const
+{
+    BvhStats stats;
+    stats.nodeCount = static_cast<uint32_t>(m_nodes.size());
+    stats.memoryBytes = m_nodes.size() * sizeof(BvhNode) + m_primitiveIndices.size() * sizeof(uint32_t);
+    stats.leafSizeHistogram.resize(settings.maxLeafSize + 1, 0);
+    if (m_nodes.empty())
+        return stats;
+
+    const float rootArea = std::max(m_nodes.front().bounds.getSurfaceArea(), std::numeric_limits<float>::min());
+    stats.minLeafSize = std::numeric_limits<uint32_t>::max();
+    float nodeOverlapSum = 0.0f;
+
+    std::vector<std::pair<uint32_t, uint32_t>> stack = { { 0, 0 } };
+    while (!stack.empty())
+    {
+        const auto [index, depth] = stack.back();
+        stack.pop_back();
+        const auto& node = m_nodes.at(index);
+        const float area = node.bounds.getSurfaceArea();
+        stats.maxDepth = std::max(stats.maxDepth, depth);
+
+        if (node.isLeaf())
+        {
+            stats.leafCount++;
+            stats.sahCost += settings.intersectionCost * static_cast<float>(node.primitiveCount) * area / rootArea;
+            stats.minLeafSize = std::min(stats.minLeafSize, node.primitiveCount);
+            stats.maxLeafSize = std::max(stats.maxLeafSize, node.primitiveCount);
+            stats.leafSizeHistogram.at(std::min(node.primitiveCount, settings.maxLeafSize + 1) - 1)++;
+            continue;
+        }
+
+        stats.sahCost += settings.traversalCost * area / rootArea;
+        const float overlapArea = m_nodes.at(node.first).bounds.intersect(m_nodes.at(node.first + 1).bounds).getSurfaceArea();
+        stats.overlap += overlapArea / rootArea;
+        if (area > 0.0f)
+            nodeOverlapSum += overlapArea / area;
+
+        stack.emplace_back(node.first, depth + 1);
+        stack.emplace_back(node.first + 1, depth + 1);
+    }
+
+    const auto innerCount = stats.nodeCount - stats.leafCount;
+    stats.averageNodeOverlap = innerCount > 0 ? nodeOverlapSum / static_cast<float>(innerCount) : 0.0f;
+    stats.averageLeafSize = static_cast<float>(m_primitiveIndices.size()) / static_cast<float>(stats.leafCount);
+    return stats;
+}
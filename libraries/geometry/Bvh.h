@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "glm/glm.hpp"
+
+struct Aabb
+{
+    glm::vec3 min{ std::numeric_limits<float>::max() };
+    glm::vec3 max{ std::numeric_limits<float>::lowest() };
+
+    void grow(const glm::vec3& point) { min = glm::min(min, point); max = glm::max(max, point); }
+    void grow(const Aabb& other) { min = glm::min(min, other.min); max = glm::max(max, other.max); }
+    [[nodiscard]] bool isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+    [[nodiscard]] glm::vec3 getCenter() const { return 0.5f * (min + max); }
+    // 0 for empty boxes
+    [[nodiscard]] float getSurfaceArea() const;
+    [[nodiscard]] Aabb intersect(const Aabb& other) const { return { glm::max(min, other.min), glm::min(max, other.max) }; }
+    // bounds of the box after the transform
+    [[nodiscard]] Aabb transform(const glm::mat4& transform) const;
+};
+
+struct BvhBuildSettings
+{
+    // split candidates per axis
+    uint32_t binCount = 16;
+    // nodes with more primitives are always split
+    uint32_t maxLeafSize = 4;
+    // SAH costs of visiting a node and of testing a primitive
+    float traversalCost = 1.0f;
+    float intersectionCost = 1.0f;
+    // 0 uses every hardware thread
+    uint32_t threadCount = 0;
+    // smaller subtrees are built by the thread that split their parent
+    uint32_t parallelThreshold = 4096;
+};
+
+// 32 bytes, the children of an inner node are stored next to each other
+struct BvhNode
+{
+    Aabb bounds;
+    // first child for inner nodes, first entry of getPrimitiveIndices() for leaves
+    uint32_t first = 0;
+    // 0 for inner nodes
+    uint32_t primitiveCount = 0;
+
+    [[nodiscard]] bool isLeaf() const { return primitiveCount != 0; }
+};
+
+struct BvhStats
+{
+    uint32_t nodeCount = 0;
+    uint32_t leafCount = 0;
+    uint32_t maxDepth = 0;
+    // expected cost of a ray that hits the root, in units of the settings' traversal and intersection costs
+    float sahCost = 0.0f;
+    // sum over the inner nodes of the area their children overlap in, relative to the root.
+    // the average is the overlap relative to the node itself
+    float overlap = 0.0f;
+    float averageNodeOverlap = 0.0f;
+    uint32_t minLeafSize = 0;
+    uint32_t maxLeafSize = 0;
+    float averageLeafSize = 0.0f;
+    // leaves by primitive count, the last entry counts every larger leaf
+    std::vector<uint32_t> leafSizeHistogram;
+    size_t memoryBytes = 0;
+};
+
+// binary BVH over the bounds of arbitrary primitives, built top down with the binned surface area heuristic.
+// subtrees above the parallel threshold are built on their own threads, and so is the binning of large nodes
+class Bvh
+{
+public:
+    Bvh() = default;
+
+    static Bvh build(const std::vector<Aabb>& primitiveBounds, const BvhBuildSettings& settings = {});
+    // primitives are the triangles of the index list
+    static Bvh buildTriangles(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, const BvhBuildSettings& settings = {});
+
+    [[nodiscard]] const std::vector<BvhNode>& getNodes() const { return m_nodes; }
+    [[nodiscard]] const std::vector<uint32_t>& getPrimitiveIndices() const { return m_primitiveIndices; }
+    [[nodiscard]] Aabb getBounds() const { return m_nodes.empty() ? Aabb{} : m_nodes.front().bounds; }
+    [[nodiscard]] uint32_t getPrimitiveCount() const { return static_cast<uint32_t>(m_primitiveIndices.size()); }
+
+    [[nodiscard]] BvhStats computeStats(const BvhBuildSettings& settings = {}) const;
+
+private:
+    class Builder;
+
+    std::vector<BvhNode> m_nodes;
+    std::vector<uint32_t> m_primitiveIndices;
+};
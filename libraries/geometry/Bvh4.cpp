@@ -0,0 +1,99 @@
+#include "Bvh4.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+Bvh4::Bvh4(const Bvh& bvh, const uint32_t leafSize) : m_primitiveIndices(bvh.getPrimitiveIndices())
+{
+    const auto& nodes = bvh.getNodes();
+    if (nodes.empty())
+        return;
+
+    // the primitives of every subtree are a contiguous range, children are always stored after their parent
+    std::vector<std::pair<uint32_t, uint32_t>> ranges(nodes.size());
+    for (size_t i = nodes.size(); i-- > 0;)
+    {
+        const auto& node = nodes.at(i);
+        if (node.isLeaf())
+            ranges.at(i) = { node.first, node.primitiveCount };
+        else
+            ranges.at(i) = { ranges.at(node.first).first, ranges.at(node.first).second + ranges.at(node.first + 1).second };
+    }
+    const auto isLeaf = [&](const uint32_t node) { return nodes.at(node).isLeaf() || ranges.at(node).second <= leafSize; };
+
+    // by binary node and depth, the node of this BVH it becomes
+    struct Task
+    {
+        uint32_t binaryNode;
+        uint32_t node;
+        uint32_t depth;
+    };
+    std::vector<Task> stack = { { 0, 0, 1 } };
+    m_nodes.emplace_back();
+    while (!stack.empty())
+    {
+        const auto task = stack.back();
+        stack.pop_back();
+        m_depth = std::max(m_depth, task.depth);
+
+        // a leaf root still gets a node, so the traversal always starts with a node
+        std::vector<uint32_t> children = { task.binaryNode };
+        if (!isLeaf(task.binaryNode))
+        {
+            children = { nodes.at(task.binaryNode).first, nodes.at(task.binaryNode).first + 1 };
+            while (children.size() < 4)
+            {
+                auto largest = children.end();
+                for (auto it = children.begin(); it != children.end(); ++it)
+                {
+                    if (!isLeaf(*it) && (largest == children.end() || nodes.at(*it).bounds.getSurfaceArea() > nodes.at(*largest).bounds.getSurfaceArea()))
+                        largest = it;
+                }
+                if (largest == children.end())
+                    break;
+                const auto first = nodes.at(*largest).first;
+                *largest = first;
+                children.push_back(first + 1);
+            }
+        }
+
+        // m_nodes may grow while the children are added, so the node is filled through its index
+        const auto nodeIndex = task.node;
+        m_nodes.at(nodeIndex).childCount = static_cast<uint32_t>(children.size());
+        for (size_t lane = 0; lane < 4; lane++)
+        {
+            auto& node = m_nodes.at(nodeIndex);
+            if (lane >= children.size())
+            {
+                node.minX.at(lane) = node.minY.at(lane) = node.minZ.at(lane) = 0.0f;
+                node.maxX.at(lane) = node.maxY.at(lane) = node.maxZ.at(lane) = 0.0f;
+                node.children.at(lane) = 0;
+                node.counts.at(lane) = 0;
+                continue;
+            }
+
+            const auto child = children.at(lane);
+            const auto& bounds = nodes.at(child).bounds;
+            node.minX.at(lane) = bounds.min.x;
+            node.minY.at(lane) = bounds.min.y;
+            node.minZ.at(lane) = bounds.min.z;
+            node.maxX.at(lane) = bounds.max.x;
+            node.maxY.at(lane) = bounds.max.y;
+            node.maxZ.at(lane) = bounds.max.z;
+            if (isLeaf(child))
+            {
+                if (ranges.at(child).second > std::numeric_limits<uint16_t>::max())
+                    throw std::runtime_error("Too many primitives in a BVH leaf");
+                node.children.at(lane) = ranges.at(child).first;
+                node.counts.at(lane) = static_cast<uint16_t>(ranges.at(child).second);
+            }
+            else
+            {
+                node.children.at(lane) = static_cast<uint32_t>(m_nodes.size());
+                node.counts.at(lane) = 0;
+                stack.push_back({ child, static_cast<uint32_t>(m_nodes.size()), task.depth + 1 });
+                m_nodes.emplace_back();
+            }
+        }
+    }
+}
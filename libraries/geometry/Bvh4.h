@@ -0,0 +1,45 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "Bvh.h"
+
+// the children of a node as structure of arrays, so one SSE instruction tests a ray against all of them. 128 bytes
+struct alignas(16) Bvh4Node
+{
+    std::array<float, 4> minX;
+    std::array<float, 4> minY;
+    std::array<float, 4> minZ;
+    std::array<float, 4> maxX;
+    std::array<float, 4> maxY;
+    std::array<float, 4> maxZ;
+    // node index of inner children, first leaf entry of leaf children
+    std::array<uint32_t, 4> children;
+    // leaf entries of leaf children, 0 for inner children
+    std::array<uint16_t, 4> counts;
+    // the children are packed to the front, the lanes after them are unused
+    uint32_t childCount = 0;
+
+    [[nodiscard]] bool isLeaf(const uint32_t child) const { return counts.at(child) != 0; }
+};
+
+// 4 wide BVH collapsed from a binary one: a node takes over the children of its largest inner children until it has 4.
+// the leaves keep referencing ranges of the binary BVH's primitive indices, so the order of the primitives is kept
+class Bvh4
+{
+public:
+    Bvh4() = default;
+    // subtrees with at most leafSize primitives become a single leaf
+    explicit Bvh4(const Bvh& bvh, uint32_t leafSize = 4);
+
+    [[nodiscard]] const std::vector<Bvh4Node>& getNodes() const { return m_nodes; }
+    [[nodiscard]] std::vector<Bvh4Node>& getNodes() { return m_nodes; }
+    [[nodiscard]] const std::vector<uint32_t>& getPrimitiveIndices() const { return m_primitiveIndices; }
+    // nodes on the longest path from the root, bounds the traversal stack
+    [[nodiscard]] uint32_t getDepth() const { return m_depth; }
+
+private:
+    std::vector<Bvh4Node> m_nodes;
+    std::vector<uint32_t> m_primitiveIndices;
+    uint32_t m_depth = 0;
+};
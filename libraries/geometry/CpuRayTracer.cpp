@@ -0,0 +1,296 @@
+#include "CpuRayTracer.h"
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <emmintrin.h>
+
+namespace
+{
+    // a 4 wide traversal pushes at most 3 siblings per level
+    constexpr uint32_t s_maxStackSize = 256;
+
+    struct SseRay
+    {
+        __m128 originX, originY, originZ;
+        __m128 directionX, directionY, directionZ;
+        __m128 inverseDirectionX, inverseDirectionY, inverseDirectionZ;
+        __m128 tMin;
+    };
+
+    SseRay toSseRay(const glm::vec3& origin, const glm::vec3& direction, const float tMin)
+    {
+        // a zero component gives an infinite inverse, which the slab test handles
+        const glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+        return { _mm_set1_ps(origin.x), _mm_set1_ps(origin.y), _mm_set1_ps(origin.z),
+            _mm_set1_ps(direction.x), _mm_set1_ps(direction.y), _mm_set1_ps(direction.z),
+            _mm_set1_ps(inverseDirection.x), _mm_set1_ps(inverseDirection.y), _mm_set1_ps(inverseDirection.z),
+            _mm_set1_ps(tMin) };
+    }
+
+    // bit i is set if the ray enters the box of child i within [tMin, tMax]
+    int intersectChildren(const Bvh4Node& node, const SseRay& ray, const float tMax, __m128& tNear)
+    {
+        const __m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minX.data()), ray.originX), ray.inverseDirectionX);
+        const __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxX.data()), ray.originX), ray.inverseDirectionX);
+        const __m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minY.data()), ray.originY), ray.inverseDirectionY);
+        const __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxY.data()), ray.originY), ray.inverseDirectionY);
+        const __m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minZ.data()), ray.originZ), ray.inverseDirectionZ);
+        const __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxZ.data()), ray.originZ), ray.inverseDirectionZ);
+
+        tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)), _mm_max_ps(_mm_min_ps(t0z, t1z), ray.tMin));
+        const __m128 tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)), _mm_min_ps(_mm_max_ps(t0z, t1z), _mm_set1_ps(tMax)));
+        return _mm_movemask_ps(_mm_cmple_ps(tNear, tFar)) & ((1 << node.childCount) - 1);
+    }
+
+    // Moeller-Trumbore on the 4 triangles of a pack, bit i is set if triangle i is hit in [tMin, tMax)
+    template <typename Pack>
+    int intersectTriangles(const Pack& pack, const SseRay& ray, const float tMax, __m128& t, __m128& u, __m128& v)
+    {
+        const __m128 e1x = _mm_load_ps(pack.e1x.data());
+        const __m128 e1y = _mm_load_ps(pack.e1y.data());
+        const __m128 e1z = _mm_load_ps(pack.e1z.data());
+        const __m128 e2x = _mm_load_ps(pack.e2x.data());
+        const __m128 e2y = _mm_load_ps(pack.e2y.data());
+        const __m128 e2z = _mm_load_ps(pack.e2z.data());
+
+        const __m128 px = _mm_sub_ps(_mm_mul_ps(ray.directionY, e2z), _mm_mul_ps(ray.directionZ, e2y));
+        const __m128 py = _mm_sub_ps(_mm_mul_ps(ray.directionZ, e2x), _mm_mul_ps(ray.directionX, e2z));
+        const __m128 pz = _mm_sub_ps(_mm_mul_ps(ray.directionX, e2y), _mm_mul_ps(ray.directionY, e2x));
+        const __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        const __m128 inverseDeterminant = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+
+        const __m128 tx = _mm_sub_ps(ray.originX, _mm_load_ps(pack.v0x.data()));
+        const __m128 ty = _mm_sub_ps(ray.originY, _mm_load_ps(pack.v0y.data()));
+        const __m128 tz = _mm_sub_ps(ray.originZ, _mm_load_ps(pack.v0z.data()));
+        u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), inverseDeterminant);
+
+        const __m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+        const __m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+        const __m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+        v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ray.directionX, qx), _mm_mul_ps(ray.directionY, qy)), _mm_mul_ps(ray.directionZ, qz)), inverseDeterminant);
+        t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverseDeterminant);
+
+        // unused lanes have a zero determinant, comparisons with the NaNs they produce are false
+        const __m128 zero = _mm_setzero_ps();
+        __m128 mask = _mm_cmpneq_ps(determinant, zero);
+        mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+        mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+        mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+        mask = _mm_and_ps(mask, _mm_cmpge_ps(t, ray.tMin));
+        mask = _mm_and_ps(mask, _mm_cmplt_ps(t, _mm_set1_ps(tMax)));
+        return _mm_movemask_ps(mask);
+    }
+
+    // intersectLeaf(first, count) tests the entries of a leaf and returns whether it found a hit, it shortens tMax
+    // for closest hits. with TerminateOnFirstHit the traversal returns after the first leaf that was hit
+    template <bool TerminateOnFirstHit, typename LeafFunction>
+    bool traverse(const Bvh4& bvh, const SseRay& ray, const float& tMax, LeafFunction&& intersectLeaf)
+    {
+        const auto& nodes = bvh.getNodes();
+        if (nodes.empty())
+            return false;
+
+        std::array<uint32_t, s_maxStackSize> stack;
+        uint32_t stackSize = 0;
+        stack[stackSize++] = 0;
+        bool hit = false;
+        while (stackSize > 0)
+        {
+            const auto& node = nodes[stack[--stackSize]];
+            __m128 tNear;
+            int mask = intersectChildren(node, ray, tMax, tNear);
+            if (mask == 0)
+                continue;
+
+            // near to far, so closest hits cull the far children with a shorter tMax
+            alignas(16) std::array<float, 4> distances;
+            _mm_store_ps(distances.data(), tNear);
+            std::array<uint32_t, 4> lanes;
+            uint32_t laneCount = 0;
+            for (; mask != 0; mask &= mask - 1)
+            {
+                uint32_t lane = 0;
+                while ((mask & (1 << lane)) == 0)
+                    lane++;
+                uint32_t position = laneCount++;
+                for (; !TerminateOnFirstHit && position > 0 && distances[lanes[position - 1]] > distances[lane]; position--)
+                    lanes[position] = lanes[position - 1];
+                lanes[position] = lane;
+            }
+
+            for (uint32_t i = 0; i < laneCount; i++)
+            {
+                const auto lane = lanes[i];
+                if (!node.isLeaf(lane) || !intersectLeaf(node.children[lane], node.counts[lane]))
+                    continue;
+                hit = true;
+                if (TerminateOnFirstHit)
+                    return true;
+            }
+            for (uint32_t i = laneCount; i-- > 0;)
+            {
+                if (!node.isLeaf(lanes[i]))
+                    stack[stackSize++] = node.children[lanes[i]];
+            }
+        }
+        return hit;
+    }
+
+    void checkStackSize(const Bvh4& bvh)
+    {
+        if (3 * bvh.getDepth() + 1 > s_maxStackSize)
+            throw std::runtime_error("BVH too deep for the traversal stack");
+    }
+}
+
+CpuRayTracer::CpuRayTracer(const SceneBvh& bvh) : m_topLevel(bvh.getTopLevel(), 4)
+{
+    checkStackSize(m_topLevel);
+    for (const auto& instance : bvh.getInstances())
+        m_instances.push_back({ instance.bottomLevel, glm::inverse(instance.transform) });
+
+    for (const auto& sceneBottomLevel : bvh.getBottomLevels())
+    {
+        BottomLevel bottomLevel;
+        bottomLevel.bvh = Bvh4(sceneBottomLevel.bvh, 4);
+        checkStackSize(bottomLevel.bvh);
+
+        // the leaves are rewritten from ranges of triangles to ranges of packs
+        const auto& triangles = bottomLevel.bvh.getPrimitiveIndices();
+        for (auto& node : bottomLevel.bvh.getNodes())
+        {
+            for (uint32_t lane = 0; lane < node.childCount; lane++)
+            {
+                if (!node.isLeaf(lane))
+                    continue;
+
+                const auto firstPack = static_cast<uint32_t>(bottomLevel.packs.size());
+                const auto first = node.children.at(lane);
+                const auto count = node.counts.at(lane);
+                for (uint32_t packStart = 0; packStart < count; packStart += 4)
+                {
+                    TrianglePack pack = {};
+                    for (uint32_t i = 0; i < 4; i++)
+                    {
+                        if (packStart + i >= count)
+                        {
+                            pack.primitives.at(i) = std::numeric_limits<uint32_t>::max();
+                            continue;
+                        }
+                        const auto triangle = triangles.at(first + packStart + i);
+                        const auto& v0 = sceneBottomLevel.positions.at(sceneBottomLevel.indices.at(3 * triangle));
+                        const auto e1 = sceneBottomLevel.positions.at(sceneBottomLevel.indices.at(3 * triangle + 1)) - v0;
+                        const auto e2 = sceneBottomLevel.positions.at(sceneBottomLevel.indices.at(3 * triangle + 2)) - v0;
+                        pack.v0x.at(i) = v0.x; pack.v0y.at(i) = v0.y; pack.v0z.at(i) = v0.z;
+                        pack.e1x.at(i) = e1.x; pack.e1y.at(i) = e1.y; pack.e1z.at(i) = e1.z;
+                        pack.e2x.at(i) = e2.x; pack.e2y.at(i) = e2.y; pack.e2z.at(i) = e2.z;
+                        pack.primitives.at(i) = triangle;
+                    }
+                    bottomLevel.packs.push_back(pack);
+                }
+                node.children.at(lane) = firstPack;
+                node.counts.at(lane) = static_cast<uint16_t>(bottomLevel.packs.size() - firstPack);
+            }
+        }
+        m_bottomLevels.push_back(std::move(bottomLevel));
+    }
+}
+
+bool CpuRayTracer::isOccluded(const Ray& ray) const
+{
+    Hit hit;
+    return trace<true>(ray, hit);
+}
+
+std::optional<CpuRayTracer::Hit> CpuRayTracer::traceClosest(const Ray& ray) const
+{
+    Hit hit;
+    if (!trace<false>(ray, hit))
+        return std::nullopt;
+    return hit;
+}
+
+template <bool TerminateOnFirstHit>
+bool CpuRayTracer::trace(const Ray& ray, Hit& hit) const
+{
+    float tMax = ray.tMax;
+    const auto worldRay = toSseRay(ray.origin, ray.direction, ray.tMin);
+    return traverse<TerminateOnFirstHit>(m_topLevel, worldRay, tMax, [&](const uint32_t first, const uint32_t count)
+    {
+        bool instanceHit = false;
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            // the direction is not normalized in object space, so t is the same along both rays
+            const auto instanceIndex = m_topLevel.getPrimitiveIndices()[i];
+            const auto& instance = m_instances[instanceIndex];
+            const glm::vec3 origin(instance.worldToObject * glm::vec4(ray.origin, 1.0f));
+            const glm::vec3 direction(instance.worldToObject * glm::vec4(ray.direction, 0.0f));
+            const auto objectRay = toSseRay(origin, direction, ray.tMin);
+            const auto& bottomLevel = m_bottomLevels[instance.bottomLevel];
+
+            const bool bottomLevelHit = traverse<TerminateOnFirstHit>(bottomLevel.bvh, objectRay, tMax, [&](const uint32_t firstPack, const uint32_t packCount)
+            {
+                bool packHit = false;
+                for (uint32_t p = firstPack; p < firstPack + packCount; p++)
+                {
+                    const auto& pack = bottomLevel.packs[p];
+                    __m128 t, u, v;
+                    const int mask = intersectTriangles(pack, objectRay, tMax, t, u, v);
+                    if (mask == 0)
+                        continue;
+                    if (TerminateOnFirstHit)
+                        return true;
+
+                    alignas(16) std::array<float, 4> ts, us, vs;
+                    _mm_store_ps(ts.data(), t);
+                    _mm_store_ps(us.data(), u);
+                    _mm_store_ps(vs.data(), v);
+                    for (uint32_t lane = 0; lane < 4; lane++)
+                    {
+                        if ((mask & (1 << lane)) == 0 || ts[lane] >= tMax)
+                            continue;
+                        tMax = ts[lane];
+                        hit = { ts[lane], instanceIndex, pack.primitives[lane], us[lane], vs[lane] };
+                        packHit = true;
+                    }
+                }
+                return packHit;
+            });
+
+            if (bottomLevelHit && TerminateOnFirstHit)
+                return true;
+            instanceHit |= bottomLevelHit;
+        }
+        return instanceHit;
+    });
+}
+
+void CpuRayTracer::forEachTile(const uint32_t width, const uint32_t height, const uint32_t tileSize, const uint32_t threadCount,
+    const std::function<void(uint32_t, uint32_t, uint32_t, uint32_t)>& function)
+{
+    if (tileSize == 0)
+        throw std::runtime_error("Tiles need at least one pixel");
+
+    const uint32_t tilesX = (width + tileSize - 1) / tileSize;
+    const uint32_t tileCount = tilesX * ((height + tileSize - 1) / tileSize);
+    const auto threads = std::min(threadCount != 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency()), tileCount);
+
+    std::atomic<uint32_t> nextTile = 0;
+    std::vector<std::future<void>> workers;
+    for (uint32_t i = 0; i < threads; i++)
+    {
+        workers.push_back(std::async(std::launch::async, [&]
+        {
+            for (auto tile = nextTile++; tile < tileCount; tile = nextTile++)
+            {
+                const auto x0 = (tile % tilesX) * tileSize;
+                const auto y0 = (tile / tilesX) * tileSize;
+                function(x0, y0, std::min(x0 + tileSize, width), std::min(y0 + tileSize, height));
+            }
+        }));
+    }
+    for (auto& worker : workers)
+        worker.get();
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <vector>
+#include "glm/glm.hpp"
+#include "Bvh4.h"
+#include "SceneBvh.h"
+
+// ray queries on the CPU over the two level hierarchy of a scene, for validation and for machines without RT hardware.
+// both levels are collapsed to 4 wide BVHs and the triangles of a leaf are packed by 4, so a ray is tested against the
+// children of a node and the triangles of a pack with one SSE instruction per step. triangles are opaque and double
+// sided, like the instances of rtcombined
+class CpuRayTracer
+{
+public:
+    struct Ray
+    {
+        glm::vec3 origin{ 0.0f };
+        float tMin = 0.0f;
+        glm::vec3 direction{ 0.0f, 0.0f, 1.0f };
+        float tMax = std::numeric_limits<float>::max();
+    };
+
+    struct Hit
+    {
+        // along the direction of the ray, in world space
+        float t = 0.0f;
+        uint32_t instance = 0;
+        // index in the primitive order of the instance's group, see BlasPartition
+        uint32_t primitive = 0;
+        // barycentrics of the 2nd and 3rd vertex
+        float u = 0.0f;
+        float v = 0.0f;
+    };
+
+    explicit CpuRayTracer(const SceneBvh& bvh);
+
+    // like gl_RayFlagsTerminateOnFirstHitNV, the traversal stops at the first triangle in range
+    [[nodiscard]] bool isOccluded(const Ray& ray) const;
+    [[nodiscard]] std::optional<Hit> traceClosest(const Ray& ray) const;
+
+    // runs function(x0, y0, x1, y1) for the tiles of an image on threadCount threads (0 uses every hardware thread),
+    // threads take the next tile in scanline order when they are done with one. exceptions are rethrown
+    static void forEachTile(uint32_t width, uint32_t height, uint32_t tileSize, uint32_t threadCount,
+        const std::function<void(uint32_t, uint32_t, uint32_t, uint32_t)>& function);
+
+private:
+    // 4 triangles as the first vertex and two edges, unused lanes have zero edges and never hit
+    struct alignas(16) TrianglePack
+    {
+        std::array<float, 4> v0x, v0y, v0z;
+        std::array<float, 4> e1x, e1y, e1z;
+        std::array<float, 4> e2x, e2y, e2z;
+        std::array<uint32_t, 4> primitives;
+    };
+
+    struct BottomLevel
+    {
+        // leaves reference ranges of packs
+        Bvh4 bvh;
+        std::vector<TrianglePack> packs;
+    };
+
+    struct Instance
+    {
+        uint32_t bottomLevel = 0;
+        glm::mat4 worldToObject{ 1.0f };
+    };
+
+    template <bool TerminateOnFirstHit>
+    bool trace(const Ray& ray, Hit& hit) const;
+
+    Bvh4 m_topLevel;
+    std::vector<BottomLevel> m_bottomLevels;
+    std::vector<Instance> m_instances;
+};
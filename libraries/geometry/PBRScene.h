@@ -38,6 +38,7 @@ public:
     explicit PBRScene(const std::filesystem::path& filename);
 
     std::vector<vg::VertexPosUvNormal>& getVertices() { return m_allVertices; }
+    const std::vector<vg::VertexPosUvNormal>& getVertices() const { return m_allVertices; }
     const std::vector<uint32_t>& getIndices() const { return m_allIndices; }
     const std::vector<PerMeshInfoPBR>& getDrawCommandData() const { return m_meshes; }
     const std::vector<glm::mat4>& getModelMatrices() const { return m_modelMatrices; }
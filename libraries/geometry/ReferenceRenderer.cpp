@@ -0,0 +1,529 @@
+#include "ReferenceRenderer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <glm/gtc/matrix_transform.hpp>
+#include "graphic/Definitions.h"
+#include "stb/stb_image.h"
+#include "userinput/Pilotview.h"
+
+namespace
+{
+    // the value of the shaders
+    constexpr float s_pi = 3.1415926535f;
+    // rtreflectionsPBR.rgen draws GGX directions until one is above the surface, which takes long at grazing angles
+    constexpr int s_maxReflectionDraws = 64;
+    const glm::vec3 s_reflectionMissColor(0.007f, 0.007f, 0.01f);
+
+    float random(std::mt19937& generator)
+    {
+        return std::uniform_real_distribution<float>(0.0f, 1.0f)(generator);
+    }
+
+    bool isBlack(const glm::vec3& color)
+    {
+        return color.x == 0.0f && color.y == 0.0f && color.z == 0.0f;
+    }
+
+    glm::vec3 getPseudoPerpendicular(const glm::vec3& normal)
+    {
+        return std::abs(normal.x) <= 0.6f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+
+    // the sampling functions of samplePointGen.glsl
+    glm::vec3 rotateToNormal(const glm::vec3& direction, const glm::vec3& normal)
+    {
+        const glm::vec3 u = glm::normalize(glm::cross(normal, getPseudoPerpendicular(normal)));
+        const glm::vec3 v = glm::normalize(glm::cross(normal, u));
+        return direction.x * u + direction.y * v + direction.z * normal;
+    }
+
+    glm::vec3 generateConeDirection(const float cosThetaMax, std::mt19937& generator)
+    {
+        const float rand1 = random(generator);
+        const float rand2 = random(generator);
+        const float cosTheta = (1.0f - rand1) + rand1 * cosThetaMax;
+        const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+        const float phi = rand2 * 2.0f * s_pi;
+        return glm::vec3(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+    }
+
+    glm::vec3 generatePointOnDiskLight(const glm::vec3& position, const float radius, const glm::vec3& normal, std::mt19937& generator)
+    {
+        const float r = random(generator);
+        const float theta = random(generator) * 2.0f * s_pi;
+        const float x = std::sqrt(r) * std::cos(theta);
+        const float y = std::sqrt(r) * std::sin(theta);
+        const glm::vec3 a = glm::cross(normal, getPseudoPerpendicular(normal));
+        const glm::vec3 b = glm::cross(a, normal);
+        return position + radius * x * a + radius * y * b;
+    }
+
+    glm::vec3 sampleCosineHemisphere(const float u, const float v)
+    {
+        const float sinTheta = std::sqrt(u);
+        const float phi = 2.0f * s_pi * v;
+        const float x = sinTheta * std::cos(phi);
+        const float y = sinTheta * std::sin(phi);
+        return glm::vec3(x, y, std::sqrt(std::max(0.0f, 1.0f - x * x - y * y)));
+    }
+
+    glm::vec3 importanceSampleGGX(const float u, const float v, const float roughness)
+    {
+        const float phi = v * 2.0f * 3.14156235659f;
+        const float theta = std::atan(std::sqrt(roughness * roughness * u / (1.0f - u)));
+        return glm::vec3(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+    }
+
+    // the BRDF of pbrLight.glsl
+    float distributionGGX(const glm::vec3& n, const glm::vec3& h, const float roughness)
+    {
+        const float a2 = roughness * roughness * roughness * roughness;
+        const float nDotH = std::max(glm::dot(n, h), 0.0f);
+        const float denominator = nDotH * nDotH * (a2 - 1.0f) + 1.0f;
+        return a2 / (s_pi * denominator * denominator);
+    }
+
+    float geometrySchlickGGX(const float nDotV, const float roughness)
+    {
+        const float k = (roughness + 1.0f) * (roughness + 1.0f) / 8.0f;
+        return nDotV / (nDotV * (1.0f - k) + k);
+    }
+
+    float geometrySmith(const glm::vec3& n, const glm::vec3& v, const glm::vec3& l, const float roughness)
+    {
+        return geometrySchlickGGX(std::max(glm::dot(n, v), 0.0f), roughness) * geometrySchlickGGX(std::max(glm::dot(n, l), 0.0f), roughness);
+    }
+
+    glm::vec3 fresnelSchlick(const float cosTheta, const glm::vec3& f0)
+    {
+        return f0 + (glm::vec3(1.0f) - f0) * std::pow(1.0f - cosTheta, 5.0f);
+    }
+
+    glm::vec3 fresnelSchlickRoughness(const float cosTheta, const glm::vec3& f0, const float roughness)
+    {
+        return f0 + (glm::max(glm::vec3(1.0f - roughness), f0) - f0) * std::pow(1.0f - cosTheta, 5.0f);
+    }
+
+    // outgoing radiance of one light without its visibility, the light loop of rtreflectionsPBR.rchit
+    glm::vec3 evaluateLight(const glm::vec3& n, const glm::vec3& v, const glm::vec3& l, const glm::vec3& radiance, const glm::vec3& albedo,
+        const float metallic, const float roughness, const glm::vec3& f0)
+    {
+        const glm::vec3 h = glm::normalize(v + l);
+        const float ndf = distributionGGX(n, h, roughness);
+        const float g = geometrySmith(n, v, l, roughness);
+        const glm::vec3 f = fresnelSchlick(std::max(glm::dot(h, v), 0.0f), f0);
+        const glm::vec3 kD = (glm::vec3(1.0f) - f) * (1.0f - metallic);
+        const float nDotL = std::max(glm::dot(n, l), 0.0f);
+        const glm::vec3 specular = ndf * g * f / (4.0f * std::max(glm::dot(n, v), 0.0f) * nDotL + 0.001f);
+        return (kD * albedo / s_pi + specular) * radiance * nDotL;
+    }
+}
+
+ReferenceRenderer::ReferenceRenderer(const PBRScene& scene, const std::filesystem::path& sceneFile, const BlasPartitionPolicy& policy)
+    : m_scene(scene), m_partition(scene, policy, {}), m_bvh(scene, m_partition), m_tracer(m_bvh)
+{
+    // the index space of the texture array of rtcombined: base color textures first, then metallic/roughness textures
+    std::vector<std::string> names;
+    for (const auto& [meshes, name] : scene.getIndexedBaseColorTexturePaths())
+        names.push_back(name);
+    for (const auto& [meshes, name] : scene.getIndexedMetallicRoughnessTexturePaths())
+        names.push_back(name);
+
+    stbi_set_flip_vertically_on_load(true);
+    const auto folder = sceneFile.parent_path().generic_string() + "/";
+    for (const auto& name : names)
+    {
+        auto path = vg::g_resourcesPath;
+        path.append(folder + name);
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        stbi_uc* pixels = stbi_load(path.string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        if (pixels == nullptr)
+            throw std::runtime_error("Failed to load texture " + path.string());
+
+        Texture texture;
+        texture.widths.push_back(static_cast<uint32_t>(width));
+        texture.heights.push_back(static_cast<uint32_t>(height));
+        texture.levels.emplace_back(static_cast<size_t>(width) * height);
+        std::memcpy(texture.levels.back().data(), pixels, static_cast<size_t>(width) * height * 4);
+        stbi_image_free(pixels);
+
+        // 2x2 box filter down to 1x1, like the linear blits that create the mip chain on the GPU
+        while (texture.widths.back() > 1 || texture.heights.back() > 1)
+        {
+            const auto sourceWidth = texture.widths.back();
+            const auto sourceHeight = texture.heights.back();
+            const auto levelWidth = std::max(1u, sourceWidth / 2);
+            const auto levelHeight = std::max(1u, sourceHeight / 2);
+            const auto& source = texture.levels.back();
+            std::vector<std::array<uint8_t, 4>> level(static_cast<size_t>(levelWidth) * levelHeight);
+            for (uint32_t y = 0; y < levelHeight; y++)
+            {
+                const uint32_t y0 = std::min(2 * y, sourceHeight - 1);
+                const uint32_t y1 = std::min(2 * y + 1, sourceHeight - 1);
+                for (uint32_t x = 0; x < levelWidth; x++)
+                {
+                    const uint32_t x0 = std::min(2 * x, sourceWidth - 1);
+                    const uint32_t x1 = std::min(2 * x + 1, sourceWidth - 1);
+                    for (int c = 0; c < 4; c++)
+                    {
+                        const uint32_t sum = source[y0 * sourceWidth + x0][c] + source[y0 * sourceWidth + x1][c]
+                            + source[y1 * sourceWidth + x0][c] + source[y1 * sourceWidth + x1][c];
+                        level[y * levelWidth + x][c] = static_cast<uint8_t>((sum + 2) / 4);
+                    }
+                }
+            }
+            texture.widths.push_back(levelWidth);
+            texture.heights.push_back(levelHeight);
+            texture.levels.push_back(std::move(level));
+        }
+        m_textures.push_back(std::move(texture));
+    }
+}
+
+glm::vec4 ReferenceRenderer::Texture::sample(const glm::vec2 uv, const float lod) const
+{
+    const float level = std::clamp(lod, 0.0f, static_cast<float>(levels.size() - 1));
+    const auto lower = static_cast<uint32_t>(level);
+    const auto upper = std::min(lower + 1, static_cast<uint32_t>(levels.size() - 1));
+    const float weight = level - static_cast<float>(lower);
+    return glm::mix(sampleLevel(uv, lower), sampleLevel(uv, upper), weight);
+}
+
+glm::vec4 ReferenceRenderer::Texture::sampleLevel(const glm::vec2 uv, const uint32_t level) const
+{
+    const auto width = static_cast<int>(widths.at(level));
+    const auto height = static_cast<int>(heights.at(level));
+    const auto& texels = levels.at(level);
+
+    // bilinear with repeat addressing
+    const float x = uv.x * width - 0.5f;
+    const float y = uv.y * height - 0.5f;
+    const float x0 = std::floor(x);
+    const float y0 = std::floor(y);
+    const float tx = x - x0;
+    const float ty = y - y0;
+    const auto wrap = [](const float coordinate, const int size)
+    {
+        const int i = static_cast<int>(std::fmod(coordinate, static_cast<float>(size)));
+        return i < 0 ? i + size : i;
+    };
+    const auto texel = [&](const int column, const int row)
+    {
+        const auto& t = texels[static_cast<size_t>(row) * width + column];
+        return glm::vec4(t[0], t[1], t[2], t[3]) / 255.0f;
+    };
+    const int left = wrap(x0, width);
+    const int right = wrap(x0 + 1.0f, width);
+    const int top = wrap(y0, height);
+    const int bottom = wrap(y0 + 1.0f, height);
+    return glm::mix(glm::mix(texel(left, top), texel(right, top), tx), glm::mix(texel(left, bottom), texel(right, bottom), tx), ty);
+}
+
+ReferenceRenderer::Surface ReferenceRenderer::getSurface(const CpuRayTracer::Ray& ray, const CpuRayTracer::Hit& hit) const
+{
+    const auto primitive = m_partition.getGroups().at(hit.instance).firstPrimitive + hit.primitive;
+    const auto mesh = m_partition.getPrimitiveMeshes().at(primitive);
+    const auto meshPrimitive = primitive - m_partition.getFirstPrimitiveOfMesh(mesh);
+    const auto& info = m_scene.getDrawCommandData().at(mesh);
+
+    const float weights[3] = { 1.0f - hit.u - hit.v, hit.u, hit.v };
+    Surface surface;
+    glm::vec3 normal(0.0f);
+    for (uint32_t k = 0; k < 3; k++)
+    {
+        const auto index = m_scene.getIndices().at(info.firstIndex + 3 * meshPrimitive + k) + info.vertexOffset;
+        const auto& vertex = m_scene.getVertices().at(index);
+        normal += weights[k] * vertex.normal;
+        surface.uv += weights[k] * vertex.uv;
+    }
+    // the model matrix is not applied to the normal, neither in the G-buffer nor in the closest hit shader
+    surface.normal = glm::normalize(normal);
+    surface.position = ray.origin + hit.t * ray.direction;
+    surface.mesh = mesh;
+    surface.valid = true;
+    return surface;
+}
+
+ReferenceRenderer::Material ReferenceRenderer::getMaterial(const Surface& surface, const float lod, const int32_t materialChannelLayout) const
+{
+    const auto& info = m_scene.getDrawCommandData().at(surface.mesh);
+    const auto& materialInfo = m_scene.getMaterials().at(info.assimpMaterialIndex);
+    // see MaterialChannelLayout in rtcombined, FBX stores the metalness in the blue channel
+    const bool fbx = materialChannelLayout == 1;
+
+    Material material;
+    glm::vec3 albedo = info.texIndexBaseColor != -1 ? glm::vec3(m_textures.at(info.texIndexBaseColor).sample(surface.uv, lod)) : materialInfo.baseColor;
+    material.albedo = glm::vec3(std::pow(albedo.x, 2.2f), std::pow(albedo.y, 2.2f), std::pow(albedo.z, 2.2f));
+
+    glm::vec3 metallicRoughness;
+    if (info.texIndexMetallicRoughness != -1)
+        metallicRoughness = glm::vec3(m_textures.at(info.texIndexMetallicRoughness).sample(surface.uv, lod));
+    else
+        metallicRoughness = fbx ? glm::vec3(0.0f, materialInfo.roughness, materialInfo.metalness) : glm::vec3(materialInfo.metalness, materialInfo.roughness, 0.0f);
+    material.metallic = fbx ? metallicRoughness.z : metallicRoughness.x;
+    material.roughness = metallicRoughness.y + 0.01f;
+    return material;
+}
+
+glm::vec3 ReferenceRenderer::shadeReflectionHit(const Surface& surface, const RTCapture& capture) const
+{
+    // the closest hit shader samples level 0
+    const auto material = getMaterial(surface, 0.0f, capture.materialChannelLayout);
+    const glm::vec3 n = surface.normal;
+    const glm::vec3 v = glm::normalize(capture.cameraPosition - surface.position);
+    const glm::vec3 f0 = glm::mix(glm::vec3(0.04f), material.albedo, material.metallic);
+
+    const auto isVisible = [&](const glm::vec3& direction, const float tMax)
+    {
+        CpuRayTracer::Ray ray;
+        ray.origin = surface.position;
+        ray.tMin = 0.001f;
+        ray.direction = direction;
+        ray.tMax = tMax;
+        return !m_tracer.isOccluded(ray);
+    };
+
+    // lights without intensity add nothing, their shadow rays are skipped
+    glm::vec3 lo(0.0f);
+    for (const auto& light : capture.directionalLights)
+    {
+        const glm::vec3 l = glm::normalize(-light.direction);
+        if (!isBlack(light.intensity) && isVisible(l, 10000.0f))
+            lo += evaluateLight(n, v, l, light.intensity, material.albedo, material.metallic, material.roughness, f0);
+    }
+    for (const auto& light : capture.pointLights)
+    {
+        const float distance = glm::length(light.position - surface.position);
+        const glm::vec3 l = glm::normalize(light.position - surface.position);
+        const glm::vec3 radiance = light.intensity / (distance * distance);
+        if (!isBlack(radiance) && isVisible(l, distance))
+            lo += evaluateLight(n, v, l, radiance, material.albedo, material.metallic, material.roughness, f0);
+    }
+    for (const auto& light : capture.spotLights)
+    {
+        const float distance = glm::length(light.position - surface.position);
+        const glm::vec3 l = glm::normalize(light.position - surface.position);
+        const float theta = glm::dot(l, glm::normalize(-light.direction));
+        const float spot = std::clamp((theta - light.outerCutoff) / (light.cutoff - light.outerCutoff), 0.0f, 1.0f);
+        const glm::vec3 radiance = spot * light.intensity / (distance * distance);
+        if (!isBlack(radiance) && isVisible(l, distance))
+            lo += evaluateLight(n, v, l, radiance, material.albedo, material.metallic, material.roughness, f0);
+    }
+
+    const glm::vec3 f = fresnelSchlickRoughness(std::max(glm::dot(n, v), 0.0f), f0, material.roughness);
+    const glm::vec3 kD = (glm::vec3(1.0f) - f) * (1.0f - material.metallic);
+    return 0.003f * material.albedo * kD + lo;
+}
+
+float ReferenceRenderer::traceDirectionalShadow(const Surface& surface, const PBRDirectionalLight& light, const uint32_t sampleCount, std::mt19937& generator) const
+{
+    uint32_t visible = 0;
+    for (uint32_t i = 0; i < sampleCount; i++)
+    {
+        const glm::vec3 jitter(random(generator), random(generator), random(generator));
+        CpuRayTracer::Ray ray;
+        ray.origin = surface.position;
+        ray.tMin = 0.001f;
+        ray.direction = glm::normalize(-(light.direction + 0.2f * jitter));
+        ray.tMax = 100000.0f;
+        visible += m_tracer.isOccluded(ray) ? 0 : 1;
+    }
+    return static_cast<float>(visible) / static_cast<float>(sampleCount);
+}
+
+float ReferenceRenderer::tracePointShadow(const Surface& surface, const PBRPointLight& light, const uint32_t sampleCount, std::mt19937& generator) const
+{
+    const float distance = glm::length(light.position - surface.position);
+    const glm::vec3 toLight = glm::normalize(light.position - surface.position);
+    const float cosThetaMax = distance / std::sqrt(distance * distance + light.radius * light.radius);
+
+    uint32_t visible = 0;
+    for (uint32_t i = 0; i < sampleCount; i++)
+    {
+        CpuRayTracer::Ray ray;
+        ray.origin = surface.position;
+        ray.tMin = 0.001f;
+        ray.direction = light.radius < 0.0001f ? toLight : glm::normalize(rotateToNormal(generateConeDirection(cosThetaMax, generator), toLight));
+        ray.tMax = distance + light.radius;
+        visible += m_tracer.isOccluded(ray) ? 0 : 1;
+    }
+    return static_cast<float>(visible) / static_cast<float>(sampleCount);
+}
+
+float ReferenceRenderer::traceSpotShadow(const Surface& surface, const PBRSpotLight& light, const uint32_t sampleCount, std::mt19937& generator) const
+{
+    uint32_t visible = 0;
+    for (uint32_t i = 0; i < sampleCount; i++)
+    {
+        const glm::vec3 pointOnLight = generatePointOnDiskLight(light.position, light.radius, glm::normalize(light.direction), generator);
+        CpuRayTracer::Ray ray;
+        ray.origin = surface.position;
+        ray.tMin = 0.001f;
+        ray.direction = glm::normalize(pointOnLight - surface.position);
+        ray.tMax = glm::length(pointOnLight - surface.position);
+        visible += m_tracer.isOccluded(ray) ? 0 : 1;
+    }
+    return static_cast<float>(visible) / static_cast<float>(sampleCount);
+}
+
+float ReferenceRenderer::traceAmbientOcclusion(const Surface& surface, const RTCapture& capture, const uint32_t sampleCount, std::mt19937& generator) const
+{
+    float value = 0.0f;
+    for (uint32_t i = 0; i < sampleCount; i++)
+    {
+        const float u = random(generator);
+        const float v = random(generator);
+        CpuRayTracer::Ray ray;
+        ray.origin = surface.position;
+        ray.tMin = 0.001f;
+        ray.direction = glm::normalize(rotateToNormal(sampleCosineHemisphere(u, v), surface.normal));
+        ray.tMax = capture.aoRadius;
+        // occluders close to the surface darken more
+        const auto hit = m_tracer.traceClosest(ray);
+        value += hit ? std::pow(hit->t / capture.aoRadius, 2.0f) : 1.0f;
+    }
+    return value / static_cast<float>(sampleCount);
+}
+
+glm::vec3 ReferenceRenderer::traceReflection(const Surface& surface, const Material& material, const RTCapture& capture, const uint32_t sampleCount, std::mt19937& generator) const
+{
+    if (capture.reflectionRoughnessThreshold > material.roughness - 0.01f)
+        return glm::vec3(0.0f);
+
+    const glm::vec3 f0 = glm::mix(glm::vec3(0.04f), material.albedo, material.metallic);
+    const glm::vec3 view = glm::normalize(surface.position - capture.cameraPosition);
+    const glm::vec3 reflected = view - 2.0f * glm::dot(surface.normal, view) * surface.normal;
+
+    glm::vec3 value(0.0f);
+    uint32_t taken = 0;
+    for (uint32_t i = 0; i < sampleCount; i++)
+    {
+        glm::vec3 direction;
+        int draws = 0;
+        do
+        {
+            const float u = random(generator);
+            const float v = random(generator);
+            direction = rotateToNormal(importanceSampleGGX(u, v, material.roughness), reflected);
+        } while (glm::dot(direction, surface.normal) < 0.0f && ++draws < s_maxReflectionDraws);
+        // the GPU would keep drawing, the sample is left out of the mean instead
+        if (glm::dot(direction, surface.normal) < 0.0f)
+            continue;
+
+        CpuRayTracer::Ray ray;
+        ray.origin = surface.position;
+        ray.tMin = 0.001f;
+        ray.direction = direction;
+        ray.tMax = 100000.0f;
+        const auto hit = m_tracer.traceClosest(ray);
+        const glm::vec3 hitValue = hit ? shadeReflectionHit(getSurface(ray, *hit), capture) : s_reflectionMissColor;
+        value += fresnelSchlickRoughness(std::max(glm::dot(direction, surface.normal), 0.0f), f0, material.roughness) * hitValue;
+        taken++;
+    }
+    return taken != 0 ? value / static_cast<float>(taken) : glm::vec3(0.0f);
+}
+
+ReferenceRenderer::Images ReferenceRenderer::render(const RTCapture& capture, const Settings& settings) const
+{
+    if (settings.sampleCount == 0)
+        throw std::runtime_error("The reference needs at least one sample per pixel");
+
+    const uint32_t width = capture.width;
+    const uint32_t height = capture.height;
+    Pilotview camera(static_cast<int>(width), static_cast<int>(height));
+    camera.setPose(capture.cameraPosition, capture.cameraTheta, capture.cameraPhi);
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), capture.aspect, 0.1f, 10000.0f);
+    projection[1][1] *= -1;
+    const glm::mat4 inverseViewProjection = glm::inverse(projection * camera.getView());
+
+    const auto forEachPixel = [&](auto&& function)
+    {
+        CpuRayTracer::forEachTile(width, height, settings.tileSize, settings.threadCount, [&](const uint32_t x0, const uint32_t y0, const uint32_t x1, const uint32_t y1)
+        {
+            for (uint32_t y = y0; y < y1; y++)
+                for (uint32_t x = x0; x < x1; x++)
+                    function(x, y, static_cast<size_t>(y) * width + x);
+        });
+    };
+
+    // the G-buffer, the rasterizer samples at the pixel centers
+    std::vector<Surface> gBuffer(static_cast<size_t>(width) * height);
+    forEachPixel([&](const uint32_t x, const uint32_t y, const size_t pixel)
+    {
+        const glm::vec2 ndc(2.0f * (x + 0.5f) / width - 1.0f, 2.0f * (y + 0.5f) / height - 1.0f);
+        const glm::vec4 target = inverseViewProjection * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+        CpuRayTracer::Ray ray;
+        ray.origin = capture.cameraPosition;
+        ray.direction = glm::normalize(glm::vec3(target) / target.w - capture.cameraPosition);
+        ray.tMin = 0.1f;
+        ray.tMax = 10000.0f;
+        if (const auto hit = m_tracer.traceClosest(ray))
+            gBuffer[pixel] = getSurface(ray, *hit);
+    });
+
+    // textureQueryLod of the G-buffer pass, from the uv difference to the next pixel of the same mesh in x and y
+    const auto getLod = [&](const uint32_t x, const uint32_t y, const Surface& surface)
+    {
+        const auto textureIndex = m_scene.getDrawCommandData().at(surface.mesh).texIndexBaseColor;
+        if (textureIndex == -1)
+            return 0.0f;
+        const auto& texture = m_textures.at(textureIndex);
+        const glm::vec2 size(static_cast<float>(texture.widths.front()), static_cast<float>(texture.heights.front()));
+        const auto getDerivative = [&](const int dx, const int dy)
+        {
+            for (const int sign : { 1, -1 })
+            {
+                const int nx = static_cast<int>(x) + sign * dx;
+                const int ny = static_cast<int>(y) + sign * dy;
+                if (nx < 0 || ny < 0 || nx >= static_cast<int>(width) || ny >= static_cast<int>(height))
+                    continue;
+                const auto& neighbour = gBuffer[static_cast<size_t>(ny) * width + nx];
+                if (neighbour.valid && neighbour.mesh == surface.mesh)
+                    return (neighbour.uv - surface.uv) * size;
+            }
+            return glm::vec2(0.0f);
+        };
+        const glm::vec2 ddx = getDerivative(1, 0);
+        const glm::vec2 ddy = getDerivative(0, 1);
+        const float rho2 = std::max(glm::dot(ddx, ddx), glm::dot(ddy, ddy));
+        return rho2 > 0.0f ? std::max(0.0f, 0.5f * std::log2(rho2)) : 0.0f;
+    };
+
+    Images images;
+    images.coverage.resize(gBuffer.size());
+    for (size_t i = 0; i < gBuffer.size(); i++)
+        images.coverage[i] = gBuffer[i].valid ? 1 : 0;
+    images.directionalShadows.assign(capture.directionalLights.size(), FloatImage(width, height, 1));
+    images.pointShadows.assign(capture.pointLights.size(), FloatImage(width, height, 1));
+    images.spotShadows.assign(capture.spotLights.size(), FloatImage(width, height, 1));
+    images.ambientOcclusion = FloatImage(width, height, 1);
+    images.reflections = FloatImage(width, height, 3);
+
+    forEachPixel([&](const uint32_t x, const uint32_t y, const size_t pixel)
+    {
+        const auto& surface = gBuffer[pixel];
+        if (!surface.valid)
+            return;
+        // a sequence per pixel, so the result does not depend on the thread count or the tile order
+        std::seed_seq seed{ settings.seed, static_cast<uint32_t>(pixel) };
+        std::mt19937 generator(seed);
+
+        for (size_t i = 0; i < capture.directionalLights.size(); i++)
+            images.directionalShadows[i].at(x, y) = traceDirectionalShadow(surface, capture.directionalLights[i], settings.sampleCount, generator);
+        for (size_t i = 0; i < capture.pointLights.size(); i++)
+            images.pointShadows[i].at(x, y) = tracePointShadow(surface, capture.pointLights[i], settings.sampleCount, generator);
+        for (size_t i = 0; i < capture.spotLights.size(); i++)
+            images.spotShadows[i].at(x, y) = traceSpotShadow(surface, capture.spotLights[i], settings.sampleCount, generator);
+        images.ambientOcclusion.at(x, y) = traceAmbientOcclusion(surface, capture, settings.sampleCount, generator);
+
+        const auto material = getMaterial(surface, getLod(x, y, surface), capture.materialChannelLayout);
+        const glm::vec3 reflection = traceReflection(surface, material, capture, settings.sampleCount, generator);
+        for (uint32_t c = 0; c < 3; c++)
+            images.reflections.at(x, y, c) = reflection[c];
+    });
+    return images;
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include <vector>
+#include "glm/glm.hpp"
+#include "BlasPartition.h"
+#include "CpuRayTracer.h"
+#include "PBRScene.h"
+#include "SceneBvh.h"
+#include "utility/FloatImage.h"
+#include "utility/RTCapture.h"
+
+// renders the ray traced terms of rtcombined on the CPU at high sample counts, as ground truth for the GPU passes.
+// every term follows its ray generation shader: the soft shadows of softshadowPBR.rgen per light, the ambient
+// occlusion of rtao.rgen and the reflections of rtreflectionsPBR.rgen with the shading of rtreflectionsPBR.rchit.
+// the G-buffer is replaced by primary rays through the pixel centers, it holds the same interpolated position, the
+// untransformed vertex normal and the uv of the hit. the mip level of the primary surface comes from the uv
+// difference to the neighbouring pixels, without the anisotropic filtering of the GPU sampler
+class ReferenceRenderer
+{
+public:
+    struct Settings
+    {
+        // per pixel for each term, per light for the shadows
+        uint32_t sampleCount = 256;
+        uint32_t threadCount = 0;
+        uint32_t tileSize = 16;
+        uint32_t seed = 1;
+    };
+
+    struct Images
+    {
+        // 1 where a primary ray hit the scene. the G-buffer has no surface elsewhere and the GPU terms are undefined
+        std::vector<uint8_t> coverage;
+        // by light, 1 is lit
+        std::vector<FloatImage> directionalShadows;
+        std::vector<FloatImage> pointShadows;
+        std::vector<FloatImage> spotShadows;
+        FloatImage ambientOcclusion;
+        // rgb, 0 where the surface is rougher than the threshold of the capture
+        FloatImage reflections;
+    };
+
+    // sceneFile is relative to the resources folder like for PBRScene, the textures are loaded relative to it
+    ReferenceRenderer(const PBRScene& scene, const std::filesystem::path& sceneFile, const BlasPartitionPolicy& policy = {});
+
+    // at the resolution, camera and lights of the capture, the per frame sample counts of the capture are ignored
+    [[nodiscard]] Images render(const RTCapture& capture, const Settings& settings) const;
+
+private:
+    // rgba8 with its mip chain, sampled like the R8G8B8A8Unorm textures of rtcombined with repeat addressing
+    struct Texture
+    {
+        std::vector<uint32_t> widths;
+        std::vector<uint32_t> heights;
+        std::vector<std::vector<std::array<uint8_t, 4>>> levels;
+
+        [[nodiscard]] glm::vec4 sample(glm::vec2 uv, float lod) const;
+        [[nodiscard]] glm::vec4 sampleLevel(glm::vec2 uv, uint32_t level) const;
+    };
+
+    // what the G-buffer of rtcombined holds for a pixel, or a reflection ray's hit
+    struct Surface
+    {
+        glm::vec3 position{ 0.0f };
+        glm::vec3 normal{ 0.0f };
+        glm::vec2 uv{ 0.0f };
+        uint32_t mesh = 0;
+        bool valid = false;
+    };
+
+    struct Material
+    {
+        glm::vec3 albedo{ 0.0f };
+        float metallic = 0.0f;
+        float roughness = 0.0f;
+    };
+
+    [[nodiscard]] Surface getSurface(const CpuRayTracer::Ray& ray, const CpuRayTracer::Hit& hit) const;
+    [[nodiscard]] Material getMaterial(const Surface& surface, float lod, int32_t materialChannelLayout) const;
+    [[nodiscard]] glm::vec3 shadeReflectionHit(const Surface& surface, const RTCapture& capture) const;
+
+    // the mean over sampleCount samples of each term
+    [[nodiscard]] float traceDirectionalShadow(const Surface& surface, const PBRDirectionalLight& light, uint32_t sampleCount, std::mt19937& generator) const;
+    [[nodiscard]] float tracePointShadow(const Surface& surface, const PBRPointLight& light, uint32_t sampleCount, std::mt19937& generator) const;
+    [[nodiscard]] float traceSpotShadow(const Surface& surface, const PBRSpotLight& light, uint32_t sampleCount, std::mt19937& generator) const;
+    [[nodiscard]] float traceAmbientOcclusion(const Surface& surface, const RTCapture& capture, uint32_t sampleCount, std::mt19937& generator) const;
+    [[nodiscard]] glm::vec3 traceReflection(const Surface& surface, const Material& material, const RTCapture& capture, uint32_t sampleCount, std::mt19937& generator) const;
+
+    const PBRScene& m_scene;
+    BlasPartition m_partition;
+    SceneBvh m_bvh;
+    CpuRayTracer m_tracer;
+    std::vector<Texture> m_textures;
+};
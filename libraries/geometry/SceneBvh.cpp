@@ -0,0 +1,105 @@
+#include "SceneBvh.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <tuple>
+
+SceneBvh::SceneBvh(const PBRScene& scene, const BlasPartition& partition, const BvhBuildSettings& settings) : m_settings(settings)
+{
+    const auto& groups = partition.getGroups();
+    m_bottomLevels.resize(groups.size());
+
+    const auto buildBottomLevel = [&](const size_t group, const BvhBuildSettings& groupSettings)
+    {
+        auto& bottomLevel = m_bottomLevels.at(group);
+        std::tie(bottomLevel.positions, bottomLevel.indices) = partition.getGeometry(scene, group);
+        bottomLevel.bvh = Bvh::buildTriangles(bottomLevel.positions, bottomLevel.indices, groupSettings);
+    };
+
+    // large groups get every thread on their own, the small ones are spread over the threads one group at a time
+    const auto bottomLevelStart = std::chrono::steady_clock::now();
+    std::vector<size_t> smallGroups;
+    for (size_t group = 0; group < groups.size(); group++)
+    {
+        if (groups.at(group).triangleCount >= m_settings.parallelThreshold)
+            buildBottomLevel(group, m_settings);
+        else
+            smallGroups.push_back(group);
+    }
+
+    auto singleThreaded = m_settings;
+    singleThreaded.threadCount = 1;
+    std::atomic<size_t> nextGroup = 0;
+    const auto threadCount = m_settings.threadCount != 0 ? m_settings.threadCount : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::future<void>> workers;
+    for (uint32_t i = 0; i < std::min<size_t>(threadCount, smallGroups.size()); i++)
+    {
+        workers.push_back(std::async(std::launch::async, [&]
+        {
+            for (auto next = nextGroup++; next < smallGroups.size(); next = nextGroup++)
+                buildBottomLevel(smallGroups.at(next), singleThreaded);
+        }));
+    }
+    for (auto& worker : workers)
+        worker.get();
+    m_bottomLevelBuildMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - bottomLevelStart).count();
+
+    // the same instances createAccelerationStructure gets: baked groups are in world space already
+    const auto topLevelStart = std::chrono::steady_clock::now();
+    std::vector<Aabb> instanceBounds;
+    for (uint32_t group = 0; group < static_cast<uint32_t>(groups.size()); group++)
+    {
+        Instance instance;
+        instance.bottomLevel = group;
+        if (!groups.at(group).baked)
+            instance.transform = scene.getModelMatrices().at(groups.at(group).meshes.front());
+        instance.worldBounds = m_bottomLevels.at(group).bvh.getBounds().transform(instance.transform);
+        instanceBounds.push_back(instance.worldBounds);
+        m_instances.push_back(instance);
+    }
+    m_topLevel = Bvh::build(instanceBounds, m_settings);
+    m_topLevelBuildMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - topLevelStart).count();
+}
+
+SceneBvh::Stats SceneBvh::computeStats() const
+{
+    Stats stats;
+    stats.topLevel = m_topLevel.computeStats(m_settings);
+    stats.memoryBytes = stats.topLevel.memoryBytes + m_instances.size() * sizeof(Instance);
+    for (const auto& bottomLevel : m_bottomLevels)
+    {
+        stats.bottomLevels.push_back(bottomLevel.bvh.computeStats(m_settings));
+        stats.memoryBytes += stats.bottomLevels.back().memoryBytes;
+        stats.triangleCount += bottomLevel.bvh.getPrimitiveCount();
+    }
+    stats.bottomLevelBuildMilliseconds = m_bottomLevelBuildMilliseconds;
+    stats.topLevelBuildMilliseconds = m_topLevelBuildMilliseconds;
+
+    // a ray that reaches a top level leaf tests its instances, and traverses the bottom level of every instance whose
+    // bounds it hits. the bottom level cost is relative to its root, which is approximated by the world space bounds
+    const auto& nodes = m_topLevel.getNodes();
+    if (nodes.empty())
+        return stats;
+    const float rootArea = std::max(nodes.front().bounds.getSurfaceArea(), std::numeric_limits<float>::min());
+    for (const auto& node : nodes)
+    {
+        const float area = node.bounds.getSurfaceArea() / rootArea;
+        if (!node.isLeaf())
+        {
+            stats.sahCost += m_settings.traversalCost * area;
+            continue;
+        }
+
+        stats.sahCost += m_settings.intersectionCost * static_cast<float>(node.primitiveCount) * area;
+        for (uint32_t i = node.first; i < node.first + node.primitiveCount; i++)
+        {
+            const auto& instance = m_instances.at(m_topLevel.getPrimitiveIndices().at(i));
+            const float instanceArea = instance.worldBounds.getSurfaceArea() / rootArea;
+            stats.instanceVisits += instanceArea;
+            stats.sahCost += instanceArea * stats.bottomLevels.at(instance.bottomLevel).sahCost;
+        }
+    }
+    return stats;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "Bvh.h"
+#include "BlasPartition.h"
+#include "PBRScene.h"
+
+// the two level hierarchy the ray tracing pipeline gets for a scene, built on the CPU to compare partitions:
+// a bottom level BVH per group of a BlasPartition and a top level BVH over the world space bounds of their instances
+class SceneBvh
+{
+public:
+    struct BottomLevel
+    {
+        Bvh bvh;
+        // in the space of the instance, triangles in primitive order of the group
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    struct Instance
+    {
+        uint32_t bottomLevel = 0;
+        glm::mat4 transform{ 1.0f };
+        Aabb worldBounds;
+    };
+
+    struct Stats
+    {
+        BvhStats topLevel;
+        // by bottom level
+        std::vector<BvhStats> bottomLevels;
+        uint32_t triangleCount = 0;
+        // expected cost of a ray that hits the scene bounds, through the top level into the instances it enters
+        float sahCost = 0.0f;
+        // expected number of instances a ray enters, 1 if they don't overlap
+        float instanceVisits = 0.0f;
+        // nodes, primitive indices and instances, the geometry itself is not counted
+        size_t memoryBytes = 0;
+        float bottomLevelBuildMilliseconds = 0.0f;
+        float topLevelBuildMilliseconds = 0.0f;
+    };
+
+    SceneBvh() = default;
+    SceneBvh(const PBRScene& scene, const BlasPartition& partition, const BvhBuildSettings& settings = {});
+
+    [[nodiscard]] const Bvh& getTopLevel() const { return m_topLevel; }
+    [[nodiscard]] const std::vector<BottomLevel>& getBottomLevels() const { return m_bottomLevels; }
+    [[nodiscard]] const std::vector<Instance>& getInstances() const { return m_instances; }
+
+    [[nodiscard]] Stats computeStats() const;
+
+private:
+    BvhBuildSettings m_settings;
+    Bvh m_topLevel;
+    std::vector<BottomLevel> m_bottomLevels;
+    std::vector<Instance> m_instances;
+    float m_bottomLevelBuildMilliseconds = 0.0f;
+    float m_topLevelBuildMilliseconds = 0.0f;
+};
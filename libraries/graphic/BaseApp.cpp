@@ -8,10 +8,11 @@
 
 namespace vg
 {
-	BaseApp::BaseApp(const std::vector<const char*>& requiredDeviceExtensions) : m_context(requiredDeviceExtensions)
+	BaseApp::BaseApp(const std::vector<const char*>& requiredDeviceExtensions, const std::vector<const char*>& optionalDeviceExtensions)
+        : m_context(requiredDeviceExtensions, optionalDeviceExtensions)
 	{
         m_swapChainFramebuffers.resize(m_context.getSwapChainImageViews().size());
-
+        CpuProfiler::setThreadName("Main thread");
 	}
 
     void BaseApp::allocBufferVma(BufferInfo& in, vk::BufferCreateInfo bufferCreateInfo, const VmaMemoryUsage properties, const VmaAllocationCreateFlags flags) const
@@ -125,9 +126,25 @@ namespace vg
     void BaseApp::drawFrame()
     {
         // wait for the last frame to be finished
-        m_context.getDevice().waitForFences(m_inFlightFences.at(m_currentFrame), VK_TRUE, std::numeric_limits<uint64_t>::max());
+        {
+            VG_PROFILE_SCOPE("Wait for frame fence");
+            m_context.getDevice().waitForFences(m_inFlightFences.at(m_currentFrame), VK_TRUE, std::numeric_limits<uint64_t>::max());
+        }
 
-        auto nextImageResult = m_context.getDevice().acquireNextImageKHR(m_context.getSwapChain(), std::numeric_limits<uint64_t>::max(), m_imageAvailableSemaphores.at(m_currentFrame), nullptr);
+        // the frames that used retired objects are finished now, only once even if the acquire below returns early
+        if (m_lastCollectedFrameNumber != m_frameNumber)
+        {
+            m_lastCollectedFrameNumber = m_frameNumber;
+            m_retireQueue.collect(m_frameNumber);
+            if (m_frameNumber >= static_cast<uint64_t>(m_context.max_frames_in_flight))
+                frameFinished(m_frameNumber - m_context.max_frames_in_flight);
+        }
+
+        auto nextImageResult = [this]
+        {
+            VG_PROFILE_SCOPE("Acquire");
+            return m_context.getDevice().acquireNextImageKHR(m_context.getSwapChain(), std::numeric_limits<uint64_t>::max(), m_imageAvailableSemaphores.at(m_currentFrame), nullptr);
+        }();
         uint32_t imageIndex = nextImageResult.value;
 
         // maybe change this to try/catch as shown below
@@ -158,14 +175,26 @@ namespace vg
 
         vk::Semaphore signalSemaphores[] = { m_graphicsRenderFinishedSemaphores.at(m_currentFrame) };
 
-        recordPerFrameCommandBuffers(imageIndex);
+        m_currentSwapchainImage = imageIndex;
+        const uint32_t frameIndex = getFrameResourceIndex(imageIndex);
+
+        {
+            VG_PROFILE_SCOPE("Record per-frame command buffers");
+            recordPerFrameCommandBuffers(frameIndex);
+        }
 
         vk::SubmitInfo submitInfo(static_cast<uint32_t>(waitSemaphores.size()), waitSemaphores.data(), waitStages.data(),
-            1, &m_commandBuffers.at(imageIndex), 1, signalSemaphores);
+            1, &m_commandBuffers.at(frameIndex), 1, signalSemaphores);
 
-        m_context.getGraphicsQueue().submit(submitInfo, nullptr); // what to do with this fence?
+        {
+            VG_PROFILE_SCOPE("Submit");
+            m_context.getGraphicsQueue().submit(submitInfo, nullptr); // what to do with this fence?
+        }
 
-        buildImguiCmdBufferAndSubmit(imageIndex);
+        {
+            VG_PROFILE_SCOPE("ImGui record and submit");
+            buildImguiCmdBufferAndSubmit(frameIndex);
+        }
 
         std::array<vk::SwapchainKHR, 1> swapChains = { m_context.getSwapChain() };
 
@@ -175,6 +204,7 @@ namespace vg
 
         try
         {
+            VG_PROFILE_SCOPE("Present");
             presentResult = m_context.getPresentQueue().presentKHR(presentInfo);
         }
         catch (const vk::OutOfDateKHRError&)
@@ -194,6 +224,7 @@ namespace vg
 
         //m_context.getPresentQueue().waitIdle();
         m_currentFrame = (m_currentFrame + 1) % m_context.max_frames_in_flight;
+        m_frameNumber++;
     }
 
     ImageInfo BaseApp::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usageFlags,
@@ -323,10 +354,15 @@ namespace vg
     }
 
     void BaseApp::createDepthResources()
+    {
+        createDepthResources(m_context.getSwapChainExtent());
+    }
+
+    void BaseApp::createDepthResources(const vk::Extent2D extent)
     {
         // skipping "findSupportedFormat"
         vk::Format depthFormat = vk::Format::eD32SfloatS8Uint;
-        m_depthImage = createImage(m_context.getSwapChainExtent().width, m_context.getSwapChainExtent().height, 1,
+        m_depthImage = createImage(extent.width, extent.height, 1,
             depthFormat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eDepthStencilAttachment, VMA_MEMORY_USAGE_GPU_ONLY);
 
         vk::ImageViewCreateInfo viewInfo({}, m_depthImage.m_Image, vk::ImageViewType::e2D, depthFormat, {}, { vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1 });
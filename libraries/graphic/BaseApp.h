@@ -3,6 +3,9 @@
 #include <vulkan/vulkan.hpp>
 #include <glm/glm.hpp>
 #include "Context.h"
+#include "RetireQueue.h"
+#include "utility/CpuProfiler.h"
+#include "utility/TraceExporter.h"
 
 
 namespace vg
@@ -40,7 +43,7 @@ namespace vg
     class BaseApp
     {
     public:
-		BaseApp(const std::vector<const char*>& requiredDeviceExtensions);
+		BaseApp(const std::vector<const char*>& requiredDeviceExtensions, const std::vector<const char*>& optionalDeviceExtensions = {});
         virtual void recreateSwapChain() = 0;
 
         // todo maybe make this more generic e.g. "update per-frame information"
@@ -48,6 +51,14 @@ namespace vg
         //virtual void createPerFrameInformation() = 0;
         virtual void recordPerFrameCommandBuffers(uint32_t currentImage) = 0;
 
+        // the per-frame resources (command buffers, descriptor sets, query slots) that record the acquired image. by default
+        // they are indexed by the swapchain image, apps that keep them when the image count changes override this and read
+        // the acquired image from m_currentSwapchainImage. the slot of a frame must not be used by the previous frame
+        virtual uint32_t getFrameResourceIndex(const uint32_t imageIndex) const { return imageIndex; }
+
+        // the GPU finished frameNumber, called by drawFrame before the next frame is recorded, e.g. to read its queries
+        virtual void frameFinished(uint64_t frameNumber) {}
+
         virtual void buildImguiCmdBufferAndSubmit(const uint32_t imageIndex)
         {
             // submit to queue without any commands to signal the semaphore and fence to end the frame
@@ -91,6 +102,8 @@ namespace vg
         void createSyncObjects();
 
         void createDepthResources();
+        // the depth image can be larger than the swapchain, e.g. to survive resizes
+        void createDepthResources(vk::Extent2D extent);
 
         void transitionInCmdBuf(vk::Image image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, uint32_t mipLevels, vk::CommandBuffer cmdBuffer) const;
 
@@ -116,6 +129,21 @@ namespace vg
         std::vector<vk::Fence> m_inFlightFences;
         int m_currentFrame = 0;
 
+        // counts all frames, m_currentFrame only indexes the frames in flight
+        uint64_t m_frameNumber = 0;
+
+        // m_frameNumber of the last retire queue collect and frameFinished, a frame whose acquire was out of date runs again
+        uint64_t m_lastCollectedFrameNumber = ~0ull;
+
+        // the swapchain image acquired for the frame that is being recorded
+        uint32_t m_currentSwapchainImage = 0;
+
+        // objects retired for frame n are destroyed once frame n started, i.e. retire them for m_frameNumber + max_frames_in_flight
+        RetireQueue m_retireQueue;
+
+        // CPU scopes of drawFrame and the apps, GPU spans are added by the apps that have timers
+        TraceExporter m_traceExporter;
+
         std::vector<vk::CommandBuffer> m_commandBuffers;
         std::vector<vk::CommandBuffer> m_staticSecondaryCommandBuffers;
         std::vector<vk::CommandBuffer> m_perFrameSecondaryCommandBuffers;
@@ -0,0 +1,89 @@
+#include "BlasBuildScheduler.h"
+#include <algorithm>
+#include <stdexcept>
+
+// winnt.h defines MemoryBarrier as a macro
+#ifdef MemoryBarrier
+#undef MemoryBarrier
+#endif
+
+namespace vg
+{
+    BlasBuildScheduler::BlasBuildScheduler(const Context& context, const vk::DeviceSize scratchBudget, const uint32_t maxBatchSize)
+        : m_context(context), m_scratchBudget(scratchBudget), m_maxBatchSize(std::max(maxBatchSize, 1u))
+    {
+        //todo remove this when the SDK update happened
+        m_cmdBuildAccelerationStructure = reinterpret_cast<PFN_vkCmdBuildAccelerationStructureNV>(vkGetDeviceProcAddr(context.getDevice(), "vkCmdBuildAccelerationStructureNV"));
+        m_cmdWriteAccelerationStructuresProperties = reinterpret_cast<PFN_vkCmdWriteAccelerationStructuresPropertiesNV>(vkGetDeviceProcAddr(context.getDevice(), "vkCmdWriteAccelerationStructuresPropertiesNV"));
+        if (m_cmdBuildAccelerationStructure == nullptr || m_cmdWriteAccelerationStructuresProperties == nullptr)
+            throw std::runtime_error("VK_NV_ray_tracing commands are not available");
+    }
+
+    void BlasBuildScheduler::add(const vk::AccelerationStructureNV as, const vk::AccelerationStructureInfoNV& info)
+    {
+        const vk::AccelerationStructureMemoryRequirementsInfoNV scratchInfo(vk::AccelerationStructureMemoryRequirementsTypeNV::eBuildScratch, as);
+        const auto requirements = m_context.get().getDevice().getAccelerationStructureMemoryRequirementsNV(scratchInfo).memoryRequirements;
+        m_builds.push_back({ as, info, requirements.size, std::max<vk::DeviceSize>(requirements.alignment, 1) });
+        m_batches.clear();
+    }
+
+    vk::DeviceSize BlasBuildScheduler::plan()
+    {
+        m_batches.clear();
+        m_scratchSize = 0;
+
+        Batch batch;
+        for (size_t i = 0; i < m_builds.size(); i++)
+        {
+            auto& build = m_builds.at(i);
+            auto offset = (batch.scratchSize + build.scratchAlignment - 1) / build.scratchAlignment * build.scratchAlignment;
+            if (!batch.builds.empty() && (batch.builds.size() == m_maxBatchSize || offset + build.scratchSize > m_scratchBudget))
+            {
+                m_scratchSize = std::max(m_scratchSize, batch.scratchSize);
+                m_batches.push_back(std::move(batch));
+                batch = {};
+                offset = 0;
+            }
+
+            build.scratchOffset = offset;
+            batch.builds.push_back(i);
+            batch.scratchSize = offset + build.scratchSize;
+        }
+
+        if (!batch.builds.empty())
+        {
+            m_scratchSize = std::max(m_scratchSize, batch.scratchSize);
+            m_batches.push_back(std::move(batch));
+        }
+        return m_scratchSize;
+    }
+
+    void BlasBuildScheduler::cmdBuildBatch(const vk::CommandBuffer& cmdBuffer, const size_t batch, const vk::Buffer scratchBuffer, const vk::DeviceSize scratchOffset) const
+    {
+        for (const auto index : m_batches.at(batch).builds)
+        {
+            const auto& build = m_builds.at(index);
+            m_cmdBuildAccelerationStructure(cmdBuffer, reinterpret_cast<const VkAccelerationStructureInfoNV*>(&build.info), nullptr, 0, VK_FALSE,
+                build.as, nullptr, scratchBuffer, scratchOffset + build.scratchOffset);
+        }
+
+        // the scratch memory is written again by the next batch, the structures are read by the top level build
+        const vk::MemoryBarrier barrier(
+            vk::AccessFlagBits::eAccelerationStructureWriteNV | vk::AccessFlagBits::eAccelerationStructureReadNV,
+            vk::AccessFlagBits::eAccelerationStructureWriteNV | vk::AccessFlagBits::eAccelerationStructureReadNV
+        );
+        cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAccelerationStructureBuildNV, vk::PipelineStageFlagBits::eAccelerationStructureBuildNV, {}, barrier, nullptr, nullptr);
+    }
+
+    void BlasBuildScheduler::cmdWriteCompactedSizes(const vk::CommandBuffer& cmdBuffer, const vk::QueryPool queryPool, const uint32_t firstQuery) const
+    {
+        std::vector<VkAccelerationStructureNV> structures;
+        structures.reserve(m_builds.size());
+        for (const auto& build : m_builds)
+            structures.push_back(build.as);
+
+        cmdBuffer.resetQueryPool(queryPool, firstQuery, static_cast<uint32_t>(structures.size()));
+        m_cmdWriteAccelerationStructuresProperties(cmdBuffer, static_cast<uint32_t>(structures.size()), structures.data(),
+            VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_NV, queryPool, firstQuery);
+    }
+}
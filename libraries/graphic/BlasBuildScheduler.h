@@ -0,0 +1,71 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "Context.h"
+
+namespace vg
+{
+    // records the builds of many bottom level acceleration structures in batches. every build of a batch gets its own
+    // region of the scratch buffer, so the builds of a batch don't depend on each other and the GPU can run them
+    // concurrently. only the batches are separated by a barrier, the next batch reuses the scratch memory
+    class BlasBuildScheduler
+    {
+    public:
+        struct Batch
+        {
+            // indices into the added builds
+            std::vector<size_t> builds;
+            vk::DeviceSize scratchSize = 0;
+        };
+
+        // scratchBudget bounds the scratch memory of a batch, maxBatchSize the number of builds that can overlap
+        explicit BlasBuildScheduler(const Context& context, vk::DeviceSize scratchBudget = s_defaultScratchBudget, uint32_t maxBatchSize = s_defaultMaxBatchSize);
+
+        // the acceleration structure has to be created with the same info. the geometries of the info have to stay
+        // valid until the builds are recorded
+        void add(vk::AccelerationStructureNV as, const vk::AccelerationStructureInfoNV& info);
+
+        // groups the builds into batches in the order they were added. a build that exceeds the budget on its own
+        // gets a batch of its own. returns the scratch size of the largest batch
+        vk::DeviceSize plan();
+
+        [[nodiscard]] const std::vector<Batch>& getBatches() const { return m_batches; }
+        [[nodiscard]] size_t getBuildCount() const { return m_builds.size(); }
+        [[nodiscard]] vk::DeviceSize getScratchSize() const { return m_scratchSize; }
+
+        // the builds of the batch and a barrier that orders them before the following builds, the scratch buffer
+        // needs getScratchSize() bytes from scratchOffset on
+        void cmdBuildBatch(const vk::CommandBuffer& cmdBuffer, size_t batch, vk::Buffer scratchBuffer, vk::DeviceSize scratchOffset = 0) const;
+
+        // resets the queries [firstQuery, firstQuery + getBuildCount()) of an eAccelerationStructureCompactedSizeNV pool and
+        // writes the compacted size of every build into them, in the order the builds were added. after the last batch,
+        // the structures have to be built with eAllowCompaction
+        void cmdWriteCompactedSizes(const vk::CommandBuffer& cmdBuffer, vk::QueryPool queryPool, uint32_t firstQuery = 0) const;
+
+    private:
+        static constexpr vk::DeviceSize s_defaultScratchBudget = 256ull * 1024 * 1024;
+        static constexpr uint32_t s_defaultMaxBatchSize = 32;
+
+        struct Build
+        {
+            vk::AccelerationStructureNV as;
+            vk::AccelerationStructureInfoNV info;
+            vk::DeviceSize scratchSize;
+            vk::DeviceSize scratchAlignment;
+            // relative to the scratch region of the batch
+            vk::DeviceSize scratchOffset = 0;
+        };
+
+        std::reference_wrapper<const Context> m_context;
+        vk::DeviceSize m_scratchBudget;
+        uint32_t m_maxBatchSize;
+        PFN_vkCmdBuildAccelerationStructureNV m_cmdBuildAccelerationStructure = nullptr;
+        PFN_vkCmdWriteAccelerationStructuresPropertiesNV m_cmdWriteAccelerationStructuresProperties = nullptr;
+
+        std::vector<Build> m_builds;
+        std::vector<Batch> m_batches;
+        vk::DeviceSize m_scratchSize = 0;
+    };
+}
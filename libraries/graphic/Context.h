@@ -12,7 +12,8 @@ namespace vg
     class Context
     {
     public:
-        Context(const std::vector<const char*>& requiredDeviceExtensions);
+        // the optional extensions are enabled if the picked device supports them, see isDeviceExtensionEnabled
+        Context(const std::vector<const char*>& requiredDeviceExtensions, const std::vector<const char*>& optionalDeviceExtensions = {});
         ~Context();
 
         void initWindow();
@@ -59,11 +60,13 @@ namespace vg
 
         vk::Extent2D chooseSwapExtent(const vk::SurfaceCapabilitiesKHR& capabilities);
 
-        void createSwapChain();
+        // passing the old swapchain lets the driver reuse its resources, the caller still has to destroy it
+        void createSwapChain(vk::SwapchainKHR oldSwapchain = nullptr);
 
         void createImageViews();
 
         vk::ShaderModule createShaderModule(const std::vector<char>& code) const;
+        vk::ShaderModule createShaderModule(const std::vector<uint32_t>& code) const;
 
         void initImgui();
 
@@ -71,9 +74,17 @@ namespace vg
 
         GLFWwindow* getWindow() const { return m_window; }
 
+        vk::Instance getInstance() const { return m_instance; }
         vk::Device getDevice() const { return m_device; }
         vk::PhysicalDevice getPhysicalDevice() const { return m_phsyicalDevice; }
 
+        bool isDeviceExtensionEnabled(const char* extensionName) const;
+        const vk::PhysicalDeviceFeatures& getEnabledFeatures() const { return m_enabledFeatures; }
+
+        // nanoseconds per timestamp tick and the number of valid timestamp bits of the graphics queue
+        float getTimestampPeriod() const { return m_timestampPeriod; }
+        uint32_t getTimestampValidBits() const { return m_timestampValidBits; }
+
         int getWidth() const { return m_width; }
         int getHeight() const { return m_height; }
 
@@ -134,6 +145,13 @@ namespace vg
 
 		// device extensions required by app
 		std::vector<const char*> m_requiredDeviceExtensions;
+		std::vector<const char*> m_optionalDeviceExtensions;
+		// required plus the supported optional ones
+		std::vector<const char*> m_enabledDeviceExtensions;
+		vk::PhysicalDeviceFeatures m_enabledFeatures;
+
+		float m_timestampPeriod = 1.0f;
+		uint32_t m_timestampValidBits = 64;
 		std::optional<vk::PhysicalDeviceRayTracingPropertiesNV> m_raytracingProperties;
 
 		// logger
@@ -57,6 +57,8 @@ namespace vg
 		int32_t RTReflectionSampleCount = 1;
         int32_t RTUseLowResReflections = 0;
         float RTReflectionRoughnessThreshold = 0.0f;
+        // vec2 is 8-byte aligned in std430
+        alignas(8) glm::vec2 renderScale = glm::vec2(1.0f);
 	};
 
     struct ImageLoadInfo
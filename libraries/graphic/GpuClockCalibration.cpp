@@ -0,0 +1,203 @@
+#include "GpuClockCalibration.h"
+#include <algorithm>
+#include <array>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace
+{
+    using Clock = vg::GpuClockCalibration::Clock;
+
+    // the host time domain steady_clock is built on
+#ifdef _WIN32
+    constexpr VkTimeDomainEXT s_hostTimeDomain = VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+
+    Clock::time_point hostTicksToTimePoint(const uint64_t ticks)
+    {
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        const auto ticksPerSecond = static_cast<uint64_t>(frequency.QuadPart);
+        // split to avoid overflowing ticks * 1e9
+        const auto nanoseconds = (ticks / ticksPerSecond) * 1'000'000'000 + (ticks % ticksPerSecond) * 1'000'000'000 / ticksPerSecond;
+        return Clock::time_point(std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(nanoseconds)));
+    }
+#else
+    constexpr VkTimeDomainEXT s_hostTimeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+
+    Clock::time_point hostTicksToTimePoint(const uint64_t ticks)
+    {
+        return Clock::time_point(std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(ticks)));
+    }
+#endif
+}
+
+namespace vg
+{
+    GpuClockCalibration::GpuClockCalibration(const Context& context)
+        : m_context(context), m_timestampPeriod(context.getTimestampPeriod()),
+          m_timestampMask(context.getTimestampValidBits() >= 64 ? ~0ull : (1ull << context.getTimestampValidBits()) - 1)
+    {
+        const auto device = context.getDevice();
+
+        if (context.isDeviceExtensionEnabled(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME))
+        {
+            const auto getTimeDomains = reinterpret_cast<PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT>(vkGetInstanceProcAddr(context.getInstance(), "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT"));
+            m_getCalibratedTimestamps = reinterpret_cast<PFN_vkGetCalibratedTimestampsEXT>(vkGetDeviceProcAddr(device, "vkGetCalibratedTimestampsEXT"));
+
+            if (getTimeDomains != nullptr && m_getCalibratedTimestamps != nullptr)
+            {
+                const auto physicalDevice = static_cast<VkPhysicalDevice>(context.getPhysicalDevice());
+                uint32_t domainCount = 0;
+                getTimeDomains(physicalDevice, &domainCount, nullptr);
+                std::vector<VkTimeDomainEXT> domains(domainCount);
+                getTimeDomains(physicalDevice, &domainCount, domains.data());
+
+                const auto supports = [&domains](const VkTimeDomainEXT domain) { return std::find(domains.begin(), domains.end(), domain) != domains.end(); };
+                if (supports(VK_TIME_DOMAIN_DEVICE_EXT) && supports(s_hostTimeDomain))
+                    m_hostTimeDomain = s_hostTimeDomain;
+            }
+        }
+
+        // the fallback objects always exist, the extension path can still be rejected in calibrate()
+        const auto graphicsFamily = context.findQueueFamilies(context.getPhysicalDevice()).graphicsFamily.value();
+        m_commandPool = device.createCommandPool({ vk::CommandPoolCreateFlagBits::eTransient, graphicsFamily });
+        m_commandBuffer = device.allocateCommandBuffers({ m_commandPool, vk::CommandBufferLevel::ePrimary, 1 }).at(0);
+        m_queryPool = device.createQueryPool({ {}, vk::QueryType::eTimestamp, 1 });
+        m_fence = device.createFence({});
+
+        m_commandBuffer.begin(vk::CommandBufferBeginInfo());
+        m_commandBuffer.resetQueryPool(m_queryPool, 0, 1);
+        m_commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, m_queryPool, 0);
+        m_commandBuffer.end();
+
+        calibrate();
+        context.getLogger()->info("GPU clock calibrated with {}, max deviation {} us", usesCalibratedTimestamps() ? "VK_EXT_calibrated_timestamps" : "a fence",
+            std::chrono::duration<double, std::micro>(m_maxDeviation).count());
+    }
+
+    GpuClockCalibration::~GpuClockCalibration()
+    {
+        const auto device = m_context.get().getDevice();
+        device.destroyFence(m_fence);
+        device.destroyQueryPool(m_queryPool);
+        device.destroyCommandPool(m_commandPool);
+    }
+
+    void GpuClockCalibration::calibrate()
+    {
+        if (m_hostTimeDomain.has_value())
+        {
+            if (calibrateWithExtension())
+                return;
+
+            m_context.get().getLogger()->warn("Calibrated timestamps don't match steady_clock, falling back to fence based GPU clock calibration");
+            m_hostTimeDomain.reset();
+        }
+
+        calibrateWithFence(true);
+    }
+
+    void GpuClockCalibration::update(const std::vector<vk::Fence>& graphicsFences)
+    {
+        if (m_hostTimeDomain.has_value())
+        {
+            if (getSampleAge() > std::chrono::seconds(1))
+                calibrate();
+            return;
+        }
+
+        if (graphicsFences.empty() || getSampleAge() < s_fallbackInterval)
+            return;
+
+        const auto device = m_context.get().getDevice();
+        const auto idle = std::all_of(graphicsFences.begin(), graphicsFences.end(), [device](const vk::Fence fence) { return device.getFenceStatus(fence) == vk::Result::eSuccess; });
+        if (idle)
+            calibrateWithFence(false);
+    }
+
+    Clock::time_point GpuClockCalibration::toHostTime(const uint64_t gpuTicks) const
+    {
+        const auto nanoseconds = static_cast<int64_t>(static_cast<double>(ticksSinceCalibration(gpuTicks)) * m_timestampPeriod);
+        return m_hostTime + std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(nanoseconds));
+    }
+
+    bool GpuClockCalibration::calibrateWithExtension()
+    {
+        std::array<VkCalibratedTimestampInfoEXT, 2> infos{};
+        infos.at(0).sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+        infos.at(0).timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+        infos.at(1).sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+        infos.at(1).timeDomain = m_hostTimeDomain.value();
+
+        std::array<uint64_t, 2> timestamps{};
+        uint64_t maxDeviation = 0;
+        if (m_getCalibratedTimestamps(m_context.get().getDevice(), static_cast<uint32_t>(infos.size()), infos.data(), timestamps.data(), &maxDeviation) != VK_SUCCESS)
+            return false;
+
+        // steady_clock is assumed to count the host domain since its epoch, which holds for the common standard libraries
+        const auto hostTime = hostTicksToTimePoint(timestamps.at(1));
+        const auto now = Clock::now();
+        if (std::max(now, hostTime) - std::min(now, hostTime) > std::chrono::seconds(1))
+            return false;
+
+        setSample(timestamps.at(0), hostTime, std::chrono::nanoseconds(maxDeviation));
+        return true;
+    }
+
+    void GpuClockCalibration::calibrateWithFence(const bool waitForIdle)
+    {
+        const auto device = m_context.get().getDevice();
+        const auto queue = m_context.get().getGraphicsQueue();
+        if (waitForIdle)
+            queue.waitIdle();
+
+        // on the idle queue the timestamp is written between the submit and the fence signal
+        auto bestWindow = Clock::duration::max();
+        uint64_t bestTicks = 0;
+        Clock::time_point bestHostTime;
+        for (int i = 0; i < s_fenceSamples; i++)
+        {
+            device.resetFences(m_fence);
+            const vk::SubmitInfo submitInfo(0, nullptr, nullptr, 1, &m_commandBuffer);
+            const auto before = Clock::now();
+            queue.submit(submitInfo, m_fence);
+            device.waitForFences(m_fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+            const auto after = Clock::now();
+
+            uint64_t timestamp = 0;
+            const auto res = device.getQueryPoolResults(m_queryPool, 0, 1, sizeof(uint64_t), &timestamp, sizeof(uint64_t), vk::QueryResultFlagBits::eWait | vk::QueryResultFlagBits::e64);
+            if (res != vk::Result::eSuccess)
+                throw std::runtime_error("Query not successful");
+
+            if (after - before < bestWindow)
+            {
+                bestWindow = after - before;
+                bestTicks = timestamp;
+                bestHostTime = before + bestWindow / 2;
+            }
+        }
+        setSample(bestTicks, bestHostTime, std::chrono::duration_cast<std::chrono::nanoseconds>(bestWindow / 2));
+    }
+
+    void GpuClockCalibration::setSample(const uint64_t gpuTicks, const Clock::time_point hostTime, const std::chrono::nanoseconds maxDeviation)
+    {
+        if (m_calibrated)
+            m_lastDrift = std::chrono::duration_cast<std::chrono::nanoseconds>(toHostTime(gpuTicks) - hostTime);
+
+        m_gpuTicks = gpuTicks;
+        m_hostTime = hostTime;
+        m_maxDeviation = maxDeviation;
+        m_sampleTime = Clock::now();
+        m_calibrated = true;
+    }
+
+    int64_t GpuClockCalibration::ticksSinceCalibration(const uint64_t gpuTicks) const
+    {
+        const auto forward = (gpuTicks - m_gpuTicks) & m_timestampMask;
+        if (forward <= (m_timestampMask >> 1))
+            return static_cast<int64_t>(forward);
+        return -static_cast<int64_t>((m_gpuTicks - gpuTicks) & m_timestampMask);
+    }
+}
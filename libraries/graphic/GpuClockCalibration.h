@@ -0,0 +1,87 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <chrono>
+#include <optional>
+#include "Context.h"
+
+namespace vg
+{
+    // maps timestamps of the graphics queue (ticks as written by vkCmdWriteTimestamp) onto std::chrono::steady_clock,
+    // so GPU work can be put on the same timeline as CPU scopes
+    // with VK_EXT_calibrated_timestamps the driver samples both clocks at once and the mapping is refreshed every
+    // second to follow drift. without it a timestamp is written on the idle queue and bracketed by the submit and
+    // the fence signal. calibrate() waits for the queue to go idle, update() only resamples when the frames in flight
+    // already finished, so a GPU bound app can keep an old sample, see isStale()
+    class GpuClockCalibration
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit GpuClockCalibration(const Context& context);
+        ~GpuClockCalibration();
+
+        GpuClockCalibration(const GpuClockCalibration&) = delete;
+        GpuClockCalibration& operator=(const GpuClockCalibration&) = delete;
+
+        // takes a new sample, waits for the graphics queue to go idle without the extension
+        void calibrate();
+
+        // once per frame. with the extension the mapping is refreshed every second. the fallback resamples every
+        // s_fallbackInterval, but only if all given fences (of the work submitted to the graphics queue) are signalled,
+        // then the queue is idle without waiting for it
+        void update(const std::vector<vk::Fence>& graphicsFences = {});
+
+        [[nodiscard]] bool usesCalibratedTimestamps() const { return m_hostTimeDomain.has_value(); }
+
+        // how far off the last sample can be
+        [[nodiscard]] std::chrono::nanoseconds getMaxDeviation() const { return m_maxDeviation; }
+
+        // how far the previous mapping was off at the last sample, 0 until the clock was sampled twice
+        [[nodiscard]] std::chrono::nanoseconds getLastDrift() const { return m_lastDrift; }
+
+        [[nodiscard]] Clock::duration getSampleAge() const { return Clock::now() - m_sampleTime; }
+
+        // the fallback couldn't resample for a while, the mapping has drifted by an unknown amount and GPU times
+        // shouldn't be taken as aligned with the CPU timeline
+        [[nodiscard]] bool isStale() const { return getSampleAge() > s_maxSampleAge; }
+
+        [[nodiscard]] Clock::time_point toHostTime(uint64_t gpuTicks) const;
+
+    private:
+        // the samples are combined to one with the smallest bracket
+        static constexpr int s_fenceSamples = 5;
+        static constexpr std::chrono::seconds s_fallbackInterval{ 5 };
+        static constexpr std::chrono::seconds s_maxSampleAge{ 30 };
+
+        bool calibrateWithExtension();
+        // without waitForIdle the caller guarantees that the graphics queue has no pending work
+        void calibrateWithFence(bool waitForIdle);
+        // stores a new sample and measures how far the old mapping drifted from it
+        void setSample(uint64_t gpuTicks, Clock::time_point hostTime, std::chrono::nanoseconds maxDeviation);
+
+        // ticks since the calibration, negative for earlier timestamps, handles counters with less than 64 valid bits
+        [[nodiscard]] int64_t ticksSinceCalibration(uint64_t gpuTicks) const;
+
+        std::reference_wrapper<const Context> m_context;
+        double m_timestampPeriod;
+        uint64_t m_timestampMask;
+
+        uint64_t m_gpuTicks = 0;
+        Clock::time_point m_hostTime;
+        std::chrono::nanoseconds m_maxDeviation{ 0 };
+        std::chrono::nanoseconds m_lastDrift{ 0 };
+        bool m_calibrated = false;
+        // when the last sample was taken, m_hostTime can be slightly off from it
+        Clock::time_point m_sampleTime;
+
+        // VK_EXT_calibrated_timestamps, only set if the device supports a host domain that matches steady_clock
+        std::optional<VkTimeDomainEXT> m_hostTimeDomain;
+        PFN_vkGetCalibratedTimestampsEXT m_getCalibratedTimestamps = nullptr;
+
+        // fallback
+        vk::CommandPool m_commandPool;
+        vk::CommandBuffer m_commandBuffer;
+        vk::QueryPool m_queryPool;
+        vk::Fence m_fence;
+    };
+}
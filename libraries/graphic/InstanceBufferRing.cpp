@@ -0,0 +1,98 @@
+#include "InstanceBufferRing.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace vg
+{
+    InstanceBufferRing::InstanceBufferRing(const Context& context, std::vector<GeometryInstance> instances, const uint32_t slotCount)
+        : m_context(context), m_instances(std::move(instances)), m_dirtyInstances(slotCount), m_dirtyFlags(slotCount, std::vector<bool>(m_instances.size(), false))
+    {
+        if (slotCount == 0 || m_instances.empty())
+            throw std::runtime_error("An instance buffer ring needs at least one slot and one instance");
+
+        // the async AS update reads the instances on the compute queue
+        const auto indices = context.findQueueFamilies(context.getPhysicalDevice());
+        const std::array queueFamilyIndices = { indices.graphicsFamily.value(), indices.computeFamily.value() };
+        vk::BufferCreateInfo bufferCreateInfo({}, getSlotSize() * slotCount, vk::BufferUsageFlagBits::eRayTracingNV);
+        if (queueFamilyIndices.at(0) != queueFamilyIndices.at(1))
+        {
+            bufferCreateInfo.sharingMode = vk::SharingMode::eConcurrent;
+            bufferCreateInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilyIndices.size());
+            bufferCreateInfo.pQueueFamilyIndices = queueFamilyIndices.data();
+        }
+
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+        allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+        const auto result = vmaCreateBuffer(context.getAllocator(), reinterpret_cast<VkBufferCreateInfo*>(&bufferCreateInfo), &allocInfo,
+            reinterpret_cast<VkBuffer*>(&m_buffer), &m_allocation, &m_allocationInfo);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("Instance buffer creation failed");
+
+        for (uint32_t slot = 0; slot < slotCount; slot++)
+            std::memcpy(static_cast<char*>(m_allocationInfo.pMappedData) + getSlotOffset(slot), m_instances.data(), getSlotSize());
+        vmaFlushAllocation(context.getAllocator(), m_allocation, 0, VK_WHOLE_SIZE);
+    }
+
+    InstanceBufferRing::~InstanceBufferRing()
+    {
+        vmaDestroyBuffer(m_context.get().getAllocator(), static_cast<VkBuffer>(m_buffer), m_allocation);
+    }
+
+    void InstanceBufferRing::setTransform(const uint32_t instance, const glm::mat4& modelMatrix)
+    {
+        // the instance wants the upper 3 rows of the matrix in row major order
+        const glm::mat3x4 transform(glm::transpose(modelMatrix));
+        std::memcpy(m_instances.at(instance).transform, glm::value_ptr(transform), sizeof(GeometryInstance::transform));
+        markDirty(instance);
+    }
+
+    void InstanceBufferRing::setTransforms(const std::vector<std::pair<uint32_t, glm::mat4>>& transforms)
+    {
+        for (const auto& [instance, modelMatrix] : transforms)
+            setTransform(instance, modelMatrix);
+    }
+
+    uint32_t InstanceBufferRing::writeSlot(const uint32_t slot)
+    {
+        auto& dirty = m_dirtyInstances.at(slot);
+        if (dirty.empty())
+            return 0;
+
+        // neighboring instances are copied and flushed as one range
+        std::sort(dirty.begin(), dirty.end());
+        auto* slotData = static_cast<GeometryInstance*>(static_cast<void*>(static_cast<char*>(m_allocationInfo.pMappedData) + getSlotOffset(slot)));
+        for (size_t begin = 0; begin < dirty.size();)
+        {
+            size_t end = begin + 1;
+            while (end < dirty.size() && dirty.at(end) == dirty.at(end - 1) + 1)
+                end++;
+
+            const auto first = dirty.at(begin);
+            const auto count = static_cast<uint32_t>(end - begin);
+            std::memcpy(slotData + first, m_instances.data() + first, count * sizeof(GeometryInstance));
+            vmaFlushAllocation(m_context.get().getAllocator(), m_allocation, getSlotOffset(slot) + first * sizeof(GeometryInstance), count * sizeof(GeometryInstance));
+            begin = end;
+        }
+
+        const auto written = static_cast<uint32_t>(dirty.size());
+        for (const auto instance : dirty)
+            m_dirtyFlags.at(slot).at(instance) = false;
+        dirty.clear();
+        return written;
+    }
+
+    void InstanceBufferRing::markDirty(const uint32_t instance)
+    {
+        for (size_t slot = 0; slot < m_dirtyInstances.size(); slot++)
+        {
+            if (m_dirtyFlags.at(slot).at(instance))
+                continue;
+            m_dirtyFlags.at(slot).at(instance) = true;
+            m_dirtyInstances.at(slot).push_back(instance);
+        }
+    }
+}
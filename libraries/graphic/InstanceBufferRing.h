@@ -0,0 +1,55 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "glm/glm.hpp"
+#include "vma/vk_mem_alloc.h"
+#include "Context.h"
+#include "Definitions.h"
+
+namespace vg
+{
+    // host visible, persistently mapped instance buffer with one slot per frame resource, so a top level build never
+    // reads instances the CPU is writing for another frame. instances are changed on the CPU, writing a slot only copies
+    // and flushes the ranges of instances that changed since that slot was written last
+    class InstanceBufferRing
+    {
+    public:
+        // every slot starts with the given instances
+        InstanceBufferRing(const Context& context, std::vector<GeometryInstance> instances, uint32_t slotCount);
+        ~InstanceBufferRing();
+
+        InstanceBufferRing(const InstanceBufferRing&) = delete;
+        InstanceBufferRing& operator=(const InstanceBufferRing&) = delete;
+
+        void setTransform(uint32_t instance, const glm::mat4& modelMatrix);
+        // any number of instances at once, by instance index
+        void setTransforms(const std::vector<std::pair<uint32_t, glm::mat4>>& transforms);
+
+        [[nodiscard]] const GeometryInstance& getInstance(const uint32_t instance) const { return m_instances.at(instance); }
+        [[nodiscard]] uint32_t getInstanceCount() const { return static_cast<uint32_t>(m_instances.size()); }
+
+        // the GPU has to be done with the slot. returns the number of instances that were written
+        uint32_t writeSlot(uint32_t slot);
+
+        [[nodiscard]] vk::Buffer getBuffer() const { return m_buffer; }
+        [[nodiscard]] vk::DeviceSize getSlotOffset(const uint32_t slot) const { return static_cast<vk::DeviceSize>(slot) * getSlotSize(); }
+        [[nodiscard]] vk::DeviceSize getSlotSize() const { return m_instances.size() * sizeof(GeometryInstance); }
+
+    private:
+        void markDirty(uint32_t instance);
+
+        std::reference_wrapper<const Context> m_context;
+        std::vector<GeometryInstance> m_instances;
+
+        vk::Buffer m_buffer;
+        VmaAllocation m_allocation = nullptr;
+        VmaAllocationInfo m_allocationInfo = {};
+
+        // by slot: the changed instances in the order they were changed, and a flag per instance to keep them unique
+        std::vector<std::vector<uint32_t>> m_dirtyInstances;
+        std::vector<std::vector<bool>> m_dirtyFlags;
+    };
+}
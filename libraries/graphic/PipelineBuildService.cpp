@@ -0,0 +1,103 @@
+#include "PipelineBuildService.h"
+#include <algorithm>
+#include <chrono>
+#include "utility/CpuProfiler.h"
+
+namespace vg
+{
+    PipelineBuildService::PipelineBuildService(const Context& context, uint32_t numThreads) : m_context(context)
+    {
+        // leave one core for the main thread, which keeps creating resources while pipelines compile
+        // hardware_concurrency() may return 0 if it is unknown
+        if (numThreads == 0)
+            numThreads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+        for (uint32_t i = 0; i < numThreads; i++)
+            m_workers.emplace_back(&PipelineBuildService::workerLoop, this);
+    }
+
+    PipelineBuildService::~PipelineBuildService()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_shutdown = true;
+        }
+        m_jobAvailable.notify_all();
+
+        for (auto& worker : m_workers)
+            worker.join();
+    }
+
+    std::shared_future<vk::Pipeline> PipelineBuildService::submit(const std::string& name, std::function<vk::Pipeline()> buildFunction)
+    {
+        BuildJob job{ name, std::packaged_task<vk::Pipeline()>(std::move(buildFunction)) };
+        std::shared_future<vk::Pipeline> future = job.task.get_future().share();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.push(std::move(job));
+            m_jobsInFlight++;
+        }
+        m_jobAvailable.notify_one();
+
+        return future;
+    }
+
+    void PipelineBuildService::waitIdle()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_allJobsDone.wait(lock, [this] { return m_jobsInFlight == 0; });
+    }
+
+    std::map<std::string, float> PipelineBuildService::getCompileTimes() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_compileTimes;
+    }
+
+    void PipelineBuildService::logCompileTimes() const
+    {
+        const auto compileTimes = getCompileTimes();
+        float sum = 0.0f;
+        for (const auto&[name, time] : compileTimes)
+        {
+            m_context.get().getLogger()->info("Pipeline \"{}\" compiled in {} ms", name, time);
+            sum += time;
+        }
+        m_context.get().getLogger()->info("{} pipelines compiled on {} threads, {} ms of compile time in total", compileTimes.size(), m_workers.size(), sum);
+    }
+
+    void PipelineBuildService::workerLoop()
+    {
+        CpuProfiler::setThreadName("Pipeline build worker");
+        while (true)
+        {
+            BuildJob job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_jobAvailable.wait(lock, [this] { return m_shutdown || !m_jobs.empty(); });
+
+                if (m_jobs.empty())
+                    return;
+
+                job = std::move(m_jobs.front());
+                m_jobs.pop();
+            }
+
+            const auto start = std::chrono::high_resolution_clock::now();
+            {
+                VG_PROFILE_SCOPE("Pipeline build");
+                job.task();
+            }
+            const auto end = std::chrono::high_resolution_clock::now();
+            const float duration = std::chrono::duration<float, std::milli>(end - start).count();
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_compileTimes[job.name] = duration;
+                m_jobsInFlight--;
+            }
+            m_allJobsDone.notify_all();
+        }
+    }
+}
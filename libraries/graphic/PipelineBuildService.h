@@ -0,0 +1,59 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include "Context.h"
+
+namespace vg
+{
+    // builds pipelines on worker threads. vkCreate*Pipelines is thread-safe (no pipeline cache is shared),
+    // so independent pipelines can be compiled concurrently while the main thread keeps creating resources
+    class PipelineBuildService
+    {
+    public:
+        explicit PipelineBuildService(const Context& context, uint32_t numThreads = 0);
+        ~PipelineBuildService();
+
+        PipelineBuildService(const PipelineBuildService&) = delete;
+        PipelineBuildService& operator=(const PipelineBuildService&) = delete;
+
+        // enqueue a pipeline build. the build function runs on a worker thread and has to create everything it needs
+        // (shader modules, create infos) itself. exceptions are rethrown by future.get()
+        // the compile time is kept per name, builds of the same name replace it, so permutations need names of their own
+        std::shared_future<vk::Pipeline> submit(const std::string& name, std::function<vk::Pipeline()> buildFunction);
+
+        // blocks until every submitted build is finished
+        void waitIdle();
+
+        [[nodiscard]] std::map<std::string, float> getCompileTimes() const;
+        void logCompileTimes() const;
+
+    private:
+        struct BuildJob
+        {
+            std::string name;
+            std::packaged_task<vk::Pipeline()> task;
+        };
+
+        void workerLoop();
+
+        std::reference_wrapper<const Context> m_context;
+
+        std::vector<std::thread> m_workers;
+        std::queue<BuildJob> m_jobs;
+        size_t m_jobsInFlight = 0;
+        bool m_shutdown = false;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_jobAvailable;
+        std::condition_variable m_allJobsDone;
+
+        // compile time in milliseconds per pipeline name (last build)
+        std::map<std::string, float> m_compileTimes;
+    };
+}
@@ -0,0 +1,66 @@
+#include "PipelinePermutationCache.h"
+#include <chrono>
+
+namespace vg
+{
+    PipelinePermutationCache::PipelinePermutationCache(const Context& context) : m_context(context)
+    {
+    }
+
+    PipelinePermutationCache::~PipelinePermutationCache()
+    {
+        for (auto& permutation : clear())
+        {
+            try
+            {
+                m_context.get().getDevice().destroyPipeline(permutation.get());
+            }
+            catch (const std::exception&) {}
+        }
+    }
+
+    std::shared_future<vk::Pipeline> PipelinePermutationCache::get(const SpecializationConstants& constants, const BuildFunction& build)
+    {
+        auto permutation = m_permutations.find(constants);
+        if (permutation == m_permutations.end())
+            permutation = m_permutations.emplace(constants, build(constants)).first;
+
+        return permutation->second;
+    }
+
+    vk::Pipeline PipelinePermutationCache::tryGet(const SpecializationConstants& constants, const BuildFunction& build)
+    {
+        const auto pipeline = get(constants, build);
+        if (pipeline.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return nullptr;
+
+        try
+        {
+            return pipeline.get();
+        }
+        catch (const std::exception& e)
+        {
+            // only report once, the permutation stays broken until the next clear()
+            if (m_failed.insert(constants).second)
+                m_context.get().getLogger()->error("Building a pipeline permutation failed:\n{}", e.what());
+            return nullptr;
+        }
+    }
+
+    void PipelinePermutationCache::insert(const SpecializationConstants& constants, vk::Pipeline pipeline)
+    {
+        std::promise<vk::Pipeline> built;
+        built.set_value(pipeline);
+        m_permutations[constants] = built.get_future().share();
+    }
+
+    std::vector<std::shared_future<vk::Pipeline>> PipelinePermutationCache::clear()
+    {
+        std::vector<std::shared_future<vk::Pipeline>> pipelines;
+        for (auto& [constants, pipeline] : m_permutations)
+            pipelines.push_back(std::move(pipeline));
+        m_permutations.clear();
+        m_failed.clear();
+        return pipelines;
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <functional>
+#include <future>
+#include <map>
+#include <set>
+#include <vector>
+#include "Context.h"
+#include "SpecializationConstants.h"
+
+namespace vg
+{
+    // one pipeline per set of specialization constants, built on first use and kept until clear()
+    // switching back to a permutation that was used before is free, no SPIR-V variant per combination is needed
+    class PipelinePermutationCache
+    {
+    public:
+        // usually submits to the PipelineBuildService and returns immediately
+        using BuildFunction = std::function<std::shared_future<vk::Pipeline>(const SpecializationConstants&)>;
+
+        explicit PipelinePermutationCache(const Context& context);
+        ~PipelinePermutationCache();
+
+        PipelinePermutationCache(const PipelinePermutationCache&) = delete;
+        PipelinePermutationCache& operator=(const PipelinePermutationCache&) = delete;
+
+        // starts the build if this permutation is not known yet
+        std::shared_future<vk::Pipeline> get(const SpecializationConstants& constants, const BuildFunction& build);
+
+        // non-blocking: the pipeline if it is built, nullptr while the build is still running or if it failed
+        vk::Pipeline tryGet(const SpecializationConstants& constants, const BuildFunction& build);
+
+        // adds a pipeline that was built elsewhere (e.g. by a shader reload), the cache owns it afterwards
+        void insert(const SpecializationConstants& constants, vk::Pipeline pipeline);
+
+        // forgets every permutation, e.g. after the shaders changed. the caller owns the returned pipelines
+        // and has to destroy them once no frame uses them anymore (failed builds rethrow in get())
+        [[nodiscard]] std::vector<std::shared_future<vk::Pipeline>> clear();
+
+        [[nodiscard]] size_t size() const { return m_permutations.size(); }
+
+    private:
+        std::reference_wrapper<const Context> m_context;
+
+        std::map<SpecializationConstants, std::shared_future<vk::Pipeline>> m_permutations;
+        std::set<SpecializationConstants> m_failed;
+    };
+}
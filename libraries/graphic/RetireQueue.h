@@ -0,0 +1,52 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace vg
+{
+    // defers the destruction of GPU objects until every frame that might still use them is finished
+    class RetireQueue
+    {
+    public:
+        ~RetireQueue() { flush(); }
+
+        // the deleter runs in the first collect() with a frame number >= retireFrame
+        void retire(const uint64_t retireFrame, std::function<void()> deleter)
+        {
+            m_entries.push_back({ retireFrame, std::move(deleter) });
+        }
+
+        // call after waiting on the in-flight fence of frameNumber
+        void collect(const uint64_t frameNumber)
+        {
+            const auto firstDue = std::stable_partition(m_entries.begin(), m_entries.end(), [frameNumber](const Entry& e) { return e.retireFrame > frameNumber; });
+            std::vector<Entry> due(std::make_move_iterator(firstDue), std::make_move_iterator(m_entries.end()));
+            m_entries.erase(firstDue, m_entries.end());
+
+            for (auto& entry : due)
+                entry.deleter();
+        }
+
+        // runs every deleter regardless of its frame, the device has to be idle
+        void flush()
+        {
+            auto entries = std::move(m_entries);
+            m_entries.clear();
+            for (auto& entry : entries)
+                entry.deleter();
+        }
+
+        [[nodiscard]] size_t size() const { return m_entries.size(); }
+
+    private:
+        struct Entry
+        {
+            uint64_t retireFrame;
+            std::function<void()> deleter;
+        };
+
+        std::vector<Entry> m_entries;
+    };
+}
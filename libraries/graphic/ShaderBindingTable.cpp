@@ -0,0 +1,96 @@
+#include "ShaderBindingTable.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace vg
+{
+    namespace
+    {
+        vk::DeviceSize alignUp(const vk::DeviceSize value, const vk::DeviceSize alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+    }
+
+    ShaderBindingTableBuilder::ShaderBindingTableBuilder(const vk::PhysicalDeviceRayTracingPropertiesNV& properties)
+        : m_handleSize(properties.shaderGroupHandleSize), m_baseAlignment(std::max(properties.shaderGroupBaseAlignment, 1u)), m_maxStride(properties.maxShaderGroupStride)
+    {
+        if (m_handleSize == 0)
+            throw std::runtime_error("The device reports no shader group handle size");
+    }
+
+    size_t ShaderBindingTableBuilder::addPipeline(const vk::Pipeline pipeline, Record raygen, std::vector<Record> miss, std::vector<Record> hit)
+    {
+        Pipeline entry;
+        entry.pipeline = pipeline;
+        entry.raygen = std::move(raygen);
+        entry.miss = std::move(miss);
+        entry.hit = std::move(hit);
+
+        entry.groupCount = entry.raygen.group + 1;
+        for (const auto* records : { &entry.miss, &entry.hit })
+            for (const auto& record : *records)
+                entry.groupCount = std::max(entry.groupCount, record.group + 1);
+
+        entry.region.raygenOffset = allocateTable(getStride({ entry.raygen }));
+        if (!entry.miss.empty())
+        {
+            entry.region.missStride = getStride(entry.miss);
+            entry.region.missOffset = allocateTable(entry.region.missStride * entry.miss.size());
+        }
+        if (!entry.hit.empty())
+        {
+            entry.region.hitStride = getStride(entry.hit);
+            entry.region.hitOffset = allocateTable(entry.region.hitStride * entry.hit.size());
+        }
+
+        m_pipelines.push_back(std::move(entry));
+        return m_pipelines.size() - 1;
+    }
+
+    std::vector<uint8_t> ShaderBindingTableBuilder::build(const vk::Device device) const
+    {
+        std::vector<uint8_t> data(m_size, 0);
+        std::vector<uint8_t> handles;
+        for (const auto& pipeline : m_pipelines)
+        {
+            handles.resize(static_cast<size_t>(pipeline.groupCount) * m_handleSize);
+            const auto res = device.getRayTracingShaderGroupHandlesNV(pipeline.pipeline, 0, pipeline.groupCount, handles.size(), handles.data());
+            if (res != vk::Result::eSuccess) throw std::runtime_error("Failed to retrieve Shader Group Handles");
+
+            const auto writeTable = [&](const std::vector<Record>& records, const vk::DeviceSize offset, const vk::DeviceSize stride)
+            {
+                for (size_t i = 0; i < records.size(); i++)
+                {
+                    auto* record = data.data() + offset + i * stride;
+                    std::copy_n(handles.data() + static_cast<size_t>(records.at(i).group) * m_handleSize, m_handleSize, record);
+                    std::copy(records.at(i).data.begin(), records.at(i).data.end(), record + m_handleSize);
+                }
+            };
+            writeTable({ pipeline.raygen }, pipeline.region.raygenOffset, 0);
+            writeTable(pipeline.miss, pipeline.region.missOffset, pipeline.region.missStride);
+            writeTable(pipeline.hit, pipeline.region.hitOffset, pipeline.region.hitStride);
+        }
+        return data;
+    }
+
+    vk::DeviceSize ShaderBindingTableBuilder::getStride(const std::vector<Record>& records) const
+    {
+        size_t maxDataSize = 0;
+        for (const auto& record : records)
+            maxDataSize = std::max(maxDataSize, record.data.size());
+
+        const auto stride = alignUp(m_handleSize + maxDataSize, m_handleSize);
+        if (m_maxStride != 0 && stride > m_maxStride)
+            throw std::runtime_error("Shader binding table record of " + std::to_string(stride) + " bytes is larger than the device allows");
+        return stride;
+    }
+
+    vk::DeviceSize ShaderBindingTableBuilder::allocateTable(const vk::DeviceSize size)
+    {
+        const auto offset = alignUp(m_size, m_baseAlignment);
+        m_size = offset + size;
+        return offset;
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace vg
+{
+    // lays out the shader binding tables of several ray tracing pipelines in one buffer, so they are uploaded at once.
+    // a record is the handle of a shader group followed by its inline data, which the shaders read as shaderRecordNV.
+    // every table starts at shaderGroupBaseAlignment and all records of a table have the stride of its largest record,
+    // rounded up to shaderGroupHandleSize
+    class ShaderBindingTableBuilder
+    {
+    public:
+        struct Record
+        {
+            // index into the groups the pipeline was created with
+            uint32_t group = 0;
+            std::vector<uint8_t> data;
+        };
+
+        // offsets into the shared buffer, as vkCmdTraceRaysNV takes them. a stride of 0 means there is no such table
+        struct Region
+        {
+            vk::DeviceSize raygenOffset = 0;
+            vk::DeviceSize missOffset = 0;
+            vk::DeviceSize missStride = 0;
+            vk::DeviceSize hitOffset = 0;
+            vk::DeviceSize hitStride = 0;
+        };
+
+        explicit ShaderBindingTableBuilder(const vk::PhysicalDeviceRayTracingPropertiesNV& properties);
+
+        // hit records are selected by the instanceOffset of the instance that was hit (plus the record offset and stride
+        // of traceNV), so per-geometry data needs one record per instance. returns the index of the pipeline's region
+        size_t addPipeline(vk::Pipeline pipeline, Record raygen, std::vector<Record> miss, std::vector<Record> hit = {});
+
+        // reads the group handles of every pipeline and writes all records, the result is uploaded as one buffer
+        [[nodiscard]] std::vector<uint8_t> build(vk::Device device) const;
+
+        [[nodiscard]] const Region& getRegion(const size_t pipeline) const { return m_pipelines.at(pipeline).region; }
+        [[nodiscard]] vk::DeviceSize getSize() const { return m_size; }
+
+        // the bytes of a std430 compatible struct, as inline data of a record
+        template <typename T>
+        static std::vector<uint8_t> toRecordData(const T& value);
+
+    private:
+        struct Pipeline
+        {
+            vk::Pipeline pipeline;
+            Record raygen;
+            std::vector<Record> miss;
+            std::vector<Record> hit;
+            Region region;
+            uint32_t groupCount = 0;
+        };
+
+        // the stride of a table, throws if it is larger than the device allows
+        [[nodiscard]] vk::DeviceSize getStride(const std::vector<Record>& records) const;
+        // appends a table at the next base aligned offset and returns that offset
+        vk::DeviceSize allocateTable(vk::DeviceSize size);
+
+        uint32_t m_handleSize;
+        uint32_t m_baseAlignment;
+        uint32_t m_maxStride;
+
+        std::vector<Pipeline> m_pipelines;
+        vk::DeviceSize m_size = 0;
+    };
+
+    template <typename T>
+    std::vector<uint8_t> ShaderBindingTableBuilder::toRecordData(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "record data is copied bytewise");
+        std::vector<uint8_t> data(sizeof(T));
+        std::memcpy(data.data(), &value, sizeof(T));
+        return data;
+    }
+}
@@ -0,0 +1,304 @@
+#include "ShaderCompiler.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <regex>
+#include <set>
+#include <sstream>
+#ifdef VG_RUNTIME_SHADER_COMPILATION
+#include <shaderc/shaderc.hpp>
+#endif
+
+namespace vg
+{
+    namespace
+    {
+        // 64 bit FNV-1a, chained over all parts of a key
+        uint64_t fnv1a(const std::string& data, uint64_t hash = 14695981039346656037ull)
+        {
+            for (const unsigned char c : data)
+            {
+                hash ^= c;
+                hash *= 1099511628211ull;
+            }
+            // separator, so that ("ab", "c") and ("a", "bc") hash differently
+            hash ^= 0xff;
+            hash *= 1099511628211ull;
+            return hash;
+        }
+
+        std::string toHexString(const uint64_t hash)
+        {
+            char hashString[17];
+            std::snprintf(hashString, sizeof(hashString), "%016llx", static_cast<unsigned long long>(hash));
+            return hashString;
+        }
+
+        // same include resolution as the ShaderIncluder, shaderPath is relative to g_shaderPath
+        void hashSource(const std::filesystem::path& shaderPath, std::set<std::filesystem::path>& visited, uint64_t& hash)
+        {
+            static const std::regex includeRegex(R"(^\s*#\s*include\s*[<"]([^>"]+)[>"])");
+
+            if (!visited.insert(shaderPath).second)
+                return;
+
+            std::ifstream file(g_shaderPath / shaderPath, std::ios::binary);
+            if (!file.is_open())
+                throw std::runtime_error("Failed to open shader " + (g_shaderPath / shaderPath).string());
+
+            // line endings depend on the checkout
+            std::string source;
+            for (auto it = std::istreambuf_iterator<char>(file); it != std::istreambuf_iterator<char>(); ++it)
+                if (*it != '\r')
+                    source += *it;
+            hash = fnv1a(source, hash);
+
+            std::istringstream lines(source);
+            std::string line;
+            while (std::getline(lines, line))
+            {
+                std::smatch match;
+                if (!std::regex_search(line, match, includeRegex))
+                    continue;
+
+                for (const auto& candidate : { shaderPath.parent_path() / match[1].str(), std::filesystem::path("include") / match[1].str() })
+                {
+                    if (std::filesystem::exists(g_shaderPath / candidate))
+                    {
+                        hashSource(candidate.lexically_normal(), visited, hash);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+#ifdef VG_RUNTIME_SHADER_COMPILATION
+    namespace
+    {
+        // resolves #include "..." next to the including file first, then in shaders/include
+        class ShaderIncluder : public shaderc::CompileOptions::IncluderInterface
+        {
+        public:
+            shaderc_include_result* GetInclude(const char* requestedSource, shaderc_include_type type, const char* requestingSource, size_t includeDepth) override
+            {
+                auto* data = new IncludeData;
+                data->result.user_data = data;
+
+                std::vector<std::filesystem::path> candidates;
+                if (type == shaderc_include_type_relative)
+                    candidates.push_back(std::filesystem::path(requestingSource).parent_path() / requestedSource);
+                candidates.push_back(g_shaderPath / "include" / requestedSource);
+
+                for (const auto& candidate : candidates)
+                {
+                    std::ifstream file(candidate, std::ios::binary);
+                    if (!file.is_open())
+                        continue;
+
+                    data->sourceName = candidate.lexically_normal().string();
+                    data->content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+                    break;
+                }
+
+                // an empty source name signals a failed include, the content is the error message then
+                if (data->sourceName.empty())
+                    data->content = std::string("Failed to resolve include ") + requestedSource;
+
+                data->result.source_name = data->sourceName.c_str();
+                data->result.source_name_length = data->sourceName.size();
+                data->result.content = data->content.c_str();
+                data->result.content_length = data->content.size();
+                return &data->result;
+            }
+
+            void ReleaseInclude(shaderc_include_result* data) override
+            {
+                delete static_cast<IncludeData*>(data->user_data);
+            }
+
+        private:
+            struct IncludeData
+            {
+                shaderc_include_result result{};
+                std::string sourceName;
+                std::string content;
+            };
+        };
+
+        shaderc_shader_kind shaderKindFromExtension(const std::filesystem::path& shaderPath)
+        {
+            static const std::map<std::string, shaderc_shader_kind> kinds = {
+                { ".vert", shaderc_vertex_shader },
+                { ".frag", shaderc_fragment_shader },
+                { ".comp", shaderc_compute_shader },
+                { ".geom", shaderc_geometry_shader },
+                { ".tesc", shaderc_tess_control_shader },
+                { ".tese", shaderc_tess_evaluation_shader },
+                { ".rgen", shaderc_raygen_shader },
+                { ".rchit", shaderc_closesthit_shader },
+                { ".rahit", shaderc_anyhit_shader },
+                { ".rmiss", shaderc_miss_shader },
+                { ".rint", shaderc_intersection_shader },
+                { ".rcall", shaderc_callable_shader }
+            };
+
+            const auto kind = kinds.find(shaderPath.extension().string());
+            if (kind == kinds.end())
+                throw std::runtime_error("Unknown shader stage for " + shaderPath.string());
+            return kind->second;
+        }
+
+        // part of the cache key, change this together with SetTargetEnvironment
+        const std::string g_targetEnv = "vulkan1.1";
+    }
+#endif
+
+    ShaderCompiler::ShaderCompiler(const Context& context, std::filesystem::path cacheDirectory) : m_context(context), m_cacheDirectory(std::move(cacheDirectory))
+    {
+        if (hasRuntimeCompilation())
+            std::filesystem::create_directories(m_cacheDirectory);
+        else
+            context.getLogger()->warn("Built without shaderc, shaders are loaded from the precompiled SPIR-V next to their sources");
+    }
+
+    bool ShaderCompiler::hasRuntimeCompilation()
+    {
+#ifdef VG_RUNTIME_SHADER_COMPILATION
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    std::string ShaderCompiler::sourceHash(const std::filesystem::path& shaderPath)
+    {
+        std::set<std::filesystem::path> visited;
+        uint64_t hash = 14695981039346656037ull;
+        hashSource(shaderPath.lexically_normal(), visited, hash);
+        return toHexString(hash);
+    }
+
+    std::vector<uint32_t> ShaderCompiler::compile(const std::filesystem::path& shaderPath, const std::vector<ShaderDefine>& defines)
+    {
+        const auto start = std::chrono::high_resolution_clock::now();
+
+#ifdef VG_RUNTIME_SHADER_COMPILATION
+        const auto fullPath = g_shaderPath / shaderPath;
+        std::ifstream file(fullPath, std::ios::binary);
+        if (!file.is_open())
+            throw std::runtime_error("Failed to open shader " + fullPath.string());
+        const std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        const auto kind = shaderKindFromExtension(shaderPath);
+
+        // shaderc::Compiler is cheap to create, one per call keeps this thread-safe
+        shaderc::Compiler compiler;
+        shaderc::CompileOptions options;
+        options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_1);
+        options.SetIncluder(std::make_unique<ShaderIncluder>());
+        for (const auto& define : defines)
+            options.AddMacroDefinition(define.name, define.value);
+
+        const auto preprocessed = compiler.PreprocessGlsl(source, kind, fullPath.string().c_str(), options);
+        if (preprocessed.GetCompilationStatus() != shaderc_compilation_status_success)
+            throw std::runtime_error("Failed to preprocess shader " + shaderPath.string() + ":\n" + preprocessed.GetErrorMessage());
+
+        // cache key: preprocessed source (includes and defines resolved), defines, stage and target env
+        uint64_t hash = fnv1a(std::string(preprocessed.cbegin(), preprocessed.cend()));
+        for (const auto& define : defines)
+            hash = fnv1a(define.name + "=" + define.value, hash);
+        hash = fnv1a(std::to_string(static_cast<int>(kind)), hash);
+        hash = fnv1a(g_targetEnv, hash);
+
+        const auto cacheFile = m_cacheDirectory / (shaderPath.filename().string() + "." + toHexString(hash) + ".spv");
+
+        std::vector<uint32_t> spirv;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::ifstream cached(cacheFile, std::ios::ate | std::ios::binary);
+            if (cached.is_open())
+            {
+                const auto size = static_cast<size_t>(cached.tellg());
+                if (size > 0 && size % sizeof(uint32_t) == 0)
+                {
+                    spirv.resize(size / sizeof(uint32_t));
+                    cached.seekg(0);
+                    cached.read(reinterpret_cast<char*>(spirv.data()), size);
+                }
+            }
+        }
+
+        const bool cacheHit = !spirv.empty();
+        if (!cacheHit)
+        {
+            const auto result = compiler.CompileGlslToSpv(source, kind, fullPath.string().c_str(), options);
+            if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+                throw std::runtime_error("Failed to compile shader " + shaderPath.string() + ":\n" + result.GetErrorMessage());
+            if (result.GetNumWarnings() > 0)
+                m_context.get().getLogger()->warn("Shader {} compiled with warnings:\n{}", shaderPath.string(), result.GetErrorMessage());
+
+            spirv.assign(result.cbegin(), result.cend());
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::ofstream out(cacheFile, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(spirv.data()), spirv.size() * sizeof(uint32_t));
+        }
+
+        const auto end = std::chrono::high_resolution_clock::now();
+        const float duration = std::chrono::duration<float, std::milli>(end - start).count();
+
+        if (cacheHit)
+            m_context.get().getLogger()->info("Shader {} loaded from cache in {} ms", shaderPath.string(), duration);
+        else
+            m_context.get().getLogger()->info("Shader {} compiled in {} ms", shaderPath.string(), duration);
+#else
+        // the precompiled file has no variants, defines need the runtime compiler
+        if (!defines.empty())
+            throw std::runtime_error("Shader " + shaderPath.string() + " needs defines, which requires building with shaderc");
+
+        const auto spirvPath = g_shaderPath / (shaderPath.string() + ".spv");
+
+        std::ifstream file(spirvPath, std::ios::ate | std::ios::binary);
+        if (!file.is_open())
+            throw std::runtime_error("Failed to open precompiled shader " + spirvPath.string() + ", run shaders/compile.ps1");
+
+        // a binary built from an older source would silently use an outdated interface
+        std::ifstream hashFile(g_shaderPath / (shaderPath.string() + ".spv.hash"));
+        std::string builtHash;
+        hashFile >> builtHash;
+        if (builtHash != sourceHash(shaderPath))
+            throw std::runtime_error("Precompiled shader " + spirvPath.string() + " was not built from the current source, run shaders/compile.ps1");
+
+        const auto size = static_cast<size_t>(file.tellg());
+        if (size == 0 || size % sizeof(uint32_t) != 0)
+            throw std::runtime_error("Precompiled shader " + spirvPath.string() + " is not SPIR-V");
+        std::vector<uint32_t> spirv(size / sizeof(uint32_t));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(spirv.data()), size);
+
+        const auto end = std::chrono::high_resolution_clock::now();
+        const float duration = std::chrono::duration<float, std::milli>(end - start).count();
+        m_context.get().getLogger()->info("Shader {} loaded precompiled in {} ms", shaderPath.string(), duration);
+#endif
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_compileTimes[shaderPath.string()] = duration;
+        }
+
+        return spirv;
+    }
+
+    vk::ShaderModule ShaderCompiler::createShaderModule(const std::filesystem::path& shaderPath, const std::vector<ShaderDefine>& defines)
+    {
+        return m_context.get().createShaderModule(compile(shaderPath, defines));
+    }
+
+    std::map<std::string, float> ShaderCompiler::getCompileTimes() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_compileTimes;
+    }
+}
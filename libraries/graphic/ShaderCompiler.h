@@ -0,0 +1,54 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Context.h"
+
+namespace vg
+{
+    struct ShaderDefine
+    {
+        std::string name;
+        std::string value;
+    };
+
+    // compiles GLSL to SPIR-V at runtime using shaderc
+    // results are cached on disk, keyed by a hash of the preprocessed source (includes resolved), the defines, the stage and the target env,
+    // so a shader is only recompiled if it or one of its includes changed
+    // built without shaderc, compile() loads the precompiled <shader>.spv from compile.ps1 instead and defines are not supported,
+    // it is only loaded if the <shader>.spv.hash written next to it matches sourceHash(), so a stale binary is never used
+    class ShaderCompiler
+    {
+    public:
+        explicit ShaderCompiler(const Context& context, std::filesystem::path cacheDirectory = g_shaderPath / "cache");
+
+        // shaderPath is relative to g_shaderPath, the stage is deduced from the file extension
+        // thread-safe, can be called from pipeline build jobs
+        std::vector<uint32_t> compile(const std::filesystem::path& shaderPath, const std::vector<ShaderDefine>& defines = {});
+
+        vk::ShaderModule createShaderModule(const std::filesystem::path& shaderPath, const std::vector<ShaderDefine>& defines = {});
+
+        // false if the library was built without shaderc
+        static bool hasRuntimeCompilation();
+
+        // FNV-1a over the source and its includes, visited depth first in the order they appear, each file once and
+        // without '\r', as 16 hex digits. compile.ps1 computes the same hash for the .spv.hash files
+        [[nodiscard]] static std::string sourceHash(const std::filesystem::path& shaderPath);
+
+        // time in milliseconds per shader for the last compile() call, includes preprocessing and cache lookup
+        [[nodiscard]] std::map<std::string, float> getCompileTimes() const;
+
+    private:
+        std::reference_wrapper<const Context> m_context;
+
+        std::filesystem::path m_cacheDirectory;
+
+        // guards the cache directory and the compile times
+        mutable std::mutex m_mutex;
+
+        std::map<std::string, float> m_compileTimes;
+    };
+}
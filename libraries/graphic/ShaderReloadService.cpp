@@ -0,0 +1,150 @@
+#include "ShaderReloadService.h"
+#include "ShaderCompiler.h"
+#include <chrono>
+#include <fstream>
+#include <regex>
+
+namespace vg
+{
+    ShaderReloadService::ShaderReloadService(const Context& context) : m_context(context), m_watcher(g_shaderPath)
+    {
+    }
+
+    ShaderReloadService::~ShaderReloadService()
+    {
+        // builds still running at shutdown were never applied, so nobody else owns their pipelines
+        for (auto& [name, entry] : m_entries)
+        {
+            if (!entry.pendingBuild.valid())
+                continue;
+            try
+            {
+                m_context.get().getDevice().destroyPipeline(entry.pendingBuild.get());
+            }
+            catch (const std::exception&) {}
+        }
+    }
+
+    void ShaderReloadService::registerPipeline(const std::string& name, const std::vector<std::filesystem::path>& shaders, RebuildFunction rebuild, ApplyFunction apply)
+    {
+        Entry entry;
+        entry.shaders = shaders;
+        entry.dependencies = collectDependencies(shaders);
+        entry.rebuild = std::move(rebuild);
+        entry.apply = std::move(apply);
+        m_entries[name] = std::move(entry);
+    }
+
+    void ShaderReloadService::requestReload(const std::string& name)
+    {
+        m_entries.at(name).reloadRequested = true;
+    }
+
+    void ShaderReloadService::requestReloadAll()
+    {
+        for (auto& [name, entry] : m_entries)
+            entry.reloadRequested = true;
+    }
+
+    void ShaderReloadService::update()
+    {
+        if (m_watching)
+        {
+            for (const auto& changedFile : m_watcher.pollChanges())
+            {
+                // the shader cache lives inside the shader directory as well, its .spv files never match a dependency
+                const auto relativePath = changedFile.lexically_normal().lexically_relative(g_shaderPath.lexically_normal());
+                for (auto& [name, entry] : m_entries)
+                {
+                    if (entry.dependencies.count(relativePath) > 0)
+                    {
+                        m_context.get().getLogger()->info("{} changed, reloading pipeline \"{}\"", relativePath.generic_string(), name);
+                        entry.reloadRequested = true;
+                    }
+                }
+            }
+        }
+
+        for (auto& [name, entry] : m_entries)
+        {
+            if (entry.pendingBuild.valid() && entry.pendingBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+            {
+                try
+                {
+                    entry.apply(entry.pendingBuild.get());
+                    m_context.get().getLogger()->info("Pipeline \"{}\" reloaded", name);
+                }
+                catch (const std::exception& e)
+                {
+                    m_context.get().getLogger()->error("Reloading pipeline \"{}\" failed, keeping the old one:\n{}", name, e.what());
+                }
+                entry.pendingBuild = {};
+
+                // the includes might have changed
+                entry.dependencies = collectDependencies(entry.shaders);
+            }
+
+            // changes during a build start another one after it finished
+            if (entry.reloadRequested && !entry.pendingBuild.valid())
+            {
+                entry.reloadRequested = false;
+                entry.pendingBuild = entry.rebuild();
+            }
+        }
+    }
+
+    bool ShaderReloadService::isReloadPending() const
+    {
+        for (const auto& [name, entry] : m_entries)
+            if (entry.reloadRequested || entry.pendingBuild.valid())
+                return true;
+        return false;
+    }
+
+    std::set<std::filesystem::path> ShaderReloadService::collectDependencies(const std::vector<std::filesystem::path>& shaders)
+    {
+        // same resolution order as the ShaderCompiler: next to the including file first, then shaders/include
+        static const std::regex includeRegex(R"(^\s*#\s*include\s*[<"]([^>"]+)[>"])");
+
+        std::set<std::filesystem::path> dependencies;
+        std::vector<std::filesystem::path> toVisit;
+        for (const auto& shader : shaders)
+        {
+            toVisit.push_back(shader.lexically_normal());
+            // without shaderc the pipelines are rebuilt from the precompiled files, so recompiling them offline reloads too
+            if (!ShaderCompiler::hasRuntimeCompilation())
+            {
+                dependencies.insert(std::filesystem::path(shader.string() + ".spv").lexically_normal());
+                dependencies.insert(std::filesystem::path(shader.string() + ".spv.hash").lexically_normal());
+            }
+        }
+
+        while (!toVisit.empty())
+        {
+            const auto current = toVisit.back();
+            toVisit.pop_back();
+            if (!dependencies.insert(current).second)
+                continue;
+
+            std::ifstream file(g_shaderPath / current);
+            std::string line;
+            while (std::getline(file, line))
+            {
+                std::smatch match;
+                if (!std::regex_search(line, match, includeRegex))
+                    continue;
+
+                for (const auto& candidate : { current.parent_path() / match[1].str(), std::filesystem::path("include") / match[1].str() })
+                {
+                    if (std::filesystem::exists(g_shaderPath / candidate))
+                    {
+                        toVisit.push_back(candidate.lexically_normal());
+                        break;
+                    }
+                }
+            }
+        }
+
+        return dependencies;
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "Context.h"
+#include "utility/FileWatcher.h"
+
+namespace vg
+{
+    // watches the shader directory and rebuilds the pipelines whose shaders (or includes) changed
+    // the rebuild usually runs on the PipelineBuildService, the finished pipeline is handed back in update(), i.e. at a frame boundary
+    // if a build fails (e.g. a syntax error) the error is logged and the old pipeline stays in use
+    class ShaderReloadService
+    {
+    public:
+        // starts the build of the new pipeline and returns immediately, called on the main thread
+        using RebuildFunction = std::function<std::shared_future<vk::Pipeline>()>;
+        // swaps in the finished pipeline, the app is responsible for retiring the old one
+        using ApplyFunction = std::function<void(vk::Pipeline)>;
+
+        explicit ShaderReloadService(const Context& context);
+        ~ShaderReloadService();
+
+        ShaderReloadService(const ShaderReloadService&) = delete;
+        ShaderReloadService& operator=(const ShaderReloadService&) = delete;
+
+        // shaders are paths relative to g_shaderPath, their includes are tracked automatically
+        void registerPipeline(const std::string& name, const std::vector<std::filesystem::path>& shaders, RebuildFunction rebuild, ApplyFunction apply);
+
+        // rebuild without a file change, e.g. from the GUI
+        void requestReload(const std::string& name);
+        void requestReloadAll();
+
+        // call once per frame on the main thread before recording
+        void update();
+
+        void setWatching(bool watching) { m_watching = watching; }
+        [[nodiscard]] bool isWatching() const { return m_watching; }
+
+        [[nodiscard]] bool isReloadPending() const;
+
+    private:
+        struct Entry
+        {
+            std::vector<std::filesystem::path> shaders;
+            std::set<std::filesystem::path> dependencies;
+            RebuildFunction rebuild;
+            ApplyFunction apply;
+            std::shared_future<vk::Pipeline> pendingBuild;
+            bool reloadRequested = false;
+        };
+
+        // shaders and everything they #include, relative to g_shaderPath
+        static std::set<std::filesystem::path> collectDependencies(const std::vector<std::filesystem::path>& shaders);
+
+        std::reference_wrapper<const Context> m_context;
+
+        FileWatcher m_watcher;
+        bool m_watching = true;
+
+        std::map<std::string, Entry> m_entries;
+    };
+}
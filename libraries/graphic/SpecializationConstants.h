@@ -0,0 +1,68 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace vg
+{
+    // constant_ids shared by all shaders, see shaders/include/materialLayout.glsl and pbrLight.glsl
+    enum class SpecConstant : uint32_t
+    {
+        NumTextures = 0,
+        MaterialChannelLayout = 1,
+        NumDirLights = 2,
+        NumPointLights = 3,
+        NumSpotLights = 4,
+        LowResReflections = 5
+    };
+
+    // where the metallic/roughness texture stores metalness
+    enum class MaterialChannelLayout : int32_t
+    {
+        GLTF = 0,   // metalness in x
+        FBX = 1     // metalness in z
+    };
+
+    // a set of int32 specialization constants. the same set can be passed to every stage of a pipeline,
+    // map entries for ids a shader doesn't declare are ignored by the driver
+    class SpecializationConstants
+    {
+    public:
+        SpecializationConstants& set(const SpecConstant id, const int32_t value)
+        {
+            m_values[static_cast<uint32_t>(id)] = value;
+
+            m_entries.clear();
+            m_data.clear();
+            for (const auto& [constantId, constantValue] : m_values)
+            {
+                m_entries.emplace_back(constantId, static_cast<uint32_t>(m_data.size() * sizeof(int32_t)), sizeof(int32_t));
+                m_data.push_back(constantValue);
+            }
+            return *this;
+        }
+
+        [[nodiscard]] int32_t get(const SpecConstant id) const
+        {
+            return m_values.at(static_cast<uint32_t>(id));
+        }
+
+        // points into this object, so it has to stay alive until the pipeline is created
+        [[nodiscard]] vk::SpecializationInfo info() const
+        {
+            return vk::SpecializationInfo(static_cast<uint32_t>(m_entries.size()), m_entries.data(), m_data.size() * sizeof(int32_t), m_data.data());
+        }
+
+        bool operator<(const SpecializationConstants& other) const { return m_values < other.m_values; }
+        bool operator==(const SpecializationConstants& other) const { return m_values == other.m_values; }
+        bool operator!=(const SpecializationConstants& other) const { return !(*this == other); }
+
+    private:
+        std::map<uint32_t, int32_t> m_values;
+
+        // m_values in the layout vk::SpecializationInfo expects
+        std::vector<vk::SpecializationMapEntry> m_entries;
+        std::vector<int32_t> m_data;
+    };
+}
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstring>
 #include <set>
 #define GLFW_INCLUDE_VULKAN
 #include "Context.h"
@@ -101,7 +103,8 @@ VkResult vkGetRayTracingShaderGroupHandlesNV(VkDevice device, VkPipeline pipelin
 namespace vg
 {
 
-	Context::Context(const std::vector<const char*>& requiredDeviceExtensions) : m_requiredDeviceExtensions(requiredDeviceExtensions)
+	Context::Context(const std::vector<const char*>& requiredDeviceExtensions, const std::vector<const char*>& optionalDeviceExtensions)
+        : m_requiredDeviceExtensions(requiredDeviceExtensions), m_optionalDeviceExtensions(optionalDeviceExtensions)
     {
 		// init logger
 		m_logger = spdlog::stdout_color_mt("standard");
@@ -428,11 +431,28 @@ namespace vg
         deviceFeatures.fragmentStoresAndAtomics = VK_TRUE;
         deviceFeatures.multiDrawIndirect = VK_TRUE;
         deviceFeatures.shaderStorageImageExtendedFormats = VK_TRUE;
+        // optional, per-pass pipeline statistics are skipped without it
+        deviceFeatures.pipelineStatisticsQuery = m_phsyicalDevice.getFeatures().pipelineStatisticsQuery;
+        m_enabledFeatures = deviceFeatures;
+
+        m_enabledDeviceExtensions = m_requiredDeviceExtensions;
+        const auto availableExtensions = m_phsyicalDevice.enumerateDeviceExtensionProperties();
+        for (const auto optionalExtension : m_optionalDeviceExtensions)
+        {
+            const bool supported = std::any_of(availableExtensions.begin(), availableExtensions.end(), [optionalExtension](const vk::ExtensionProperties& extension)
+            {
+                return strcmp(extension.extensionName, optionalExtension) == 0;
+            });
+            if (supported)
+                m_enabledDeviceExtensions.push_back(optionalExtension);
+            else
+                m_logger->info("Optional device extension {} is not supported", optionalExtension);
+        }
 
         vk::DeviceCreateInfo createInfo({},
             static_cast<uint32_t>(queueCreateInfos.size()), queueCreateInfos.data(),
             0, nullptr,
-            static_cast<uint32_t>(m_requiredDeviceExtensions.size()), m_requiredDeviceExtensions.data(), &deviceFeatures);
+            static_cast<uint32_t>(m_enabledDeviceExtensions.size()), m_enabledDeviceExtensions.data(), &deviceFeatures);
 
         if constexpr (g_enableValidationLayers)
         {
@@ -447,6 +467,17 @@ namespace vg
         m_graphicsQueue = m_device.getQueue(indices.graphicsFamily.value(), 0);
         m_transferQueue = m_device.getQueue(indices.transferFamily.value(), 0);
         m_computeQueue = m_device.getQueue(indices.computeFamily.value(), 0);
+
+        m_timestampPeriod = m_phsyicalDevice.getProperties().limits.timestampPeriod;
+        m_timestampValidBits = m_phsyicalDevice.getQueueFamilyProperties().at(indices.graphicsFamily.value()).timestampValidBits;
+    }
+
+    bool Context::isDeviceExtensionEnabled(const char* extensionName) const
+    {
+        return std::any_of(m_enabledDeviceExtensions.begin(), m_enabledDeviceExtensions.end(), [extensionName](const char* extension)
+        {
+            return strcmp(extension, extensionName) == 0;
+        });
     }
 
     void Context::createSurface()
@@ -510,7 +541,7 @@ namespace vg
         }
     }
 
-    void Context::createSwapChain()
+    void Context::createSwapChain(vk::SwapchainKHR oldSwapchain)
     {
         auto swapChainSupport = querySwapChainSupport(m_phsyicalDevice);
 
@@ -544,7 +575,7 @@ namespace vg
         createInfo.compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque;
         createInfo.presentMode = presentMode;
         createInfo.clipped = true;
-        createInfo.oldSwapchain = nullptr;
+        createInfo.oldSwapchain = oldSwapchain;
 
         m_swapchain = m_device.createSwapchainKHR(createInfo);
         m_swapChainImages = m_device.getSwapchainImagesKHR(m_swapchain);
@@ -569,6 +600,12 @@ namespace vg
         return m_device.createShaderModule(createInfo);
     }
 
+    vk::ShaderModule Context::createShaderModule(const std::vector<uint32_t>& code) const
+    {
+        vk::ShaderModuleCreateInfo createInfo({}, code.size() * sizeof(uint32_t), code.data());
+        return m_device.createShaderModule(createInfo);
+    }
+
     void Context::initImgui()
     {
         ImGui::CreateContext();
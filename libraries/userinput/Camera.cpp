@@ -25,6 +25,12 @@ void Camera::reset()
     m_oldY = m_height / 2.f;
 }
 
+void Camera::setExtent(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+}
+
 void Camera::update(GLFWwindow* window)
 {
     if (ImGui::GetCurrentContext() && !ImGui::GetIO().WantCaptureMouse)
@@ -112,6 +118,16 @@ void Camera::setPhi(float phi)
     m_hasChanged = true;
 }
 
+float Camera::getTheta() const
+{
+    return m_theta;
+}
+
+float Camera::getPhi() const
+{
+    return m_phi;
+}
+
 void Camera::setSensitivity(float sensitivity)
 {
     m_sensitivity = sensitivity;
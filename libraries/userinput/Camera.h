@@ -65,8 +65,12 @@ public:
     void setPosition(glm::vec3 pos);
 	void setTheta(float theta);
 	void setPhi(float phi);
+    float getTheta() const;
+    float getPhi() const;
     void setSensitivity(float sensitivity);
     void setSensitivityFromBBox(glm::mat2x4 bbox);
+    // window size in pixels, e.g. after a resize. takes effect on the next reset
+    void setExtent(int width, int height);
     bool hasChanged() const;
     void resetChangeFlag();
 
@@ -15,6 +15,14 @@ public:
     void reset() override;
 
     void setDirection(glm::vec3 dir);
+
+    /**
+     * \brief Places the camera without input, e.g. for scripted camera paths
+     * \param pos position
+     * \param theta polar angle of the view direction, as in update()
+     * \param phi azimuth of the view direction, as in update()
+     */
+    void setPose(glm::vec3 pos, float theta, float phi);
     glm::vec3 getDirection() const override;
 
 private:
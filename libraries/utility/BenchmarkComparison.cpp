@@ -0,0 +1,357 @@
+#include "BenchmarkComparison.h"
+#include "TimerLogFile.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+namespace
+{
+    // just enough JSON for the reports: objects, arrays, numbers, strings and literals
+    struct JsonValue
+    {
+        enum class Type { Null, Bool, Number, String, Array, Object };
+        Type type = Type::Null;
+        double number = 0.0;
+        std::string string;
+        std::vector<JsonValue> elements;
+        // object members, keys[i] belongs to elements[i]
+        std::vector<std::string> keys;
+
+        [[nodiscard]] const JsonValue* find(const std::string& key) const
+        {
+            for (size_t i = 0; i < keys.size(); i++)
+            {
+                if (keys.at(i) == key)
+                    return &elements.at(i);
+            }
+            return nullptr;
+        }
+    };
+
+    class JsonReader
+    {
+    public:
+        explicit JsonReader(const std::string& text) : m_text(text) {}
+
+        JsonValue parse()
+        {
+            auto value = parseValue();
+            skipWhitespace();
+            if (m_pos != m_text.size())
+                fail("trailing characters");
+            return value;
+        }
+
+    private:
+        [[noreturn]] void fail(const std::string& reason) const
+        {
+            throw std::runtime_error("Invalid JSON at offset " + std::to_string(m_pos) + ": " + reason);
+        }
+
+        void skipWhitespace()
+        {
+            while (m_pos < m_text.size() && std::isspace(static_cast<unsigned char>(m_text.at(m_pos))))
+                m_pos++;
+        }
+
+        bool consume(const char c)
+        {
+            skipWhitespace();
+            if (m_pos < m_text.size() && m_text.at(m_pos) == c)
+            {
+                m_pos++;
+                return true;
+            }
+            return false;
+        }
+
+        void expect(const char c)
+        {
+            if (!consume(c))
+                fail(std::string("expected '") + c + "'");
+        }
+
+        JsonValue parseValue()
+        {
+            skipWhitespace();
+            if (m_pos >= m_text.size())
+                fail("unexpected end");
+
+            JsonValue value;
+            const char c = m_text.at(m_pos);
+            if (c == '{')
+            {
+                m_pos++;
+                value.type = JsonValue::Type::Object;
+                if (consume('}'))
+                    return value;
+                do
+                {
+                    skipWhitespace();
+                    value.keys.push_back(parseString());
+                    expect(':');
+                    value.elements.push_back(parseValue());
+                } while (consume(','));
+                expect('}');
+            }
+            else if (c == '[')
+            {
+                m_pos++;
+                value.type = JsonValue::Type::Array;
+                if (consume(']'))
+                    return value;
+                do
+                {
+                    value.elements.push_back(parseValue());
+                } while (consume(','));
+                expect(']');
+            }
+            else if (c == '"')
+            {
+                value.type = JsonValue::Type::String;
+                value.string = parseString();
+            }
+            else if (m_text.compare(m_pos, 4, "true") == 0 || m_text.compare(m_pos, 5, "false") == 0)
+            {
+                value.type = JsonValue::Type::Bool;
+                value.number = c == 't' ? 1.0 : 0.0;
+                m_pos += c == 't' ? 4 : 5;
+            }
+            else if (m_text.compare(m_pos, 4, "null") == 0)
+            {
+                m_pos += 4;
+            }
+            else
+            {
+                value.type = JsonValue::Type::Number;
+                const char* begin = m_text.c_str() + m_pos;
+                char* end = nullptr;
+                value.number = std::strtod(begin, &end);
+                if (end == begin)
+                    fail("unexpected character");
+                m_pos += static_cast<size_t>(end - begin);
+            }
+            return value;
+        }
+
+        // escapes are kept as the escaped character, the reports only escape quotes and backslashes
+        std::string parseString()
+        {
+            if (m_pos >= m_text.size() || m_text.at(m_pos) != '"')
+                fail("expected a string");
+            m_pos++;
+
+            std::string result;
+            while (m_pos < m_text.size() && m_text.at(m_pos) != '"')
+            {
+                if (m_text.at(m_pos) == '\\')
+                    m_pos++;
+                if (m_pos < m_text.size())
+                    result += m_text.at(m_pos++);
+            }
+            if (m_pos >= m_text.size())
+                fail("unterminated string");
+            m_pos++;
+            return result;
+        }
+
+        const std::string& m_text;
+        size_t m_pos = 0;
+    };
+
+    std::vector<float> readSamples(const JsonValue* series)
+    {
+        std::vector<float> samples;
+        if (series == nullptr)
+            return samples;
+        if (const auto* array = series->find("samples"); array != nullptr)
+        {
+            for (const auto& element : array->elements)
+                samples.push_back(static_cast<float>(element.number));
+        }
+        return samples;
+    }
+
+    BenchmarkComparison::Samples loadReport(const std::filesystem::path& path)
+    {
+        std::ifstream file(path);
+        if (!file.is_open())
+            throw std::runtime_error("Failed to open " + path.string());
+        std::stringstream text;
+        text << file.rdbuf();
+        const auto report = JsonReader(text.str()).parse();
+
+        BenchmarkComparison::Samples samples;
+        for (const auto& name : { "cpuFrameTime", "gpuFrameTime" })
+        {
+            if (auto series = readSamples(report.find(name)); !series.empty())
+                samples[name] = std::move(series);
+        }
+        if (const auto* passes = report.find("gpuPasses"); passes != nullptr)
+        {
+            for (size_t i = 0; i < passes->keys.size(); i++)
+            {
+                if (auto series = readSamples(&passes->elements.at(i)); !series.empty())
+                    samples[passes->keys.at(i)] = std::move(series);
+            }
+        }
+        return samples;
+    }
+
+    // one file per timer, named by TimerLogFile, one "value," per line
+    BenchmarkComparison::Samples loadCsvFolder(const std::filesystem::path& path)
+    {
+        BenchmarkComparison::Samples samples;
+        for (const auto& entry : std::filesystem::directory_iterator(path))
+        {
+            if (!entry.is_regular_file() || entry.path().extension() != ".csv")
+                continue;
+
+            const auto name = TimerLogFile::toTimerName(entry.path().stem().string());
+            std::ifstream file(entry.path());
+            std::string line;
+            std::vector<float> series;
+            while (std::getline(file, line))
+            {
+                if (!line.empty() && std::isdigit(static_cast<unsigned char>(line.front())))
+                    series.push_back(std::stof(line));
+            }
+            if (!series.empty())
+                samples[name] = std::move(series);
+        }
+        return samples;
+    }
+
+    double percentile(std::vector<double>& values, const double p)
+    {
+        const auto index = static_cast<size_t>(std::clamp(p * static_cast<double>(values.size() - 1) + 0.5, 0.0, static_cast<double>(values.size() - 1)));
+        std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index), values.end());
+        return values.at(index);
+    }
+}
+
+BenchmarkComparison::Samples BenchmarkComparison::load(const std::filesystem::path& path)
+{
+    auto samples = std::filesystem::is_directory(path) ? loadCsvFolder(path) : loadReport(path);
+    if (samples.empty())
+        throw std::runtime_error("No samples in " + path.string());
+    return samples;
+}
+
+std::vector<BenchmarkComparison::Result> BenchmarkComparison::compare(const Samples& baseline, const Samples& candidate, const Settings& settings)
+{
+    std::vector<Result> results;
+    for (const auto& [name, a] : baseline)
+    {
+        const auto it = candidate.find(name);
+        if (it == candidate.end() || a.empty() || it->second.empty())
+            continue;
+        const auto& b = it->second;
+
+        Result result;
+        result.name = name;
+        result.baselineCount = a.size();
+        result.candidateCount = b.size();
+        result.baselineMedian = median(a);
+        result.candidateMedian = median(b);
+        result.delta = result.candidateMedian - result.baselineMedian;
+        result.relativeDelta = result.baselineMedian > 0.0 ? result.delta / result.baselineMedian : 0.0;
+        std::tie(result.deltaLow, result.deltaHigh) = bootstrapMedianDelta(a, b, settings.bootstrapIterations, settings.confidence, settings.seed);
+        result.pValue = mannWhitneyU(a, b);
+
+        const bool significant = result.pValue < settings.alpha;
+        result.regression = significant && result.relativeDelta > settings.threshold && result.deltaLow > 0.0;
+        result.improvement = significant && result.relativeDelta < -settings.threshold && result.deltaHigh < 0.0;
+        results.push_back(result);
+    }
+    return results;
+}
+
+double BenchmarkComparison::median(std::vector<float> samples)
+{
+    if (samples.empty())
+        return 0.0;
+
+    const auto middle = samples.begin() + static_cast<std::ptrdiff_t>(samples.size() / 2);
+    std::nth_element(samples.begin(), middle, samples.end());
+    if (samples.size() % 2 == 1)
+        return *middle;
+    return 0.5 * (static_cast<double>(*middle) + *std::max_element(samples.begin(), middle));
+}
+
+double BenchmarkComparison::mannWhitneyU(const std::vector<float>& a, const std::vector<float>& b)
+{
+    if (a.empty() || b.empty())
+        return 1.0;
+
+    // rank both samples together, ties get the mean of their ranks
+    std::vector<std::pair<float, bool>> all;
+    all.reserve(a.size() + b.size());
+    for (const float x : a)
+        all.emplace_back(x, true);
+    for (const float x : b)
+        all.emplace_back(x, false);
+    std::sort(all.begin(), all.end(), [](const auto& l, const auto& r) { return l.first < r.first; });
+
+    double rankSumA = 0.0;
+    double tieCorrection = 0.0;
+    for (size_t i = 0; i < all.size();)
+    {
+        size_t j = i;
+        while (j < all.size() && all.at(j).first == all.at(i).first)
+            j++;
+
+        const double rank = 0.5 * static_cast<double>(i + 1 + j);
+        for (size_t k = i; k < j; k++)
+        {
+            if (all.at(k).second)
+                rankSumA += rank;
+        }
+        const auto ties = static_cast<double>(j - i);
+        tieCorrection += ties * ties * ties - ties;
+        i = j;
+    }
+
+    const auto n1 = static_cast<double>(a.size());
+    const auto n2 = static_cast<double>(b.size());
+    const auto n = n1 + n2;
+    const double u = rankSumA - n1 * (n1 + 1.0) / 2.0;
+    const double mean = n1 * n2 / 2.0;
+    const double variance = n1 * n2 / 12.0 * ((n + 1.0) - tieCorrection / (n * (n - 1.0)));
+    if (variance <= 0.0)
+        return 1.0;
+
+    const double z = std::max(0.0, std::abs(u - mean) - 0.5) / std::sqrt(variance);
+    return std::erfc(z / std::sqrt(2.0));
+}
+
+std::pair<double, double> BenchmarkComparison::bootstrapMedianDelta(const std::vector<float>& a, const std::vector<float>& b, const uint32_t iterations, const double confidence, const uint32_t seed)
+{
+    if (a.empty() || b.empty() || iterations == 0)
+        return { 0.0, 0.0 };
+
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<size_t> pickA(0, a.size() - 1);
+    std::uniform_int_distribution<size_t> pickB(0, b.size() - 1);
+
+    std::vector<float> resampleA(a.size());
+    std::vector<float> resampleB(b.size());
+    std::vector<double> deltas(iterations);
+    for (auto& delta : deltas)
+    {
+        for (auto& x : resampleA)
+            x = a.at(pickA(generator));
+        for (auto& x : resampleB)
+            x = b.at(pickB(generator));
+        delta = median(resampleB) - median(resampleA);
+    }
+
+    const double tail = (1.0 - confidence) / 2.0;
+    return { percentile(deltas, tail), percentile(deltas, 1.0 - tail) };
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+// tells regressions from noise between two benchmark runs
+// per series (CPU frame, GPU frame, every pass) the medians are compared, a bootstrap gives the confidence
+// interval of the difference and a Mann-Whitney U test whether the distributions differ at all. frame times are
+// skewed and have outliers, so neither means nor a t-test are used
+class BenchmarkComparison
+{
+public:
+    // milliseconds per frame, by series name
+    using Samples = std::map<std::string, std::vector<float>>;
+
+    struct Settings
+    {
+        // smallest relative slowdown of the median that counts, 0.05 = 5%
+        float threshold = 0.05f;
+        // significance level of the Mann-Whitney test
+        double alpha = 0.01;
+        // of the bootstrap interval
+        double confidence = 0.95;
+        uint32_t bootstrapIterations = 2000;
+        uint32_t seed = 1;
+    };
+
+    struct Result
+    {
+        std::string name;
+        size_t baselineCount = 0;
+        size_t candidateCount = 0;
+        double baselineMedian = 0.0;
+        double candidateMedian = 0.0;
+        // candidate - baseline, positive is slower
+        double delta = 0.0;
+        double relativeDelta = 0.0;
+        double deltaLow = 0.0;
+        double deltaHigh = 0.0;
+        double pValue = 1.0;
+        // significant, above the threshold and the whole interval on the same side
+        bool regression = false;
+        bool improvement = false;
+    };
+
+    // a report written by BenchmarkRunner (.json) or a folder of the CSVs written by the timers
+    // ("Write Timediffs to file"), throws if neither can be read
+    static Samples load(const std::filesystem::path& path);
+
+    // only series present in both runs are compared
+    static std::vector<Result> compare(const Samples& baseline, const Samples& candidate, const Settings& settings);
+
+    static double median(std::vector<float> samples);
+
+    // two-sided p-value, normal approximation with tie and continuity correction
+    static double mannWhitneyU(const std::vector<float>& a, const std::vector<float>& b);
+
+    // percentile interval of median(b) - median(a) over resamples of both
+    static std::pair<double, double> bootstrapMedianDelta(const std::vector<float>& a, const std::vector<float>& b, uint32_t iterations, double confidence, uint32_t seed);
+};
@@ -0,0 +1,287 @@
+#include "BenchmarkRunner.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <stdexcept>
+#include "CpuProfiler.h"
+
+namespace
+{
+    std::string escapeJson(const std::string& text)
+    {
+        std::string escaped;
+        escaped.reserve(text.size());
+        for (const char c : text)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            if (static_cast<unsigned char>(c) >= 0x20)
+                escaped += c;
+        }
+        return escaped;
+    }
+
+    std::string quoted(const std::string& text)
+    {
+        return "\"" + escapeJson(text) + "\"";
+    }
+
+    // linear interpolation between the closest ranks, samples have to be sorted
+    double percentile(const std::vector<float>& sorted, const double p)
+    {
+        const double rank = p * static_cast<double>(sorted.size() - 1);
+        const auto lower = static_cast<size_t>(rank);
+        const auto upper = std::min(lower + 1, sorted.size() - 1);
+        return sorted.at(lower) + (rank - static_cast<double>(lower)) * (sorted.at(upper) - sorted.at(lower));
+    }
+
+    // exact summary and all samples in measurement order
+    void writeSeries(std::ostream& out, const std::vector<float>& samples)
+    {
+        out << "{\"count\":" << samples.size();
+        if (!samples.empty())
+        {
+            auto sorted = samples;
+            std::sort(sorted.begin(), sorted.end());
+            const double mean = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+            double variance = 0.0;
+            for (const float sample : samples)
+                variance += (sample - mean) * (sample - mean);
+            variance /= static_cast<double>(samples.size());
+
+            out << ",\"min\":" << sorted.front() << ",\"max\":" << sorted.back() << ",\"mean\":" << mean << ",\"stddev\":" << std::sqrt(variance)
+                << ",\"p50\":" << percentile(sorted, 0.50) << ",\"p95\":" << percentile(sorted, 0.95) << ",\"p99\":" << percentile(sorted, 0.99);
+        }
+        out << ",\"samples\":[";
+        for (size_t i = 0; i < samples.size(); i++)
+            out << (i == 0 ? "" : ",") << samples.at(i);
+        out << "]}";
+    }
+
+    template <typename T>
+    T parseNumber(const std::string& argument, const std::string& value)
+    {
+        try
+        {
+            size_t end = 0;
+            const double number = std::stod(value, &end);
+            if (end != value.size() || number < 0.0)
+                throw std::invalid_argument(value);
+            return static_cast<T>(number);
+        }
+        catch (const std::logic_error&)
+        {
+            throw std::runtime_error("Invalid value \"" + value + "\" for " + argument);
+        }
+    }
+}
+
+std::optional<BenchmarkOptions> BenchmarkOptions::parse(const int argc, char* argv[])
+{
+    BenchmarkOptions options;
+    bool benchmark = false;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string argument = argv[i];
+        if (i + 1 >= argc)
+            throw std::runtime_error("Missing value for " + argument);
+        const std::string value = argv[++i];
+
+        if (argument == "--benchmark")
+        {
+            options.script = value;
+            benchmark = true;
+        }
+        else if (argument == "--scene")
+            options.scene = value;
+        else if (argument == "--warmup")
+            options.warmupFrames = parseNumber<uint32_t>(argument, value);
+        else if (argument == "--frames")
+            options.measuredFrames = parseNumber<uint32_t>(argument, value);
+        else if (argument == "--timestep")
+            options.timestep = parseNumber<double>(argument, value);
+        else if (argument == "--output")
+            options.output = value;
+        else if (argument == "--label")
+            options.label = value;
+        else if (argument == "--blas-partition")
+            options.blasPartition = value;
+        else
+            throw std::runtime_error("Unknown argument " + argument);
+    }
+
+    if (!benchmark)
+        return std::nullopt;
+    if (options.measuredFrames == 0 || options.timestep <= 0.0)
+        throw std::runtime_error("A benchmark needs at least one frame and a positive timestep");
+    return options;
+}
+
+BenchmarkRunner::BenchmarkRunner(BenchmarkOptions options, std::string application)
+    : m_options(std::move(options)), m_application(std::move(application)), m_script(BenchmarkScript::load(m_options.script))
+{
+}
+
+const std::string& BenchmarkRunner::getScene() const
+{
+    return m_options.scene.empty() ? m_script.getScene() : m_options.scene;
+}
+
+void BenchmarkRunner::beginFrame(const uint64_t frameNumber)
+{
+    if (!m_firstFrame.has_value())
+        m_firstFrame = frameNumber;
+    m_currentFrame = frameNumber;
+
+    // the scope statistics of the report only cover the measured frames
+    if (m_currentFrame - m_firstFrame.value() == m_options.warmupFrames)
+        CpuProfiler::resetStatistics();
+}
+
+double BenchmarkRunner::getTime() const
+{
+    return m_firstFrame.has_value() ? static_cast<double>(m_currentFrame - m_firstFrame.value()) * m_options.timestep : 0.0;
+}
+
+bool BenchmarkRunner::isMeasuring() const
+{
+    return isMeasured(m_currentFrame);
+}
+
+bool BenchmarkRunner::isMeasured(const uint64_t frameNumber) const
+{
+    if (!m_firstFrame.has_value() || frameNumber < m_firstFrame.value())
+        return false;
+    const auto index = frameNumber - m_firstFrame.value();
+    return index >= m_options.warmupFrames && index < static_cast<uint64_t>(m_options.warmupFrames) + m_options.measuredFrames;
+}
+
+bool BenchmarkRunner::isFinished() const
+{
+    return m_firstFrame.has_value() && m_currentFrame - m_firstFrame.value() >= static_cast<uint64_t>(m_options.warmupFrames) + m_options.measuredFrames + s_drainFrames;
+}
+
+void BenchmarkRunner::addCpuFrameTime(const uint64_t frameNumber, const float milliseconds)
+{
+    if (isMeasured(frameNumber))
+        m_cpuFrameTimes.push_back(milliseconds);
+}
+
+void BenchmarkRunner::addGpuTimes(const uint64_t frameNumber, const std::map<std::string, float>& passMilliseconds)
+{
+    if (!isMeasured(frameNumber))
+        return;
+
+    auto& frameTime = m_gpuFrameTimes[frameNumber];
+    for (const auto& [name, milliseconds] : passMilliseconds)
+    {
+        m_gpuPassTimes[name].push_back(milliseconds);
+        // nested timers ("parent/child") are already part of their parent
+        if (name.find('/') == std::string::npos)
+            frameTime += milliseconds;
+    }
+}
+
+void BenchmarkRunner::addPipelineStatistics(const uint64_t frameNumber, const std::string& pass, const std::map<std::string, uint64_t>& counters)
+{
+    if (!isMeasured(frameNumber))
+        return;
+
+    for (const auto& [name, value] : counters)
+    {
+        auto& summary = m_pipelineStatistics[pass][name];
+        summary.min = std::min(summary.min, value);
+        summary.max = std::max(summary.max, value);
+        summary.sum += static_cast<double>(value);
+        summary.count++;
+    }
+}
+
+void BenchmarkRunner::addMemorySample(const MemoryStats& stats)
+{
+    m_lastMemory = stats;
+    m_peakUsedBytes = std::max(m_peakUsedBytes, stats.usedBytes);
+}
+
+bool BenchmarkRunner::writeReport(const std::filesystem::path& path) const
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+        return false;
+
+    file << std::fixed << std::setprecision(4);
+    file << "{\n";
+    file << "\"application\":" << quoted(m_application) << ",\n";
+    file << "\"label\":" << quoted(m_options.label) << ",\n";
+    file << "\"script\":" << quoted(m_options.script.generic_string()) << ",\n";
+    file << "\"scene\":" << quoted(getScene()) << ",\n";
+    file << "\"timestamp\":" << std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count() << ",\n";
+    file << "\"warmupFrames\":" << m_options.warmupFrames << ",\"measuredFrames\":" << m_options.measuredFrames << ",\"timestep\":" << m_options.timestep << ",\n";
+    file << "\"device\":{\"name\":" << quoted(m_deviceInfo.name) << ",\"driverVersion\":" << quoted(m_deviceInfo.driverVersion) << ",\"apiVersion\":" << quoted(m_deviceInfo.apiVersion) << "},\n";
+    file << "\"resolution\":{\"width\":" << m_width << ",\"height\":" << m_height << "},\n";
+    file << "\"accelerationStructure\":{\"partition\":" << quoted(m_accelerationStructureStats.partition) << ",\"bottomLevelCount\":" << m_accelerationStructureStats.bottomLevelCount
+        << ",\"instanceCount\":" << m_accelerationStructureStats.instanceCount << ",\"bottomLevelBytes\":" << m_accelerationStructureStats.bottomLevelBytes
+        << ",\"topLevelBytes\":" << m_accelerationStructureStats.topLevelBytes << ",\"buildMilliseconds\":" << m_accelerationStructureStats.buildMilliseconds << "},\n";
+
+    file << "\"cpuFrameTime\":";
+    writeSeries(file, m_cpuFrameTimes);
+    file << ",\n";
+
+    std::vector<float> gpuFrameTimes;
+    gpuFrameTimes.reserve(m_gpuFrameTimes.size());
+    for (const auto& [frame, milliseconds] : m_gpuFrameTimes)
+        gpuFrameTimes.push_back(milliseconds);
+    file << "\"gpuFrameTime\":";
+    writeSeries(file, gpuFrameTimes);
+    file << ",\n";
+
+    file << "\"gpuPasses\":{";
+    bool first = true;
+    for (const auto& [name, samples] : m_gpuPassTimes)
+    {
+        file << (first ? "\n" : ",\n") << quoted(name) << ":";
+        writeSeries(file, samples);
+        first = false;
+    }
+    file << "},\n";
+
+    // per frame sums from the profiler, without samples
+    file << "\"cpuScopes\":{";
+    first = true;
+    for (const auto& scope : CpuProfiler::getScopeStatistics())
+    {
+        const auto summary = scope.statistics.getSummary();
+        if (summary.count == 0)
+            continue;
+        file << (first ? "\n" : ",\n") << quoted(scope.name) << ":{\"count\":" << summary.count << ",\"min\":" << summary.min << ",\"max\":" << summary.max
+            << ",\"mean\":" << summary.mean << ",\"stddev\":" << summary.stddev << ",\"p50\":" << summary.p50 << ",\"p95\":" << summary.p95 << ",\"p99\":" << summary.p99 << "}";
+        first = false;
+    }
+    file << "},\n";
+    // counts per frame, without samples
+    file << "\"pipelineStatistics\":{";
+    first = true;
+    for (const auto& [pass, counters] : m_pipelineStatistics)
+    {
+        file << (first ? "\n" : ",\n") << quoted(pass) << ":{";
+        bool firstCounter = true;
+        for (const auto& [name, summary] : counters)
+        {
+            file << (firstCounter ? "" : ",") << quoted(name) << ":{\"count\":" << summary.count << ",\"min\":" << summary.min << ",\"max\":" << summary.max
+                << ",\"mean\":" << summary.sum / static_cast<double>(summary.count) << "}";
+            firstCounter = false;
+        }
+        file << "}";
+        first = false;
+    }
+    file << "},\n";
+    file << "\"droppedProfilerEvents\":" << CpuProfiler::getDroppedEventCount() << ",\n";
+
+    file << "\"memory\":{\"peakUsedBytes\":" << m_peakUsedBytes << ",\"usedBytes\":" << m_lastMemory.usedBytes << ",\"unusedBytes\":" << m_lastMemory.unusedBytes
+        << ",\"allocationCount\":" << m_lastMemory.allocationCount << ",\"blockCount\":" << m_lastMemory.blockCount << "}\n";
+    file << "}\n";
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+#include "BenchmarkScript.h"
+
+// command line of the benchmark mode:
+//   --benchmark <script> [--scene <path>] [--warmup <frames>] [--frames <frames>] [--timestep <seconds>]
+//   [--output <report.json>] [--label <text>] [--blas-partition <policy>]
+struct BenchmarkOptions
+{
+    std::filesystem::path script;
+    // overrides the scene of the script
+    std::string scene;
+    uint32_t warmupFrames = 100;
+    uint32_t measuredFrames = 1000;
+    // simulated seconds per frame
+    double timestep = 1.0 / 60.0;
+    // empty: chosen by the application
+    std::filesystem::path output;
+    std::string label;
+    // see BlasPartitionPolicy::parse, empty: the default of the application
+    std::string blasPartition;
+
+    // nullopt without --benchmark, throws on unknown or malformed arguments
+    static std::optional<BenchmarkOptions> parse(int argc, char* argv[]);
+};
+
+// drives one benchmark run: plays the script back at a fixed timestep, skips the warm-up frames, collects the
+// measured frames and writes them as a JSON report
+// all samples of the measured frames are kept, so the report has exact percentiles and can be compared
+// run against run (see benchcompare)
+class BenchmarkRunner
+{
+public:
+    struct MemoryStats
+    {
+        uint64_t usedBytes = 0;
+        uint64_t unusedBytes = 0;
+        uint32_t allocationCount = 0;
+        uint32_t blockCount = 0;
+    };
+
+    struct DeviceInfo
+    {
+        std::string name;
+        std::string driverVersion;
+        std::string apiVersion;
+    };
+
+    // the acceleration structures of the scene as built at load time
+    struct AccelerationStructureStats
+    {
+        std::string partition;
+        uint32_t bottomLevelCount = 0;
+        uint32_t instanceCount = 0;
+        uint64_t bottomLevelBytes = 0;
+        uint64_t topLevelBytes = 0;
+        float buildMilliseconds = 0.0f;
+    };
+
+    // loads the script, throws if it can't
+    BenchmarkRunner(BenchmarkOptions options, std::string application);
+
+    [[nodiscard]] const BenchmarkOptions& getOptions() const { return m_options; }
+    [[nodiscard]] const BenchmarkScript& getScript() const { return m_script; }
+
+    // the scene given on the command line, else the one of the script, empty if neither has one
+    [[nodiscard]] const std::string& getScene() const;
+
+    // once per frame before it is recorded, the first call starts the run
+    void beginFrame(uint64_t frameNumber);
+
+    // simulated seconds since the first frame
+    [[nodiscard]] double getTime() const;
+
+    [[nodiscard]] bool isMeasuring() const;
+    [[nodiscard]] bool isMeasured(uint64_t frameNumber) const;
+
+    // true once all measured frames were recorded and their GPU results had time to arrive
+    [[nodiscard]] bool isFinished() const;
+
+    // samples of frames outside of the measured range are ignored
+    void addCpuFrameTime(uint64_t frameNumber, float milliseconds);
+    void addGpuTimes(uint64_t frameNumber, const std::map<std::string, float>& passMilliseconds);
+    void addMemorySample(const MemoryStats& stats);
+    // counter name to value, see PipelineStatisticsManager
+    void addPipelineStatistics(uint64_t frameNumber, const std::string& pass, const std::map<std::string, uint64_t>& counters);
+
+    void setDeviceInfo(DeviceInfo info) { m_deviceInfo = std::move(info); }
+    void setResolution(uint32_t width, uint32_t height) { m_width = width; m_height = height; }
+    void setAccelerationStructureStats(AccelerationStructureStats stats) { m_accelerationStructureStats = std::move(stats); }
+
+    // returns false if the file could not be written
+    bool writeReport(const std::filesystem::path& path) const;
+
+private:
+    // GPU results arrive a few frames late, see TimerManager::collectResults
+    static constexpr uint32_t s_drainFrames = 16;
+
+    BenchmarkOptions m_options;
+    std::string m_application;
+    BenchmarkScript m_script;
+
+    std::optional<uint64_t> m_firstFrame;
+    uint64_t m_currentFrame = 0;
+
+    std::vector<float> m_cpuFrameTimes;
+    std::map<std::string, std::vector<float>> m_gpuPassTimes;
+    // sum of the top level passes per frame
+    std::map<uint64_t, float> m_gpuFrameTimes;
+
+    struct CounterSummary
+    {
+        uint64_t min = ~0ull;
+        uint64_t max = 0;
+        double sum = 0.0;
+        uint64_t count = 0;
+    };
+    // by pass and counter
+    std::map<std::string, std::map<std::string, CounterSummary>> m_pipelineStatistics;
+
+    MemoryStats m_lastMemory;
+    uint64_t m_peakUsedBytes = 0;
+
+    DeviceInfo m_deviceInfo;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    AccelerationStructureStats m_accelerationStructureStats;
+};
@@ -0,0 +1,170 @@
+#include "BenchmarkScript.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+BenchmarkScript BenchmarkScript::load(const std::filesystem::path& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to open benchmark script " + path.string());
+
+    BenchmarkScript script;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        if (const auto comment = line.find('#'); comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream stream(line);
+        std::string command;
+        if (!(stream >> command))
+            continue;
+
+        const auto fail = [&](const std::string& reason)
+        {
+            throw std::runtime_error(path.string() + ":" + std::to_string(lineNumber) + ": " + reason);
+        };
+
+        if (command == "scene")
+        {
+            // the rest of the line, paths can contain spaces
+            std::getline(stream >> std::ws, script.m_scene);
+            script.m_scene.erase(script.m_scene.find_last_not_of(" \t\r") + 1);
+            if (script.m_scene.empty())
+                fail("expected scene <path>");
+        }
+        else if (command == "camera")
+        {
+            Keyframe<CameraPose> keyframe{};
+            auto& pose = keyframe.value;
+            if (!(stream >> keyframe.time >> pose.position.x >> pose.position.y >> pose.position.z >> pose.theta >> pose.phi))
+                fail("expected camera <time> <x> <y> <z> <theta> <phi>");
+            script.m_cameraKeyframes.push_back(keyframe);
+        }
+        else if (command == "pointlight")
+        {
+            int index = 0;
+            Keyframe<glm::vec3> keyframe{};
+            if (!(stream >> index >> keyframe.time >> keyframe.value.x >> keyframe.value.y >> keyframe.value.z) || index < 0)
+                fail("expected pointlight <index> <time> <x> <y> <z>");
+            script.m_pointLightKeyframes[index].push_back(keyframe);
+        }
+        else if (command == "animate")
+        {
+            Animation animation;
+            std::string mode, async;
+            const std::map<std::string, Animation::UpdateMode> modes = { { "rebuild", Animation::UpdateMode::Rebuild }, { "update", Animation::UpdateMode::Update }, { "auto", Animation::UpdateMode::Automatic } };
+            if (!(stream >> animation.objectID >> mode) || animation.objectID < 0 || modes.count(mode) == 0)
+                fail("expected animate <object id> <rebuild|update|auto> [async]");
+            animation.updateMode = modes.at(mode);
+            if (stream >> async)
+            {
+                if (async != "async")
+                    fail("unknown animation option " + async);
+                animation.useAsyncCompute = true;
+            }
+            script.m_animation = animation;
+        }
+        else
+        {
+            fail("unknown command " + command);
+        }
+    }
+
+    // keyframes don't have to be written in order
+    const auto byTime = [](const auto& a, const auto& b) { return a.time < b.time; };
+    std::stable_sort(script.m_cameraKeyframes.begin(), script.m_cameraKeyframes.end(), byTime);
+    for (auto& [index, keyframes] : script.m_pointLightKeyframes)
+        std::stable_sort(keyframes.begin(), keyframes.end(), byTime);
+
+    return script;
+}
+
+BenchmarkScript::CameraPose BenchmarkScript::getCameraPose(const double time) const
+{
+    return sample(m_cameraKeyframes, time, [](const CameraPose& a, const CameraPose& b, const float t)
+    {
+        return CameraPose{ glm::mix(a.position, b.position, t), glm::mix(a.theta, b.theta, t), glm::mix(a.phi, b.phi, t) };
+    });
+}
+
+std::map<int, glm::vec3> BenchmarkScript::getPointLightPositions(const double time) const
+{
+    std::map<int, glm::vec3> positions;
+    for (const auto& [index, keyframes] : m_pointLightKeyframes)
+        positions[index] = sample(keyframes, time, [](const glm::vec3& a, const glm::vec3& b, const float t) { return glm::mix(a, b, t); });
+    return positions;
+}
+
+double BenchmarkScript::getDuration() const
+{
+    double duration = m_cameraKeyframes.empty() ? 0.0 : m_cameraKeyframes.back().time;
+    for (const auto& [index, keyframes] : m_pointLightKeyframes)
+        duration = std::max(duration, keyframes.back().time);
+    return duration;
+}
+
+template <typename T, typename Lerp>
+T BenchmarkScript::sample(const std::vector<Keyframe<T>>& keyframes, const double time, Lerp lerp)
+{
+    if (keyframes.empty())
+        return T{};
+
+    const auto next = std::upper_bound(keyframes.begin(), keyframes.end(), time, [](const double t, const Keyframe<T>& keyframe) { return t < keyframe.time; });
+    if (next == keyframes.begin())
+        return keyframes.front().value;
+    if (next == keyframes.end())
+        return keyframes.back().value;
+
+    const auto& previous = *(next - 1);
+    const auto t = static_cast<float>((time - previous.time) / (next->time - previous.time));
+    return lerp(previous.value, next->value, t);
+}
+
+void CameraPathRecorder::start(const std::string& scene)
+{
+    m_scene = scene;
+    m_keyframes.clear();
+    m_start = Clock::now();
+    m_lastKeyframe = Clock::time_point();
+    m_recording = true;
+}
+
+void CameraPathRecorder::update(const BenchmarkScript::CameraPose& pose)
+{
+    if (!m_recording)
+        return;
+
+    m_lastPose = pose;
+    const auto now = Clock::now();
+    if (!m_keyframes.empty() && now - m_lastKeyframe < m_keyframeInterval)
+        return;
+
+    m_keyframes.emplace_back(std::chrono::duration<double>(now - m_start).count(), pose);
+    m_lastKeyframe = now;
+}
+
+bool CameraPathRecorder::stop(const std::filesystem::path& path)
+{
+    m_recording = false;
+    if (m_keyframes.empty())
+        return false;
+    m_keyframes.emplace_back(std::chrono::duration<double>(Clock::now() - m_start).count(), m_lastPose);
+
+    std::ofstream file(path);
+    if (!file.is_open())
+        return false;
+
+    file << "# recorded camera path, camera <time> <x> <y> <z> <theta> <phi>\n";
+    if (!m_scene.empty())
+        file << "scene " << m_scene << "\n";
+    file << std::fixed << std::setprecision(5);
+    for (const auto& [time, pose] : m_keyframes)
+        file << "camera " << time << " " << pose.position.x << " " << pose.position.y << " " << pose.position.z << " " << pose.theta << " " << pose.phi << "\n";
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+// what a benchmark run plays back, a text file with one command per line, '#' starts a comment:
+//   scene <path relative to the resources folder>
+//   camera <time> <x> <y> <z> <theta> <phi>
+//   pointlight <index> <time> <x> <y> <z>
+//   animate <object id> <rebuild|update|auto> [async]
+// keyframes are interpolated linearly, before the first and after the last one the nearest keyframe holds
+// times are in seconds of simulated time, so the playback does not depend on the frame rate
+class BenchmarkScript
+{
+public:
+    struct CameraPose
+    {
+        glm::vec3 position{ 0.0f };
+        // angles as used by Pilotview
+        float theta = 0.0f;
+        float phi = 0.0f;
+    };
+
+    struct Animation
+    {
+        // how the top level acceleration structure follows the object, auto lets TlasUpdatePolicy choose per frame
+        enum class UpdateMode
+        {
+            Rebuild,
+            Update,
+            Automatic
+        };
+
+        int objectID = 0;
+        UpdateMode updateMode = UpdateMode::Rebuild;
+        bool useAsyncCompute = false;
+    };
+
+    BenchmarkScript() = default;
+
+    // throws if the file cannot be read or a line cannot be parsed
+    static BenchmarkScript load(const std::filesystem::path& path);
+
+    [[nodiscard]] const std::string& getScene() const { return m_scene; }
+    [[nodiscard]] bool hasCameraPath() const { return !m_cameraKeyframes.empty(); }
+    [[nodiscard]] CameraPose getCameraPose(double time) const;
+
+    // only the lights the script moves, by index
+    [[nodiscard]] std::map<int, glm::vec3> getPointLightPositions(double time) const;
+
+    [[nodiscard]] const std::optional<Animation>& getAnimation() const { return m_animation; }
+
+    // time of the last keyframe
+    [[nodiscard]] double getDuration() const;
+
+private:
+    template <typename T>
+    struct Keyframe
+    {
+        double time;
+        T value;
+    };
+
+    template <typename T, typename Lerp>
+    static T sample(const std::vector<Keyframe<T>>& keyframes, double time, Lerp lerp);
+
+    std::string m_scene;
+    std::vector<Keyframe<CameraPose>> m_cameraKeyframes;
+    std::map<int, std::vector<Keyframe<glm::vec3>>> m_pointLightKeyframes;
+    std::optional<Animation> m_animation;
+};
+
+// writes the camera while it is flown by hand as a BenchmarkScript, one keyframe per interval
+class CameraPathRecorder
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit CameraPathRecorder(std::chrono::milliseconds keyframeInterval = std::chrono::milliseconds(250)) : m_keyframeInterval(keyframeInterval) {}
+
+    void start(const std::string& scene);
+
+    // once per frame, only keeps a keyframe if the interval passed since the last one
+    void update(const BenchmarkScript::CameraPose& pose);
+
+    // always ends with the current pose, returns false if the file could not be written
+    bool stop(const std::filesystem::path& path);
+
+    [[nodiscard]] bool isRecording() const { return m_recording; }
+    [[nodiscard]] size_t getKeyframeCount() const { return m_keyframes.size(); }
+
+private:
+    std::chrono::milliseconds m_keyframeInterval;
+    bool m_recording = false;
+    std::string m_scene;
+    Clock::time_point m_start;
+    Clock::time_point m_lastKeyframe;
+    BenchmarkScript::CameraPose m_lastPose;
+    std::vector<std::pair<double, BenchmarkScript::CameraPose>> m_keyframes;
+};
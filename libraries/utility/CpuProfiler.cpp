@@ -0,0 +1,293 @@
+#include "CpuProfiler.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "TraceExporter.h"
+#include "imgui/imgui.h"
+
+namespace
+{
+    using SteadyClock = std::chrono::steady_clock;
+
+    // per thread, about 200 KB, enough for a few thousand scopes per frame, a power of two so indexing is a mask
+    constexpr uint64_t s_bufferCapacity = 8192;
+    static_assert((s_bufferCapacity & (s_bufferCapacity - 1)) == 0);
+
+    // atomics, so a reader racing with a writer that lapped it is not a data race, it just drops the event
+    struct Event
+    {
+        std::atomic<uint64_t> begin;
+        std::atomic<uint64_t> end;
+        std::atomic<uint32_t> scope;
+    };
+
+    // single producer (its thread), single consumer (collect)
+    struct ThreadBuffer
+    {
+        std::array<Event, s_bufferCapacity> events;
+        // writeIndex is head + 1 while a slot is overwritten, the consumer drops what it copied from there
+        std::atomic<uint64_t> writeIndex = 0;
+        std::atomic<uint64_t> head = 0;
+        uint64_t tail = 0;
+
+        std::thread::id thread;
+        std::string name;
+        std::atomic<bool> threadExited = false;
+    };
+
+    struct ProfilerState
+    {
+        ProfilerState()
+        {
+            anchorTicks = CpuProfiler::now();
+            anchorTime = SteadyClock::now();
+#ifdef VG_PROFILE_USE_RDTSC
+            // rough tick rate until collect() has a longer baseline
+            while (SteadyClock::now() - anchorTime < std::chrono::milliseconds(1)) {}
+            nanosecondsPerTick = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(SteadyClock::now() - anchorTime).count())
+                / static_cast<double>(CpuProfiler::now() - anchorTicks);
+#endif
+        }
+
+        std::mutex mutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        std::vector<const char*> scopeNames;
+
+        // main thread only
+        std::vector<CpuProfiler::ScopeStatistics> statistics;
+        uint64_t droppedEvents = 0;
+
+        uint64_t anchorTicks;
+        SteadyClock::time_point anchorTime;
+        double nanosecondsPerTick = 1.0;
+    };
+
+    ProfilerState& state()
+    {
+        static ProfilerState profilerState;
+        return profilerState;
+    }
+
+    // marks the buffer for removal once its thread exits, the remaining events are still collected
+    struct ThreadBufferHolder
+    {
+        std::shared_ptr<ThreadBuffer> buffer;
+
+        ~ThreadBufferHolder()
+        {
+            if (buffer)
+                buffer->threadExited.store(true, std::memory_order_release);
+        }
+    };
+
+    ThreadBuffer& registerThreadBuffer()
+    {
+        thread_local ThreadBufferHolder holder;
+        holder.buffer = std::make_shared<ThreadBuffer>();
+        holder.buffer->thread = std::this_thread::get_id();
+
+        auto& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        holder.buffer->name = "Thread " + std::to_string(s.buffers.size());
+        s.buffers.push_back(holder.buffer);
+        return *holder.buffer;
+    }
+
+    // a plain pointer, unlike the holder it needs no initialization guard on every access
+    thread_local ThreadBuffer* t_threadBuffer = nullptr;
+
+    ThreadBuffer& threadBuffer()
+    {
+        if (t_threadBuffer == nullptr)
+            t_threadBuffer = &registerThreadBuffer();
+        return *t_threadBuffer;
+    }
+
+    struct CollectedEvent
+    {
+        uint32_t scope;
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    // everything written since the last drain that was not overwritten in the meantime
+    std::vector<CollectedEvent> drain(ThreadBuffer& buffer, uint64_t& dropped)
+    {
+        const auto head = buffer.head.load(std::memory_order_acquire);
+        auto first = buffer.tail;
+        if (head - first > s_bufferCapacity)
+        {
+            dropped += head - s_bufferCapacity - first;
+            first = head - s_bufferCapacity;
+        }
+
+        std::vector<CollectedEvent> events;
+        events.reserve(head - first);
+        for (auto i = first; i < head; i++)
+        {
+            const auto& event = buffer.events.at(i % s_bufferCapacity);
+            events.push_back({ event.scope.load(std::memory_order_relaxed), event.begin.load(std::memory_order_relaxed), event.end.load(std::memory_order_relaxed) });
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const auto writeIndex = buffer.writeIndex.load(std::memory_order_relaxed);
+        const auto firstValid = writeIndex > s_bufferCapacity ? writeIndex - s_bufferCapacity : 0;
+        if (firstValid > first)
+        {
+            const auto overwritten = std::min(firstValid - first, head - first);
+            dropped += overwritten;
+            events.erase(events.begin(), events.begin() + static_cast<std::ptrdiff_t>(overwritten));
+        }
+
+        buffer.tail = head;
+        return events;
+    }
+}
+
+uint32_t CpuProfiler::registerScope(const char* name)
+{
+    auto& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.scopeNames.push_back(name);
+    return static_cast<uint32_t>(s.scopeNames.size() - 1);
+}
+
+void CpuProfiler::record(const uint32_t scopeId, const uint64_t begin, const uint64_t end)
+{
+    auto& buffer = threadBuffer();
+    const auto head = buffer.head.load(std::memory_order_relaxed);
+    buffer.writeIndex.store(head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    auto& event = buffer.events[head & (s_bufferCapacity - 1)];
+    event.scope.store(scopeId, std::memory_order_relaxed);
+    event.begin.store(begin, std::memory_order_relaxed);
+    event.end.store(end, std::memory_order_relaxed);
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void CpuProfiler::setThreadName(const std::string& name)
+{
+    auto& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(state().mutex);
+    buffer.name = name;
+}
+
+void CpuProfiler::collect(TraceExporter* exporter)
+{
+    auto& s = state();
+
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    std::vector<const char*> scopeNames;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        buffers = s.buffers;
+        scopeNames = s.scopeNames;
+
+        // the buffers of finished threads were drained in the last collect
+        s.buffers.erase(std::remove_if(s.buffers.begin(), s.buffers.end(), [](const std::shared_ptr<ThreadBuffer>& buffer)
+        {
+            return buffer->threadExited.load(std::memory_order_acquire) && buffer->tail == buffer->head.load(std::memory_order_acquire);
+        }), s.buffers.end());
+    }
+
+    for (auto i = s.statistics.size(); i < scopeNames.size(); i++)
+        s.statistics.push_back({ scopeNames.at(i), TimingStatistics(0.05f), 0 });
+
+#ifdef VG_PROFILE_USE_RDTSC
+    // the longer the baseline the better the tick rate
+    const auto ticks = now();
+    const auto time = SteadyClock::now();
+    if (time - s.anchorTime > std::chrono::milliseconds(100))
+        s.nanosecondsPerTick = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(time - s.anchorTime).count()) / static_cast<double>(ticks - s.anchorTicks);
+#endif
+
+    const auto toTimePoint = [&s](const uint64_t tick)
+    {
+        const auto nanoseconds = static_cast<int64_t>(static_cast<double>(static_cast<int64_t>(tick - s.anchorTicks)) * s.nanosecondsPerTick);
+        return s.anchorTime + std::chrono::duration_cast<SteadyClock::duration>(std::chrono::nanoseconds(nanoseconds));
+    };
+    const bool tracing = exporter != nullptr && exporter->isCapturing();
+
+    std::vector<uint64_t> ticksPerScope(scopeNames.size(), 0);
+    std::vector<uint32_t> callsPerScope(scopeNames.size(), 0);
+    for (const auto& buffer : buffers)
+    {
+        const auto events = drain(*buffer, s.droppedEvents);
+        if (tracing && !events.empty())
+        {
+            std::string name;
+            {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                name = buffer->name;
+            }
+            exporter->setThreadName(buffer->thread, name);
+        }
+
+        for (const auto& event : events)
+        {
+            ticksPerScope.at(event.scope) += event.end - event.begin;
+            callsPerScope.at(event.scope)++;
+            if (tracing)
+                exporter->addCpuScope(scopeNames.at(event.scope), toTimePoint(event.begin), toTimePoint(event.end), buffer->thread);
+        }
+    }
+
+    for (size_t i = 0; i < scopeNames.size(); i++)
+    {
+        auto& scope = s.statistics.at(i);
+        scope.callsLastFrame = callsPerScope.at(i);
+        if (callsPerScope.at(i) > 0)
+            scope.statistics.add(static_cast<float>(static_cast<double>(ticksPerScope.at(i)) * s.nanosecondsPerTick / 1'000'000.0));
+    }
+}
+
+const std::vector<CpuProfiler::ScopeStatistics>& CpuProfiler::getScopeStatistics()
+{
+    return state().statistics;
+}
+
+uint64_t CpuProfiler::getDroppedEventCount()
+{
+    return state().droppedEvents;
+}
+
+double CpuProfiler::getNanosecondsPerTick()
+{
+    return state().nanosecondsPerTick;
+}
+
+void CpuProfiler::resetStatistics()
+{
+    for (auto& scope : state().statistics)
+        scope.statistics.reset();
+}
+
+void CpuProfiler::drawGUI()
+{
+    for (const auto& scope : state().statistics)
+    {
+        if (scope.statistics.getSummary().count == 0)
+            continue;
+
+        ImGui::Text("%s", scope.name.c_str());
+        const float availableWidth = ImGui::GetContentRegionAvailWidth();
+        if (availableWidth >= 300)
+            ImGui::SameLine(ImGui::GetWindowContentRegionWidth() - 300);
+        ImGui::Text("%.3f ms, %u calls", scope.statistics.getRecentMean(20), scope.callsLastFrame);
+        if (ImGui::IsItemHovered())
+        {
+            ImGui::BeginTooltip();
+            scope.statistics.drawGUI();
+            ImGui::EndTooltip();
+        }
+    }
+
+    if (const auto dropped = state().droppedEvents; dropped > 0)
+        ImGui::Text("%llu events dropped, a thread wrote more scopes than its buffer holds", static_cast<unsigned long long>(dropped));
+}
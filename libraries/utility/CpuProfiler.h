@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "TimingStatistics.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define VG_PROFILE_USE_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define VG_PROFILE_USE_RDTSC
+#else
+#include <chrono>
+#endif
+
+class TraceExporter;
+
+// CPU scopes, see VG_PROFILE_SCOPE
+// every thread writes into its own lock-free ring buffer, collect() drains them once per frame on the main thread,
+// aggregates the time per scope and frame and forwards the scopes to a running trace capture
+class CpuProfiler
+{
+public:
+    // rdtsc where available (calibrated against steady_clock), steady_clock nanoseconds otherwise
+    static uint64_t now()
+    {
+#ifdef VG_PROFILE_USE_RDTSC
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    // once per call site, the id indexes the statistics
+    static uint32_t registerScope(const char* name);
+
+    // called at the end of a scope, lock-free
+    static void record(uint32_t scopeId, uint64_t begin, uint64_t end);
+
+    // names the calling thread in traces
+    static void setThreadName(const std::string& name);
+
+    // ends the frame: drains all thread buffers, adds the summed time of every scope that ran to its statistics
+    static void collect(TraceExporter* exporter = nullptr);
+
+    struct ScopeStatistics
+    {
+        std::string name;
+        // milliseconds per frame, summed over all calls
+        TimingStatistics statistics;
+        uint32_t callsLastFrame = 0;
+    };
+
+    // the statistics are only written in collect(), read them from the same thread
+    [[nodiscard]] static const std::vector<ScopeStatistics>& getScopeStatistics();
+
+    // events lost because a thread wrote more than its buffer holds between two collects
+    [[nodiscard]] static uint64_t getDroppedEventCount();
+
+    [[nodiscard]] static double getNanosecondsPerTick();
+
+    static void resetStatistics();
+
+    // one line per scope, for the "Performance" menu
+    static void drawGUI();
+};
+
+// records the time from construction to destruction
+class CpuProfileScope
+{
+public:
+    explicit CpuProfileScope(const uint32_t scopeId) : m_scopeId(scopeId), m_begin(CpuProfiler::now()) {}
+    ~CpuProfileScope() { CpuProfiler::record(m_scopeId, m_begin, CpuProfiler::now()); }
+
+    CpuProfileScope(const CpuProfileScope&) = delete;
+    CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+
+private:
+    uint32_t m_scopeId;
+    uint64_t m_begin;
+};
+
+#define VG_PROFILE_CONCAT_IMPL(a, b) a##b
+#define VG_PROFILE_CONCAT(a, b) VG_PROFILE_CONCAT_IMPL(a, b)
+
+// VG_PROFILE_SCOPE("name") times the rest of the enclosing block, the name has to be a string literal
+// compiled out with VG_NO_PROFILE (CMake option of the same name)
+#ifdef VG_NO_PROFILE
+#define VG_PROFILE_SCOPE(name) ((void)0)
+#else
+#define VG_PROFILE_SCOPE(name) \
+    static const uint32_t VG_PROFILE_CONCAT(vgProfileScopeId, __LINE__) = CpuProfiler::registerScope(name); \
+    const CpuProfileScope VG_PROFILE_CONCAT(vgProfileScope, __LINE__)(VG_PROFILE_CONCAT(vgProfileScopeId, __LINE__))
+#endif
@@ -0,0 +1,71 @@
+#include "DynamicResolutionController.h"
+#include <algorithm>
+#include <cmath>
+
+DynamicResolutionController::DynamicResolutionController(Settings settings) : m_settings(settings), m_scale(settings.maxScale)
+{
+}
+
+bool DynamicResolutionController::update(const float gpuFrameTime)
+{
+    if (!m_enabled || gpuFrameTime <= 0.0f)
+        return false;
+
+    if (!m_hasSamples)
+    {
+        m_averageFrameTime = gpuFrameTime;
+        m_hasSamples = true;
+    }
+    else
+    {
+        m_averageFrameTime += m_settings.smoothing * (gpuFrameTime - m_averageFrameTime);
+    }
+
+    if (m_cooldown > 0)
+    {
+        m_cooldown--;
+        return false;
+    }
+
+    const float target = m_settings.targetFrameTime;
+    if (std::abs(m_averageFrameTime - target) <= m_settings.headroom * target)
+        return false;
+
+    // the scaled passes cost roughly proportional to the pixel count, i.e. scale^2
+    const float newScale = quantize(m_scale * std::sqrt(target / m_averageFrameTime));
+    if (newScale == m_scale)
+        return false;
+
+    // predict the new frame time instead of waiting for the average to catch up, otherwise it overshoots
+    m_averageFrameTime *= (newScale * newScale) / (m_scale * m_scale);
+    m_scale = newScale;
+    m_cooldown = m_settings.cooldownFrames;
+    return true;
+}
+
+void DynamicResolutionController::reset()
+{
+    m_scale = m_settings.maxScale;
+    m_averageFrameTime = 0.0f;
+    m_hasSamples = false;
+    m_cooldown = 0;
+}
+
+void DynamicResolutionController::setEnabled(const bool enabled)
+{
+    m_enabled = enabled;
+    reset();
+}
+
+void DynamicResolutionController::setSettings(const Settings& settings)
+{
+    m_settings = settings;
+    m_scale = std::clamp(quantize(m_scale), m_settings.minScale, m_settings.maxScale);
+}
+
+float DynamicResolutionController::quantize(const float scale) const
+{
+    // round down, a slightly too low resolution is better than missing the target
+    const float steps = std::floor(scale / m_settings.scaleStep + 1e-4f);
+    return std::clamp(steps * m_settings.scaleStep, m_settings.minScale, m_settings.maxScale);
+}
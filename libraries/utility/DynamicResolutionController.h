@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+
+// keeps the GPU frame time close to a target by scaling the internal render resolution
+// deterministic: the scale only depends on the settings and the sequence of frame times passed to update(),
+// so recorded timing traces can be replayed offline
+class DynamicResolutionController
+{
+public:
+    struct Settings
+    {
+        float targetFrameTime = 16.0f;  // milliseconds
+        float minScale = 0.5f;
+        float maxScale = 1.0f;
+        // scales are quantized, so the passes are not re-recorded for every tiny change
+        float scaleStep = 0.05f;
+        // weight of the newest frame time in the moving average
+        float smoothing = 0.1f;
+        // no change while the average is within +-headroom (relative) of the target
+        float headroom = 0.05f;
+        // frames after a change before the next one, the timings lag behind by a few frames
+        uint32_t cooldownFrames = 15;
+    };
+
+    explicit DynamicResolutionController(Settings settings);
+    DynamicResolutionController() : DynamicResolutionController(Settings{}) {}
+
+    // feed the GPU time of one frame in milliseconds, returns true if the scale changed
+    bool update(float gpuFrameTime);
+
+    // back to maxScale, forgets the timing history
+    void reset();
+
+    // disabled (the default): the scale stays at maxScale
+    void setEnabled(bool enabled);
+    [[nodiscard]] bool isEnabled() const { return m_enabled; }
+
+    void setSettings(const Settings& settings);
+    [[nodiscard]] const Settings& getSettings() const { return m_settings; }
+
+    // fraction of the full resolution per axis, in [minScale, maxScale]
+    [[nodiscard]] float getScale() const { return m_scale; }
+    [[nodiscard]] float getAverageFrameTime() const { return m_averageFrameTime; }
+
+private:
+    [[nodiscard]] float quantize(float scale) const;
+
+    Settings m_settings;
+    // opt-in, it changes the rendered image and the timings
+    bool m_enabled = false;
+
+    float m_scale;
+    float m_averageFrameTime = 0.0f;
+    bool m_hasSamples = false;
+    uint32_t m_cooldown = 0;
+};
@@ -0,0 +1,120 @@
+#include "FileWatcher.h"
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#ifdef __linux__
+
+FileWatcher::FileWatcher(std::filesystem::path directory) : m_directory(std::move(directory))
+{
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd < 0)
+        throw std::runtime_error("Failed to initialize inotify");
+
+    // inotify is not recursive, every subdirectory needs its own watch
+    addWatch(m_directory);
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(m_directory))
+        if (entry.is_directory())
+            addWatch(entry.path());
+}
+
+FileWatcher::~FileWatcher()
+{
+    if (m_inotifyFd >= 0)
+        close(m_inotifyFd);
+}
+
+void FileWatcher::addWatch(const std::filesystem::path& directory)
+{
+    // editors either write in place (close_write) or write a temporary file and rename it (moved_to)
+    const int wd = inotify_add_watch(m_inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (wd >= 0)
+        m_watchedDirectories[wd] = directory;
+}
+
+std::vector<std::filesystem::path> FileWatcher::pollChanges()
+{
+    std::vector<std::filesystem::path> changes;
+
+    alignas(inotify_event) char buffer[4096];
+    while (true)
+    {
+        const ssize_t length = read(m_inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0)
+            break; // EAGAIN: no more events
+
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            const auto directory = m_watchedDirectories.find(event->wd);
+            if (directory == m_watchedDirectories.end() || event->len == 0)
+                continue;
+
+            const auto path = directory->second / event->name;
+            if (event->mask & IN_ISDIR)
+            {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                    addWatch(path);
+            }
+            else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+            {
+                changes.push_back(path);
+            }
+        }
+    }
+
+    std::sort(changes.begin(), changes.end());
+    changes.erase(std::unique(changes.begin(), changes.end()), changes.end());
+    return changes;
+}
+
+#else
+
+FileWatcher::FileWatcher(std::filesystem::path directory) : m_directory(std::move(directory)), m_lastPoll(std::chrono::steady_clock::now())
+{
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(m_directory))
+        if (entry.is_regular_file())
+            m_writeTimes[entry.path()] = entry.last_write_time();
+}
+
+FileWatcher::~FileWatcher() = default;
+
+std::vector<std::filesystem::path> FileWatcher::pollChanges()
+{
+    std::vector<std::filesystem::path> changes;
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now - m_lastPoll < s_pollInterval)
+        return changes;
+    m_lastPoll = now;
+
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(m_directory, ec))
+    {
+        if (!entry.is_regular_file(ec))
+            continue;
+
+        // files can be locked by the editor while being written, try again next time
+        const auto writeTime = entry.last_write_time(ec);
+        if (ec)
+            continue;
+
+        auto& knownWriteTime = m_writeTimes[entry.path()];
+        if (knownWriteTime != writeTime)
+        {
+            knownWriteTime = writeTime;
+            changes.push_back(entry.path());
+        }
+    }
+
+    return changes;
+}
+
+#endif
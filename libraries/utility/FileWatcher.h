@@ -0,0 +1,36 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <vector>
+
+// watches a directory tree for written files
+// uses inotify on linux, polls the last write times everywhere else
+class FileWatcher
+{
+public:
+    explicit FileWatcher(std::filesystem::path directory);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // non-blocking, returns every file that was written since the last call (absolute paths, no duplicates)
+    std::vector<std::filesystem::path> pollChanges();
+
+private:
+    std::filesystem::path m_directory;
+
+#ifdef __linux__
+    void addWatch(const std::filesystem::path& directory);
+
+    int m_inotifyFd = -1;
+    std::map<int, std::filesystem::path> m_watchedDirectories;
+#else
+    std::map<std::filesystem::path, std::filesystem::file_time_type> m_writeTimes;
+    std::chrono::steady_clock::time_point m_lastPoll;
+
+    // walking the tree is not free, so don't do it every frame
+    static constexpr std::chrono::milliseconds s_pollInterval{ 500 };
+#endif
+};
@@ -0,0 +1,89 @@
+#include "FloatImage.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+FloatImage::FloatImage(const uint32_t width, const uint32_t height, const uint32_t channels, const float value)
+    : m_width(width), m_height(height), m_channels(channels), m_pixels(static_cast<size_t>(width) * height * channels, value)
+{
+    if (channels == 0 || channels > 4)
+        throw std::runtime_error("Float images have 1 to 4 channels");
+}
+
+FloatImage FloatImage::loadPfm(const std::filesystem::path& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("Could not open " + path.string());
+
+    std::string type;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    float scale = 0.0f;
+    in >> type >> width >> height >> scale;
+    if (!in || (type != "PF" && type != "Pf") || width == 0 || height == 0 || scale == 0.0f)
+        throw std::runtime_error("Not a PFM image: " + path.string());
+    // exactly one whitespace character ends the header
+    in.get();
+
+    FloatImage image(width, height, type == "PF" ? 3 : 1);
+    std::vector<char> bytes(image.m_pixels.size() * sizeof(float));
+    if (!in.read(bytes.data(), static_cast<std::streamsize>(bytes.size())))
+        throw std::runtime_error("PFM image is truncated: " + path.string());
+
+    // a negative scale is little endian
+    uint32_t one = 1;
+    const bool littleEndianHost = *reinterpret_cast<uint8_t*>(&one) == 1;
+    if ((scale < 0.0f) != littleEndianHost)
+    {
+        for (size_t i = 0; i < bytes.size(); i += sizeof(float))
+        {
+            std::swap(bytes.at(i), bytes.at(i + 3));
+            std::swap(bytes.at(i + 1), bytes.at(i + 2));
+        }
+    }
+
+    // PFM rows go from the bottom to the top
+    const size_t rowSize = static_cast<size_t>(width) * image.m_channels;
+    for (uint32_t y = 0; y < height; y++)
+        std::memcpy(&image.m_pixels.at((height - 1 - y) * rowSize), &bytes.at(y * rowSize * sizeof(float)), rowSize * sizeof(float));
+    return image;
+}
+
+void FloatImage::savePfm(const std::filesystem::path& path) const
+{
+    if (m_channels != 1 && m_channels != 3)
+        throw std::runtime_error("PFM images have 1 or 3 channels");
+
+    uint32_t one = 1;
+    const bool littleEndianHost = *reinterpret_cast<uint8_t*>(&one) == 1;
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+        throw std::runtime_error("Could not write " + path.string());
+    out << (m_channels == 3 ? "PF" : "Pf") << "\n" << m_width << " " << m_height << "\n" << (littleEndianHost ? "-1.0" : "1.0") << "\n";
+
+    const size_t rowSize = static_cast<size_t>(m_width) * m_channels;
+    for (uint32_t y = m_height; y-- > 0;)
+        out.write(reinterpret_cast<const char*>(&m_pixels.at(y * rowSize)), static_cast<std::streamsize>(rowSize * sizeof(float)));
+    if (!out)
+        throw std::runtime_error("Could not write " + path.string());
+}
+
+FloatImage FloatImage::resized(const uint32_t width, const uint32_t height) const
+{
+    FloatImage result(width, height, m_channels);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const auto sourceY = std::min(m_height - 1, static_cast<uint32_t>((static_cast<uint64_t>(y) * m_height) / height));
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const auto sourceX = std::min(m_width - 1, static_cast<uint32_t>((static_cast<uint64_t>(x) * m_width) / width));
+            for (uint32_t c = 0; c < m_channels; c++)
+                result.at(x, y, c) = at(sourceX, sourceY, c);
+        }
+    }
+    return result;
+}
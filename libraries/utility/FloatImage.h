@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// linear float pixels with 1 to 4 interleaved channels, the first row is the top of the image like in Vulkan
+class FloatImage
+{
+public:
+    FloatImage() = default;
+    FloatImage(uint32_t width, uint32_t height, uint32_t channels, float value = 0.0f);
+
+    // PFM ("PF" rgb or "Pf" grayscale, either byte order), throws if the file can't be read
+    static FloatImage loadPfm(const std::filesystem::path& path);
+    // little endian PFM, only for 1 or 3 channels, throws otherwise or if the file can't be written
+    void savePfm(const std::filesystem::path& path) const;
+
+    [[nodiscard]] uint32_t getWidth() const { return m_width; }
+    [[nodiscard]] uint32_t getHeight() const { return m_height; }
+    [[nodiscard]] uint32_t getChannels() const { return m_channels; }
+    [[nodiscard]] bool isEmpty() const { return m_pixels.empty(); }
+
+    [[nodiscard]] float& at(const uint32_t x, const uint32_t y, const uint32_t channel = 0) { return m_pixels.at((static_cast<size_t>(y) * m_width + x) * m_channels + channel); }
+    [[nodiscard]] float at(const uint32_t x, const uint32_t y, const uint32_t channel = 0) const { return m_pixels.at((static_cast<size_t>(y) * m_width + x) * m_channels + channel); }
+
+    [[nodiscard]] std::vector<float>& getPixels() { return m_pixels; }
+    [[nodiscard]] const std::vector<float>& getPixels() const { return m_pixels; }
+
+    // nearest neighbour, e.g. to compare a half resolution term at full resolution
+    [[nodiscard]] FloatImage resized(uint32_t width, uint32_t height) const;
+
+private:
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint32_t m_channels = 0;
+    std::vector<float> m_pixels;
+};
@@ -0,0 +1,275 @@
+#include "ImageComparison.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <glm/glm.hpp>
+
+namespace
+{
+    constexpr float s_pi = 3.14159265358979f;
+    // D65, as in FLIP
+    const glm::vec3 s_whitePoint(0.950428545f, 1.0f, 1.088900371f);
+
+    // exponents and breakpoints of the FLIP paper
+    constexpr float s_colorExponent = 0.7f;
+    constexpr float s_featureExponent = 0.5f;
+    constexpr float s_breakpointColor = 0.4f;
+    constexpr float s_breakpointError = 0.95f;
+    // width of the feature detectors in degrees
+    constexpr float s_featureWidth = 0.082f;
+
+    glm::vec3 linearRgbToXyz(const glm::vec3& c)
+    {
+        return glm::vec3(0.4124564f * c.x + 0.3575761f * c.y + 0.1804375f * c.z,
+            0.2126729f * c.x + 0.7151522f * c.y + 0.0721750f * c.z,
+            0.0193339f * c.x + 0.1191920f * c.y + 0.9503041f * c.z);
+    }
+
+    glm::vec3 xyzToLinearRgb(const glm::vec3& c)
+    {
+        return glm::vec3(3.2404542f * c.x - 1.5371385f * c.y - 0.4985314f * c.z,
+            -0.9692660f * c.x + 1.8760108f * c.y + 0.0415560f * c.z,
+            0.0556434f * c.x - 0.2040259f * c.y + 1.0572252f * c.z);
+    }
+
+    glm::vec3 xyzToYcxcz(const glm::vec3& c)
+    {
+        const glm::vec3 normalized = c / s_whitePoint;
+        return glm::vec3(116.0f * normalized.y - 16.0f, 500.0f * (normalized.x - normalized.y), 200.0f * (normalized.y - normalized.z));
+    }
+
+    glm::vec3 ycxczToXyz(const glm::vec3& c)
+    {
+        const float y = (c.x + 16.0f) / 116.0f;
+        return glm::vec3(c.y / 500.0f + y, y, y - c.z / 200.0f) * s_whitePoint;
+    }
+
+    // L*a*b* with the Hunt adjustment, which reduces the chroma of dark colors
+    glm::vec3 xyzToHuntLab(const glm::vec3& c)
+    {
+        const auto f = [](const float t)
+        {
+            constexpr float delta = 6.0f / 29.0f;
+            return t > delta * delta * delta ? std::cbrt(t) : t / (3.0f * delta * delta) + 4.0f / 29.0f;
+        };
+        const glm::vec3 normalized = c / s_whitePoint;
+        const float l = 116.0f * f(normalized.y) - 16.0f;
+        const float a = 500.0f * (f(normalized.x) - f(normalized.y));
+        const float b = 200.0f * (f(normalized.y) - f(normalized.z));
+        return glm::vec3(l, 0.01f * l * a, 0.01f * l * b);
+    }
+
+    float hyab(const glm::vec3& a, const glm::vec3& b)
+    {
+        const glm::vec3 d = a - b;
+        return std::abs(d.x) + std::sqrt(d.y * d.y + d.z * d.z);
+    }
+
+    // spread of a Gaussian with the given b parameter of FLIP's contrast sensitivity functions, in pixels
+    float getSpread(const float b, const float pixelsPerDegree)
+    {
+        return std::sqrt(b / (2.0f * s_pi * s_pi)) * pixelsPerDegree;
+    }
+
+    std::vector<float> gaussianKernel(const float sigma)
+    {
+        const int radius = std::max(1, static_cast<int>(std::ceil(3.0f * sigma)));
+        std::vector<float> kernel;
+        float sum = 0.0f;
+        for (int x = -radius; x <= radius; x++)
+        {
+            kernel.push_back(std::exp(-static_cast<float>(x * x) / (2.0f * sigma * sigma)));
+            sum += kernel.back();
+        }
+        for (auto& weight : kernel)
+            weight /= sum;
+        return kernel;
+    }
+
+    // first (order 1) or second (order 2) derivative of a Gaussian, positive and negative weights sum to 1 and -1
+    std::vector<float> derivativeKernel(const float sigma, const int order)
+    {
+        const int radius = std::max(1, static_cast<int>(std::ceil(3.0f * sigma)));
+        std::vector<float> kernel;
+        float positive = 0.0f;
+        float negative = 0.0f;
+        for (int i = -radius; i <= radius; i++)
+        {
+            const auto x = static_cast<float>(i);
+            const float gaussian = std::exp(-x * x / (2.0f * sigma * sigma));
+            kernel.push_back(order == 1 ? -x * gaussian : (x * x / (sigma * sigma) - 1.0f) * gaussian);
+            (kernel.back() > 0.0f ? positive : negative) += kernel.back();
+        }
+        for (auto& weight : kernel)
+            weight /= weight > 0.0f ? positive : -negative;
+        return kernel;
+    }
+
+    // separable, clamped at the borders
+    std::vector<float> convolve(const std::vector<float>& plane, const uint32_t width, const uint32_t height, const std::vector<float>& kernelX, const std::vector<float>& kernelY)
+    {
+        const int radiusX = static_cast<int>(kernelX.size() / 2);
+        const int radiusY = static_cast<int>(kernelY.size() / 2);
+        const auto w = static_cast<int>(width);
+        const auto h = static_cast<int>(height);
+        std::vector<float> rows(plane.size());
+        for (int y = 0; y < h; y++)
+        {
+            for (int x = 0; x < w; x++)
+            {
+                float sum = 0.0f;
+                for (int k = -radiusX; k <= radiusX; k++)
+                    sum += kernelX.at(k + radiusX) * plane.at(static_cast<size_t>(y) * width + std::clamp(x + k, 0, w - 1));
+                rows.at(static_cast<size_t>(y) * width + x) = sum;
+            }
+        }
+        std::vector<float> result(plane.size());
+        for (int y = 0; y < h; y++)
+        {
+            for (int x = 0; x < w; x++)
+            {
+                float sum = 0.0f;
+                for (int k = -radiusY; k <= radiusY; k++)
+                    sum += kernelY.at(k + radiusY) * rows.at(static_cast<size_t>(std::clamp(y + k, 0, h - 1)) * width + x);
+                result.at(static_cast<size_t>(y) * width + x) = sum;
+            }
+        }
+        return result;
+    }
+
+    // what FLIP compares per pixel: the filtered color and the luminance features
+    struct FlipInput
+    {
+        std::vector<glm::vec3> color;
+        std::vector<float> edges;
+        std::vector<float> points;
+    };
+
+    FlipInput prepareFlipInput(const FloatImage& image, const ImageComparison::Settings& settings)
+    {
+        const auto width = image.getWidth();
+        const auto height = image.getHeight();
+        const size_t pixelCount = static_cast<size_t>(width) * height;
+
+        // single channel images are gray, a 4th channel is ignored
+        std::array<std::vector<float>, 3> opponent;
+        for (auto& plane : opponent)
+            plane.resize(pixelCount);
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                glm::vec3 rgb(image.at(x, y, 0));
+                if (image.getChannels() >= 3)
+                    rgb = glm::vec3(image.at(x, y, 0), image.at(x, y, 1), image.at(x, y, 2));
+                rgb = glm::clamp(rgb * settings.exposure, 0.0f, 1.0f);
+                const glm::vec3 ycxcz = xyzToYcxcz(linearRgbToXyz(rgb));
+                const size_t pixel = static_cast<size_t>(y) * width + x;
+                opponent.at(0).at(pixel) = ycxcz.x;
+                opponent.at(1).at(pixel) = ycxcz.y;
+                opponent.at(2).at(pixel) = ycxcz.z;
+            }
+        }
+
+        FlipInput input;
+        std::vector<float> luminance(pixelCount);
+        for (size_t pixel = 0; pixel < pixelCount; pixel++)
+            luminance.at(pixel) = (opponent.at(0).at(pixel) + 16.0f) / 116.0f;
+
+        // the dominant lobe of the contrast sensitivity function of each channel
+        const std::array<float, 3> spreads = { getSpread(0.0047f, settings.pixelsPerDegree), getSpread(0.0053f, settings.pixelsPerDegree), getSpread(0.04f, settings.pixelsPerDegree) };
+        for (size_t channel = 0; channel < 3; channel++)
+        {
+            const auto kernel = gaussianKernel(spreads.at(channel));
+            opponent.at(channel) = convolve(opponent.at(channel), width, height, kernel, kernel);
+        }
+        input.color.resize(pixelCount);
+        for (size_t pixel = 0; pixel < pixelCount; pixel++)
+        {
+            const glm::vec3 filtered(opponent.at(0).at(pixel), opponent.at(1).at(pixel), opponent.at(2).at(pixel));
+            const glm::vec3 rgb = glm::clamp(xyzToLinearRgb(ycxczToXyz(filtered)), 0.0f, 1.0f);
+            input.color.at(pixel) = xyzToHuntLab(linearRgbToXyz(rgb));
+        }
+
+        const float featureSpread = 0.5f * s_featureWidth * settings.pixelsPerDegree;
+        const auto gaussian = gaussianKernel(featureSpread);
+        const auto firstDerivative = derivativeKernel(featureSpread, 1);
+        const auto secondDerivative = derivativeKernel(featureSpread, 2);
+        const auto edgesX = convolve(luminance, width, height, firstDerivative, gaussian);
+        const auto edgesY = convolve(luminance, width, height, gaussian, firstDerivative);
+        const auto pointsX = convolve(luminance, width, height, secondDerivative, gaussian);
+        const auto pointsY = convolve(luminance, width, height, gaussian, secondDerivative);
+        input.edges.resize(pixelCount);
+        input.points.resize(pixelCount);
+        for (size_t pixel = 0; pixel < pixelCount; pixel++)
+        {
+            input.edges.at(pixel) = std::hypot(edgesX.at(pixel), edgesY.at(pixel));
+            input.points.at(pixel) = std::hypot(pointsX.at(pixel), pointsY.at(pixel));
+        }
+        return input;
+    }
+}
+
+ImageComparison::Result ImageComparison::compare(const FloatImage& reference, const FloatImage& test, const std::vector<uint8_t>& mask, const Settings& settings)
+{
+    if (reference.getWidth() != test.getWidth() || reference.getHeight() != test.getHeight() || reference.getChannels() != test.getChannels())
+        throw std::runtime_error("Compared images differ in size or channel count");
+    const size_t pixelCount = static_cast<size_t>(reference.getWidth()) * reference.getHeight();
+    if (!mask.empty() && mask.size() != pixelCount)
+        throw std::runtime_error("Comparison mask does not match the image size");
+
+    Result result;
+    result.flipMap = FloatImage(reference.getWidth(), reference.getHeight(), 1);
+    if (pixelCount == 0)
+        return result;
+
+    const auto referenceInput = prepareFlipInput(reference, settings);
+    const auto testInput = prepareFlipInput(test, settings);
+
+    // the largest color difference, between green and blue
+    const float maxColorError = std::pow(hyab(xyzToHuntLab(linearRgbToXyz(glm::vec3(0.0f, 1.0f, 0.0f))), xyzToHuntLab(linearRgbToXyz(glm::vec3(0.0f, 0.0f, 1.0f)))), s_colorExponent);
+    const float breakpoint = s_breakpointColor * maxColorError;
+
+    double squaredErrorSum = 0.0;
+    double flipSum = 0.0;
+    const auto channels = reference.getChannels();
+    for (uint32_t y = 0; y < reference.getHeight(); y++)
+    {
+        for (uint32_t x = 0; x < reference.getWidth(); x++)
+        {
+            const size_t pixel = static_cast<size_t>(y) * reference.getWidth() + x;
+            if (!mask.empty() && mask.at(pixel) == 0)
+                continue;
+            result.pixelCount++;
+            for (uint32_t c = 0; c < channels; c++)
+            {
+                const double difference = static_cast<double>(test.at(x, y, c)) - static_cast<double>(reference.at(x, y, c));
+                squaredErrorSum += difference * difference;
+            }
+
+            // small color differences are compressed into [0, 0.95), the rest into [0.95, 1]
+            float colorError = std::pow(hyab(referenceInput.color.at(pixel), testInput.color.at(pixel)), s_colorExponent);
+            colorError = colorError < breakpoint ? (s_breakpointError / breakpoint) * colorError
+                : s_breakpointError + (colorError - breakpoint) / (maxColorError - breakpoint) * (1.0f - s_breakpointError);
+            colorError = std::min(colorError, 1.0f);
+
+            const float featureDifference = std::max(std::abs(referenceInput.edges.at(pixel) - testInput.edges.at(pixel)), std::abs(referenceInput.points.at(pixel) - testInput.points.at(pixel)));
+            const float featureError = std::pow(std::min(1.0f, featureDifference / std::sqrt(2.0f)), s_featureExponent);
+
+            // features raise the error where edges or points differ
+            const float flip = std::pow(colorError, 1.0f - featureError);
+            result.flipMap.at(x, y) = flip;
+            flipSum += flip;
+            result.maxFlip = std::max(result.maxFlip, static_cast<double>(flip));
+        }
+    }
+
+    if (result.pixelCount == 0)
+        return result;
+    result.rmse = std::sqrt(squaredErrorSum / (static_cast<double>(result.pixelCount) * channels));
+    result.psnr = result.rmse > 0.0 ? 20.0 * std::log10(static_cast<double>(settings.peak) / result.rmse) : std::numeric_limits<double>::infinity();
+    result.flip = flipSum / static_cast<double>(result.pixelCount);
+    return result;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "FloatImage.h"
+
+// error of a rendered image against a reference, to put a number on the quality an optimization costs.
+// RMSE and PSNR are computed on the linear values. the perceptual error follows the LDR FLIP metric
+// (Andersson et al. 2020) in a reduced form: one Gaussian per opponent channel instead of the full contrast
+// sensitivity functions, HyAB color difference with the Hunt adjustment, and edge and point features of the luminance
+class ImageComparison
+{
+public:
+    struct Settings
+    {
+        // of the display the images are seen on, 67 is a 0.7 m viewing distance to a 24" 4K monitor
+        float pixelsPerDegree = 67.0f;
+        // scales the values before FLIP, which expects [0, 1]. values above 1 are clamped
+        float exposure = 1.0f;
+        // largest possible value for PSNR
+        float peak = 1.0f;
+    };
+
+    struct Result
+    {
+        uint32_t pixelCount = 0;
+        double rmse = 0.0;
+        // in dB, infinite for identical images
+        double psnr = 0.0;
+        // mean of the FLIP map, 0 is identical, 1 the largest error
+        double flip = 0.0;
+        double maxFlip = 0.0;
+        // per pixel, 0 outside of the mask
+        FloatImage flipMap;
+    };
+
+    // only pixels with a non-zero mask entry count, an empty mask selects every pixel. the images need the same
+    // size and channel count, throws otherwise
+    static Result compare(const FloatImage& reference, const FloatImage& test, const std::vector<uint8_t>& mask, const Settings& settings);
+};
@@ -0,0 +1,139 @@
+#include "PipelineStatistics.h"
+#include <algorithm>
+#include <stdexcept>
+#include "imgui/imgui.h"
+
+namespace
+{
+    // the results are written in the order of the bits, lowest first
+    constexpr vk::QueryPipelineStatisticFlags s_counterFlags =
+        vk::QueryPipelineStatisticFlagBits::eInputAssemblyVertices |
+        vk::QueryPipelineStatisticFlagBits::eInputAssemblyPrimitives |
+        vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations |
+        vk::QueryPipelineStatisticFlagBits::eClippingInvocations |
+        vk::QueryPipelineStatisticFlagBits::eClippingPrimitives |
+        vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations |
+        vk::QueryPipelineStatisticFlagBits::eComputeShaderInvocations;
+}
+
+const std::array<const char*, PipelineStatisticsManager::s_counterCount>& PipelineStatisticsManager::getCounterNames()
+{
+    static const std::array<const char*, s_counterCount> names = {
+        "IA vertices", "IA primitives", "VS invocations", "Clipping invocations", "Clipping primitives", "FS invocations", "CS invocations"
+    };
+    return names;
+}
+
+PipelineStatisticsManager::PipelineStatisticsManager(std::vector<std::string> passes, const vg::Context& context)
+    : m_context(context), m_passes(std::move(passes)), m_slotCount(static_cast<uint32_t>(context.getSwapChainImages().size()))
+{
+    if (!context.getEnabledFeatures().pipelineStatisticsQuery)
+    {
+        context.getLogger()->info("Pipeline statistics queries are not supported");
+        return;
+    }
+
+    const vk::QueryPoolCreateInfo info({}, vk::QueryType::ePipelineStatistics, static_cast<uint32_t>(m_passes.size()) * m_slotCount, s_counterFlags);
+    m_queryPool = context.getDevice().createQueryPool(info);
+}
+
+PipelineStatisticsManager::~PipelineStatisticsManager()
+{
+    if (m_queryPool)
+        m_context.get().getDevice().destroyQueryPool(m_queryPool);
+}
+
+void PipelineStatisticsManager::cmdResetQueries(const vk::CommandBuffer& cmdBuffer, const size_t frameIndex) const
+{
+    if (!isSupported())
+        return;
+
+    for (const auto& pass : m_passes)
+        cmdBuffer.resetQueryPool(m_queryPool, queryIndex(pass, frameIndex), 1);
+}
+
+void PipelineStatisticsManager::cmdBeginQuery(const std::string& pass, const vk::CommandBuffer& cmdBuffer, const size_t frameIndex) const
+{
+    if (isSupported())
+        cmdBuffer.beginQuery(m_queryPool, queryIndex(pass, frameIndex), {});
+}
+
+void PipelineStatisticsManager::cmdEndQuery(const std::string& pass, const vk::CommandBuffer& cmdBuffer, const size_t frameIndex) const
+{
+    if (isSupported())
+        cmdBuffer.endQuery(m_queryPool, queryIndex(pass, frameIndex));
+}
+
+std::map<std::string, PipelineStatisticsManager::Counters> PipelineStatisticsManager::collectResults(const size_t frameIndex, const uint64_t frameNumber)
+{
+    std::map<std::string, Counters> results;
+    if (!isSupported())
+        return results;
+
+    for (const auto& pass : m_passes)
+    {
+        // the counters followed by the availability
+        std::array<uint64_t, s_counterCount + 1> result{};
+        const auto res = m_context.get().getDevice().getQueryPoolResults(m_queryPool, queryIndex(pass, frameIndex), 1, sizeof(result), result.data(), sizeof(result),
+            vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability);
+        if ((res != vk::Result::eSuccess && res != vk::Result::eNotReady) || result.back() == 0)
+            continue;
+
+        Counters counters{};
+        std::copy_n(result.begin(), s_counterCount, counters.begin());
+        results[pass] = counters;
+    }
+
+    if (!results.empty())
+    {
+        m_lastResults = results;
+        m_lastResultFrame = frameNumber;
+    }
+    return results;
+}
+
+void PipelineStatisticsManager::drawGUI() const
+{
+    if (!isSupported())
+    {
+        ImGui::Text("Pipeline statistics are not supported");
+        return;
+    }
+
+    const auto& names = getCounterNames();
+    ImGui::Columns(static_cast<int>(s_counterCount) + 1, "Pipeline statistics");
+    ImGui::Text("Frame %llu", static_cast<unsigned long long>(m_lastResultFrame));
+    ImGui::NextColumn();
+    for (const auto name : names)
+    {
+        ImGui::Text("%s", name);
+        ImGui::NextColumn();
+    }
+    for (const auto& [pass, counters] : m_lastResults)
+    {
+        ImGui::Text("%s", pass.c_str());
+        ImGui::NextColumn();
+        for (const auto value : counters)
+        {
+            ImGui::Text("%llu", static_cast<unsigned long long>(value));
+            ImGui::NextColumn();
+        }
+    }
+    ImGui::Columns(1);
+}
+
+std::map<std::string, uint64_t> PipelineStatisticsManager::toMap(const Counters& counters)
+{
+    std::map<std::string, uint64_t> values;
+    for (size_t i = 0; i < s_counterCount; i++)
+        values[getCounterNames().at(i)] = counters.at(i);
+    return values;
+}
+
+uint32_t PipelineStatisticsManager::queryIndex(const std::string& pass, const size_t frameIndex) const
+{
+    const auto index = static_cast<uint32_t>(std::find(m_passes.begin(), m_passes.end(), pass) - m_passes.begin());
+    if (index == m_passes.size())
+        throw std::runtime_error("Unknown pipeline statistics pass " + pass);
+    return index * m_slotCount + static_cast<uint32_t>(frameIndex);
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include "graphic/Context.h"
+
+// pipeline statistics queries per pass, one query per pass and frame slot like the timers of TimerManager
+// the counts tell e.g. whether a raster pass is vertex or fragment bound and whether culling or LOD reduce work
+// ray tracing passes are not counted by any of the counters, so they are not worth a query
+// without the pipelineStatisticsQuery feature all calls do nothing
+class PipelineStatisticsManager
+{
+public:
+    static constexpr size_t s_counterCount = 7;
+    using Counters = std::array<uint64_t, s_counterCount>;
+
+    // in the order of the counters, which is the order of the query result
+    static const std::array<const char*, s_counterCount>& getCounterNames();
+
+    PipelineStatisticsManager(std::vector<std::string> passes, const vg::Context& context);
+    ~PipelineStatisticsManager();
+
+    PipelineStatisticsManager(const PipelineStatisticsManager&) = delete;
+    PipelineStatisticsManager& operator=(const PipelineStatisticsManager&) = delete;
+
+    [[nodiscard]] bool isSupported() const { return static_cast<bool>(m_queryPool); }
+
+    // resets the queries of all passes in the slot, outside of a render pass and before any of them begins
+    void cmdResetQueries(const vk::CommandBuffer& cmdBuffer, size_t frameIndex) const;
+
+    // begin and end have to be in the same command buffer and subpass
+    void cmdBeginQuery(const std::string& pass, const vk::CommandBuffer& cmdBuffer, size_t frameIndex) const;
+    void cmdEndQuery(const std::string& pass, const vk::CommandBuffer& cmdBuffer, size_t frameIndex) const;
+
+    // reads the slot without waiting, call once the frame that wrote it finished (see TimerManager::collectResults)
+    // returns the passes that had results
+    std::map<std::string, Counters> collectResults(size_t frameIndex, uint64_t frameNumber);
+
+    [[nodiscard]] const std::map<std::string, Counters>& getLastResults() const { return m_lastResults; }
+
+    // one row per pass, for the "Performance" menu
+    void drawGUI() const;
+
+    // counter name to value, e.g. for the benchmark reports
+    static std::map<std::string, uint64_t> toMap(const Counters& counters);
+
+private:
+    [[nodiscard]] uint32_t queryIndex(const std::string& pass, size_t frameIndex) const;
+
+    std::reference_wrapper<const vg::Context> m_context;
+    std::vector<std::string> m_passes;
+    uint32_t m_slotCount;
+    vk::QueryPool m_queryPool;
+
+    std::map<std::string, Counters> m_lastResults;
+    uint64_t m_lastResultFrame = 0;
+};
@@ -0,0 +1,165 @@
+#include "RTCapture.h"
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+RTCapture RTCapture::load(const std::filesystem::path& folder)
+{
+    const auto path = folder / "capture.txt";
+    std::ifstream file(path);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to open capture " + path.string());
+
+    RTCapture capture;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        if (const auto comment = line.find('#'); comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream stream(line);
+        std::string command;
+        if (!(stream >> command))
+            continue;
+
+        const auto fail = [&](const std::string& reason)
+        {
+            throw std::runtime_error(path.string() + ":" + std::to_string(lineNumber) + ": " + reason);
+        };
+
+        if (command == "scene")
+        {
+            // the rest of the line, paths can contain spaces
+            std::getline(stream >> std::ws, capture.scene);
+            capture.scene.erase(capture.scene.find_last_not_of(" \t\r") + 1);
+            if (capture.scene.empty())
+                fail("expected scene <path>");
+        }
+        else if (command == "size")
+        {
+            if (!(stream >> capture.width >> capture.height) || capture.width == 0 || capture.height == 0)
+                fail("expected size <width> <height>");
+        }
+        else if (command == "aspect")
+        {
+            if (!(stream >> capture.aspect) || capture.aspect <= 0.0f)
+                fail("expected aspect <aspect ratio>");
+        }
+        else if (command == "camera")
+        {
+            if (!(stream >> capture.cameraPosition.x >> capture.cameraPosition.y >> capture.cameraPosition.z >> capture.cameraTheta >> capture.cameraPhi))
+                fail("expected camera <x> <y> <z> <theta> <phi>");
+        }
+        else if (command == "frames")
+        {
+            if (!(stream >> capture.frameCount) || capture.frameCount < 0)
+                fail("expected frames <n>");
+        }
+        else if (command == "ao")
+        {
+            if (!(stream >> capture.aoRadius >> capture.aoSamples))
+                fail("expected ao <radius> <samples per frame>");
+        }
+        else if (command == "reflections")
+        {
+            int lowRes = 0;
+            if (!(stream >> capture.reflectionSamples >> capture.reflectionRoughnessThreshold >> lowRes))
+                fail("expected reflections <samples per frame> <roughness threshold> <low resolution 0|1>");
+            capture.lowResReflections = lowRes != 0;
+        }
+        else if (command == "materiallayout")
+        {
+            if (!(stream >> capture.materialChannelLayout))
+                fail("expected materiallayout <0|1>");
+        }
+        else if (command == "directionallight")
+        {
+            PBRDirectionalLight light;
+            if (!(stream >> light.direction.x >> light.direction.y >> light.direction.z >> light.intensity.x >> light.intensity.y >> light.intensity.z >> light.numShadowSamples))
+                fail("expected directionallight <direction xyz> <intensity rgb> <shadow samples>");
+            capture.directionalLights.push_back(light);
+        }
+        else if (command == "pointlight")
+        {
+            PBRPointLight light;
+            if (!(stream >> light.position.x >> light.position.y >> light.position.z >> light.radius >> light.intensity.x >> light.intensity.y >> light.intensity.z >> light.numShadowSamples))
+                fail("expected pointlight <position xyz> <radius> <intensity rgb> <shadow samples>");
+            capture.pointLights.push_back(light);
+        }
+        else if (command == "spotlight")
+        {
+            PBRSpotLight light;
+            if (!(stream >> light.position.x >> light.position.y >> light.position.z >> light.radius >> light.intensity.x >> light.intensity.y >> light.intensity.z
+                >> light.direction.x >> light.direction.y >> light.direction.z >> light.cutoff >> light.outerCutoff >> light.numShadowSamples))
+                fail("expected spotlight <position xyz> <radius> <intensity rgb> <direction xyz> <cutoff> <outer cutoff> <shadow samples>");
+            capture.spotLights.push_back(light);
+        }
+        else
+        {
+            fail("unknown command " + command);
+        }
+    }
+
+    if (capture.scene.empty() || capture.width == 0)
+        throw std::runtime_error(path.string() + ": scene and size are required");
+    return capture;
+}
+
+bool RTCapture::save(const std::filesystem::path& folder) const
+{
+    std::ofstream file(folder / "capture.txt");
+    if (!file.is_open())
+        return false;
+
+    // every digit, so the frame can be rendered again exactly
+    file << std::setprecision(std::numeric_limits<float>::max_digits10);
+    file << "# captured by rtcombined\n";
+    file << "scene " << scene << "\n";
+    file << "size " << width << " " << height << "\n";
+    file << "aspect " << aspect << "\n";
+    file << "camera " << cameraPosition.x << " " << cameraPosition.y << " " << cameraPosition.z << " " << cameraTheta << " " << cameraPhi << "\n";
+    file << "frames " << frameCount << "\n";
+    file << "ao " << aoRadius << " " << aoSamples << "\n";
+    file << "reflections " << reflectionSamples << " " << reflectionRoughnessThreshold << " " << (lowResReflections ? 1 : 0) << "\n";
+    file << "materiallayout " << materialChannelLayout << "\n";
+    for (const auto& light : directionalLights)
+    {
+        file << "directionallight " << light.direction.x << " " << light.direction.y << " " << light.direction.z << " "
+            << light.intensity.x << " " << light.intensity.y << " " << light.intensity.z << " " << light.numShadowSamples << "\n";
+    }
+    for (const auto& light : pointLights)
+    {
+        file << "pointlight " << light.position.x << " " << light.position.y << " " << light.position.z << " " << light.radius << " "
+            << light.intensity.x << " " << light.intensity.y << " " << light.intensity.z << " " << light.numShadowSamples << "\n";
+    }
+    for (const auto& light : spotLights)
+    {
+        file << "spotlight " << light.position.x << " " << light.position.y << " " << light.position.z << " " << light.radius << " "
+            << light.intensity.x << " " << light.intensity.y << " " << light.intensity.z << " "
+            << light.direction.x << " " << light.direction.y << " " << light.direction.z << " "
+            << light.cutoff << " " << light.outerCutoff << " " << light.numShadowSamples << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+std::string RTCapture::getImageFile(const Term term, const size_t light)
+{
+    switch (term)
+    {
+    case Term::DirectionalShadow:
+        return "shadow_directional_" + std::to_string(light) + ".pfm";
+    case Term::PointShadow:
+        return "shadow_point_" + std::to_string(light) + ".pfm";
+    case Term::SpotShadow:
+        return "shadow_spot_" + std::to_string(light) + ".pfm";
+    case Term::AmbientOcclusion:
+        return "ao.pfm";
+    case Term::Reflections:
+        return "reflections.pfm";
+    }
+    throw std::runtime_error("Unknown RT term");
+}
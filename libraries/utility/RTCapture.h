@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "geometry/lightmanager.h"
+
+// the ray traced terms of an rtcombined frame as read back from the GPU, and everything needed to render them again:
+// a folder with one PFM per term (see getImageFile) and capture.txt, one setting per line, '#' starts a comment:
+//   scene <path relative to the resources folder>
+//   size <width> <height>                  render resolution of the RT passes
+//   aspect <aspect ratio>                  of the projection, 45 degree vertical field of view
+//   camera <x> <y> <z> <theta> <phi>       as used by Pilotview
+//   frames <n>                             accumulated frames, the terms average n times the per frame samples
+//   ao <radius> <samples per frame>
+//   reflections <samples per frame> <roughness threshold> <low resolution 0|1>
+//   materiallayout <0 gltf|1 fbx>
+//   directionallight <direction xyz> <intensity rgb> <shadow samples>
+//   pointlight <position xyz> <radius> <intensity rgb> <shadow samples>
+//   spotlight <position xyz> <radius> <intensity rgb> <direction xyz> <cutoff> <outer cutoff> <shadow samples>
+struct RTCapture
+{
+    enum class Term
+    {
+        DirectionalShadow,
+        PointShadow,
+        SpotShadow,
+        AmbientOcclusion,
+        Reflections
+    };
+
+    std::string scene;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    float aspect = 1.0f;
+    glm::vec3 cameraPosition{ 0.0f };
+    float cameraTheta = 0.0f;
+    float cameraPhi = 0.0f;
+    int32_t frameCount = 0;
+    float aoRadius = 100.0f;
+    int32_t aoSamples = 1;
+    int32_t reflectionSamples = 1;
+    float reflectionRoughnessThreshold = 0.0f;
+    bool lowResReflections = false;
+    int32_t materialChannelLayout = 0;
+    std::vector<PBRDirectionalLight> directionalLights;
+    std::vector<PBRPointLight> pointLights;
+    std::vector<PBRSpotLight> spotLights;
+
+    // reads capture.txt of the folder, throws if it can't be read or a line can't be parsed
+    static RTCapture load(const std::filesystem::path& folder);
+    // writes capture.txt into the folder, returns false if that fails
+    bool save(const std::filesystem::path& folder) const;
+
+    // file name of a term in the capture folder, shadows have one image per light
+    static std::string getImageFile(Term term, size_t light = 0);
+};
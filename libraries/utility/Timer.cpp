@@ -1,5 +1,6 @@
 #include "Timer.h"
 #include "imgui/imgui.h"
+#include <array>
 
 //TODO maybe let the timer create the pool, so only a timer object is needed
 void Timer::acquireCurrentTimestamp(const vk::Device& device, const vk::QueryPool& pool)
@@ -9,39 +10,63 @@ void Timer::acquireCurrentTimestamp(const vk::Device& device, const vk::QueryPoo
         throw std::runtime_error("Query not successful");
 
     // save elapsed time
-    m_timeDiffs.push_back(static_cast<float>((m_currentTimestamp - m_lastTimestamp) / 1'000'000.0));
-
-    // max amount of time diffs
-    if (m_timeDiffs.size() > m_maxTimeDiffs)
-        m_timeDiffs.erase(m_timeDiffs.begin());
+    m_statistics.add(toMilliseconds(m_lastTimestamp, m_currentTimestamp));
 
     m_lastTimestamp = m_currentTimestamp;
 }
 
-void Timer::acquireTimestepDifference(const vk::Device& device, const vk::QueryPool& pool, const size_t frameIndex)
+bool Timer::acquireTimestepDifference(const vk::Device& device, const vk::QueryPool& pool, const size_t frameIndex, const uint64_t frameNumber)
 {
-    std::array<uint64_t, 4> fourUints = {3, 3, 3, 3};
+    // value and availability per query
+    std::array<uint64_t, 4> results = {};
 
-    auto res = device.getQueryPoolResults(pool, static_cast<uint32_t>(m_queryIndex + (2 * frameIndex)), 2, sizeof(uint64_t) * 4, fourUints.data(), 2 * sizeof(uint64_t), vk::QueryResultFlagBits::eWithAvailability | vk::QueryResultFlagBits::e64);
-    if (res != vk::Result::eSuccess)
+    // no eWait: the caller knows the frame is finished, a query that is still unavailable was not written
+    const auto res = device.getQueryPoolResults(pool, static_cast<uint32_t>(m_queryIndex + (2 * frameIndex)), 2, sizeof(uint64_t) * 4, results.data(), 2 * sizeof(uint64_t), vk::QueryResultFlagBits::eWithAvailability | vk::QueryResultFlagBits::e64);
+    if (res != vk::Result::eSuccess && res != vk::Result::eNotReady)
         throw std::runtime_error("Query not successful");
 
-    m_lastTimestamp = fourUints.at(0);
-    m_currentTimestamp = fourUints.at(2);
-
-    if constexpr (vg::g_enableValidationLayers)
+    // an older result must not be taken for this frame's
+    if (results.at(1) == 0 || results.at(3) == 0)
     {
-        if (fourUints.at(1) != 1 || fourUints.at(3) != 1)
-            __debugbreak();
+        m_lastTimestamp = 0;
+        m_currentTimestamp = 0;
+        m_lastResultAvailable = false;
+        return false;
     }
 
+    m_lastTimestamp = results.at(0);
+    m_currentTimestamp = results.at(2);
+    m_lastResultAvailable = true;
+    m_lastResultFrame = frameNumber;
+
     // save elapsed time
-    m_timeDiffs.push_back(static_cast<float>((m_currentTimestamp - m_lastTimestamp) / 1'000'000.0));
+    m_statistics.add(toMilliseconds(m_lastTimestamp, m_currentTimestamp));
+    return true;
+}
+
+bool Timer::acquireFrameTimestamp(const vk::Device& device, const vk::QueryPool& pool, const size_t frameIndex, const uint64_t frameNumber)
+{
+    std::array<uint64_t, 2> result = {};
+    const auto res = device.getQueryPoolResults(pool, static_cast<uint32_t>(m_queryIndex + (2 * frameIndex)), 1, sizeof(uint64_t) * 2, result.data(), 2 * sizeof(uint64_t), vk::QueryResultFlagBits::eWithAvailability | vk::QueryResultFlagBits::e64);
+    if (res != vk::Result::eSuccess && res != vk::Result::eNotReady)
+        throw std::runtime_error("Query not successful");
+
+    if (result.at(1) == 0)
+        return false;
 
+    // a difference over skipped frames would show up as a spike
+    if (m_lastResultAvailable && m_lastResultFrame + 1 == frameNumber)
+        m_statistics.add(toMilliseconds(m_lastTimestamp, result.at(0)));
 
-    // max amount of time diffs
-    if (m_timeDiffs.size() > m_maxTimeDiffs)
-        m_timeDiffs.erase(m_timeDiffs.begin());
+    m_lastTimestamp = result.at(0);
+    m_lastResultAvailable = true;
+    m_lastResultFrame = frameNumber;
+    return true;
+}
+
+void Timer::cmdResetQueries(const vk::CommandBuffer& cmdBuffer, const vk::QueryPool& pool, const size_t frameIndex) const
+{
+    cmdBuffer.resetQueryPool(pool, static_cast<uint32_t>(m_queryIndex + (2 * frameIndex)), 2);
 }
 
 void Timer::cmdWriteTimestampStart(const vk::CommandBuffer& cmdBuffer, const vk::PipelineStageFlagBits& stageflags, const vk::QueryPool& pool, const size_t frameIndex) const
@@ -54,9 +79,21 @@ void Timer::cmdWriteTimestampStop(const vk::CommandBuffer& cmdBuffer, const vk::
     cmdBuffer.writeTimestamp(stageflags, pool, static_cast<uint32_t>(m_queryIndex + (2 * frameIndex) + 1));
 }
 
+void Timer::setTimestampProperties(const float timestampPeriod, const uint32_t timestampValidBits)
+{
+    m_timestampPeriod = timestampPeriod;
+    m_timestampMask = timestampValidBits >= 64 ? ~0ull : (1ull << timestampValidBits) - 1;
+}
+
+float Timer::toMilliseconds(const uint64_t start, const uint64_t stop) const
+{
+    // the mask handles a counter that wrapped around between the two timestamps
+    return static_cast<float>(static_cast<double>((stop - start) & m_timestampMask) * m_timestampPeriod / 1'000'000.0);
+}
+
 void Timer::dumpTimediffsToFile()
 {
-    for (auto timeDiff : m_timeDiffs)
+    for (auto timeDiff : m_statistics.getRecentSamples())
         m_logger->info("{},", timeDiff);
 }
 
@@ -64,33 +101,18 @@ void Timer::drawGUIWindow()
 {
     ImGui::SetNextWindowSize(ImVec2(300, 100), ImGuiSetCond_FirstUseEver);
     ImGui::Begin("Performance");
-    float acc = 0;
-    if (m_timeDiffs.size() > m_numFramesToAccumulate + 1)
-    {
-        for (auto i = m_timeDiffs.size() - m_numFramesToAccumulate + 1; i < m_timeDiffs.size(); ++i)
-        {
-            acc += m_timeDiffs.at(i);
-        }
-        acc /= static_cast<float>(m_numFramesToAccumulate);
-    }
-    
-    ImGui::PlotLines("Frametime", m_timeDiffs.data(), static_cast<int>(m_timeDiffs.size()), 0, nullptr, 0.0f, std::numeric_limits<float>::max());
-    ImGui::Value("Frametime (milliseconds)", acc);
+
+    const auto timeDiffs = m_statistics.getRecentSamples();
+    ImGui::PlotLines("Frametime", timeDiffs.data(), static_cast<int>(timeDiffs.size()), 0, nullptr, 0.0f, std::numeric_limits<float>::max());
+    ImGui::Value("Frametime (milliseconds)", m_statistics.getRecentMean(m_numFramesToAccumulate));
+    m_statistics.drawGUI();
    
     ImGui::End();
 }
 
 void Timer::drawGUI()
 {
-    float acc = 0;
-    if (m_timeDiffs.size() > m_numFramesToAccumulate + 1)
-    {
-        for (auto i = m_timeDiffs.size() - m_numFramesToAccumulate + 1; i < m_timeDiffs.size(); ++i)
-        {
-            acc += m_timeDiffs.at(i);
-        }
-        acc /= static_cast<float>(m_numFramesToAccumulate);
-    }
+    const float acc = m_statistics.getRecentMean(m_numFramesToAccumulate);
 
     const float availableWidth = ImGui::GetContentRegionAvailWidth();
     if (availableWidth >= 300)
@@ -100,17 +122,49 @@ void Timer::drawGUI()
 
     //ImGui::PushItemWidth(70);
     ImGui::Text("%.3f ms ", acc);
+    if (ImGui::IsItemHovered())
+    {
+        ImGui::BeginTooltip();
+        m_statistics.drawGUI();
+        ImGui::EndTooltip();
+    }
 
     if (availableWidth >= 300)
     {
         ImGui::SameLine(ImGui::GetWindowContentRegionWidth() - 240);
         ImGui::PushItemWidth(240);
-        const auto offset = static_cast<int>(m_timeDiffs.size() <= 240 ? m_timeDiffs.size() - 1 : 240);
-        if(!m_timeDiffs.empty())
-            ImGui::PlotLines("", &m_timeDiffs.back() - offset, offset, 0, nullptr, 0.0f, std::numeric_limits<float>::max());
+        const auto timeDiffs = m_statistics.getRecentSamples(240);
+        if(!timeDiffs.empty())
+            ImGui::PlotLines("", timeDiffs.data(), static_cast<int>(timeDiffs.size()), 0, nullptr, 0.0f, std::numeric_limits<float>::max());
 
         ImGui::PopItemWidth();
     }
 
     //ImGui::PopItemWidth();
-}
\ No newline at end of file
+}
+
+thread_local GpuTimerScope* GpuTimerScope::s_current = nullptr;
+
+GpuTimerScope::GpuTimerScope(TimerManager& timerManager, const vk::CommandBuffer& cmdBuffer, const std::string& name, const size_t frameIndex,
+    const vk::PipelineStageFlagBits stageflags, const bool resetQueries)
+    : m_timerManager(timerManager), m_cmdBuffer(cmdBuffer), m_previous(s_current),
+      m_parent(m_previous != nullptr && m_previous->m_cmdBuffer == cmdBuffer ? m_previous : nullptr),
+      m_timerName(m_parent != nullptr ? m_parent->m_timerName + "/" + name : name),
+      m_timer(timerManager.getOrAddTimer(m_timerName)),
+      m_frameIndex(frameIndex), m_stageflags(stageflags), m_resetQueries(resetQueries || (m_parent != nullptr && m_parent->m_resetQueries))
+{
+    if (m_timer != nullptr && m_resetQueries)
+        m_timerManager.cmdResetQueries(*m_timer, m_cmdBuffer, m_frameIndex);
+    m_timerManager.cmdBeginLabel(m_cmdBuffer, name);
+    if (m_timer != nullptr)
+        m_timerManager.writeTimestampStart(*m_timer, m_cmdBuffer, m_stageflags, m_frameIndex);
+    s_current = this;
+}
+
+GpuTimerScope::~GpuTimerScope()
+{
+    if (m_timer != nullptr)
+        m_timerManager.writeTimestampStop(*m_timer, m_cmdBuffer, m_stageflags, m_frameIndex);
+    m_timerManager.cmdEndLabel(m_cmdBuffer);
+    s_current = m_previous;
+}
@@ -1,72 +1,101 @@
 #pragma once
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <vulkan/vulkan.hpp>
 #include "graphic/Context.h"
+#include "graphic/GpuClockCalibration.h"
+#include <deque>
 #include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
 #include "imgui/imgui.h"
 #include "spdlog/spdlog.h"
 #include "spdlog/sinks/basic_file_sink.h"
+#include "TimerLogFile.h"
+#include "TimingStatistics.h"
+#include "TraceExporter.h"
 
 class Timer
 {
 public:
+    // getLastResultFrame of results read outside of the frame loop, e.g. of one-time submits, never matches a frame
+    static constexpr uint64_t s_noFrame = ~0ull;
+
     Timer() = default;
     explicit Timer(const bool guiActive) : m_guiActive(guiActive){}
     void acquireCurrentTimestamp(const vk::Device& device, const vk::QueryPool& pool);
-    void acquireTimestepDifference(const vk::Device& device, const vk::QueryPool& pool, const size_t frameIndex);
+    // reads the pair of the given slot without waiting, false (and no sample) if either query was not written since its reset,
+    // which also clears the last result. frameNumber tags the result, see getLastResultFrame
+    bool acquireTimestepDifference(const vk::Device& device, const vk::QueryPool& pool, const size_t frameIndex, uint64_t frameNumber = s_noFrame);
+    // non-blocking acquireCurrentTimestamp for one slot per frame in flight, only adds a sample if the previous frame was read too
+    bool acquireFrameTimestamp(const vk::Device& device, const vk::QueryPool& pool, const size_t frameIndex, uint64_t frameNumber);
+    // queries have to be reset before they are written again, outside of a render pass
+    void cmdResetQueries(const vk::CommandBuffer& cmdBuffer, const vk::QueryPool& pool, const size_t frameIndex = 0) const;
     void cmdWriteTimestampStart(const vk::CommandBuffer& cmdBuffer, const vk::PipelineStageFlagBits& stageflags, const vk::QueryPool& pool, const size_t frameIndex = 0) const;
     void cmdWriteTimestampStop(const vk::CommandBuffer& cmdBuffer, const vk::PipelineStageFlagBits& stageflags, const vk::QueryPool& pool, const size_t frameIndex = 0) const;
     void dumpTimediffsToFile();
     void drawGUIWindow();
     void drawGUI();
-    void incrementTimestamps() { m_timestampsPerFrameWritten++; }
-    void resetTimestamps() { m_timestampsPerFrameWritten = 0; }
-    [[nodiscard]] uint64_t getCurrentNumberOfTimestampsPerFrame() const { return m_timestampsPerFrameWritten; }
     void setQueryIndex(const int32_t index) { m_queryIndex = index; }
+    [[nodiscard]] uint32_t getQueryIndex() const { return m_queryIndex; }
     [[nodiscard]] bool isGuiActive() const { return m_guiActive; }
     void setGuiActiveStatus(const bool status) { m_guiActive = status; }
-    [[nodiscard]] const std::vector<float>& getTimeDiffs() const { return m_timeDiffs; }
+    // snapshot of the most recent time diffs, oldest first, safe to call from another thread
+    [[nodiscard]] std::vector<float> getTimeDiffs() const { return m_statistics.getRecentSamples(); }
+    [[nodiscard]] const TimingStatistics& getStatistics() const { return m_statistics; }
+    void resetStatistics() { m_statistics.reset(); }
+    // raw begin/end timestamps of the last acquireTimestepDifference, only valid if both queries were available
+    [[nodiscard]] uint64_t getLastStartTimestamp() const { return m_lastTimestamp; }
+    [[nodiscard]] uint64_t getLastStopTimestamp() const { return m_currentTimestamp; }
+    [[nodiscard]] bool isLastResultAvailable() const { return m_lastResultAvailable; }
+    [[nodiscard]] uint64_t getLastResultFrame() const { return m_lastResultFrame; }
+    // nanoseconds per tick and valid bits of the queue the timestamps are written on, see vg::Context
+    void setTimestampProperties(float timestampPeriod, uint32_t timestampValidBits);
     void setLogger(std::shared_ptr<spdlog::logger> logger) { m_logger = std::move(logger); }
     [[nodiscard]] const std::shared_ptr<spdlog::logger>& getLogger() const { return m_logger; }
 
 private:
+    [[nodiscard]] float toMilliseconds(uint64_t start, uint64_t stop) const;
+
     uint32_t m_numFramesToAccumulate = 20U;
-    uint32_t m_maxTimeDiffs = 1000U;
     uint32_t m_queryIndex = 0;
     uint64_t m_currentTimestamp = 0;
     uint64_t m_lastTimestamp = 0;
+    bool m_lastResultAvailable = false;
+    uint64_t m_lastResultFrame = 0;
+    float m_timestampPeriod = 1.0f;
+    uint64_t m_timestampMask = ~0ull;
     bool m_guiActive = true;
-    std::vector<float> m_timeDiffs;
-    uint64_t m_timestampsPerFrameWritten = 0;
+    TimingStatistics m_statistics;
 
     std::shared_ptr<spdlog::logger> m_logger = nullptr;
 };
 
+// timers are usually written through GpuTimerScope, which adds them on first use. a timer named "parent/child"
+// is nested in "parent", see GpuTimerScope
 class TimerManager
 {
 public:
-    TimerManager(std::map<std::string, Timer> timers, const vg::Context& context)
-        : m_timers(std::move(timers)), m_context(context)
+    // maxTimers bounds the query pool, i.e. the given timers and all timers added later
+    TimerManager(std::map<std::string, Timer> timers, const vg::Context& context, const uint32_t maxTimers = s_defaultMaxTimers)
+        : m_context(context), m_gpuClock(context), m_maxTimers(std::max(maxTimers, static_cast<uint32_t>(timers.size()))),
+          m_slotCount(static_cast<uint32_t>(context.getSwapChainImages().size()))
     {
-        uint32_t index = 0;
-        for (auto& [name, timer] : m_timers)
-        {
-            timer.setQueryIndex(index);
-            index += 2 * static_cast<uint32_t>(context.getSwapChainImages().size());
+        const vk::QueryPoolCreateInfo qpinfo({}, vk::QueryType::eTimestamp, m_maxTimers * getQueriesPerTimer());
+        m_queryPool = context.getDevice().createQueryPool(qpinfo);
 
-            // create logger and directory
-            auto newName = name;
-            std::replace(newName.begin(), newName.end(), ' ', '_');
-            auto path = vg::g_resourcesPath / std::string("logs");
-            std::filesystem::create_directory(path);
-            path /= newName;
-            path.replace_extension(".csv");
-            timer.setLogger(spdlog::basic_logger_mt(name, path.string()));
-            timer.getLogger()->set_pattern("%v");
-        }
+        for (auto& [name, timer] : timers)
+            addTimer(name, std::move(timer));
 
-        const vk::QueryPoolCreateInfo qpinfo({}, vk::QueryType::eTimestamp, static_cast<uint32_t>(2 * context.getSwapChainImages().size() * m_timers.size()));
-        m_queryPool = context.getDevice().createQueryPool(qpinfo);
+        // labels show the timed scopes in debuggers like RenderDoc and Nsight, the extension is only enabled with the validation layers
+        if constexpr (vg::g_enableValidationLayers)
+        {
+            m_cmdBeginDebugUtilsLabel = reinterpret_cast<PFN_vkCmdBeginDebugUtilsLabelEXT>(vkGetInstanceProcAddr(context.getInstance(), "vkCmdBeginDebugUtilsLabelEXT"));
+            m_cmdEndDebugUtilsLabel = reinterpret_cast<PFN_vkCmdEndDebugUtilsLabelEXT>(vkGetInstanceProcAddr(context.getInstance(), "vkCmdEndDebugUtilsLabelEXT"));
+        }
     }
 
     ~TimerManager()
@@ -74,32 +103,119 @@ public:
         m_context.get().getDevice().destroyQueryPool(m_queryPool);
     }
 
-    void writeTimestampStart(const std::string& timerName, const vk::CommandBuffer& cmdBuffer, const vk::PipelineStageFlagBits& stageflags, const size_t frameIndex)
+    TimerManager(const TimerManager&) = delete;
+    TimerManager& operator=(const TimerManager&) = delete;
+
+    // the timer gets the queries of an erased timer or the next unused ones of the pool, throws if the name exists or the pool is full
+    // the queries of a timer never change, static command buffers keep using them
+    Timer& addTimer(const std::string& timerName, Timer timer = {})
+    {
+        if (m_timers.count(timerName) != 0)
+            throw std::runtime_error("Timer \"" + timerName + "\" already exists");
+        if (!hasFreeQueries())
+            throw std::runtime_error("Timer \"" + timerName + "\" does not fit into the query pool of " + std::to_string(m_maxTimers) + " timers");
+
+        if (!m_freeQueryIndices.empty())
+        {
+            timer.setQueryIndex(m_freeQueryIndices.back());
+            m_freeQueryIndices.pop_back();
+        }
+        else
+        {
+            timer.setQueryIndex(m_nextQueryIndex);
+            m_nextQueryIndex += getQueriesPerTimer();
+        }
+        timer.setTimestampProperties(m_context.get().getTimestampPeriod(), m_context.get().getTimestampValidBits());
+
+        // create logger and directory
+        auto path = vg::g_resourcesPath / std::string("logs");
+        std::filesystem::create_directory(path);
+        path /= TimerLogFile::toFileStem(timerName) + ".csv";
+        timer.setLogger(spdlog::basic_logger_mt(timerName, path.string()));
+        timer.getLogger()->set_pattern("%v");
+
+        return m_timers.emplace(timerName, std::move(timer)).first->second;
+    }
+
+    // the slot has to be reset before a frame writes it again, outside of a render pass and before the first
+    // timestamp on any queue. timers written on another queue are excluded here and reset with cmdResetTimer
+    void cmdResetTimers(const vk::CommandBuffer& cmdBuffer, const size_t frameIndex, const std::set<std::string>& excludedTimers = {}) const
     {
-        Timer& currentTimer = m_timers.at(timerName);
-        currentTimer.incrementTimestamps();
-        currentTimer.cmdWriteTimestampStart(cmdBuffer, stageflags, m_queryPool, frameIndex);
+        for (const auto& [name, timer] : m_timers)
+        {
+            if (excludedTimers.count(name) == 0)
+                timer.cmdResetQueries(cmdBuffer, m_queryPool, frameIndex);
+        }
     }
 
-    void writeTimestampStop(const std::string& timerName, const vk::CommandBuffer& cmdBuffer, const vk::PipelineStageFlagBits& stageflags, const size_t frameIndex)
+    // also resets the nested timers
+    void cmdResetTimer(const std::string& timerName, const vk::CommandBuffer& cmdBuffer, const size_t frameIndex) const
     {
-        Timer& currentTimer = m_timers.at(timerName);
-        currentTimer.incrementTimestamps();
-        currentTimer.cmdWriteTimestampStop(cmdBuffer, stageflags, m_queryPool, frameIndex);
+        for (const auto& [name, timer] : m_timers)
+        {
+            if (isSameOrNested(name, timerName))
+                timer.cmdResetQueries(cmdBuffer, m_queryPool, frameIndex);
+        }
     }
 
+    // only for work the caller already waited for, e.g. one-time submits. also queries the nested timers
+    // the results are tagged with Timer::s_noFrame, so they don't show up in the results of a frame
     void querySpecificTimerResults(const std::string& timerName, const size_t frameIndex = 0)
     {
-        Timer& currentTimer = m_timers.at(timerName);
-        queryTimerResult(currentTimer, timerName, frameIndex);
+        for (auto& [name, timer] : m_timers)
+        {
+            if (isSameOrNested(name, timerName))
+                queryTimerResult(timer, frameIndex, Timer::s_noFrame);
+        }
     }
 
-    void queryAllTimerResults(const size_t frameIndex)
+    // frameNumber writes its timestamps into the slot frameIndex, call while recording it
+    void beginFrame(const uint64_t frameNumber, const size_t frameIndex)
     {
-        for(auto& [name, timer] : m_timers)
+        m_pendingFrames.push_back({ frameNumber, frameIndex, std::chrono::steady_clock::now() });
+        m_lastSubmittedFrame = frameNumber;
+
+        // nobody collects, don't grow forever
+        while (m_pendingFrames.size() > s_maxPendingFrames)
+            m_pendingFrames.pop_front();
+    }
+
+    struct CollectedFrame
+    {
+        uint64_t frameNumber;
+        size_t frameIndex;
+        // milliseconds of the GUI-active timers that had results for this frame, a nested timer is part of its parent's time
+        std::map<std::string, float> timings;
+    };
+
+    // reads the results of every pending frame up to completedFrameNumber without waiting, i.e. call it once that
+    // frame's fence signaled and before its slot is recorded again. the results are tagged with their frame number
+    // (Timer::getLastResultFrame) and, if an exporter is given, added to its capture
+    std::vector<CollectedFrame> collectResults(const uint64_t completedFrameNumber, TraceExporter* exporter = nullptr)
+    {
+        std::vector<CollectedFrame> collected;
+        while (!m_pendingFrames.empty() && m_pendingFrames.front().frameNumber <= completedFrameNumber)
         {
-            queryTimerResult(timer, name, frameIndex);
+            const auto pending = m_pendingFrames.front();
+            m_pendingFrames.pop_front();
+
+            for (auto& [name, timer] : m_timers)
+                queryTimerResult(timer, pending.frameIndex, pending.frameNumber);
+            measureQueueBubbles(pending.frameNumber);
+            if (exporter != nullptr)
+                exportResults(*exporter, pending.frameNumber);
+
+            m_resultLatencyFrames = m_lastSubmittedFrame - pending.frameNumber;
+            m_resultLatency.add(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - pending.recordTime).count());
+            CollectedFrame frame{ pending.frameNumber, pending.frameIndex, {} };
+            for (const auto& [name, timer] : m_timers)
+            {
+                if (timer.isGuiActive() && timer.isLastResultAvailable() && timer.getLastResultFrame() == pending.frameNumber)
+                    frame.timings[name] = timer.getStatistics().getSummary().last;
+            }
+            collected.push_back(std::move(frame));
         }
+        return collected;
     }
 
     void drawTimerGUIs()
@@ -108,11 +224,33 @@ public:
         {
             if(timer.isGuiActive())
             {
-                ImGui::Text(name.c_str());
+                // nested timers are indented below their parent, the map keeps them in that order
+                const auto depth = getNestingDepth(name);
+                for (size_t i = 0; i < depth; i++)
+                    ImGui::Indent();
+                ImGui::Text("%s", name.substr(name.rfind('/') + 1).c_str());
                 ImGui::SameLine();
                 timer.drawGUI();
+                for (size_t i = 0; i < depth; i++)
+                    ImGui::Unindent();
             }
         }
+
+        ImGui::Text("GPU idle between passes");
+        ImGui::SameLine();
+        ImGui::Text("%.3f ms", m_queueBubbleStatistics.getRecentMean(20));
+        if (ImGui::IsItemHovered())
+        {
+            ImGui::BeginTooltip();
+            m_queueBubbleStatistics.drawGUI();
+            ImGui::EndTooltip();
+        }
+        if (m_gpuClock.isStale())
+            ImGui::Text("GPU clock: not aligned, last fence estimate %.0f s ago", std::chrono::duration<double>(m_gpuClock.getSampleAge()).count());
+        else
+            ImGui::Text("GPU clock: %s, +-%.1f us, drifted %.1f us", m_gpuClock.usesCalibratedTimestamps() ? "calibrated timestamps" : "fence estimate",
+                std::chrono::duration<double, std::micro>(m_gpuClock.getMaxDeviation()).count(), std::chrono::duration<double, std::micro>(m_gpuClock.getLastDrift()).count());
+        ImGui::Text("Results arrive %llu frames, %.1f ms after recording", static_cast<unsigned long long>(m_resultLatencyFrames), m_resultLatency.getRecentMean(20));
     }
 
     [[nodiscard]] const Timer& getTimer(const std::string& timerName) const
@@ -130,9 +268,54 @@ public:
         m_timers.at(timerName).setGuiActiveStatus(status);
     }
 
+    // also erases the nested timers. their queries go to the next added timers, so only erase a timer once no
+    // command buffer that writes it is pending or recorded for reuse
     void eraseTimer(const std::string& timerName)
     {
-        m_timers.erase(timerName);
+        for (auto it = m_timers.begin(); it != m_timers.end();)
+        {
+            if (isSameOrNested(it->first, timerName))
+            {
+                spdlog::drop(it->first);
+                m_freeQueryIndices.push_back(it->second.getQueryIndex());
+                it = m_timers.erase(it);
+            }
+            else
+                ++it;
+        }
+    }
+
+    // number of '/' in the name, 0 for a timer that is not nested
+    [[nodiscard]] static size_t getNestingDepth(const std::string& timerName)
+    {
+        return static_cast<size_t>(std::count(timerName.begin(), timerName.end(), '/'));
+    }
+
+    // e.g. after a resolution or scene change, so the percentiles only cover the new configuration
+    void resetAllStatistics()
+    {
+        for (auto& [name, timer] : m_timers)
+            timer.resetStatistics();
+        m_queueBubbleStatistics.reset();
+        m_resultLatency.reset();
+    }
+
+    // keeps the GPU clock mapping from drifting, once per frame. without calibrated timestamps it only resamples
+    // once all fences of the graphics queue's work are signalled
+    void updateGpuClock(const std::vector<vk::Fence>& graphicsFences = {})
+    {
+        m_gpuClock.update(graphicsFences);
+    }
+
+    // a fresh mapping, e.g. at the start of a trace capture. waits for the graphics queue without calibrated timestamps
+    void recalibrateGpuClock()
+    {
+        m_gpuClock.calibrate();
+    }
+
+    [[nodiscard]] const vg::GpuClockCalibration& getGpuClock() const
+    {
+        return m_gpuClock;
     }
 
     void dumpActiveTimerDiffsToFile()
@@ -147,21 +330,178 @@ public:
     }
 
 private:
+    friend class GpuTimerScope;
 
-    void queryTimerResult(Timer& timer, const std::string& name, const size_t frameIndex) const
+    static constexpr uint32_t s_defaultMaxTimers = 64;
+
+    // a begin and an end timestamp per frame slot
+    [[nodiscard]] uint32_t getQueriesPerTimer() const
     {
-        if constexpr (vg::g_enableValidationLayers)
+        return 2 * m_slotCount;
+    }
+
+    [[nodiscard]] static bool isSameOrNested(const std::string& name, const std::string& parentName)
+    {
+        return name.compare(0, parentName.size(), parentName) == 0 && (name.size() == parentName.size() || name.at(parentName.size()) == '/');
+    }
+
+    [[nodiscard]] bool hasFreeQueries() const
+    {
+        return !m_freeQueryIndices.empty() || m_nextQueryIndex + getQueriesPerTimer() <= m_maxTimers * getQueriesPerTimer();
+    }
+
+    // a new nested timer inherits the GUI status of its parent
+    // nullptr if the pool is full, scopes are recorded every frame, so this logs an error once per timer instead of throwing
+    Timer* getOrAddTimer(const std::string& timerName)
+    {
+        if (const auto it = m_timers.find(timerName); it != m_timers.end())
+            return &it->second;
+
+        if (!hasFreeQueries())
+        {
+            if (m_untimedScopes.insert(timerName).second)
+                m_context.get().getLogger()->error("Timer \"{}\" does not fit into the query pool of {} timers, its scope is not timed", timerName, m_maxTimers);
+            return nullptr;
+        }
+
+        bool guiActive = true;
+        if (const auto separator = timerName.rfind('/'); separator != std::string::npos)
+        {
+            if (const auto parent = m_timers.find(timerName.substr(0, separator)); parent != m_timers.end())
+                guiActive = parent->second.isGuiActive();
+        }
+        return &addTimer(timerName, Timer{ guiActive });
+    }
+
+    void cmdResetQueries(const Timer& timer, const vk::CommandBuffer& cmdBuffer, const size_t frameIndex) const
+    {
+        timer.cmdResetQueries(cmdBuffer, m_queryPool, frameIndex);
+    }
+
+    void writeTimestampStart(const Timer& timer, const vk::CommandBuffer& cmdBuffer, const vk::PipelineStageFlagBits& stageflags, const size_t frameIndex) const
+    {
+        timer.cmdWriteTimestampStart(cmdBuffer, stageflags, m_queryPool, frameIndex);
+    }
+
+    void writeTimestampStop(const Timer& timer, const vk::CommandBuffer& cmdBuffer, const vk::PipelineStageFlagBits& stageflags, const size_t frameIndex) const
+    {
+        timer.cmdWriteTimestampStop(cmdBuffer, stageflags, m_queryPool, frameIndex);
+    }
+
+    void cmdBeginLabel(const vk::CommandBuffer& cmdBuffer, const std::string& label) const
+    {
+        if (m_cmdBeginDebugUtilsLabel == nullptr)
+            return;
+        const VkDebugUtilsLabelEXT info = { VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT, nullptr, label.c_str(), {} };
+        m_cmdBeginDebugUtilsLabel(cmdBuffer, &info);
+    }
+
+    void cmdEndLabel(const vk::CommandBuffer& cmdBuffer) const
+    {
+        if (m_cmdEndDebugUtilsLabel != nullptr)
+            m_cmdEndDebugUtilsLabel(cmdBuffer);
+    }
+
+    // time between the first and the last pass of the frame that no timer covers, the queue ran untimed work or
+    // waited, e.g. for a semaphore or for the CPU to submit
+    void measureQueueBubbles(const uint64_t frameNumber)
+    {
+        std::vector<std::pair<vg::GpuClockCalibration::Clock::time_point, vg::GpuClockCalibration::Clock::time_point>> spans;
+        for (const auto& [name, timer] : m_timers)
         {
-            if (const auto numTimeStamps = timer.getCurrentNumberOfTimestampsPerFrame(); numTimeStamps % 2 != 0)
-                m_context.get().getLogger()->warn("Timer \"{}\" has an odd number ({}) of registered Timestamps before querying", name, numTimeStamps);
+            if (timer.isGuiActive() && timer.isLastResultAvailable() && timer.getLastResultFrame() == frameNumber)
+                spans.emplace_back(m_gpuClock.toHostTime(timer.getLastStartTimestamp()), m_gpuClock.toHostTime(timer.getLastStopTimestamp()));
         }
+        if (spans.size() < 2)
+            return;
 
-        timer.acquireTimestepDifference(m_context.get().getDevice(), m_queryPool, frameIndex);
-        timer.resetTimestamps();
+        std::sort(spans.begin(), spans.end());
+        std::chrono::duration<float, std::milli> idle(0);
+        auto coveredUntil = spans.front().second;
+        for (const auto& [begin, end] : spans)
+        {
+            if (begin > coveredUntil)
+                idle += begin - coveredUntil;
+            coveredUntil = std::max(coveredUntil, end);
+        }
+        m_queueBubbleStatistics.add(idle.count());
+    }
+
+    void exportResults(TraceExporter& exporter, const uint64_t frameNumber) const
+    {
+        for (const auto& [name, timer] : m_timers)
+        {
+            if (timer.isGuiActive() && timer.isLastResultAvailable() && timer.getLastResultFrame() == frameNumber)
+                exporter.addGpuSpan(name, frameNumber, m_gpuClock.toHostTime(timer.getLastStartTimestamp()), m_gpuClock.toHostTime(timer.getLastStopTimestamp()));
+        }
+    }
+
+    void queryTimerResult(Timer& timer, const size_t frameIndex, const uint64_t frameNumber) const
+    {
+        timer.acquireTimestepDifference(m_context.get().getDevice(), m_queryPool, frameIndex, frameNumber);
     }
 
     std::map<std::string, Timer> m_timers;
     vk::QueryPool m_queryPool;
     std::reference_wrapper<const vg::Context> m_context;
+    vg::GpuClockCalibration m_gpuClock;
+    uint32_t m_maxTimers;
+    // the frame slots are fixed by the swapchain image count at creation, even if a recreated swapchain has more or fewer images
+    uint32_t m_slotCount;
+    uint32_t m_nextQueryIndex = 0;
+    // first query of each erased timer
+    std::vector<uint32_t> m_freeQueryIndices;
+    // scopes that got no timer because the pool was full, each is reported once
+    std::set<std::string> m_untimedScopes;
+    PFN_vkCmdBeginDebugUtilsLabelEXT m_cmdBeginDebugUtilsLabel = nullptr;
+    PFN_vkCmdEndDebugUtilsLabelEXT m_cmdEndDebugUtilsLabel = nullptr;
+    TimingStatistics m_queueBubbleStatistics{ 0.05f };
+
+    struct PendingFrame
+    {
+        uint64_t frameNumber;
+        size_t frameIndex;
+        std::chrono::steady_clock::time_point recordTime;
+    };
+    static constexpr size_t s_maxPendingFrames = 16;
+    std::deque<PendingFrame> m_pendingFrames;
+    uint64_t m_lastSubmittedFrame = 0;
+    uint64_t m_resultLatencyFrames = 0;
+    TimingStatistics m_resultLatency{ 0.5f };
     
+};
+
+// writes the timestamps of a timer around the commands recorded during its lifetime, and a debug label with its
+// name if the debug utils are enabled. the timer is added on first use. a scope opened while another one is open
+// on the same command buffer is nested: its timer is named "parent/child" and inherits the parent's GUI status
+// begin and end have to be in the same command buffer, so end the scope before ending the command buffer
+// resetQueries resets the queries right before the first timestamp, for command buffers that are not reset by
+// TimerManager::cmdResetTimers, e.g. one-time submits. only outside of a render pass, nested scopes inherit it
+class GpuTimerScope
+{
+public:
+    GpuTimerScope(TimerManager& timerManager, const vk::CommandBuffer& cmdBuffer, const std::string& name, size_t frameIndex,
+        vk::PipelineStageFlagBits stageflags = vk::PipelineStageFlagBits::eAllCommands, bool resetQueries = false);
+    ~GpuTimerScope();
+
+    GpuTimerScope(const GpuTimerScope&) = delete;
+    GpuTimerScope& operator=(const GpuTimerScope&) = delete;
+
+    [[nodiscard]] const std::string& getTimerName() const { return m_timerName; }
+
+private:
+    TimerManager& m_timerManager;
+    vk::CommandBuffer m_cmdBuffer;
+    // the scope that was current before this one, the parent if it is on the same command buffer
+    GpuTimerScope* m_previous;
+    GpuTimerScope* m_parent;
+    std::string m_timerName;
+    // nullptr if the query pool is full, the scope only writes its debug label then
+    const Timer* m_timer;
+    size_t m_frameIndex;
+    vk::PipelineStageFlagBits m_stageflags;
+    bool m_resetQueries;
+
+    // innermost open scope of the recording thread
+    static thread_local GpuTimerScope* s_current;
 };
\ No newline at end of file
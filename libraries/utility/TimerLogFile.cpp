@@ -0,0 +1,47 @@
+#include "TimerLogFile.h"
+#include <cctype>
+#include <cstdio>
+#include <string_view>
+
+namespace
+{
+    constexpr std::string_view s_escapedCharacters = "_%/\\:*?\"<>|";
+}
+
+std::string TimerLogFile::toFileStem(const std::string& timerName)
+{
+    std::string stem;
+    for (const char c : timerName)
+    {
+        if (c == ' ')
+            stem += '_';
+        else if (s_escapedCharacters.find(c) != std::string_view::npos || std::iscntrl(static_cast<unsigned char>(c)))
+        {
+            char escaped[4];
+            std::snprintf(escaped, sizeof(escaped), "%%%02X", static_cast<unsigned char>(c));
+            stem += escaped;
+        }
+        else
+            stem += c;
+    }
+    return stem;
+}
+
+std::string TimerLogFile::toTimerName(const std::string& fileStem)
+{
+    std::string name;
+    for (size_t i = 0; i < fileStem.size(); i++)
+    {
+        const char c = fileStem.at(i);
+        if (c == '_')
+            name += ' ';
+        else if (c == '%' && i + 2 < fileStem.size() && std::isxdigit(static_cast<unsigned char>(fileStem.at(i + 1))) && std::isxdigit(static_cast<unsigned char>(fileStem.at(i + 2))))
+        {
+            name += static_cast<char>(std::stoi(fileStem.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        }
+        else
+            name += c;
+    }
+    return name;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+
+// the file names of the CSVs the timers write to resources/logs, so BenchmarkComparison can read the timer names back
+// spaces become '_' to keep the common names readable, '_', '%' and characters that can't be in a file name (like
+// the '/' of nested timers) are written as "%XX"
+class TimerLogFile
+{
+public:
+    // without the .csv extension
+    [[nodiscard]] static std::string toFileStem(const std::string& timerName);
+
+    // the inverse of toFileStem
+    [[nodiscard]] static std::string toTimerName(const std::string& fileStem);
+};
@@ -0,0 +1,247 @@
+#include "TimingStatistics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <limits>
+#include "imgui/imgui.h"
+
+P2Quantile::P2Quantile(const double quantile) : m_quantile(quantile)
+{
+    reset();
+}
+
+void P2Quantile::reset()
+{
+    m_count = 0;
+    m_heights = {};
+    m_positions = { 0.0, 1.0, 2.0, 3.0, 4.0 };
+    m_desiredPositions = { 0.0, 2.0 * m_quantile, 4.0 * m_quantile, 2.0 + 2.0 * m_quantile, 4.0 };
+    m_increments = { 0.0, m_quantile / 2.0, m_quantile, (1.0 + m_quantile) / 2.0, 1.0 };
+}
+
+void P2Quantile::add(const double x)
+{
+    // the first five samples are the initial markers
+    if (m_count < 5)
+    {
+        m_heights.at(m_count++) = x;
+        if (m_count == 5)
+            std::sort(m_heights.begin(), m_heights.end());
+        return;
+    }
+    m_count++;
+
+    // cell k with heights[k] <= x < heights[k + 1], extreme markers move with the data
+    int k;
+    if (x < m_heights.at(0))
+    {
+        m_heights.at(0) = x;
+        k = 0;
+    }
+    else if (x >= m_heights.at(4))
+    {
+        m_heights.at(4) = x;
+        k = 3;
+    }
+    else
+    {
+        k = static_cast<int>(std::upper_bound(m_heights.begin() + 1, m_heights.begin() + 4, x) - m_heights.begin()) - 1;
+    }
+
+    for (int i = k + 1; i < 5; i++)
+        m_positions.at(i) += 1.0;
+    for (int i = 0; i < 5; i++)
+        m_desiredPositions.at(i) += m_increments.at(i);
+
+    // move the middle markers towards their desired positions, piecewise parabolic, linear if that breaks the order
+    for (int i = 1; i < 4; i++)
+    {
+        const double offset = m_desiredPositions.at(i) - m_positions.at(i);
+        if ((offset >= 1.0 && m_positions.at(i + 1) - m_positions.at(i) > 1.0) || (offset <= -1.0 && m_positions.at(i - 1) - m_positions.at(i) < -1.0))
+        {
+            const int d = offset > 0.0 ? 1 : -1;
+            const double candidate = parabolic(i, d);
+            if (m_heights.at(i - 1) < candidate && candidate < m_heights.at(i + 1))
+                m_heights.at(i) = candidate;
+            else
+                m_heights.at(i) = linear(i, d);
+            m_positions.at(i) += d;
+        }
+    }
+}
+
+double P2Quantile::get() const
+{
+    if (m_count == 0)
+        return 0.0;
+
+    if (m_count < 5)
+    {
+        auto sorted = m_heights;
+        std::sort(sorted.begin(), sorted.begin() + m_count);
+        const auto index = static_cast<size_t>(std::lround(m_quantile * static_cast<double>(m_count - 1)));
+        return sorted.at(index);
+    }
+
+    return m_heights.at(2);
+}
+
+double P2Quantile::parabolic(const int i, const double d) const
+{
+    const auto& q = m_heights;
+    const auto& n = m_positions;
+    return q.at(i) + d / (n.at(i + 1) - n.at(i - 1)) *
+        ((n.at(i) - n.at(i - 1) + d) * (q.at(i + 1) - q.at(i)) / (n.at(i + 1) - n.at(i)) +
+         (n.at(i + 1) - n.at(i) - d) * (q.at(i) - q.at(i - 1)) / (n.at(i) - n.at(i - 1)));
+}
+
+double P2Quantile::linear(const int i, const int d) const
+{
+    return m_heights.at(i) + d * (m_heights.at(i + d) - m_heights.at(i)) / (m_positions.at(i + d) - m_positions.at(i));
+}
+
+
+TimingStatistics::TimingStatistics(const float histogramBinWidth) : m_histogramBinWidth(histogramBinWidth)
+{
+}
+
+TimingStatistics::TimingStatistics(const TimingStatistics& other) : m_histogramBinWidth(other.m_histogramBinWidth)
+{
+    *this = other;
+}
+
+TimingStatistics& TimingStatistics::operator=(const TimingStatistics& other)
+{
+    if (this == &other)
+        return *this;
+
+    for (uint32_t i = 0; i < s_capacity; i++)
+        m_samples.at(i).store(other.m_samples.at(i).load(std::memory_order_relaxed), std::memory_order_relaxed);
+    m_writeIndex.store(other.m_writeIndex.load());
+    m_head.store(other.m_head.load());
+
+    m_count = other.m_count;
+    m_mean = other.m_mean;
+    m_m2 = other.m_m2;
+    m_min = other.m_min;
+    m_max = other.m_max;
+    m_p50 = other.m_p50;
+    m_p95 = other.m_p95;
+    m_p99 = other.m_p99;
+    m_summary.store(other.m_summary.load());
+
+    m_histogramBinWidth = other.m_histogramBinWidth;
+    for (uint32_t i = 0; i < s_histogramBins; i++)
+        m_histogram.at(i).store(other.m_histogram.at(i).load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    return *this;
+}
+
+void TimingStatistics::add(const float milliseconds)
+{
+    // announce the slot first, readers drop what they copied from it (see getRecentSamples)
+    const auto head = m_head.load(std::memory_order_relaxed);
+    m_writeIndex.store(head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_samples.at(head % s_capacity).store(milliseconds, std::memory_order_relaxed);
+    m_head.store(head + 1, std::memory_order_release);
+
+    m_count++;
+    const double delta = milliseconds - m_mean;
+    m_mean += delta / static_cast<double>(m_count);
+    m_m2 += delta * (milliseconds - m_mean);
+    m_min = m_count == 1 ? milliseconds : std::min(m_min, milliseconds);
+    m_max = m_count == 1 ? milliseconds : std::max(m_max, milliseconds);
+    m_p50.add(milliseconds);
+    m_p95.add(milliseconds);
+    m_p99.add(milliseconds);
+
+    const auto bin = std::min(static_cast<uint32_t>(std::max(milliseconds, 0.0f) / m_histogramBinWidth), s_histogramBins - 1);
+    m_histogram.at(bin).fetch_add(1, std::memory_order_relaxed);
+
+    Summary summary;
+    summary.count = m_count;
+    summary.last = milliseconds;
+    summary.min = m_min;
+    summary.max = m_max;
+    summary.mean = static_cast<float>(m_mean);
+    summary.stddev = m_count > 1 ? static_cast<float>(std::sqrt(m_m2 / static_cast<double>(m_count - 1))) : 0.0f;
+    summary.p50 = static_cast<float>(m_p50.get());
+    summary.p95 = static_cast<float>(m_p95.get());
+    summary.p99 = static_cast<float>(m_p99.get());
+    m_summary.store(summary);
+}
+
+void TimingStatistics::reset()
+{
+    m_count = 0;
+    m_mean = 0.0;
+    m_m2 = 0.0;
+    m_min = 0.0f;
+    m_max = 0.0f;
+    m_p50.reset();
+    m_p95.reset();
+    m_p99.reset();
+    m_summary.store(Summary{});
+
+    for (auto& bin : m_histogram)
+        bin.store(0, std::memory_order_relaxed);
+}
+
+std::vector<float> TimingStatistics::getRecentSamples(const uint32_t maxCount) const
+{
+    const auto head = m_head.load(std::memory_order_acquire);
+    const auto count = std::min<uint64_t>({ head, s_capacity, maxCount });
+
+    std::vector<float> samples(count);
+    for (uint64_t i = 0; i < count; i++)
+        samples.at(i) = m_samples.at((head - count + i) % s_capacity).load(std::memory_order_relaxed);
+
+    // the writer may have lapped the oldest copied samples in the meantime, those slots hold newer values now
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const auto writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+    const auto firstValid = writeIndex > s_capacity ? writeIndex - s_capacity : 0;
+    const auto first = head - count;
+    if (firstValid > first)
+        samples.erase(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(std::min(firstValid - first, count)));
+
+    return samples;
+}
+
+float TimingStatistics::getRecentMean(const uint32_t n) const
+{
+    const auto samples = getRecentSamples(n);
+    if (samples.empty())
+        return 0.0f;
+
+    float sum = 0.0f;
+    for (const auto sample : samples)
+        sum += sample;
+    return sum / static_cast<float>(samples.size());
+}
+
+std::array<uint32_t, TimingStatistics::s_histogramBins> TimingStatistics::getHistogram() const
+{
+    std::array<uint32_t, s_histogramBins> histogram{};
+    for (uint32_t i = 0; i < s_histogramBins; i++)
+        histogram.at(i) = m_histogram.at(i).load(std::memory_order_relaxed);
+    return histogram;
+}
+
+// min/mean/max over all samples since the last reset, so single spikes stay visible
+void TimingStatistics::drawGUI() const
+{
+    const auto summary = getSummary();
+    ImGui::Text("%llu samples", static_cast<unsigned long long>(summary.count));
+    ImGui::Text("min %.3f  mean %.3f  max %.3f ms", summary.min, summary.mean, summary.max);
+    ImGui::Text("stddev %.3f ms", summary.stddev);
+    ImGui::Text("p50 %.3f  p95 %.3f  p99 %.3f ms", summary.p50, summary.p95, summary.p99);
+
+    const auto histogram = getHistogram();
+    std::array<float, s_histogramBins> bins{};
+    std::copy(histogram.begin(), histogram.end(), bins.begin());
+    char label[32];
+    std::snprintf(label, sizeof(label), "0 - %.0f ms", m_histogramBinWidth * s_histogramBins);
+    ImGui::PlotHistogram("", bins.data(), static_cast<int>(bins.size()), 0, label, 0.0f, std::numeric_limits<float>::max(), ImVec2(256, 60));
+}
@@ -0,0 +1,152 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// streaming estimate of one quantile with the P-square algorithm (Jain & Chlamtac), O(1) memory and time per sample
+class P2Quantile
+{
+public:
+    explicit P2Quantile(double quantile);
+
+    void add(double x);
+    void reset();
+
+    // exact for the first five samples, 0 without samples
+    [[nodiscard]] double get() const;
+    [[nodiscard]] double getQuantile() const { return m_quantile; }
+
+private:
+    [[nodiscard]] double parabolic(int i, double d) const;
+    [[nodiscard]] double linear(int i, int d) const;
+
+    double m_quantile;
+    uint64_t m_count = 0;
+    // marker heights, actual and desired marker positions and the increments of the desired positions
+    std::array<double, 5> m_heights{};
+    std::array<double, 5> m_positions{};
+    std::array<double, 5> m_desiredPositions{};
+    std::array<double, 5> m_increments{};
+};
+
+// a trivially copyable value written by one thread and read by any number of threads without locks
+// readers retry if the writer published a new value while they were copying
+template <typename T>
+class SeqLockValue
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+    void store(const T& value)
+    {
+        std::array<uint64_t, s_words> words{};
+        std::memcpy(words.data(), &value, sizeof(T));
+
+        const auto sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < s_words; i++)
+            m_words.at(i).store(words.at(i), std::memory_order_relaxed);
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    [[nodiscard]] T load() const
+    {
+        std::array<uint64_t, s_words> words{};
+        uint64_t before, after;
+        do
+        {
+            before = m_sequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < s_words; i++)
+                words.at(i) = m_words.at(i).load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = m_sequence.load(std::memory_order_relaxed);
+        } while (before != after || (before & 1) != 0);
+
+        T value;
+        std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+        return value;
+    }
+
+private:
+    static constexpr size_t s_words = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint64_t> m_sequence = 0;
+    std::array<std::atomic<uint64_t>, s_words> m_words{};
+};
+
+// frame time statistics of one timer: the last s_capacity samples in a ring buffer, min/mean/max/stddev,
+// p50/p95/p99 and a histogram, all updated per sample in O(1)
+// add() and reset() belong to a single writer (the thread reading the queries), the getters can be called
+// from any thread (GUI, exporters) without locks
+class TimingStatistics
+{
+public:
+    static constexpr uint32_t s_capacity = 1024;
+    static constexpr uint32_t s_histogramBins = 64;
+
+    struct Summary
+    {
+        uint64_t count = 0;
+        float last = 0.0f;
+        float min = 0.0f;
+        float max = 0.0f;
+        float mean = 0.0f;
+        float stddev = 0.0f;
+        float p50 = 0.0f;
+        float p95 = 0.0f;
+        float p99 = 0.0f;
+    };
+
+    // the last bin also counts everything above binCount * binWidth
+    explicit TimingStatistics(float histogramBinWidth = 0.5f);
+
+    // copies are made by the writer (e.g. when the timers are set up), not while another thread writes
+    TimingStatistics(const TimingStatistics& other);
+    TimingStatistics& operator=(const TimingStatistics& other);
+
+    void add(float milliseconds);
+
+    // forgets the summary and the histogram, the ring keeps its samples
+    void reset();
+
+    [[nodiscard]] Summary getSummary() const { return m_summary.load(); }
+
+    // up to maxCount of the most recent samples, oldest first
+    [[nodiscard]] std::vector<float> getRecentSamples(uint32_t maxCount = s_capacity) const;
+
+    // mean of up to the last n samples, 0 without samples
+    [[nodiscard]] float getRecentMean(uint32_t n) const;
+
+    // counts per bin, the bins are not updated together, so the counts can be off by the samples added while reading
+    [[nodiscard]] std::array<uint32_t, s_histogramBins> getHistogram() const;
+    [[nodiscard]] float getHistogramBinWidth() const { return m_histogramBinWidth; }
+
+    // summary and histogram as ImGui text, e.g. for a tooltip
+    void drawGUI() const;
+
+private:
+    // ring buffer, m_head counts all samples ever written
+    // m_writeIndex is m_head + 1 while a slot is overwritten, it tells readers which of their copies are stale
+    std::array<std::atomic<float>, s_capacity> m_samples{};
+    std::atomic<uint64_t> m_writeIndex = 0;
+    std::atomic<uint64_t> m_head = 0;
+
+    // Welford's online mean and variance, writer only
+    uint64_t m_count = 0;
+    double m_mean = 0.0;
+    double m_m2 = 0.0;
+    float m_min = 0.0f;
+    float m_max = 0.0f;
+    P2Quantile m_p50{ 0.50 };
+    P2Quantile m_p95{ 0.95 };
+    P2Quantile m_p99{ 0.99 };
+
+    SeqLockValue<Summary> m_summary;
+
+    float m_histogramBinWidth;
+    std::array<std::atomic<uint32_t>, s_histogramBins> m_histogram{};
+};
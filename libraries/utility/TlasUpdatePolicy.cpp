@@ -0,0 +1,156 @@
+#include "TlasUpdatePolicy.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+void TlasUpdatePolicy::setInstances(const uint32_t structureCount, std::vector<Bounds> objectBounds, const std::vector<glm::mat4>& transforms)
+{
+    if (objectBounds.size() != transforms.size())
+        throw std::runtime_error("Every instance needs bounds and a transform");
+
+    m_objectBounds = std::move(objectBounds);
+    m_currentBounds.resize(m_objectBounds.size());
+    m_currentSurfaceAreas.resize(m_objectBounds.size());
+    m_currentSurfaceArea = 0.0f;
+    for (size_t i = 0; i < m_objectBounds.size(); i++)
+    {
+        m_currentBounds.at(i) = transform(m_objectBounds.at(i), transforms.at(i));
+        m_currentSurfaceAreas.at(i) = surfaceArea(m_currentBounds.at(i));
+        m_currentSurfaceArea += m_currentSurfaceAreas.at(i);
+    }
+
+    m_structures.assign(structureCount, { m_currentBounds, std::vector<float>(m_objectBounds.size(), 0.0f) });
+    m_updates.clear();
+    m_pendingRebuilds = 0;
+}
+
+void TlasUpdatePolicy::setTransform(const uint32_t instance, const glm::mat4& transform)
+{
+    m_currentBounds.at(instance) = TlasUpdatePolicy::transform(m_objectBounds.at(instance), transform);
+    m_currentSurfaceArea -= m_currentSurfaceAreas.at(instance);
+    m_currentSurfaceAreas.at(instance) = surfaceArea(m_currentBounds.at(instance));
+    m_currentSurfaceArea += m_currentSurfaceAreas.at(instance);
+
+    for (auto& structure : m_structures)
+        updateAddedSurfaceArea(structure, instance);
+}
+
+bool TlasUpdatePolicy::shouldRebuild(const uint32_t structure) const
+{
+    if (getEstimatedDegradation(structure) <= 1.0f)
+        return false;
+
+    // the first rebuild measures what a rebuild costs, the following frames refit until that measurement arrived
+    if (!m_rebuildTime.has_value())
+        return m_pendingRebuilds == 0;
+    if (!m_refitTime.has_value() || !m_baselineTraceTime.has_value())
+        return false;
+
+    // like renting vs buying: refitting is kept until the time it lost adds up to what the rebuild costs extra
+    return m_structures.at(structure).extraTraceTime >= m_rebuildTime.value() - m_refitTime.value();
+}
+
+void TlasUpdatePolicy::recordUpdate(const uint64_t frameNumber, const uint32_t structure, const bool rebuild)
+{
+    // timings of old frames got lost, e.g. when the timer was hidden
+    while (!m_updates.empty() && m_updates.begin()->first + s_maxPendingFrames < frameNumber)
+    {
+        const auto& update = m_updates.begin()->second;
+        if (update.rebuild && !update.updateTimed)
+            m_pendingRebuilds--;
+        m_updates.erase(m_updates.begin());
+    }
+
+    auto& s = m_structures.at(structure);
+    if (rebuild)
+    {
+        s.buildBounds = m_currentBounds;
+        std::fill(s.addedSurfaceAreas.begin(), s.addedSurfaceAreas.end(), 0.0f);
+        s.addedSurfaceArea = 0.0f;
+        s.extraTraceTime = 0.0f;
+        m_pendingRebuilds++;
+        m_rebuildCount++;
+    }
+
+    const float degradation = getEstimatedDegradation(structure);
+    if (!rebuild && m_baselineTraceTime.has_value())
+        s.extraTraceTime += m_baselineTraceTime.value() * (degradation - 1.0f);
+
+    m_updates[frameNumber] = { rebuild, degradation };
+}
+
+void TlasUpdatePolicy::addUpdateTime(const uint64_t frameNumber, const float milliseconds)
+{
+    const auto it = m_updates.find(frameNumber);
+    if (it == m_updates.end() || it->second.updateTimed)
+        return;
+
+    it->second.updateTimed = true;
+    if (it->second.rebuild)
+    {
+        average(m_rebuildTime, milliseconds);
+        m_pendingRebuilds--;
+    }
+    else
+    {
+        average(m_refitTime, milliseconds);
+    }
+}
+
+void TlasUpdatePolicy::addTraceTime(const uint64_t frameNumber, const float milliseconds)
+{
+    const auto it = m_updates.find(frameNumber);
+    if (it == m_updates.end() || it->second.traceTimed)
+        return;
+
+    // the traversal cost is assumed to grow with the surface area of the tree
+    it->second.traceTimed = true;
+    average(m_baselineTraceTime, milliseconds / it->second.degradation);
+}
+
+float TlasUpdatePolicy::getEstimatedDegradation(const uint32_t structure) const
+{
+    if (m_currentSurfaceArea <= 0.0f)
+        return 1.0f;
+    return (m_currentSurfaceArea + m_structures.at(structure).addedSurfaceArea) / m_currentSurfaceArea;
+}
+
+TlasUpdatePolicy::Bounds TlasUpdatePolicy::transform(const Bounds& bounds, const glm::mat4& transform)
+{
+    Bounds result{ glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest()) };
+    for (int corner = 0; corner < 8; corner++)
+    {
+        const glm::vec3 position((corner & 1) ? bounds.max.x : bounds.min.x, (corner & 2) ? bounds.max.y : bounds.min.y, (corner & 4) ? bounds.max.z : bounds.min.z);
+        const glm::vec3 transformed(transform * glm::vec4(position, 1.0f));
+        result.min = glm::min(result.min, transformed);
+        result.max = glm::max(result.max, transformed);
+    }
+    return result;
+}
+
+float TlasUpdatePolicy::surfaceArea(const Bounds& bounds)
+{
+    const glm::vec3 extent = glm::max(bounds.max - bounds.min, glm::vec3(0.0f));
+    return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+void TlasUpdatePolicy::average(std::optional<float>& value, const float sample)
+{
+    if (!value.has_value())
+        value = sample;
+    else
+        value.value() += s_smoothing * (sample - value.value());
+}
+
+void TlasUpdatePolicy::updateAddedSurfaceArea(Structure& structure, const uint32_t instance) const
+{
+    // the tree was split around the box of the build, refitting grows the ancestors of the instance to roughly the
+    // union of the old and the new box
+    const auto& buildBounds = structure.buildBounds.at(instance);
+    const auto& currentBounds = m_currentBounds.at(instance);
+    const Bounds unionBounds{ glm::min(buildBounds.min, currentBounds.min), glm::max(buildBounds.max, currentBounds.max) };
+    const float added = std::max(surfaceArea(unionBounds) - surfaceArea(buildBounds), 0.0f);
+
+    structure.addedSurfaceArea += added - structure.addedSurfaceAreas.at(instance);
+    structure.addedSurfaceAreas.at(instance) = added;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <vector>
+#include "glm/glm.hpp"
+
+// decides whether a top level acceleration structure is refit or rebuilt.
+// refitting keeps the tree of the last build, so an instance that moved away from its build position stretches the
+// boxes of its ancestors. the quality loss is estimated from the surface area the moved instances add to the tree,
+// and turned into extra trace time with the trace time of a fresh tree. a structure is rebuilt once the extra time
+// accumulated since its last build exceeds what a rebuild costs more than a refit, both measured on the GPU
+class TlasUpdatePolicy
+{
+public:
+    struct Bounds
+    {
+        glm::vec3 min{ 0.0f };
+        glm::vec3 max{ 0.0f };
+    };
+
+    // object space bounds and the transforms of every instance, all structures are built from them
+    void setInstances(uint32_t structureCount, std::vector<Bounds> objectBounds, const std::vector<glm::mat4>& transforms);
+    void setTransform(uint32_t instance, const glm::mat4& transform);
+
+    [[nodiscard]] bool shouldRebuild(uint32_t structure) const;
+    // the structure is updated in the frame with the current transforms, the frame's timings are matched to it later
+    void recordUpdate(uint64_t frameNumber, uint32_t structure, bool rebuild);
+
+    // GPU timings of a frame, frames without a recorded update are ignored
+    void addUpdateTime(uint64_t frameNumber, float milliseconds);
+    void addTraceTime(uint64_t frameNumber, float milliseconds);
+
+    [[nodiscard]] uint32_t getStructureCount() const { return static_cast<uint32_t>(m_structures.size()); }
+    // surface area of the refit tree relative to a fresh build, 1 right after a rebuild
+    [[nodiscard]] float getEstimatedDegradation(uint32_t structure) const;
+    [[nodiscard]] float getAccumulatedExtraTraceTime(uint32_t structure) const { return m_structures.at(structure).extraTraceTime; }
+    [[nodiscard]] std::optional<float> getRebuildTime() const { return m_rebuildTime; }
+    [[nodiscard]] std::optional<float> getRefitTime() const { return m_refitTime; }
+    [[nodiscard]] std::optional<float> getBaselineTraceTime() const { return m_baselineTraceTime; }
+    [[nodiscard]] uint64_t getRebuildCount() const { return m_rebuildCount; }
+
+private:
+    struct Structure
+    {
+        // world space bounds of the instances at the last build
+        std::vector<Bounds> buildBounds;
+        // by instance, how much the box of the instance grew the tree
+        std::vector<float> addedSurfaceAreas;
+        float addedSurfaceArea = 0.0f;
+        // estimated trace time lost to refitting since the last build
+        float extraTraceTime = 0.0f;
+    };
+
+    struct Update
+    {
+        bool rebuild = false;
+        float degradation = 1.0f;
+        bool updateTimed = false;
+        bool traceTimed = false;
+    };
+
+    // weight of a new sample in the running averages
+    static constexpr float s_smoothing = 0.1f;
+    // updates older than this won't get timings anymore
+    static constexpr uint64_t s_maxPendingFrames = 64;
+
+    static Bounds transform(const Bounds& bounds, const glm::mat4& transform);
+    static float surfaceArea(const Bounds& bounds);
+    static void average(std::optional<float>& value, float sample);
+
+    void updateAddedSurfaceArea(Structure& structure, uint32_t instance) const;
+
+    std::vector<Bounds> m_objectBounds;
+    std::vector<Bounds> m_currentBounds;
+    std::vector<float> m_currentSurfaceAreas;
+    float m_currentSurfaceArea = 0.0f;
+    std::vector<Structure> m_structures;
+
+    // by frame number
+    std::map<uint64_t, Update> m_updates;
+    // rebuilds that were recorded but not timed yet
+    uint32_t m_pendingRebuilds = 0;
+    std::optional<float> m_rebuildTime;
+    std::optional<float> m_refitTime;
+    // trace time with a freshly built tree
+    std::optional<float> m_baselineTraceTime;
+    uint64_t m_rebuildCount = 0;
+};
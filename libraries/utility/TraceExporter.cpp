@@ -0,0 +1,142 @@
+#include "TraceExporter.h"
+#include <fstream>
+#include <iomanip>
+
+namespace
+{
+    // process ids of the two groups of tracks in the viewer
+    constexpr int s_cpuProcess = 1;
+    constexpr int s_gpuProcess = 2;
+
+    std::string escapeJson(const std::string& text)
+    {
+        std::string escaped;
+        escaped.reserve(text.size());
+        for (const char c : text)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            if (static_cast<unsigned char>(c) >= 0x20)
+                escaped += c;
+        }
+        return escaped;
+    }
+}
+
+void TraceExporter::beginCapture()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_events.clear();
+    m_captureStart = Clock::now();
+    m_capturing.store(true, std::memory_order_relaxed);
+}
+
+bool TraceExporter::endCapture(const std::filesystem::path& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_capturing.store(false, std::memory_order_relaxed);
+
+    std::ofstream file(path);
+    if (!file.is_open())
+        return false;
+
+    // the viewer expects microseconds
+    file << std::fixed << std::setprecision(3);
+    const auto micros = [](const int64_t nanoseconds) { return static_cast<double>(nanoseconds) / 1000.0; };
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << s_cpuProcess << ",\"tid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << s_gpuProcess << ",\"tid\":0,\"args\":{\"name\":\"GPU\"}},\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << s_gpuProcess << ",\"tid\":0,\"args\":{\"name\":\"Graphics queue\"}}";
+    for (const auto& [track, name] : m_trackNames)
+        file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << s_cpuProcess << ",\"tid\":" << track << ",\"args\":{\"name\":\"" << escapeJson(name) << "\"}}";
+
+    for (const auto& event : m_events)
+    {
+        file << ",\n{\"name\":\"" << escapeJson(event.name) << "\"";
+        switch (event.type)
+        {
+        case EventType::CpuScope:
+            file << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":" << s_cpuProcess << ",\"tid\":" << event.track
+                << ",\"ts\":" << micros(event.begin) << ",\"dur\":" << micros(event.duration);
+            break;
+        case EventType::GpuSpan:
+            file << ",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":" << s_gpuProcess << ",\"tid\":0"
+                << ",\"ts\":" << micros(event.begin) << ",\"dur\":" << micros(event.duration);
+            break;
+        case EventType::FrameMarker:
+            // global scope: a line through all tracks
+            file << ",\"cat\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":" << s_cpuProcess << ",\"tid\":" << event.track
+                << ",\"ts\":" << micros(event.begin);
+            break;
+        }
+        file << ",\"args\":{\"frame\":" << event.frame << "}}";
+    }
+    file << "\n]}\n";
+
+    return file.good();
+}
+
+void TraceExporter::setThreadName(const std::string& name)
+{
+    setThreadName(std::this_thread::get_id(), name);
+}
+
+void TraceExporter::setThreadName(const std::thread::id thread, const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_trackNames[trackOf(thread)] = name;
+}
+
+void TraceExporter::beginFrame(const uint64_t frameNumber)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_currentFrame = frameNumber;
+    if (!isCapturing())
+        return;
+
+    m_events.push_back({ EventType::FrameMarker, "Frame " + std::to_string(frameNumber), trackOf(std::this_thread::get_id()), toCaptureTime(Clock::now()), 0, frameNumber });
+}
+
+void TraceExporter::addCpuScope(const char* name, const Clock::time_point begin, const Clock::time_point end)
+{
+    addCpuScope(name, begin, end, std::this_thread::get_id());
+}
+
+void TraceExporter::addCpuScope(const char* name, const Clock::time_point begin, const Clock::time_point end, const std::thread::id thread)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!isCapturing())
+        return;
+
+    m_events.push_back({ EventType::CpuScope, name, trackOf(thread), toCaptureTime(begin), toCaptureTime(end) - toCaptureTime(begin), m_currentFrame });
+}
+
+void TraceExporter::addGpuSpan(const std::string& name, const uint64_t frameNumber, const Clock::time_point begin, const Clock::time_point end)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!isCapturing() || end < begin)
+        return;
+
+    m_events.push_back({ EventType::GpuSpan, name, 0, toCaptureTime(begin), toCaptureTime(end) - toCaptureTime(begin), frameNumber });
+}
+
+size_t TraceExporter::getEventCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_events.size();
+}
+
+uint32_t TraceExporter::trackOf(const std::thread::id thread)
+{
+    // track 0 is the first thread that shows up, usually the main thread
+    const auto [it, inserted] = m_tracks.try_emplace(thread, static_cast<uint32_t>(m_tracks.size()));
+    if (inserted)
+        m_trackNames.try_emplace(it->second, "Thread " + std::to_string(it->second));
+    return it->second;
+}
+
+int64_t TraceExporter::toCaptureTime(const Clock::time_point time) const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time - m_captureStart).count();
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// records CPU scopes and GPU pass spans while a capture is running and writes them as Chrome Trace Event JSON,
+// which chrome://tracing and ui.perfetto.dev open directly
+// CPU scopes can be added from any thread, each thread gets its own track, the GPU passes share one track
+// frame markers span all tracks, so stalls can be attributed to a frame
+class TraceExporter
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // drops the events of a previous capture
+    void beginCapture();
+
+    // writes everything captured since beginCapture(), returns false if the file could not be written
+    bool endCapture(const std::filesystem::path& path);
+
+    [[nodiscard]] bool isCapturing() const { return m_capturing.load(std::memory_order_relaxed); }
+
+    // names the track of the calling thread
+    void setThreadName(const std::string& name);
+    void setThreadName(std::thread::id thread, const std::string& name);
+
+    // marker on every track, the events added afterwards belong to this frame
+    void beginFrame(uint64_t frameNumber);
+
+    void addCpuScope(const char* name, Clock::time_point begin, Clock::time_point end);
+    // for scopes recorded on another thread and added later, see CpuProfiler::collect
+    void addCpuScope(const char* name, Clock::time_point begin, Clock::time_point end, std::thread::id thread);
+
+    // GPU times already mapped to the host clock, see vg::GpuClockCalibration
+    // frameNumber is the frame the results were read back in
+    void addGpuSpan(const std::string& name, uint64_t frameNumber, Clock::time_point begin, Clock::time_point end);
+
+    [[nodiscard]] size_t getEventCount() const;
+
+private:
+    enum class EventType { CpuScope, GpuSpan, FrameMarker };
+
+    struct Event
+    {
+        EventType type;
+        std::string name;
+        uint32_t track;
+        // nanoseconds since the start of the capture
+        int64_t begin;
+        int64_t duration;
+        uint64_t frame;
+    };
+
+    [[nodiscard]] uint32_t trackOf(std::thread::id thread);
+    [[nodiscard]] int64_t toCaptureTime(Clock::time_point time) const;
+
+    std::atomic<bool> m_capturing = false;
+    Clock::time_point m_captureStart;
+    uint64_t m_currentFrame = 0;
+
+    mutable std::mutex m_mutex;
+    std::vector<Event> m_events;
+    std::map<std::thread::id, uint32_t> m_tracks;
+    std::map<uint32_t, std::string> m_trackNames;
+};
@@ -50,10 +50,15 @@ layout (push_constant) uniform perFramePush
     mat4 proj;
     vec4 cameraPos;
     float exposure;
-    int useLowResReflections;
+    int useLowResReflections; // unused, LOW_RES_REFLECTIONS selects the image
+    vec2 renderScale; // the g-buffer and RT images are only filled in [0, renderScale]
 } matrices;
 
+// 0: sample the full resolution reflection image, 1: the half resolution one
+layout(constant_id = 5) const int LOW_RES_REFLECTIONS = 0;
+
 #include "pbrLight.glsl"
+#include "materialLayout.glsl"
 
 layout(set = 2, binding = 0) uniform sampler2DArray shadowDirectionalImage;
 layout(set = 2, binding = 1) uniform sampler2DArray shadowPointImage;
@@ -65,7 +70,10 @@ layout(set = 2, binding = 5) uniform sampler2D reflectionLowResImage;
 
 void main() 
 { 
-    vec4 posAndID = texture(gbufferPositionSampler, inUV);
+    // upscale from the dynamic resolution sub-rectangle, clamped so filtering doesn't read outside of it
+    const vec2 renderUV = min(inUV * matrices.renderScale, matrices.renderScale - 0.5f / vec2(textureSize(gbufferPositionSampler, 0)));
+
+    vec4 posAndID = texture(gbufferPositionSampler, renderUV);
     vec3 WorldPos = posAndID.xyz;
     int drawID = int(posAndID.w);
 
@@ -79,10 +87,10 @@ void main()
         return;
     }
     // normal in world space
-    vec3 N = normalize(texture(gbufferNormalSampler, inUV).xyz); 
+    vec3 N = normalize(texture(gbufferNormalSampler, renderUV).xyz); 
 
     PerMeshInfoPBR currentMeshInfo = perMeshInfos.perMesh[drawID];
-    vec4 uvLOD = texture(gbufferUVSampler, inUV);
+    vec4 uvLOD = texture(gbufferUVSampler, renderUV);
 
     MaterialInfoPBR material = materials[currentMeshInfo.assimpMaterialIndex];
     //todo use "correct" mixed f0
@@ -99,22 +107,14 @@ void main()
         metallicRoughness = textureLod(allTextures[currentMeshInfo.texIndexMetallicRoughness], uvLOD.xy, uvLOD.w).xyz;
     else
     {
-        #ifdef FBX
-        metallicRoughness = vec3(0.0f, material.roughness, material.metalness); // what is z? // FBX
-        #else
-        metallicRoughness = vec3(material.metalness, material.roughness, 0.0f); // what is z? // GLTF
-        #endif
+        metallicRoughness = packMetallicRoughness(material.metalness, material.roughness);
     }
 
-    #ifdef FBX
-    float metallic = metallicRoughness.z; // FBX
-    #else
-    float metallic = metallicRoughness.x; // GLTF
-    #endif
+    float metallic = getMetallic(metallicRoughness);
     float roughness = metallicRoughness.y + 0.01;
     
     ///////////// AO
-    float ao = texture(rtaoImage, inUV).x;
+    float ao = texture(rtaoImage, renderUV).x;
 
     // viewing vector
     vec3 V = normalize(matrices.cameraPos.xyz - WorldPos);
@@ -124,9 +124,9 @@ void main()
     //F0 = material.f0;
 
     vec3 Lo = vec3(0.0);
-    for(int i = 0; i < dirLights.length(); ++i) 
+    for(int i = 0; i < DIR_LIGHT_COUNT; ++i) 
     {
-        float dirShadow = texture(shadowDirectionalImage, vec3(inUV, i)).x;
+        float dirShadow = texture(shadowDirectionalImage, vec3(renderUV, i)).x;
 
         // get light parameters
         PBRDirectionalLight currentLight = dirLights[i];
@@ -159,9 +159,9 @@ void main()
         Lo += (kD * albedo / PI + specular) * radiance * NdotL * dirShadow; 
     }   
 
-    for(int i = 0; i < pointLights.length(); ++i) 
+    for(int i = 0; i < POINT_LIGHT_COUNT; ++i) 
     {
-        float pointShadow = texture(shadowPointImage, vec3(inUV, i)).x;
+        float pointShadow = texture(shadowPointImage, vec3(renderUV, i)).x;
 
         // get light parameters
         PBRPointLight currentLight = pointLights[i];
@@ -196,9 +196,9 @@ void main()
         Lo += (kD * albedo / PI + specular) * radiance * NdotL * pointShadow; 
     }
 
-    for(int i = 0; i < spotLights.length(); ++i) 
+    for(int i = 0; i < SPOT_LIGHT_COUNT; ++i) 
     {
-        float spotShadow = texture(shadowSpotImage, vec3(inUV, i)).x;
+        float spotShadow = texture(shadowSpotImage, vec3(renderUV, i)).x;
 
         // get light parameters
         PBRSpotLight currentLight = spotLights[i];
@@ -244,10 +244,10 @@ void main()
     kD *= 1.0 - metallic;
 
     vec3 reflectionColor;
-    if(matrices.useLowResReflections == 0)
-        reflectionColor = texture(reflectionImage, inUV).xyz;
+    if(LOW_RES_REFLECTIONS == 0)
+        reflectionColor = texture(reflectionImage, renderUV).xyz;
     else
-        reflectionColor = texture(reflectionLowResImage, inUV).xyz;
+        reflectionColor = texture(reflectionLowResImage, renderUV).xyz;
 
     vec3 backgroundAmbient = vec3(0.003f);
     vec3 color = (backgroundAmbient * (albedo / PI) * kD * ao + reflectionColor) + Lo;
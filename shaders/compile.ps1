@@ -6,6 +6,64 @@ param(
 $startoutput = "Compiling shaders using " + $Compiler
 Write-Output $startoutput
 
+# the hash of a source and its includes, the same as ShaderCompiler::sourceHash
+# it is written to <shader>.spv.hash, builds without shaderc only load a .spv if its hash matches the current source
+Add-Type -TypeDefinition @"
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text.RegularExpressions;
+
+public static class ShaderSourceHash
+{
+    static readonly Regex IncludeRegex = new Regex("^\\s*#\\s*include\\s*[<\"]([^>\"]+)[>\"]");
+
+    public static string Compute(string shaderRoot, string file)
+    {
+        ulong hash = 14695981039346656037UL;
+        Visit(Path.GetFullPath(shaderRoot), Path.GetFullPath(file), new HashSet<string>(StringComparer.OrdinalIgnoreCase), ref hash);
+        return hash.ToString("x16");
+    }
+
+    static void Visit(string shaderRoot, string file, HashSet<string> visited, ref ulong hash)
+    {
+        if (!visited.Add(file))
+            return;
+
+        var source = new List<byte>();
+        foreach (var b in File.ReadAllBytes(file))
+            if (b != (byte)'\r')
+                source.Add(b);
+
+        foreach (var b in source)
+        {
+            hash ^= b;
+            hash *= 1099511628211UL;
+        }
+        hash ^= 0xff;
+        hash *= 1099511628211UL;
+
+        var text = System.Text.Encoding.UTF8.GetString(source.ToArray());
+        foreach (var line in text.Split('\n'))
+        {
+            var match = IncludeRegex.Match(line);
+            if (!match.Success)
+                continue;
+
+            var candidates = new[] { Path.Combine(Path.GetDirectoryName(file), match.Groups[1].Value), Path.Combine(shaderRoot, "include", match.Groups[1].Value) };
+            foreach (var candidate in candidates)
+            {
+                if (File.Exists(candidate))
+                {
+                    Visit(shaderRoot, Path.GetFullPath(candidate), visited, ref hash);
+                    break;
+                }
+            }
+        }
+    }
+}
+"@
+
 $types = @("*.vert", "*.frag", "*.tesc", "*.tese", "*.geom", "*.comp", "*.rgen", "*.rchit", "*.rmiss", "*.rahit")
 $files = Get-Childitem $Folder -Include $types -Recurse -File
 
@@ -14,13 +72,13 @@ foreach($file in $files)
 {
     if($Compiler -eq "glslc")
     {
-        # GLTF
+        # material layout (GLTF/FBX) is a specialization constant, one binary serves both
         $command = "$Env:VK_SDK_PATH\Bin\glslc.exe $file -o $file.spv -c -I include --target-env=vulkan1.1 $Flags"
         Invoke-Expression $command
-
-        # FBX
-        $command = "$Env:VK_SDK_PATH\Bin\glslc.exe $file -o $file.fbx.spv -c -I include --target-env=vulkan1.1 -DFBX $Flags"
-        Invoke-Expression $command
+        if($LASTEXITCODE -eq 0)
+        {
+            [ShaderSourceHash]::Compute($PSScriptRoot, $file) | Set-Content -NoNewline "$file.spv.hash"
+        }
 
         $name = [System.IO.Path]::GetFileName($file)
         $end = [System.IO.Path]::GetDirectoryName($file).split("\")
@@ -32,6 +90,10 @@ foreach($file in $files)
     {
         $command = "$Env:VK_SDK_PATH\Bin\glslangvalidator.exe -V $file -o $file.spv --target-env vulkan1.1"
         Invoke-Expression $command
+        if($LASTEXITCODE -eq 0)
+        {
+            [ShaderSourceHash]::Compute($PSScriptRoot, $file) | Set-Content -NoNewline "$file.spv.hash"
+        }
     }
     else
     {
@@ -0,0 +1,14 @@
+// channel layout of the metallic/roughness texture, set per scene as a specialization constant
+// 0: GLTF (metalness in x), 1: FBX (metalness in z)
+layout(constant_id = 1) const int MATERIAL_CHANNEL_LAYOUT = 0;
+
+// material constants if there is no metallic/roughness texture, in the same layout as the texture
+vec3 packMetallicRoughness(float metalness, float roughness)
+{
+    return MATERIAL_CHANNEL_LAYOUT == 1 ? vec3(0.0f, roughness, metalness) : vec3(metalness, roughness, 0.0f);
+}
+
+float getMetallic(vec3 metallicRoughness)
+{
+    return MATERIAL_CHANNEL_LAYOUT == 1 ? metallicRoughness.z : metallicRoughness.x;
+}
@@ -40,6 +40,16 @@ layout(set = 1, binding = 2) readonly buffer spotLightBuffer
     PBRSpotLight spotLights[];
 };
 
+// light counts, fixed per pipeline when specialized so the light loops can be unrolled
+// -1 (default) reads the buffer length at runtime
+layout(constant_id = 2) const int NUM_DIR_LIGHTS = -1;
+layout(constant_id = 3) const int NUM_POINT_LIGHTS = -1;
+layout(constant_id = 4) const int NUM_SPOT_LIGHTS = -1;
+
+#define DIR_LIGHT_COUNT (NUM_DIR_LIGHTS >= 0 ? NUM_DIR_LIGHTS : dirLights.length())
+#define POINT_LIGHT_COUNT (NUM_POINT_LIGHTS >= 0 ? NUM_POINT_LIGHTS : pointLights.length())
+#define SPOT_LIGHT_COUNT (NUM_SPOT_LIGHTS >= 0 ? NUM_SPOT_LIGHTS : spotLights.length())
+
 
 // Trowbridge-Reitz GGX
 // statistically approximates the ratio of microfacets aligned
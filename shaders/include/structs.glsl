@@ -14,6 +14,7 @@ struct RTperFrameInfo2
     int RTReflectionSampleCount;
     int RTUseLowResReflections;
     float RTReflectionRoughnessThreshold;
+    vec2 renderScale;
 };
 
 struct MaterialInfoPBR
@@ -44,6 +45,8 @@ struct OffsetInfo
     int m_ibOffset;
     int m_diffTextureID;
     int m_specTextureID;
+    // first entry of the mesh in the primitive mesh buffer
+    int m_firstPrimitive;
 };
 
 struct VertexInfo
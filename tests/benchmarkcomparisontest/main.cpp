@@ -0,0 +1,139 @@
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "utility/BenchmarkComparison.h"
+#include "utility/TimerLogFile.h"
+
+// checks BenchmarkComparison on synthetic frame times with a fixed seed, and that the timer CSVs load under the timer names
+namespace
+{
+    int g_failures = 0;
+
+    void check(const bool condition, const std::string& message)
+    {
+        if (!condition)
+        {
+            std::printf("FAILED: %s\n", message.c_str());
+            g_failures++;
+        }
+    }
+
+    // skewed like real frame times: a floor, gamma distributed noise and rare hitches
+    std::vector<float> frameTimes(std::mt19937& generator, const float median, const size_t count)
+    {
+        std::gamma_distribution<float> noise(2.0f, 0.05f * median);
+        std::bernoulli_distribution hitch(0.01);
+        std::vector<float> samples(count);
+        for (auto& sample : samples)
+            sample = 0.9f * median + noise(generator) + (hitch(generator) ? 2.0f * median : 0.0f);
+        return samples;
+    }
+
+    BenchmarkComparison::Result compareOne(const std::vector<float>& baseline, const std::vector<float>& candidate)
+    {
+        const auto results = BenchmarkComparison::compare({ { "frame", baseline } }, { { "frame", candidate } }, {});
+        if (results.size() != 1)
+            throw std::runtime_error("expected one compared series");
+        return results.front();
+    }
+
+    void testIdentical(std::mt19937& generator)
+    {
+        const auto run = frameTimes(generator, 10.0f, 500);
+        const auto same = compareOne(run, run);
+        check(same.delta == 0.0 && !same.regression && !same.improvement, "a run compared with itself is unchanged");
+        check(same.pValue > 0.99, "a run compared with itself has p ~ 1, got " + std::to_string(same.pValue));
+
+        const auto rerun = compareOne(run, frameTimes(generator, 10.0f, 500));
+        check(!rerun.regression && !rerun.improvement, "a rerun of the same distribution is not flagged");
+        check(rerun.deltaLow <= 0.0 && rerun.deltaHigh >= 0.0, "the interval of a rerun contains 0");
+    }
+
+    void testShift(std::mt19937& generator)
+    {
+        const auto slower = compareOne(frameTimes(generator, 10.0f, 500), frameTimes(generator, 11.0f, 500));
+        check(slower.regression && !slower.improvement, "a 10% slower run is a regression");
+        check(slower.deltaLow > 0.0 && slower.pValue < 0.01, "the slowdown is significant");
+        check(std::abs(slower.relativeDelta - 0.1) < 0.03, "the slowdown is about 10%, got " + std::to_string(slower.relativeDelta));
+
+        const auto belowThreshold = compareOne(frameTimes(generator, 10.0f, 500), frameTimes(generator, 10.2f, 500));
+        check(!belowThreshold.regression, "a 2% slowdown is below the default threshold");
+    }
+
+    void testImprovement(std::mt19937& generator)
+    {
+        const auto faster = compareOne(frameTimes(generator, 10.0f, 500), frameTimes(generator, 9.0f, 500));
+        check(faster.improvement && !faster.regression, "a 10% faster run is an improvement");
+        check(faster.deltaHigh < 0.0, "the whole interval of the improvement is below 0");
+    }
+
+    // runs of the same distribution may only differ significantly at about the rate alpha
+    void testFalsePositiveRate(std::mt19937& generator)
+    {
+        const BenchmarkComparison::Settings settings;
+        constexpr int trials = 2000;
+        int positives = 0;
+        for (int i = 0; i < trials; i++)
+        {
+            if (BenchmarkComparison::mannWhitneyU(frameTimes(generator, 10.0f, 200), frameTimes(generator, 10.0f, 200)) < settings.alpha)
+                positives++;
+        }
+        // the expected count is 20 with a standard deviation of about 4.5
+        const double rate = static_cast<double>(positives) / trials;
+        check(rate <= 2.0 * settings.alpha, "false positive rate " + std::to_string(rate) + " at alpha " + std::to_string(settings.alpha));
+    }
+
+    void testCsvNames()
+    {
+        const std::vector<std::string> names = { "0 AS Update", "AS Build/Top level", "my_timer", "100% load" };
+        for (const auto& name : names)
+            check(TimerLogFile::toTimerName(TimerLogFile::toFileStem(name)) == name, "\"" + name + "\" round-trips through its file name");
+        check(TimerLogFile::toFileStem("0 AS Update") == "0_AS_Update", "spaces are written as '_'");
+        check(TimerLogFile::toFileStem("AS Build/Top level").find('/') == std::string::npos, "nested timers don't create folders");
+
+        const auto folder = std::filesystem::temp_directory_path() / "benchmarkcomparisontest";
+        std::filesystem::remove_all(folder);
+        std::filesystem::create_directories(folder);
+        for (const auto& name : names)
+        {
+            std::ofstream file(folder / (TimerLogFile::toFileStem(name) + ".csv"));
+            file << "1.5,\n2.5,\n";
+        }
+
+        const auto samples = BenchmarkComparison::load(folder);
+        check(samples.size() == names.size(), "every CSV is loaded");
+        for (const auto& name : names)
+        {
+            const auto it = samples.find(name);
+            check(it != samples.end() && it->second == std::vector<float>{ 1.5f, 2.5f }, "the CSV of \"" + name + "\" loads under its timer name");
+        }
+        std::filesystem::remove_all(folder);
+    }
+}
+
+int main()
+{
+    try
+    {
+        std::mt19937 generator(20240611);
+        testIdentical(generator);
+        testShift(generator);
+        testImprovement(generator);
+        testFalsePositiveRate(generator);
+        testCsvNames();
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("FAILED: %s\n", e.what());
+        return 1;
+    }
+
+    std::printf("%s\n", g_failures == 0 ? "all checks passed" : (std::to_string(g_failures) + " checks failed").c_str());
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "utility/DynamicResolutionController.h"
+
+// replays recorded GPU frame times through the DynamicResolutionController and checks the scale it picks per frame.
+// the argument is this folder, trace.csv holds one "<frame time>,<expected scale>" line per frame
+namespace
+{
+    int g_failures = 0;
+
+    void check(const bool condition, const std::string& message)
+    {
+        if (!condition)
+        {
+            std::printf("FAILED: %s\n", message.c_str());
+            g_failures++;
+        }
+    }
+
+    struct TraceFrame
+    {
+        float frameTime;
+        float expectedScale;
+    };
+
+    std::vector<TraceFrame> loadTrace(const std::filesystem::path& file)
+    {
+        std::ifstream in(file);
+        if (!in.is_open())
+            throw std::runtime_error("Failed to open " + file.string());
+
+        std::vector<TraceFrame> frames;
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (line.empty() || line.front() == '#')
+                continue;
+            const auto comma = line.find(',');
+            frames.push_back({ std::stof(line.substr(0, comma)), std::stof(line.substr(comma + 1)) });
+        }
+        return frames;
+    }
+
+    void testDisabledByDefault()
+    {
+        DynamicResolutionController controller;
+        check(!controller.isEnabled(), "the controller is opt-in");
+        check(!controller.update(100.0f) && controller.getScale() == controller.getSettings().maxScale, "a disabled controller keeps the full resolution");
+    }
+
+    void testReplay(const std::vector<TraceFrame>& trace)
+    {
+        DynamicResolutionController controller;
+        controller.setEnabled(true);
+        const auto& settings = controller.getSettings();
+
+        size_t lastChange = 0;
+        bool changed = false;
+        for (size_t i = 0; i < trace.size(); i++)
+        {
+            const auto previousScale = controller.getScale();
+            controller.update(trace.at(i).frameTime);
+            const auto scale = controller.getScale();
+
+            if (std::abs(scale - trace.at(i).expectedScale) > 1e-4f)
+            {
+                check(false, "frame " + std::to_string(i) + ": scale " + std::to_string(scale) + ", expected " + std::to_string(trace.at(i).expectedScale));
+                return;
+            }
+            check(scale >= settings.minScale && scale <= settings.maxScale, "frame " + std::to_string(i) + ": scale out of range");
+            const auto steps = scale / settings.scaleStep;
+            check(std::abs(steps - std::round(steps)) < 1e-3f, "frame " + std::to_string(i) + ": scale is not quantized");
+            if (scale != previousScale)
+            {
+                check(!changed || i - lastChange > settings.cooldownFrames, "frame " + std::to_string(i) + ": changed during the cooldown");
+                lastChange = i;
+                changed = true;
+            }
+        }
+    }
+
+    // the trace was recorded from this load model, in closed loop the scale has to settle where the frame time meets the target
+    void testConvergence()
+    {
+        DynamicResolutionController controller;
+        controller.setEnabled(true);
+        const auto& settings = controller.getSettings();
+
+        for (const float pixelCost : { 10.0f, 20.0f, 30.0f, 10.0f })
+        {
+            const auto frameTime = [&](const float scale) { return 3.0f + pixelCost * scale * scale; };
+            for (int i = 0; i < 300; i++)
+                controller.update(frameTime(controller.getScale()));
+
+            const auto scale = controller.getScale();
+            const auto label = "load " + std::to_string(pixelCost) + ": ";
+            check(frameTime(scale) <= settings.targetFrameTime * (1.0f + settings.headroom), label + "settled above the target");
+            check(scale == settings.maxScale || frameTime(scale + settings.scaleStep) > settings.targetFrameTime, label + "settled lower than needed");
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::printf("usage: dynamicresolutiontest <folder with trace.csv>\n");
+        return 2;
+    }
+
+    try
+    {
+        const auto trace = loadTrace(std::filesystem::path(argv[1]) / "trace.csv");
+        check(!trace.empty(), "the trace has frames");
+        testDisabledByDefault();
+        testReplay(trace);
+        testConvergence();
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("FAILED: %s\n", e.what());
+        return 1;
+    }
+
+    std::printf("%s\n", g_failures == 0 ? "all checks passed" : (std::to_string(g_failures) + " checks failed").c_str());
+    return g_failures == 0 ? 0 : 1;
+}